@@ -42,6 +42,7 @@
 # include <global.h>		/* mcpu */
 
 # include "check_exc.h"
+# include "memory.h"	/* cow_fault() */
 
 # ifndef NO_FAKE_SUPER
 
@@ -456,6 +457,119 @@ handle_68060_frame(struct m68k_stack_frames *f __attribute__((unused)))
 	return 0;
 }
 
+# ifdef COW_FORK
+
+/* 68040 writeback status bits */
+# define WBV_040	0x80	/* writeback valid */
+# define WBSIZ_040	0x60	/* writeback size */
+# define WBTT_040	0x18	/* transfer type */
+# define WBTM_SUPER	0x04	/* supervisor access */
+
+# define WBSIZ_LONG	0x00
+# define WBSIZ_BYTE	0x20
+# define WBSIZ_WORD	0x40
+
+/* 68060 fault status long word */
+# define FSLW_RW_READ	0x01000000L	/* RW field 10: read */
+# define FSLW_RW_WRITE	0x00800000L	/* RW field 01: write */
+# define FSLW_WP	0x00000080L	/* write protected page */
+
+/* The 68040 doesn't rerun the writes that were pending
+ * when the access error occurred, we must do them ourself.
+ */
+static long
+do_040writeback(ushort wbs, ulong wba, ulong wbd)
+{
+	/* the write can hit another shared page */
+	cow_fault(curproc, wba);
+
+	switch (wbs & WBSIZ_040)
+	{
+		case WBSIZ_BYTE:
+			*(volatile uchar *)wba = wbd;
+			break;
+		case WBSIZ_WORD:
+			*(volatile ushort *)wba = wbd;
+			break;
+		case WBSIZ_LONG:
+			*(volatile ulong *)wba = wbd;
+			break;
+		default:
+			/* line transfers come from MOVE16 only */
+			return 0;
+	}
+
+	return 1;
+}
+
+/* Writes to a page that a Pfork()'ed process still shares
+ * with its parent or child. The page gets copied and the write
+ * protection is removed; return nonzero to rerun the access.
+ */
+static long
+check_cow(struct m68k_stack_frames *f)
+{
+	ushort frame_format = f->type.zero.format_word & 0xf000;
+
+	if (frame_format == 0xa000 || frame_format == 0xb000)
+	{
+		/* the top of the long frame equals the short frame */
+		struct mc68030_bus_frame_short *frame = &f->type.m68030_sbus;
+
+		/* data write, rerun on RTE */
+		if (frame->ssw.df && !frame->ssw.rw)
+			return cow_fault(curproc, frame->fault_address);
+	}
+	else if (frame_format == 0x7000)
+	{
+		struct mc68040_bus_frame *frame = &f->type.m68040_bus;
+		ulong addr = frame->fault_address;
+		long ok = 1;
+
+		if (!frame->ssw.atc || (frame->ssw.rw && !frame->ssw.lk))
+			return 0;
+
+		/* the access crosses a page boundary */
+		if (frame->ssw.ma)
+		{
+			cow_fault(curproc, addr);
+			addr = (addr + 7) & ~7UL;
+		}
+
+		if (!cow_fault(curproc, addr))
+			return 0;
+
+		if ((frame->wb2s & WBV_040) && !(frame->wb2s & WBTT_040))
+		{
+			ok = do_040writeback(frame->wb2s, (ulong)frame->wb2a, frame->wb2d);
+			if (ok)
+				frame->wb2s = 0;
+		}
+
+		if ((frame->wb3s & WBV_040) && (ok || (frame->wb3s & WBTM_SUPER)))
+		{
+			ok = do_040writeback(frame->wb3s, (ulong)frame->wb3a, frame->wb3d);
+			if (ok)
+				frame->wb3s = 0;
+		}
+
+		return ok;
+	}
+	else if (frame_format == 0x4000)
+	{
+		struct mc68060_bus_frame *frame = &f->type.m68060_bus;
+		ulong fslw = *(ulong *)&frame->bottom;
+
+		/* write protection fault, the instruction is restarted */
+		if ((fslw & FSLW_WP) && !((fslw & (FSLW_RW_READ | FSLW_RW_WRITE)) == FSLW_RW_READ))
+			return cow_fault(curproc, frame->fault_address);
+	}
+
+	return 0;
+}
+
+# endif /* COW_FORK */
+
 /* We use the frame_zero type initially
  * to get access to the frame format word.
  */
@@ -465,6 +579,11 @@ check_bus(struct m68k_stack_frames frame)
 {
 	ushort frame_format = frame.type.zero.format_word & 0xf000;
 
+# ifdef COW_FORK
+	if (check_cow(&frame))
+		return -1L;
+# endif
+
 	/* All this below only applies, when the program
 	 * has called Super() or Supexec() and thinks that
 	 * it is executing in supervisor mode.
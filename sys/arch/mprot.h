@@ -25,6 +25,7 @@ int get_prot_mode (MEMREGION *);
 void mark_region (MEMREGION *region, short mode, short cmode);
 void mark_proc_region (struct memspace *p_mem, MEMREGION *region, short mode, short pid);
 int prot_temp (ulong loc, ulong len, short mode);
+void prot_cow (struct memspace *p_mem, ulong start, ulong len, short readonly);
 void init_page_table (PROC *proc, struct memspace *p_mem); /* XXX */
 void mem_prot_special (PROC *proc);
 void QUICKDUMP (void);
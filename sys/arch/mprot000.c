@@ -65,6 +65,12 @@ prot_temp(ulong loc, ulong len, short mode)
 	return -1;
 }
 
+void
+prot_cow (struct memspace *p_mem, ulong start, ulong len, short readonly)
+{
+	return;
+}
+
 void
 init_page_table (PROC *proc, struct memspace *p_mem)
 {
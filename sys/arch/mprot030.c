@@ -803,6 +803,22 @@ prot_temp(ulong loc, ulong len, short mode)
 	}
 }
 
+/*
+ * prot_cow: write protect (or unprotect) pages of a region the process
+ * owns; used for sharing the pages of a forked process copy-on-write.
+ * Only the write protect bit changes, the page stays accessible.
+ */
+
+void
+prot_cow(struct memspace *p_mem, ulong start, ulong len, short readonly)
+{
+	if (no_mem_prot)
+		return;
+
+	assert(p_mem && p_mem->page_table);
+	mark_pages(p_mem->page_table,start,len,MMU030_DESCR_TYPE_PAGE,0,readonly ? 1 : 0);
+}
+
 #if DEBUG_MMU_TREE
 #include "mmudump030.c"
 #endif
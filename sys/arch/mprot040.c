@@ -1299,6 +1299,40 @@ prot_temp(ulong loc, ulong len, short mode)
 	}
 }
 
+/*
+ * prot_cow: write protect (or unprotect) pages of a region the process
+ * owns; used for sharing the pages of a forked process copy-on-write.
+ * Only the read-only bit of the descriptors changes.
+ */
+
+void
+prot_cow(struct memspace *p_mem, ulong start, ulong len, short readonly)
+{
+	ulong *desc, *first;
+
+	if (no_mem_prot)
+		return;
+
+	assert(p_mem && p_mem->page_table);
+
+	len = ROUND(len);
+	first = desc = get_page_descriptor(p_mem->page_table, start);
+
+	for (; len; desc++)
+	{
+		if (readonly)
+			*desc |= READONLYBIT;
+		else
+			*desc &= ~READONLYBIT;
+
+		len -= pagesize;
+	}
+
+	/* push the modified descriptors before the ATC reloads them */
+	cpush((void *)first, (ulong)desc - (ulong)first);
+	flush_mmu();
+}
+
 /*
  * init_page_table: fill in the page table for the indicated process. The
  * master page map is consulted for the modes of all pages, and the memory
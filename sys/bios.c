@@ -60,6 +60,11 @@
 # define MEDIACH	*((long *) 0x47eL)
 # define GETBPB 	*((long *) 0x472L)
 
+# ifdef COW_FORK
+/* logical sector size of the drives, from their last Getbpb */
+static ushort recsiz [NUM_DRIVES];
+# endif
+
 
 /* tickcal: return milliseconds per system clock tick
  */
@@ -120,6 +125,11 @@ sys_b_getbpb (int dev)
 	 */
 	r.r = callout1 (GETBPB, dev);
 
+# ifdef COW_FORK
+	if (dev >= 0 && dev < NUM_DRIVES)
+		recsiz [dev] = r.r ? r.ptr[0] : 0;
+# endif
+
 	/* There is a bug in the TOS disk handling routines (well, several
 	 * actually). If the directory size of Getbpb() is returned as zero
 	 * then the drive 'dies' and won't read any new disks even with the
@@ -176,31 +186,41 @@ sys_b_rwabs (int rwflag, void *buffer, int number, int recno, int dev, long lrec
 
 	/* only the superuser can make Rwabs calls directly
 	 */
-	if (secure_mode)
+	if (secure_mode && !(p->in_dos || suser (p->p_cred->ucr)))
 	{
-		if (p->in_dos || suser (p->p_cred->ucr))
-		{
-			/* Note that some (most?) Rwabs device drivers don't
-			 * bother saving registers, whereas our compiler
-			 * expects politeness. So we go via callout(), which
-			 * will save registers for us.
-			 */
-			TRACE (("calling RWABS buffer:%p",buffer));
-			r = callout (RWABS, rwflag, buffer, number, recno, dev, lrecno);
-			TRACE (("returning from RWABS"));
-		}
-		else
-		{
-			DEBUG (("RWABS by non privileged process!"));
-			r = EPERM;
-		}
+		DEBUG (("RWABS by non privileged process!"));
+		return EPERM;
 	}
-	else
+
+# ifdef COW_FORK
+	/* the driver may read directly into the buffer (DMA); if that is
+	 * memory the process still shares with its parent or child, copy
+	 * it first.  The sector size is from the last Getbpb (media
+	 * change), without one assume the largest.
+	 */
+	if (!(rwflag & 1) && number > 0)
 	{
-		TRACE (("calling RWABS buffer:%p",buffer));
-		r = callout (RWABS, rwflag, buffer, number, recno, dev, lrecno);
-		TRACE (("returning from RWABS"));
+		MEMREGION *m = proc_addr2region (p, (ulong) buffer);
+
+		if (m && (m->mflags & M_COW))
+		{
+			long secsize = 16384L;
+
+			if (!(rwflag & 8) && dev >= 0 && dev < NUM_DRIVES && recsiz [dev])
+				secsize = recsiz [dev];
+
+			cow_break (p, (ulong) buffer, (long) number * secsize);
+		}
 	}
+# endif
+
+	/* Note that some (most?) Rwabs device drivers don't bother saving
+	 * registers, whereas our compiler expects politeness. So we go via
+	 * callout(), which will save registers for us.
+	 */
+	TRACE (("calling RWABS buffer:%p",buffer));
+	r = callout (RWABS, rwflag, buffer, number, recno, dev, lrecno);
+	TRACE (("returning from RWABS"));
 
 	return r;
 }
@@ -354,6 +374,9 @@ sys_b_setexc (int number, long vector)
 				if (r && get_prot_mode (r) == PROT_P)
 				{
 					DEBUG (("Changing protection to Supervisor because of Setexc"));
+# ifdef COW_FORK
+					cow_unshare (r);
+# endif
 					mark_region (r, PROT_S, 0);
 				}
 			}
@@ -1160,7 +1183,7 @@ _ubconout (int dev, int c)
 	else if (dev == 5)
 	{
 		c &= 0x00ff;
-		f = get_curproc()->p_fd->control;
+		f = FD_CONTROL(get_curproc()->p_fd);
 		if (!f)
 			return 0;
 
@@ -2581,8 +2581,8 @@ set_auxhandle (PROC *p, int dev)
 # if 1
 				/* don't close and reopen the same device again
 				 */
-				if (p->p_fd->aux && p->p_fd->aux->fc.fs == &bios_filesys &&
-				    p->p_fd->aux->fc.index == f->fc.index)
+				if (FD_AUX(p->p_fd) && FD_AUX(p->p_fd)->fc.fs == &bios_filesys &&
+				    FD_AUX(p->p_fd)->fc.index == f->fc.index)
 				{
 					f->links = 0;
 					FP_FREE (f);
@@ -2636,10 +2636,10 @@ found_device:
 		f->links++;
 	}
 
-	if (p->p_fd->aux)
-		do_close (p, p->p_fd->aux);
+	if (FD_AUX(p->p_fd))
+		do_close (p, FD_AUX(p->p_fd));
 
-	p->p_fd->aux = f;
+	FD_AUX(p->p_fd) = f;
 
 	return 1;
 }
@@ -166,10 +166,15 @@
 
 # include "libkern/libkern.h"
 
+# include "arch/timer.h"	/* jiffies */
+
 # include "bios.h"
 # include "info.h"
 # include "k_prot.h"
+# include "k_semaphore.h"
+# include "k_workq.h"
 # include "kmemory.h"
+# include "ktrace.h"
 # include "pun.h"
 # include "proc.h"
 # include "random.h"
@@ -184,6 +189,7 @@
 # define DEFAULT_PERC	5UL		/* 5% */
 
 # define WB_BUFFER	(1024UL * 64)	/* 64 kb writeback buffer (static) */
+# define WB_DIRTY	4		/* background writeback when more than 1/4 of the cache is dirty */
 
 # define HASHBITS	8		/* size of UNIT hashtable */
 # define HASHSIZE	(1UL << HASHBITS)
@@ -347,6 +353,10 @@ INLINE UNIT *	bio_wbq_getfirst	(register UNIT **queue);
 INLINE long	bio_wb_unit		(register UNIT *u);
 static void	bio_wb_queue		(DI *di);
 
+/* background writeback, run by a worker thread */
+static void _cdecl bio_wb_func		(struct work *w);
+static struct work wb_work;
+
 
 /* cache unit management functions */
 
@@ -704,6 +714,7 @@ bio_hash_remove (register UNIT *u)
 INLINE long
 bio_readin (DI *di, void *buffer, ulong size, ulong sector)
 {
+	ulong start = jiffies;
 	register long r;
 
 /* NASTY HACK, FIXME */
@@ -712,6 +723,7 @@ bio_readin (DI *di, void *buffer, ulong size, ulong sector)
 	else
 #endif
 	r = BIO_RWABS (di, 0, buffer, size, sector);
+	KTRACE (KTC_BIO, KT_BIO, di->drv << 1, sector, size, jiffies - start);
 	if (r)
 	{
 		BIO_ALERT (("block_IO [%c]: bio_readin: RWABS fail (%li))", di->drv+'A', r));
@@ -735,6 +747,7 @@ INLINE long
 bio_writeout (DI *di, const void *buffer, ulong size, ulong sector)
 {
 	union { const void *cvb; void *b;} ptr = {buffer};	// ptr.cvb = buffer;
+	ulong start = jiffies;
 	register long r;
 
 /* NASTY HACK, FIXME */
@@ -743,6 +756,7 @@ bio_writeout (DI *di, const void *buffer, ulong size, ulong sector)
 	else
 #endif
 	r = BIO_RWABS (di, 1, ptr.b, size, sector);
+	KTRACE (KTC_BIO, KT_BIO, di->drv << 1 | 1, sector, size, jiffies - start);
 	if (r)
 	{
 		BIO_ALERT (("block_IO [%c]: bio_writeout: RWABS fail (ignored, %li))", di->drv+'A', r));
@@ -813,6 +827,9 @@ bio_unit_wait (register UNIT *u)
 /****************************************************************************/
 /* BEGIN writeback queue functions */
 
+/* bytes in all writeback queues */
+static ulong wb_dirty;
+
 /*
  * ATTENTION: must be executed atomic!
  *
@@ -828,6 +845,7 @@ bio_wbq_insert (register UNIT *u)
 
 		u->dirty = 1;
 		u->di->lock++;
+		wb_dirty += u->size;
 
 		if (queue)
 		{
@@ -898,6 +916,7 @@ bio_wbq_remove (register UNIT *u)
 		u->dirty = 0;
 
 		u->di->lock--;
+		wb_dirty -= u->size;
 	}
 }
 
@@ -923,6 +942,7 @@ bio_wbq_getfirst (register UNIT **queue)
 		u->dirty = 0;
 
 		u->di->lock--;
+		wb_dirty -= u->size;
 	}
 
 	return u;
@@ -961,29 +981,12 @@ bio_wb_unit (register UNIT *u)
 static char _buffer [WB_BUFFER + 16];
 static char *buffer;
 
-static long buffer_locked = 0;
-static long buffer_sleepers = 0;
-
-static void
-buffer_lock (void)
-{
-	while (buffer_locked)
-	{
-		buffer_sleepers++;
-		sleep (IO_Q, (long) &buffer_locked);
-		buffer_sleepers--;
-	}
+/* only one writer can use it, so a release wakes only the next one */
+static struct sema buffer_sema;
+static struct lockstat buffer_stat;
 
-	buffer_locked = 1;
-}
-
-static void
-buffer_unlock (void)
-{
-	buffer_locked = 0;
-	if (buffer_sleepers)
-		wake (IO_Q, (long) &buffer_locked);
-}
+# define buffer_lock()		sema_lock (&buffer_sema)
+# define buffer_unlock()	sema_unlock (&buffer_sema)
 
 /*
  * writeback a complete queue
@@ -1331,6 +1334,8 @@ init_block_IO (void)
 
 	/* set up aligned buffer */
 	buffer = (char *) (((long) _buffer + 15) & ~15);
+	sema_init_stat (&buffer_sema, &buffer_stat, "bio buffer");
+	work_init (&wb_work, "bio writeback", bio_wb_func, 0);
 
 	/* initalize SCSIDRV interface */
 	scsidrv_init ();
@@ -2338,6 +2343,12 @@ bio_mark_modified (UNIT *u)
 
 	bio_wbq_insert (u);
 
+	/* write back in the background before cache units have to be
+	 * written back synchronously to get reused
+	 */
+	if (wb_dirty > (cache.count * cache.max_size) / WB_DIRTY)
+		queue_work (&wb_work);
+
 	BIO_DEBUG (("bio_mark_modified: sector = %lu, drv = %u", u->sector, u->di->drv));
 }
 
@@ -2383,6 +2394,14 @@ bio_sync_all (void)
 	BIO_DEBUG (("bio_sync_all: all wb_queues flushed."));
 }
 
+static void _cdecl
+bio_wb_func (struct work *w)
+{
+	UNUSED (w);
+	
+	bio_sync_all ();
+}
+
 /* END update functions */
 /****************************************************************************/
 
@@ -2443,6 +2462,7 @@ restart:
 			{
 				/* never writeback */
 				u->dirty = 0;
+				wb_dirty -= u->size;
 
 				/* inform user */
 				BIO_DEBUG (("block_IO [%c]: bio_invalidate: cache unit not written back (%li, %li)!", di->drv+'A', u->sector, u->size));
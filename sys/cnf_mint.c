@@ -37,6 +37,7 @@
 # include "dosdir.h"
 # include "dosfile.h"
 # include "dosmem.h"
+# include "execcache.h"
 # include "fatfs.h"
 # include "filesys.h"
 # include "info.h"		/* messages */
@@ -47,6 +48,7 @@
 # include "keyboard.h"
 # include "kmemory.h"
 # include "memory.h"
+# include "pcache.h"
 # include "proc.h"
 # include "update.h"
 # include "xbios.h"
@@ -136,6 +138,7 @@ static PCB_TTx	pCB_setenv;		/* setenv name val	*/
  * GEMDOS_PRN=file .............. specify initial file for handle 3
  * FS_CACHE_SIZE=n .............. set buffer cache to size in kb
  * FS_CACHE_PERCENTAGE=n ........ set max. percentage of cache to fill with linear reads
+ * FS_PAGECACHE=n ............... set file data page cache to size in kb
  * FS_WB_ENABLE=<drives> ........ enable write back mode for specified drives
  * FS_WRITE_PROTECT=<drives> .... enable software write protection for specified drives
  * FS_UPDATE=n .................. set sync time in seconds for the system update daemon
@@ -148,7 +151,9 @@ static PCB_TTx	pCB_setenv;		/* setenv name val	*/
  * KERN_MPFLAGS=bitvector ....... set flags for mem protection, bit 0: strict mode on/off
  * KERN_SECURITY_LEVEL=n ........ enables the appropriate security level, range 0-2
  * KERN_SLICES=n ................ set multitasking granularity
+ * PROC_COWFORK=[yn] ............ share forked memory copy-on-write (MMU kernels)
  * PROC_MAXMEM=n ................ set memory maximum per process
+ * TPA_EXECCACHE=n .............. set executable image cache to size in kb
  * TPA_FASTLOAD=[yn] ............ force FASTLOAD for all programs, if YES
  * TPA_INITIALMEM=n ............. set maximum additional TPA size for new processes
  * FDC_HIDE_B=[yn] .............. really remove drive B
@@ -203,6 +208,7 @@ static struct parser_item parser_tab[] =
 	{ "GEMDOS_PRN",			PI_V_T,	pCB_prn				},
 	{ "FS_CACHE_SIZE",		PI_V_L,	bio_set_cache_size		},
 	{ "FS_CACHE_PERCENTAGE",	PI_V_L,	bio_set_percentage		},
+	{ "FS_PAGECACHE",		PI_V_L,	pc_set_cache_size		},
 	{ "FS_UPDATE",			PI_R_L,	& sync_time			},
 	{ "FS_VFAT",			PI_V_D,	pCB_vfat			},
 	{ "FS_VFAT_LCASE",		PI_V_B,	pCB_vfatlcase			},
@@ -217,7 +223,11 @@ static struct parser_item parser_tab[] =
 # endif
 	{ "KERN_SECURITY_LEVEL",	PI_V_L,	pCL_securelevel, Range(0, 2)	},
 	{ "KERN_SLICES",		PI_R_S,	& time_slice			},
+# ifdef COW_FORK
+	{ "PROC_COWFORK",		PI_R_B,	& cow_fork			},
+# endif
 	{ "PROC_MAXMEM",		PI_V_L,	pCB_maxmem			},
+	{ "TPA_EXECCACHE",		PI_V_L,	exec_cache_set_size		},
 	{ "TPA_FASTLOAD",		PI_R_B,	& forcefastload			},
 	{ "TPA_INITIALMEM",		PI_R_L,	& initialmem			},
 	{ "ALLOW_SETEXC",	PI_R_B,	& allow_setexc },
@@ -337,8 +347,8 @@ pCB_aux(char *path)
 	if (!ret)
 	{
 		do_close(get_curproc(), get_curproc()->p_fd->ofiles[2]);
-		do_close(get_curproc(), get_curproc()->p_fd->aux);
-		get_curproc()->p_fd->aux = get_curproc()->p_fd->ofiles[2] = fp;
+		do_close(get_curproc(), FD_AUX(get_curproc()->p_fd));
+		FD_AUX(get_curproc()->p_fd) = get_curproc()->p_fd->ofiles[2] = fp;
 		fp->links++;
 		if (is_terminal(fp) && fp->fc.fs == &bios_filesys &&
 		    fp->dev == &bios_tdevice &&
@@ -542,9 +552,9 @@ pCB_prn(char *path)
 	if (!ret)
 	{
 		do_close(get_curproc(), get_curproc()->p_fd->ofiles[3]);
-		do_close(get_curproc(), get_curproc()->p_fd->prn);
+		do_close(get_curproc(), FD_PRN(get_curproc()->p_fd));
 
-		get_curproc()->p_fd->prn =
+		FD_PRN(get_curproc()->p_fd) =
 		get_curproc()->p_fd->ofiles[3] = fp;
 
 		fp->links++;
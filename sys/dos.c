@@ -581,7 +581,7 @@ sys_s_ysconf (int which)
 		case -1:	return 9;
 		case  0:	return UNLIMITED;
 		case  1:	return 32767; /* matches ARG_MAX */
-		case  2:	return NDFILE;
+		case  2:	return NOFILE;
 		case  3:	return NGROUPS_MAX;
 		case  4:	return UNLIMITED;
 		case  5:	return HZ;
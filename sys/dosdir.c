@@ -543,6 +543,62 @@ sys_f_getdta (void)
 	return r;
 }
 
+/*
+ * per slot state of a wildcard Fsfirst/Fsnext search; the compiled
+ * pattern lets Fsnext sort out names without converting them to 8.3
+ * form, and on filesystems with readdirs the entries are fetched in
+ * batches together with their attributes
+ */
+struct srchx
+{
+	struct pat83 pat;		/* compiled dta_pat */
+	short	pos;			/* next record in batch */
+	short	fill;			/* bytes used in batch */
+	char	*batch;			/* struct dgdent records or NULL */
+};
+
+# define SRCH_BATCH	1024
+
+static void
+srch_setpat (struct srchx *sx, const char *pat)
+{
+	pat_compile (&sx->pat, pat);
+}
+
+static struct srchx *
+srch_alloc (FILESYS *fs, const char *pat)
+{
+	struct srchx *sx;
+	long size = sizeof (*sx);
+
+	if (fs->fsflags & FS_EXT_4)
+		size += SRCH_BATCH;
+
+	sx = kmalloc (size);
+	if (sx)
+	{
+		srch_setpat (sx, pat);
+		sx->pos = sx->fill = 0;
+		sx->batch = (fs->fsflags & FS_EXT_4) ? (char *)(sx + 1) : NULL;
+	}
+
+	return sx;
+}
+
+/*
+ * release the search state of Fsfirst/Fsnext slot i; the directory
+ * itself is closed by the caller
+ */
+void
+srch_free (struct filedesc *fd, int i)
+{
+	if (fd->srchx[i])
+	{
+		kfree (fd->srchx[i]);
+		fd->srchx[i] = NULL;
+	}
+}
+
 /*
  * Fsfirst/next are actually implemented in terms of opendir/readdir/closedir.
  */
@@ -629,6 +685,7 @@ sys_f_sfirst (const char *path, int attrib)
 				release_cookie(&dirh->fc);
 				dirh->fc.fs = 0;
 			}
+			srch_free (p->p_fd, i);
 			p->p_fd->srchdta[i] = 0; /* slot is now free */
 		}
 	}
@@ -732,6 +789,7 @@ sys_f_sfirst (const char *path, int attrib)
 			release_cookie(&dirh->fc);
 			dirh->fc.fs = 0;
 		}
+		srch_free (p->p_fd, i);
 
 		/* invalidate re-used DTA */
 		p->p_fd->srchdta[i]->magic = EVALID;
@@ -763,8 +821,11 @@ sys_f_sfirst (const char *path, int attrib)
 		return r;
 	}
 
-	/* mark the slot as in-use */
+	/* mark the slot as in-use; without the search state
+	 * Fsnext just does it the slow way
+	 */
 	p->p_fd->srchdta[i] = dta;
+	p->p_fd->srchx[i] = srch_alloc (dir.fs, dta->dta_pat);
 
 	/* set up the DTA for Fsnext */
 	dta->index = i;
@@ -810,8 +871,10 @@ sys_f_snext (void)
 	fcookie fc;
 	ushort i;
 	DIR *dirh;
+	struct srchx *sx;
 	long r;
 	XATTR xattr;
+	int local;
 
 
 	TRACE (("Fsnext"));
@@ -846,10 +909,81 @@ sys_f_snext (void)
 		return EINTERNAL;
 	}
 
+	/* the program may have changed the pattern in the DTA */
+	sx = p->p_fd->srchx[i];
+	if (sx && strncmp (sx->pat.tmpl, dta->dta_pat, TOS_NAMELEN))
+		srch_setpat (sx, dta->dta_pat);
+
 	/* BUG: f_snext and readdir should check for disk media changes
 	 */
 	for(;;)
 	{
+		if (sx && sx->batch)
+		{
+			struct dgdent *d;
+			char *name;
+
+			if (sx->pos >= sx->fill)
+			{
+				r = xfs_readdirs (fs, dirh, sx->batch, SRCH_BATCH, 0, sx->pat.prefix);
+				if (r == ENOSYS)
+				{
+					sx->batch = NULL;
+					continue;
+				}
+
+				if (r == 0)
+					r = ENMFILES;
+
+				if (r < 0)
+					goto baderror;
+
+				sx->fill = r;
+				sx->pos = 0;
+			}
+
+			d = (struct dgdent *)(sx->batch + sx->pos);
+			sx->pos += d->reclen;
+			name = (char *)(d + 1) + sizeof (XATTR);
+
+			if (d->namlen > TOS_NAMELEN)
+				continue;	/* TOS programs never see these names */
+
+			if (!pat_match83 (&sx->pat, name))
+				continue;	/* different patterns */
+
+			r = d->xret;
+			if (r)
+			{
+				DEBUG(("Fsnext: couldn't get file attributes"));
+				goto baderror;
+			}
+
+			/* readdirs did the local time conversion */
+			memcpy (&xattr, d + 1, sizeof (xattr));
+			local = 1;
+
+			strcpy (buf, name);
+
+			if (S_ISLNK(xattr.mode))
+			{
+				r = relpath2cookie (p, &dirh->fc, name,
+					follow_links, &fc, 0);
+				if (r == E_OK)
+				{
+					r = xfs_getxattr (fc.fs, &fc, &xattr);
+					release_cookie (&fc);
+					if (r == E_OK)
+						local = 0;
+				}
+				if (r)
+					DEBUG(("Fsnext: couldn't follow link: error %ld", r));
+			}
+
+			goto attrib;
+		}
+
+		local = 0;
 		r = xfs_readdir (fs, dirh, buf, TOS_NAMELEN+1, &fc);
 
 		if (r == EBADARG)
@@ -865,6 +999,7 @@ baderror:
 				(void) xfs_closedir (fs, dirh);
 			release_cookie(&dirh->fc);
 			dirh->fc.fs = 0;
+			srch_free (p->p_fd, i);
 			p->p_fd->srchdta[i] = 0;
 			dta->magic = EVALID;
 			if (r != ENMFILES)
@@ -872,7 +1007,7 @@ baderror:
 			return r;
 		}
 
-		if (!pat_match (buf, dta->dta_pat))
+		if (sx ? !pat_match83 (&sx->pat, buf) : !pat_match (buf, dta->dta_pat))
 		{
 			release_cookie (&fc);
 			continue;	/* different patterns */
@@ -910,6 +1045,7 @@ baderror:
 		else
 			release_cookie (&fc);
 
+attrib:
 		/* silly TOS rules for matching attributes */
 		if (xattr.attr == 0)
 			break;
@@ -924,7 +1060,7 @@ baderror:
 	/* here, we have a match
 	 */
 
-	if (fs->fsflags & FS_EXT_3)
+	if (!local && (fs->fsflags & FS_EXT_3))
 	{
 		dta_UTC_local_dos(dta,xattr,m);
 	}
@@ -1368,6 +1504,148 @@ sys_d_xreaddir (int len, long handle, char *buf, XATTR *xattr, long *xret)
 	return r;
 }
 
+/*
+ * store one Dgetdents() record for the entry name/fc at buf; index is
+ * what Dreaddir() puts in front of the name if the directory wasn't
+ * opened in TOS mode; returns the record length or 0 if it needs more
+ * than len bytes
+ *
+ * filesystems implementing readdirs may use this too, with infs set
+ * the attributes are fetched without going through the xfs locking and
+ * the times are left for xfs_readdirs to convert
+ */
+long
+dgdent_put (char *buf, long len, DIR *dirh, int flags, long index, const char *name, fcookie *fc, int infs)
+{
+	struct dgdent *d = (struct dgdent *) buf;
+	FILESYS *fs = fc->fs;
+	long asize = (flags & DGD_STAT) ? sizeof (STAT) : sizeof (XATTR);
+	long ilen = (dirh->flags & TOS_SEARCH) ? 0 : sizeof (long);
+	long namlen = strlen (name);
+	long reclen;
+	char *nm;
+
+	reclen = (sizeof (*d) + asize + ilen + namlen + 2) & ~1L;
+	if (reclen > len)
+		return 0;
+
+	if (flags & DGD_STAT)
+	{
+		STAT *st = (STAT *)(d + 1);
+
+		if (!infs)
+			d->xret = xfs_stat64 (fs, fc, st);
+		else if (fs->fsflags & FS_EXT_3)
+			d->xret = (*fs->stat64)(fc, st);
+		else
+			d->xret = getstat64 (fs, fc, st);
+	}
+	else
+	{
+		XATTR *xattr = (XATTR *)(d + 1);
+
+		if (!infs)
+			d->xret = xfs_getxattr (fs, fc, xattr);
+		else if (fs->getxattr)
+			d->xret = (*fs->getxattr)(fc, xattr);
+		else
+			d->xret = getxattr (fs, fc, xattr);
+
+		if (!infs && (d->xret == E_OK) && (fs->fsflags & FS_EXT_3))
+		{
+			xtime_to_local_dos(xattr, m);
+			xtime_to_local_dos(xattr, a);
+			xtime_to_local_dos(xattr, c);
+		}
+	}
+
+	nm = (char *)(d + 1) + asize;
+	if (ilen)
+	{
+		memcpy (nm, &index, ilen);
+		nm += ilen;
+	}
+	strcpy (nm, name);
+
+	d->reclen = reclen;
+	d->namlen = namlen;
+
+	return reclen;
+}
+
+/* room for the longest name readdir may return, plus the index
+ */
+# define DGD_NAMEMAX	(256 + sizeof (long))
+
+/*
+ * GEMDOS extension: Dgetdents(handle, buf, len, flags)
+ *
+ * like Dxreaddir, but stores as many entries as fit into buf as a
+ * sequence of struct dgdent records; returns the number of bytes used,
+ * 0 at the end of the directory
+ */
+long _cdecl
+sys_d_getdents (long handle, char *buf, long len, int flags)
+{
+	struct proc *p = get_curproc();
+	DIR *dirh = (DIR *) handle;
+	DIR **where;
+	long asize, done, r;
+
+	where = &p->p_fd->searches;
+	while (*where && *where != dirh)
+		where = &((*where)->next);
+
+	if (!*where)
+	{
+		DEBUG(("Dgetdents: not an open directory"));
+		return EBADF;
+	}
+
+	if (!dirh->fc.fs)
+		return EBADF;
+
+	flags &= DGD_STAT;
+
+	/* the filesystem may produce the records itself */
+	r = xfs_readdirs (dirh->fc.fs, dirh, buf, len, flags, NULL);
+	if (r != ENOSYS)
+		return r;
+
+	asize = (flags & DGD_STAT) ? sizeof (STAT) : sizeof (XATTR);
+	if (len < sizeof (struct dgdent) + asize + DGD_NAMEMAX + 2)
+		return EBADARG;
+
+	/* readdir consumes an entry even if the name doesn't fit, so
+	 * only go on while the longest possible record has room
+	 */
+	for (done = 0; len - done >= sizeof (struct dgdent) + asize + DGD_NAMEMAX + 2; )
+	{
+		char name[DGD_NAMEMAX];
+		long index = 0;
+		fcookie fc;
+
+		r = xfs_readdir (dirh->fc.fs, dirh, name, sizeof (name), &fc);
+		if (r != E_OK)
+		{
+			if (r == ENMFILES || done)
+				break;
+
+			return r;
+		}
+
+		if (!(dirh->flags & TOS_SEARCH))
+			memcpy (&index, name, sizeof (long));
+
+		done += dgdent_put (buf + done, len - done, dirh, flags, index,
+				    (dirh->flags & TOS_SEARCH) ? name : name + sizeof (long), &fc, 0);
+
+		release_cookie (&fc);
+	}
+
+	return done;
+}
+
 
 long _cdecl
 sys_d_rewind (long handle)
@@ -9,6 +9,7 @@
 # include "mint/mint.h"
 # include "mint/file.h"
 
+struct filedesc;
 struct proc;
 
 /* table of processes holding locks on drives */
@@ -28,6 +29,7 @@ long _cdecl sys_f_setdta	(DTABUF *dta);
 long _cdecl sys_f_getdta	(void);
 long _cdecl sys_f_sfirst	(const char *path, int attrib);
 long _cdecl sys_f_snext		(void);
+void        srch_free		(struct filedesc *fd, int i);
 long _cdecl sys_f_attrib	(const char *name, int rwflag, int attr);
 long _cdecl sys_f_delete	(const char *name);
 long _cdecl sys_f_rename	(int junk, const char *old, const char *new);
@@ -35,6 +37,8 @@ long _cdecl sys_d_pathconf	(const char *name, int which);
 long _cdecl sys_d_opendir	(const char *path, int flags);
 long _cdecl sys_d_readdir	(int len, long handle, char *buf);
 long _cdecl sys_d_xreaddir	(int len, long handle, char *buf, XATTR *xattr, long *xret);
+long _cdecl sys_d_getdents	(long handle, char *buf, long len, int flags);
+long dgdent_put (char *buf, long len, DIR *dirh, int flags, long index, const char *name, fcookie *fc, int infs);
 long _cdecl sys_d_rewind	(long handle);
 long _cdecl sys_d_closedir	(long handle);
 long _cdecl sys_f_xattr		(int flag, const char *name, XATTR *xattr);
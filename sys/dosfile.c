@@ -252,6 +252,10 @@ sys_f_read (short fd, long count, char *buf)
 		return tty_read (f, buf, count);
 
 	TRACELOW (("Fread: %ld bytes from handle %d to %p", count, fd, buf));
+# ifdef COW_FORK
+	/* block devices may transfer directly into the buffer */
+	cow_break (p, (ulong) buf, count);
+# endif
 	return xdd_read (f, buf, count);
 }
 
@@ -350,16 +354,20 @@ sys_f_force (short newfd, short oldfd)
 	ret = GETFILEPTR (&p, &oldfd, &fp);
 	if (ret) return ret;
 
-	if (newfd < MIN_HANDLE || newfd >= p->p_fd->nfiles)
+	if (newfd < MIN_HANDLE || newfd >= NOFILE)
 	{
 		DEBUG (("Fforce: new handle out of range"));
 		return EBADF;
 	}
 
+	ret = fd_extend (p->p_fd, newfd);
+	if (ret) return ret;
+
 	do_close (p, p->p_fd->ofiles[newfd]);
 
 	p->p_fd->ofiles[newfd] = fp;
 	p->p_fd->ofileflags[newfd] = 0;
+	fd_mark (p->p_fd, newfd);
 
 	fp->links++;
 
@@ -986,11 +994,11 @@ sys_f_midipipe (short pid, short in, short out)
 	fin->links++;
 	fout->links++;
 
-	do_close (p, p->p_fd->midiin);
-	do_close (p, p->p_fd->midiout);
+	do_close (p, FD_MIDIIN(p->p_fd));
+	do_close (p, FD_MIDIOUT(p->p_fd));
 
-	p->p_fd->midiin = fin;
-	p->p_fd->midiout = fout;
+	FD_MIDIIN(p->p_fd) = fin;
+	FD_MIDIOUT(p->p_fd) = fout;
 
 	return E_OK;
 }
@@ -1171,7 +1179,7 @@ sys_f_poll (POLLFD *fds, ulong nfds, ulong timeout)
 # define LEGAL_INPUT_FLAGS \
 	(POLLIN | POLLPRI | POLLOUT | POLLRDNORM | POLLWRNORM | POLLRDBAND | POLLWRBAND)
 		if (((fds[i].events | LEGAL_INPUT_FLAGS) != LEGAL_INPUT_FLAGS) ||
-		   fds[i].fd >= NDFILE || 
+		   fds[i].fd >= p->p_fd->nfiles || 
 		   !p->p_fd->ofiles[fds[i].fd]) {
 			fds[i].revents |= POLLNVAL;
 		} else {
@@ -0,0 +1,328 @@
+/*
+ * This file belongs to FreeMiNT. It's not in the original MiNT 1.12
+ * distribution. See the file CHANGES for a detailed log of changes.
+ *
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This file is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *
+ * Executable image cache.
+ *
+ * load_region() keeps the text and data of recently loaded programs
+ * together with the decoded relocation table, keyed by the device,
+ * index, size and modification time of the file. When the same program
+ * is started again, the image is copied from here and relocated from
+ * the table; neither the program file nor its relocation stream have
+ * to be read again.
+ *
+ * load_region() lays out text, data and bss contiguously, so every
+ * fixup simply adds the text base; the image is kept unrelocated.
+ *
+ */
+
+# include "execcache.h"
+
+# include "libkern/libkern.h"
+# include "arch/cpu.h"		/* cpushi */
+
+# include "kmemory.h"
+
+
+struct exec_image
+{
+	struct exec_image *next;	/* most recently used first */
+
+	short	links;			/* load_region()s using the image */
+	short	stale;			/* free on the last release */
+
+	/* key */
+	ushort	dev;
+	ushort	mtime, mdate;
+	long	index;
+	long	size;
+
+	FILEHEAD fh;
+
+	long	nfix;			/* relocation table */
+	ulong	*fix;
+
+	long	len;			/* text + data */
+	char	*image;
+
+	long	memsize;		/* all of the above */
+};
+
+/* cache size in bytes, TPA_EXECCACHE in mint.cnf */
+long exec_cache_max = 256 * 1024L;
+
+static struct exec_image *images;
+static long exec_cache_used;
+
+/* statistics for /kern/execcache */
+static ulong exec_hits;
+static ulong exec_misses;
+
+
+static void
+image_free (struct exec_image *img)
+{
+	exec_cache_used -= img->memsize;
+	kfree (img);
+}
+
+static void
+image_unlink (struct exec_image *img)
+{
+	struct exec_image **list;
+
+	for (list = &images; *list; list = &(*list)->next)
+	{
+		if (*list == img)
+		{
+			*list = img->next;
+			break;
+		}
+	}
+
+	if (img->links)
+		img->stale = 1;
+	else
+		image_free (img);
+}
+
+/*
+ * exec_cache_get(xa, fh): look up the image of the file with the
+ * attributes xa; on a hit, the file header is returned in fh and the
+ * image is referenced until exec_cache_put()
+ */
+struct exec_image *
+exec_cache_get (const XATTR *xa, FILEHEAD *fh)
+{
+	struct exec_image *img, **list;
+
+	/* no stable file identity */
+	if (!xa->index)
+		return NULL;
+
+	for (list = &images; (img = *list); list = &img->next)
+	{
+		if (img->index != xa->index || img->dev != xa->dev)
+			continue;
+
+		if (img->size != xa->size || img->mtime != xa->mtime || img->mdate != xa->mdate)
+		{
+			/* the file was changed */
+			image_unlink (img);
+			break;
+		}
+
+		/* move to the front */
+		*list = img->next;
+		img->next = images;
+		images = img;
+
+		img->links++;
+		*fh = img->fh;
+
+		exec_hits++;
+		return img;
+	}
+
+	exec_misses++;
+	return NULL;
+}
+
+void
+exec_cache_put (struct exec_image *img)
+{
+	if (--img->links == 0 && img->stale)
+		image_free (img);
+}
+
+/*
+ * exec_cache_load(img, where, b): copy the image to where and relocate
+ * it for the basepage b
+ */
+void
+exec_cache_load (struct exec_image *img, char *where, BASEPAGE *b)
+{
+	ulong *fix = img->fix;
+	long n;
+
+	quickmove (where, img->image, img->len);
+
+	for (n = img->nfix; n > 0; n--)
+		*(long *)(where + *fix++) += b->p_tbase;
+
+	cpushi ((void *) b->p_tbase, b->p_tlen);
+}
+
+/*
+ * exec_cache_enter(xa, fh, where, b, fix): remember the image just
+ * loaded and relocated by load_and_reloc() at where; the relocation
+ * table in fix is taken over
+ */
+void
+exec_cache_enter (const XATTR *xa, const FILEHEAD *fh, const char *where, BASEPAGE *b, struct exec_fixups *fix)
+{
+	struct exec_image *img, **list;
+	long len = fh->ftext + fh->fdata;
+	long memsize;
+	long n;
+
+	if (fix->n < 0 || !xa->index || !exec_cache_max)
+		goto out;
+
+	memsize = sizeof (*img) + len + fix->n * sizeof (ulong);
+	if (memsize > exec_cache_max / 2)
+		goto out;
+
+	/* make room, the least recently used images go first */
+	while (exec_cache_used + memsize > exec_cache_max)
+	{
+		for (list = &images; *list && (*list)->next; list = &(*list)->next)
+			;
+
+		if (!*list)
+			goto out;
+
+		image_unlink (*list);
+	}
+
+	img = kmalloc (memsize);
+	if (!img)
+		goto out;
+
+	img->links = 0;
+	img->stale = 0;
+
+	img->dev = xa->dev;
+	img->mtime = xa->mtime;
+	img->mdate = xa->mdate;
+	img->index = xa->index;
+	img->size = xa->size;
+
+	img->fh = *fh;
+
+	img->len = len;
+	img->image = (char *)(img + 1);
+
+	img->nfix = fix->n;
+	img->fix = (ulong *)(img->image + len);
+
+	img->memsize = memsize;
+
+	quickmove (img->image, where, len);
+	if (fix->n)
+		quickmove (img->fix, fix->off, fix->n * sizeof (ulong));
+
+	/* undo the relocation, backwards in case the fixups overlap */
+	for (n = img->nfix; n > 0; n--)
+		*(long *)(img->image + img->fix[n - 1]) -= b->p_tbase;
+
+	img->next = images;
+	images = img;
+	exec_cache_used += memsize;
+
+out:
+	exec_fixup_free (fix);
+}
+
+void
+exec_fixup_add (struct exec_fixups *fix, ulong off)
+{
+	if (fix->n < 0)
+		return;
+
+	if (fix->n == fix->max)
+	{
+		long max = fix->max ? fix->max * 2 : 256;
+		ulong *off = kmalloc (max * sizeof (ulong));
+
+		if (!off)
+		{
+			exec_fixup_free (fix);
+			fix->n = -1;
+			return;
+		}
+
+		if (fix->off)
+		{
+			quickmove (off, fix->off, fix->n * sizeof (ulong));
+			kfree (fix->off);
+		}
+
+		fix->off = off;
+		fix->max = max;
+	}
+
+	fix->off[fix->n++] = off;
+}
+
+void
+exec_fixup_free (struct exec_fixups *fix)
+{
+	if (fix->off)
+		kfree (fix->off);
+
+	fix->off = NULL;
+	fix->max = 0;
+}
+
+long
+exec_cache_set_size (long size)
+{
+	if (size < 0)
+		return exec_cache_max / 1024L;
+
+	exec_cache_max = size * 1024L;
+
+	while (images && exec_cache_used > exec_cache_max)
+	{
+		struct exec_image *img = images;
+
+		while (img->next)
+			img = img->next;
+
+		image_unlink (img);
+	}
+
+	return E_OK;
+}
+
+long
+exec_cache_dump (char *buf, long len)
+{
+	struct exec_image *img;
+	char *crs = buf;
+	long i;
+
+	i = ksprintf (crs, len,
+		      "hits:\t\t%lu\nmisses:\t\t%lu\nused:\t\t%ld kB\nlimit:\t\t%ld kB\n\n"
+		      "dev     index       size fixups links\n",
+		      exec_hits, exec_misses,
+		      exec_cache_used / 1024L, exec_cache_max / 1024L);
+	crs += i; len -= i;
+
+	for (img = images; img && len > 48; img = img->next)
+	{
+		i = ksprintf (crs, len, "%3u %9ld %10ld %6ld %5d\n",
+			      (unsigned) img->dev, img->index, img->size,
+			      img->nfix, img->links);
+		crs += i; len -= i;
+	}
+
+	return crs - buf;
+}
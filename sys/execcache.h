@@ -0,0 +1,55 @@
+/*
+ * This file belongs to FreeMiNT. It's not in the original MiNT 1.12
+ * distribution. See the file CHANGES for a detailed log of changes.
+ *
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This file is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+# ifndef _execcache_h
+# define _execcache_h
+
+# include "mint/mint.h"
+# include "mint/basepage.h"
+# include "mint/mem.h"
+# include "mint/stat.h"
+
+
+struct exec_image;
+
+/* relocation offsets collected by load_and_reloc() */
+struct exec_fixups
+{
+	ulong	*off;		/* offsets into the program image */
+	long	n;		/* used entries, < 0 if out of memory */
+	long	max;		/* allocated entries */
+};
+
+extern long exec_cache_max;
+
+struct exec_image *exec_cache_get (const XATTR *xa, FILEHEAD *fh);
+void	exec_cache_put (struct exec_image *img);
+void	exec_cache_load (struct exec_image *img, char *where, BASEPAGE *b);
+void	exec_cache_enter (const XATTR *xa, const FILEHEAD *fh, const char *where, BASEPAGE *b, struct exec_fixups *fix);
+
+void	exec_fixup_add (struct exec_fixups *fix, ulong off);
+void	exec_fixup_free (struct exec_fixups *fix);
+
+long	exec_cache_set_size (long size);
+long	exec_cache_dump (char *buf, long len);
+
+
+# endif /* _execcache_h */
@@ -364,11 +364,13 @@
 
 # include "block_IO.h"
 # include "dev-null.h"
+# include "dosdir.h"
 # include "filesys.h"
 # include "init.h"
 # include "kerinfo.h"
 # include "kmemory.h"
 # include "nullfs.h"
+# include "pcache.h"
 # include "proc.h"
 # include "time.h"
 # include "unicode.h"
@@ -557,6 +559,7 @@ static long	_cdecl fatfs_rename	(fcookie *olddir, char *oldname, fcookie *newdir
 
 static long	_cdecl fatfs_opendir	(DIR *dirh, int flags);
 static long	_cdecl fatfs_readdir	(DIR *dirh, char *nm, int nmlen, fcookie *);
+static long	_cdecl fatfs_readdirs	(DIR *dirh, char *buf, long len, int flags, const char *prefix);
 static long	_cdecl fatfs_rewinddir	(DIR *dirh);
 static long	_cdecl fatfs_closedir	(DIR *dirh);
 
@@ -594,6 +597,7 @@ FILESYS fatfs_filesys =
 	 * FS_EXT_1		extensions level 1 - mknod & unmount
 	 * FS_EXT_2		extensions level 2 - additional place at the end
 	 * FS_EXT_3		extensions level 3 - stat & native UTC timestamps
+	 * FS_EXT_4		extensions level 4 - readdirs
 	 */
 	FS_CASESENSITIVE	|
 	FS_NOXBIT		|
@@ -602,7 +606,8 @@ FILESYS fatfs_filesys =
 	FS_DO_SYNC		|
 	FS_OWN_MEDIACHANGE	|
 	FS_EXT_1		|
-	FS_EXT_2		,
+	FS_EXT_2		|
+	FS_EXT_4		,
 
 	root:			fatfs_root,
 	lookup:			fatfs_lookup,
@@ -648,7 +653,10 @@ FILESYS fatfs_filesys =
 	res3:			0,
 
 	lock: 0, sleepers: 0,
-	block: NULL, deblock: NULL
+	block: NULL, deblock: NULL,
+
+	/* FS_EXT_4 */
+	readdirs:		fatfs_readdirs
 };
 
 /*
@@ -1704,6 +1712,9 @@ c_del_cookie (register COOKIE *c)
 	if (c->lastlookup)
 		kfree (c->lastlookup);
 
+	/* the file data is cached by cookie */
+	pcache.invalidate (c, 0, 0, -1);
+
 	kfree (c->name);
 	mint_bzero (c, sizeof (*c));
 }
@@ -6872,13 +6883,66 @@ fatfs_opendir (DIR *dirh, int flags)
 	return r;
 }
 
+/* cookie of the entry __nextdir just read as nm with slots vfat slots
+ */
+static COOKIE *
+fatfs_dircookie (COOKIE *c, oDIR *dir, const char *nm, long slots)
+{
+	COOKIE *new;
+	char *name;
+
+	name = fullname (c, nm);
+	if (!name)
+		return NULL;
+
+	new = c_hash_lookup (name, dir->dev);
+	if (!new)
+	{
+		new = c_get_cookie (name);
+		if (new)
+		{
+			new->dev = dir->dev;
+			new->rdev = dir->dev;
+			new->dir = c->stcl;
+			new->offset = dir->index;
+			new->stcl = GET_STCL (dir->info, dir->dev);
+			new->flen = le2cpu32 (dir->info->flen);
+			new->info = *(dir->info);
+			new->slots = slots;
+		}
+	}
+	else
+	{
+		kfree (name);
+		new->links++;
+	}
+
+	return new;
+}
+
+/* case of the name readdir returns
+ */
+static void
+fatfs_namecase (DIR *dirh, oDIR *dir, char *nm, long slots)
+{
+	if (!(dirh->flags & TOS_SEARCH) && VFAT (dir->dev))
+	{
+		if (!slots && LCASE (dir->dev))
+			strlwr (nm);
+	}
+	else
+	{
+		if (get_curproc()->domain != DOM_TOS)
+			strlwr (nm);
+	}
+}
+
 static long _cdecl
 fatfs_readdir (DIR *dirh, char *nm, int nmlen, fcookie *fc)
 {
 	oDIR *dir = (oDIR *) dirh->fsstuff;
 	COOKIE *c = (COOKIE *) dirh->fc.index;
 	COOKIE *new;
-	char *name;
 	char *read_nm;
 	char buf[VFAT_NAMEMAX];
 	char shortbuf[FAT_NAMEMAX];
@@ -6922,77 +6986,118 @@ fatfs_readdir (DIR *dirh, char *nm, int nmlen, fcookie *fc)
 		read_nm = nm;
 	}
 
-	name = fullname (c, read_nm);
-	if (name)
+	new = fatfs_dircookie (c, dir, read_nm, r);
+	if (!new)
 	{
-		new = c_hash_lookup (name, dir->dev);
-		if (!new)
-		{
-			new = c_get_cookie (name);
-			if (new)
-			{
-				new->dev = dir->dev;
-				new->rdev = dir->dev;
-				new->dir = c->stcl;
-				new->offset = dir->index;
-				new->stcl = GET_STCL (dir->info, dir->dev);
-				new->flen = le2cpu32 (dir->info->flen);
-				new->info = *(dir->info);
-				new->slots = r;
-			}
-		}
-		else
+		FAT_DEBUG (("fatfs_readdir: leave failure (out of memory)"));
+		return ENOMEM;
+	}
+
+	fc->fs = &fatfs_filesys;
+	fc->dev = dir->dev;
+	fc->aux = 0;
+	fc->index = (long) new;
+
+	dirh->index = dir->index;
+
+	if (r && ((dirh->flags & TOS_SEARCH) || !VFAT (dir->dev)))
+	{
+		/* return TOS name */
+		FAT_DEBUG (("fatfs_readdir: TOS_SEARCH, make TOS_NAME"));
+		dir2str (dir->info->name, nm);
+	}
+
+	fatfs_namecase (dirh, dir, nm, r);
+
+	if ((dirh->flags & TOS_SEARCH) == 0)
+	{
+		unaligned_putl(nm - 4, INDEX (new));
+	}
+
+	FAT_DEBUG_COOKIE ((new));
+	FAT_DEBUG (("fatfs_readdir: leave ok (nm = %s)", nm));
+
+	return E_OK;
+}
+
+/* Dgetdents() and Fsnext batches; names that don't start with prefix
+ * are sorted out before a cookie is made for them
+ */
+static long _cdecl
+fatfs_readdirs (DIR *dirh, char *buf, long len, int flags, const char *prefix)
+{
+	oDIR *dir = (oDIR *) dirh->fsstuff;
+	COOKIE *c = (COOKIE *) dirh->fc.index;
+	char name[VFAT_NAMEMAX];
+	char shortbuf[FAT_NAMEMAX];
+	long done = 0;
+	long r = E_OK;
+
+	FAT_DEBUG (("fatfs_readdirs [%s]: enter", c->name));
+
+	for (;;)
+	{
+		long real_index = dir->real_index;
+		long index = dir->index;
+		COOKIE *new;
+		fcookie fc;
+		char *nm;
+		long slots, n;
+
+		slots = __nextdir (dir, name, VFAT_NAMEMAX);
+		if (slots < 0)
 		{
-			kfree (name);
-			new->links++;
+			if (slots != ENMFILES)
+				r = slots;
+
+			break;
 		}
 
-		if (new)
+		nm = name;
+		if (slots && ((dirh->flags & TOS_SEARCH) || !VFAT (dir->dev)))
 		{
-			fc->fs = &fatfs_filesys;
-			fc->dev = dir->dev;
-			fc->aux = 0;
-			fc->index = (long) new;
-
-			dirh->index = dir->index;
+			/* TOS name */
+			dir2str (dir->info->name, shortbuf);
+			nm = shortbuf;
+		}
 
-			if (r && ((dirh->flags & TOS_SEARCH) || !VFAT (dir->dev)))
-			{
-				/* return TOS name */
-				FAT_DEBUG (("fatfs_readdir: TOS_SEARCH, make TOS_NAME"));
-				dir2str (dir->info->name, nm);
+		if (!prefix_match (nm, prefix))
+			continue;
 
-				if (get_curproc()->domain != DOM_TOS)
-					strlwr (nm);
-			}
+		new = fatfs_dircookie (c, dir, name, slots);
+		if (!new)
+		{
+			r = ENOMEM;
+			break;
+		}
 
-			if (!(dirh->flags & TOS_SEARCH) && VFAT (dir->dev))
-			{
-				if (!r && LCASE (dir->dev))
-					strlwr (nm);
-			}
-			else
-			{
-				if (get_curproc()->domain != DOM_TOS)
-					strlwr (nm);
-			}
+		fatfs_namecase (dirh, dir, nm, slots);
 
-			if ((dirh->flags & TOS_SEARCH) == 0)
-			{
-				unaligned_putl(nm - 4, INDEX (new));
-			}
+		fc.fs = &fatfs_filesys;
+		fc.dev = dir->dev;
+		fc.aux = 0;
+		fc.index = (long) new;
 
-			FAT_DEBUG_COOKIE ((new));
-			FAT_DEBUG (("fatfs_readdir: leave ok (nm = %s)", nm));
+		n = dgdent_put (buf + done, len - done, dirh, flags, INDEX (new), nm, &fc, 1);
+		rel_cookie (new);
 
-			return E_OK;
+		if (!n)
+		{
+			/* read it again next time */
+			dir->real_index = real_index;
+			dir->index = index;
+			r = EBADARG;
+			break;
 		}
 
-		FAT_DEBUG (("fatfs_readdir: leave failure (c_get_cookie)"));
+		done += n;
+		dirh->index = dir->index;
 	}
 
-	FAT_DEBUG (("fatfs_readdir: leave failure (out of memory)"));
-	return ENOMEM;
+	FAT_DEBUG (("fatfs_readdirs: leave (done = %li, r = %li)", done, r));
+
+	/* EBADARG only if not even the first entry fits */
+	return done ? done : r;
 }
 
 static long _cdecl
@@ -7911,6 +8016,8 @@ __FTRUNCATE (COOKIE *c, long newlen)
 	c->flen = newlen;
 	c->info.flen = cpu2le32 (newlen);
 
+	pcache.invalidate (c, 0, newlen, -1);
+
 	FAT_DEBUG (("__FTRUNCATE: leave return write_cookie"));
 
 	/* write and leave */
@@ -7931,6 +8038,8 @@ __FIO (FILEPTR *f, char *buf, long bytes, ushort mode)
 	long todo;
 	long offset;
 	long data;
+	long start;
+	char *startbuf;
 
 	FAT_DEBUG (("__FIO [%s]: enter (bytes = %li, mode: %s)", c->name, bytes, (mode == READ) ? "READ" : "WRITE"));
 	FAT_DEBUG (("__FIO: f->pos = %li, ptr->current = %li", f->pos, ptr->current));
@@ -7967,6 +8076,26 @@ __FIO (FILEPTR *f, char *buf, long bytes, ushort mode)
 
 	todo = bytes;
 
+	if (mode == READ)
+	{
+		/* cached file data doesn't need the cluster walk,
+		 * it's done on the next uncached access
+		 */
+		data = pcache.read (c, 0, f->pos, buf, todo);
+		buf += data;
+		todo -= data;
+		f->pos += data;
+
+		if (todo == 0)
+		{
+			FAT_DEBUG (("__FIO: leave ok, cached (pos = %li)", f->pos));
+			return bytes;
+		}
+	}
+
+	start = f->pos;
+	startbuf = buf;
+
 	if (c->stcl == 0)
 	{
 		/* no first cluster,
@@ -8094,8 +8223,15 @@ __FIO (FILEPTR *f, char *buf, long bytes, ushort mode)
 		f->pos += data;
 	}
 
-	if (mode == WRITE)
+	if (mode == READ)
 	{
+		if (todo == 0)
+			pcache.fill (c, 0, start, startbuf, f->pos - start, c->flen);
+	}
+	else
+	{
+		pcache.invalidate (c, 0, start, f->pos - start);
+
 		if (f->pos > c->flen)
 		{
 			c->flen = f->pos;
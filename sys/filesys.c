@@ -207,6 +207,7 @@ init_filesys (void)
 	int i;
 
 	active_fs = NULL;
+	xfs_lock_init ();
 
 	/* init data structures */
 	for (i = 0; i < NUM_DRIVES; i++)
@@ -539,6 +540,7 @@ _changedrv (ushort d, const char *function)
 				TRACE (("closing search for process %d", p->pid));
 				release_cookie (&dirh->fc);
 				dirh->fc.fs = NULL;
+				srch_free (fd, i);
 				fd->srchdta[i] = 0;
 			}
 		}
@@ -1633,6 +1635,118 @@ pat_match(const char *name, const char *template)
 	return 1;
 }
 
+/*
+ * void pat_compile(pat, patrn): set up pat for pat_match83 from patrn,
+ * a pattern expanded by copy8_3. The literal characters the name part
+ * starts with go to pat->prefix; a name that doesn't start with them
+ * can't match, so filesystems may use prefix_match to leave such names
+ * out early.
+ */
+void
+pat_compile(struct pat83 *pat, const char *patrn)
+{
+	int i;
+
+	strncpy(pat->tmpl, patrn, sizeof(pat->tmpl) - 1);
+	pat->tmpl[sizeof(pat->tmpl) - 1] = 0;
+
+	if (pat->tmpl[0] == '*')
+		pat->mode = PAT_ALL;
+	else if (strlen(pat->tmpl) == 12 && pat->tmpl[8] == '.')
+		pat->mode = PAT_83;
+	else
+		pat->mode = PAT_SLOW;	/* not made by copy8_3 */
+
+	/* "." and ".." which copy8_3 leaves alone */
+	if (pat->mode != PAT_83 || pat->tmpl[0] == '.')
+		i = 0;
+	else
+	{
+		for (i = 0; i < 8 && pat->tmpl[i] != '?' && pat->tmpl[i] != ' '; i++)
+			pat->prefix[i] = pat->tmpl[i];
+	}
+
+	pat->prefix[i] = 0;
+}
+
+/*
+ * int pat_match83(pat, name): like pat_match(name, pat->tmpl), but
+ * compares the name while expanding it, so most names are rejected
+ * after the first few characters
+ */
+int
+pat_match83(const struct pat83 *pat, const char *name)
+{
+	const char *t = pat->tmpl;
+	const char *s = name;
+	int i;
+
+	if (pat->mode == PAT_ALL)
+		return 1;
+
+	if (pat->mode == PAT_SLOW || *s == '.')
+		return pat_match(name, t);
+
+	/* name part, blank padded */
+	for (i = 0; i < 8 && *s && *s != '.'; i++, s++)
+	{
+		if (*s == '*')
+			return pat_match(name, t);
+		if (t[i] != '?' && t[i] != toupper((int)*s & 0xff))
+			return 0;
+	}
+	for (; i < 8; i++)
+	{
+		if (t[i] != '?' && t[i] != ' ')
+			return 0;
+	}
+
+	/* copy8_3 drops the rest of a long name part */
+	while (*s && *s != '.')
+		s++;
+	if (*s)
+		s++;
+
+	/* extension, after the '.' which is always there */
+	t += 9;
+	for (i = 0; i < 3 && *s && *s != '.'; i++, s++)
+	{
+		if (*s == '*')
+			return pat_match(name, pat->tmpl);
+		if (t[i] != '?' && t[i] != toupper((int)*s & 0xff))
+			return 0;
+	}
+	for (; i < 3; i++)
+	{
+		if (t[i] != '?' && t[i] != ' ')
+			return 0;
+	}
+
+	return 1;
+}
+
+/*
+ * int prefix_match(name, prefix): returns 0 if the upper cased name
+ * doesn't start with prefix (as set up by pat_compile); a NULL prefix
+ * matches everything
+ */
+int
+prefix_match(const char *name, const char *prefix)
+{
+	if (!prefix)
+		return 1;
+
+	while (*prefix)
+	{
+		if (toupper((int)*name & 0xff) != ((int)*prefix & 0xff))
+			return 0;
+		name++;
+		prefix++;
+	}
+
+	return 1;
+}
+
 /*
  * int samefile(fcookie *a, fcookie *b): returns 1 if the two cookies
  * refer to the same file or directory, 0 otherwise
@@ -7,6 +7,7 @@
 # define _filesys_h
 
 # include "mint/mint.h"
+# include "mint/emu_tos.h"
 # include "mint/file.h"
 
 # include "xfs_xdd.h"
@@ -64,6 +65,21 @@ long dir_access(struct ucred *cred, fcookie *, ushort, ushort *);
 int has_wild(const char *name);
 void copy8_3(char *dest, const char *src);
 int pat_match(const char *name, const char *template);
+
+/* an Fsfirst pattern prepared for matching many names */
+struct pat83
+{
+	char	tmpl[TOS_NAMELEN+1];	/* as expanded by copy8_3 */
+	char	prefix[9];		/* literal start of the name part */
+	short	mode;
+# define PAT_ALL	0		/* "*.*" */
+# define PAT_83		1		/* usual 12 character template */
+# define PAT_SLOW	2		/* anything else, use pat_match */
+};
+
+void pat_compile(struct pat83 *pat, const char *patrn);
+int pat_match83(const struct pat83 *pat, const char *name);
+int prefix_match(const char *name, const char *prefix);
 int samefile(fcookie *, fcookie *);
 
 # endif /* _filesys_h */
@@ -57,6 +57,7 @@
 # include "k_exec.h"		/* sys_pexec */
 # include "k_exit.h"		/* sys_pwaitpid */
 # include "k_fds.h"		/* do_open/do_close */
+# include "k_workq.h"		/* workq_init */
 # include "keyboard.h"		/* init_keytbl() */
 # include "kmemory.h"		/* kmalloc */
 # include "memory.h"		/* init_mem, get_region, attach_region, restr_screen */
@@ -648,7 +649,7 @@ init (void)
 	if (r)
 		FATAL("unable to open CONSOLE device");
 
-	rootproc->p_fd->control = f;
+	FD_CONTROL(rootproc->p_fd) = f;
 	rootproc->p_fd->ofiles[0] = f; f->links++;
 	if( !write_boot_file )
 	{
@@ -695,7 +696,7 @@ init (void)
 	if (r)
 		FATAL("unable to open MODEM1 device");
 
-	rootproc->p_fd->aux = f;
+	FD_AUX(rootproc->p_fd) = f;
 	((struct tty *) f->devinfo)->aux_cnt = 1;
 	f->pos = 1;	/* flag for close to --aux_cnt */
 
@@ -705,7 +706,7 @@ init (void)
 		 * MODEM1 may no longer be the default
 		 */
 		sys_b_bconmap(curbconmap);
-		f = rootproc->p_fd->aux;	/* bconmap can change rootproc->aux */
+		f = FD_AUX(rootproc->p_fd);	/* bconmap can change rootproc->aux */
 	}
 
 	if (f)
@@ -721,7 +722,7 @@ init (void)
 	if (!r)
 	{
 		rootproc->p_fd->ofiles[3] = f;
-		rootproc->p_fd->prn = f;
+		FD_PRN(rootproc->p_fd) = f;
 		f->links++;
 	}
 
@@ -731,8 +732,8 @@ init (void)
 	r = do_open(&f, "u:/dev/midi", O_RDWR, 0, NULL);
 	if (!r)
 	{
-		rootproc->p_fd->midiin = f;
-		rootproc->p_fd->midiout = f;
+		FD_MIDIIN(rootproc->p_fd) = f;
+		FD_MIDIOUT(rootproc->p_fd) = f;
 		f->links++;
 
 		((struct tty *) f->devinfo)->use_cnt++;
@@ -793,6 +794,9 @@ init (void)
 
 	stop_and_ask();
 
+	/* start the work queue threads, update may use them */
+	workq_init();
+
 	/* start system update daemon */
 # ifdef VERBOSE_BOOT
 	boot_print(MSG_init_starting_sysupdate);
@@ -0,0 +1,602 @@
+/*
+ * This file belongs to FreeMiNT. It's not in the original MiNT 1.12
+ * distribution. See the file CHANGES for a detailed log of changes.
+ *
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This file is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *
+ * Asynchronous I/O through a submission/completion ring.
+ *
+ * A process sets up a ring in its own memory and gets back a handle.
+ * Requests put into the submission queue are picked up by Faio(AIO_ENTER)
+ * and executed by a small number of kernel threads that share the address
+ * space of the process. Results are posted into the completion queue; the
+ * handle becomes readable for Fselect()/Fpoll() while completions are
+ * pending, so they can be waited on together with other handles.
+ *
+ * Every request holds its own reference to the FILEPTR it operates on,
+ * so closing the handle number in the meantime is harmless. Closing the
+ * ring handle itself cancels what is queued and interrupts the requests
+ * the workers are blocked in (e.g. a read from a terminal or socket).
+ *
+ */
+
+# include "k_aio.h"
+
+# include "libkern/libkern.h"
+# include "mint/file.h"
+# include "mint/filedesc.h"
+# include "mint/ioctl.h"
+# include "mint/net.h"
+
+# include "dev-null.h"
+# include "ipc_socketdev.h"
+# include "k_fds.h"
+# include "k_kthread.h"
+# include "kmemory.h"
+# include "memory.h"
+# include "proc.h"
+# include "proc_help.h"
+# include "tty.h"
+# include "xfs_xdd.h"
+
+
+struct aio_req
+{
+	struct aio_req	*next;
+	FILEPTR		*fp;		/* referenced file, NULL for NOP */
+	struct aio_sqe	sqe;		/* private copy of the submission */
+};
+
+struct aio_ctx
+{
+	struct aio_ring	*ring;		/* user space ring header */
+	struct aio_sqe	*sq;		/* submission entries */
+	struct aio_cqe	*cq;		/* completion entries */
+	ulong		entries;	/* as validated at setup */
+
+	struct aio_req	*head;		/* queued requests */
+	struct aio_req	*tail;
+
+	long		inflight;	/* submitted but not yet completed */
+	long		rsel;		/* process selecting for completions */
+	long		wsel;		/* process selecting for free entries */
+
+	struct proc	*worker[AIO_MAXWORKERS];	/* running workers */
+
+	short		links;		/* handle + worker threads */
+	short		dying;		/* handle closed */
+};
+
+
+static long _cdecl aio_open	(FILEPTR *f);
+static long _cdecl aio_write	(FILEPTR *f, const char *buf, long bytes);
+static long _cdecl aio_read	(FILEPTR *f, char *buf, long bytes);
+static long _cdecl aio_ioctl	(FILEPTR *f, int mode, void *buf);
+static long _cdecl aio_close	(FILEPTR *f, int pid);
+static long _cdecl aio_select	(FILEPTR *f, long proc, int mode);
+static void _cdecl aio_unselect	(FILEPTR *f, long proc, int mode);
+
+static DEVDRV aio_device =
+{
+	open:		aio_open,
+	write:		aio_write,
+	read:		aio_read,
+	lseek:		null_lseek,
+	ioctl:		aio_ioctl,
+	datime:		null_datime,
+	close:		aio_close,
+	select:		aio_select,
+	unselect:	aio_unselect,
+	writeb:		NULL,
+	readb:		NULL
+};
+
+
+static void
+aio_put (struct aio_ctx *ctx)
+{
+	if (--ctx->links == 0)
+		kfree (ctx);
+}
+
+/* number of completions the process has not yet reaped */
+INLINE ulong
+aio_pending (struct aio_ctx *ctx)
+{
+	return ctx->ring->cq_tail - ctx->ring->cq_head;
+}
+
+/* post a completion; there is always room for it as
+ * aio_submit() never lets more requests in than fit
+ */
+static void
+aio_post (struct aio_ctx *ctx, long user_data, long res)
+{
+	struct aio_ring *ring = ctx->ring;
+	struct aio_cqe *cqe = &ctx->cq[ring->cq_tail & (ctx->entries - 1)];
+
+	cqe->user_data = user_data;
+	cqe->res = res;
+	ring->cq_tail++;
+
+	wake (IO_Q, (long) ctx);
+	if (ctx->rsel)
+		wakeselect ((struct proc *) ctx->rsel);
+}
+
+static long
+aio_execute (struct aio_req *req)
+{
+	struct aio_sqe *sqe = &req->sqe;
+	FILEPTR *f = req->fp;
+	long r;
+
+	switch (sqe->opcode)
+	{
+		case AIO_OP_NOP:
+			return 0;
+
+		case AIO_OP_READ:
+		{
+			if ((f->flags & O_RWMODE) == O_WRONLY)
+				return EACCES;
+			if (f->flags & O_DIRECTORY)
+				return EISDIR;
+
+			if (is_terminal (f))
+				return tty_read (f, sqe->buf, sqe->nbytes);
+
+			if (sqe->offset >= 0)
+			{
+				r = xdd_lseek (f, sqe->offset, SEEK_SET);
+				if (r < 0)
+					return r;
+			}
+
+# ifdef COW_FORK
+			cow_break (get_curproc(), (ulong) sqe->buf, sqe->nbytes);
+# endif
+			return xdd_read (f, sqe->buf, sqe->nbytes);
+		}
+		case AIO_OP_WRITE:
+		{
+			if ((f->flags & O_RWMODE) == O_RDONLY)
+				return EACCES;
+
+			if (is_terminal (f))
+				return tty_write (f, sqe->buf, sqe->nbytes);
+
+			if (sqe->nbytes <= 0)
+				return 0;
+
+			if (f->flags & O_APPEND)
+			{
+				r = xdd_lseek (f, 0L, SEEK_END);
+				/* ignore errors from unseekable files (e.g. pipes) */
+				if (r == EACCES)
+					r = 0;
+			}
+			else if (sqe->offset >= 0)
+				r = xdd_lseek (f, sqe->offset, SEEK_SET);
+			else
+				r = 0;
+
+			if (r < 0)
+				return r;
+
+			return xdd_write (f, sqe->buf, sqe->nbytes);
+		}
+		case AIO_OP_SEND:
+		case AIO_OP_RECV:
+		{
+			struct iovec iov[1];
+			struct socket *so;
+
+			if (f->dev != &sockdev)
+				return ENOTSOCK;
+
+			so = (struct socket *) f->devinfo;
+			if (so->state == SS_VIRGIN)
+				return EINVAL;
+
+			iov[0].iov_base = sqe->buf;
+			iov[0].iov_len = sqe->nbytes;
+
+			if (sqe->opcode == AIO_OP_SEND)
+				return (*so->ops->send)(so, iov, 1, f->flags & O_NDELAY,
+							sqe->flags, NULL, 0);
+
+			return (*so->ops->recv)(so, iov, 1, f->flags & O_NDELAY,
+						sqe->flags, NULL, NULL);
+		}
+	}
+
+	return ENOSYS;
+}
+
+/*
+ * Worker thread; runs in the address space of the process
+ * that set up the ring.
+ */
+static void _cdecl
+aio_worker (void *arg)
+{
+	struct aio_ctx *ctx = arg;
+	struct proc *p = get_curproc();
+
+	int slot;
+
+	/* requests carry their own file references; don't keep the
+	 * descriptor table (and with it the ring handle) of the owner alive
+	 */
+	free_fd (p);
+	p->p_fd = share_fd (rootproc);
+
+	/* so aio_close() can interrupt us */
+	for (slot = 0; ctx->worker[slot]; slot++)
+		;
+	ctx->worker[slot] = p;
+
+	for (;;)
+	{
+		struct aio_req *req;
+		long r;
+
+		while (!ctx->head && !ctx->dying)
+			sleep (WAIT_Q, (long) &ctx->head);
+
+		req = ctx->head;
+		if (!req)
+			break;
+
+		ctx->head = req->next;
+		if (!ctx->head)
+			ctx->tail = NULL;
+
+		r = ctx->dying ? EINTR : aio_execute (req);
+
+		if (req->fp)
+			do_close (p, req->fp);
+
+		ctx->inflight--;
+
+		/* after the handle is closed the ring may not
+		 * exist anymore (Pexec)
+		 */
+		if (!ctx->dying)
+			aio_post (ctx, req->sqe.user_data, r);
+
+		/* the process may have reaped completions meanwhile */
+		if (ctx->wsel)
+			wakeselect ((struct proc *) ctx->wsel);
+
+		kfree (req);
+	}
+
+	ctx->worker[slot] = NULL;
+	aio_put (ctx);
+	kthread_exit (0);
+}
+
+static long
+aio_submit (struct proc *p, struct aio_ctx *ctx)
+{
+	struct aio_ring *ring = ctx->ring;
+	ulong mask = ctx->entries - 1;
+	long n = 0, queued = 0;
+
+	while (ring->sq_head != ring->sq_tail)
+	{
+		struct aio_req *req;
+		long r;
+
+		/* never let in more than the completion queue can hold */
+		if (ctx->inflight + aio_pending (ctx) >= ctx->entries)
+			break;
+
+		req = kmalloc (sizeof (*req));
+		if (!req)
+		{
+			if (n == 0)
+				return ENOMEM;
+			break;
+		}
+
+		req->next = NULL;
+		req->fp = NULL;
+		req->sqe = ctx->sq[ring->sq_head & mask];
+		ring->sq_head++;
+		n++;
+
+		if (req->sqe.opcode != AIO_OP_NOP)
+		{
+			r = FP_GET1 (p, req->sqe.fd, &req->fp);
+			if (r)
+			{
+				aio_post (ctx, req->sqe.user_data, r);
+				kfree (req);
+				continue;
+			}
+
+			req->fp->links++;
+		}
+
+		if (ctx->tail)
+			ctx->tail->next = req;
+		else
+			ctx->head = req;
+		ctx->tail = req;
+
+		ctx->inflight++;
+		queued++;
+	}
+
+	if (queued)
+		wake (WAIT_Q, (long) &ctx->head);
+
+	return n;
+}
+
+static long
+aio_setup (struct proc *p, struct aio_ring *ring, long workers)
+{
+	struct aio_ctx *ctx;
+	FILEPTR *fp = NULL;
+	short fd = MIN_OPEN - 1;
+	long ret;
+	int i;
+
+	if (!ring)
+		return EFAULT;
+
+	if (ring->entries == 0 || ring->entries > AIO_MAXENTRIES
+	    || (ring->entries & (ring->entries - 1)))
+		return EINVAL;
+
+	if (workers <= 0)
+		workers = 2;
+	else if (workers > AIO_MAXWORKERS)
+		workers = AIO_MAXWORKERS;
+
+	ctx = kmalloc (sizeof (*ctx));
+	if (!ctx)
+		return ENOMEM;
+
+	mint_bzero (ctx, sizeof (*ctx));
+
+	ctx->ring = ring;
+	ctx->entries = ring->entries;
+	ctx->sq = AIO_RING_SQ (ring);
+	ctx->cq = (struct aio_cqe *) (ctx->sq + ctx->entries);
+	ctx->links = 1;
+
+	ring->sq_head = ring->sq_tail = 0;
+	ring->cq_head = ring->cq_tail = 0;
+
+	ret = FD_ALLOC (p, &fd, MIN_OPEN);
+	if (ret) goto error;
+
+	ret = FP_ALLOC (p, &fp);
+	if (ret) goto error;
+
+	fp->flags = O_RDWR;
+	fp->devinfo = (long) ctx;
+	fp->dev = &aio_device;
+
+	for (i = 0; i < workers; i++)
+	{
+		ctx->links++;
+
+		ret = kthread_create (p, aio_worker, ctx, NULL, "aio-%d", p->pid);
+		if (ret)
+		{
+			ctx->links--;
+			if (i == 0)
+				goto error;
+
+			/* run with what we got */
+			break;
+		}
+	}
+
+	FP_DONE (p, fp, fd, FD_CLOEXEC);
+
+	TRACE (("Faio: ring %p, %li entries, handle %i", ring, ctx->entries, fd));
+	return fd;
+
+error:
+	if (fd >= MIN_OPEN) FD_REMOVE (p, fd);
+	if (fp) { fp->links--; FP_FREE (fp); }
+	aio_put (ctx);
+
+	DEBUG (("Faio: setup failed (%li)", ret));
+	return ret;
+}
+
+long _cdecl
+sys_f_aio (short mode, short fd, long arg1, long arg2)
+{
+	struct proc *p = get_curproc();
+	struct aio_ctx *ctx;
+	FILEPTR *f;
+	long r;
+
+	TRACE (("Faio(%i, %i, %lx, %lx)", mode, fd, arg1, arg2));
+
+	if (mode == AIO_SETUP)
+		return aio_setup (p, (struct aio_ring *) arg1, arg2);
+
+	if (mode != AIO_ENTER)
+		return ENOSYS;
+
+	r = FP_GET1 (p, fd, &f);
+	if (r) return r;
+
+	if (f->dev != &aio_device)
+		return EBADF;
+
+	ctx = (struct aio_ctx *) f->devinfo;
+
+	r = aio_submit (p, ctx);
+	if (r < 0)
+		return r;
+
+	/* wait for completions; don't wait for more than can arrive */
+	while (arg1 > 0 && aio_pending (ctx) < arg1 && ctx->inflight)
+	{
+		if (aio_pending (ctx) + ctx->inflight < arg1)
+			arg1 = aio_pending (ctx) + ctx->inflight;
+
+		if (sleep (IO_Q, (long) ctx))
+		{
+			if (r == 0)
+				r = EINTR;
+			break;
+		}
+	}
+
+	return r;
+}
+
+
+/* device driver for the ring handle */
+
+static long _cdecl
+aio_open (FILEPTR *f)
+{
+	UNUSED (f);
+	return EACCES;
+}
+
+static long _cdecl
+aio_write (FILEPTR *f, const char *buf, long bytes)
+{
+	UNUSED (f); UNUSED (buf); UNUSED (bytes);
+	return EACCES;
+}
+
+static long _cdecl
+aio_read (FILEPTR *f, char *buf, long bytes)
+{
+	UNUSED (f); UNUSED (buf); UNUSED (bytes);
+	return EACCES;
+}
+
+static long _cdecl
+aio_ioctl (FILEPTR *f, int mode, void *buf)
+{
+	struct aio_ctx *ctx = (struct aio_ctx *) f->devinfo;
+
+	switch (mode)
+	{
+		case FIONREAD:
+			*(long *) buf = aio_pending (ctx);
+			break;
+		case FIONWRITE:
+			*(long *) buf = ctx->entries - ctx->inflight - aio_pending (ctx);
+			break;
+		case FIOEXCEPT:
+			*(long *) buf = 0;
+			break;
+		default:
+			return ENOSYS;
+	}
+
+	return E_OK;
+}
+
+static long _cdecl
+aio_close (FILEPTR *f, int pid)
+{
+	struct aio_ctx *ctx = (struct aio_ctx *) f->devinfo;
+	struct aio_req *req;
+	int i;
+
+	UNUSED (pid);
+
+	if (f->links > 0)
+		return E_OK;
+
+	ctx->dying = 1;
+	ctx->rsel = 0;
+	ctx->wsel = 0;
+
+	/* drop everything that didn't start yet */
+	while ((req = ctx->head) != NULL)
+	{
+		ctx->head = req->next;
+		if (req->fp)
+			do_close (get_curproc(), req->fp);
+
+		ctx->inflight--;
+		kfree (req);
+	}
+	ctx->tail = NULL;
+
+	/* let the workers exit; the ones blocked in a request
+	 * (a terminal or socket may never deliver) get EINTR there
+	 */
+	for (i = 0; i < AIO_MAXWORKERS; i++)
+		if (ctx->worker[i])
+			abort_sleep (ctx->worker[i]);
+
+	aio_put (ctx);
+	return E_OK;
+}
+
+static long _cdecl
+aio_select (FILEPTR *f, long proc, int mode)
+{
+	struct aio_ctx *ctx = (struct aio_ctx *) f->devinfo;
+
+	if (mode == O_RDONLY)
+	{
+		if (aio_pending (ctx))
+			return 1;
+
+		if (ctx->rsel)
+			return 2;	/* collision */
+
+		ctx->rsel = proc;
+		return 0;
+	}
+
+	if (mode == O_WRONLY)
+	{
+		if (ctx->inflight + aio_pending (ctx) < ctx->entries)
+			return 1;
+
+		if (ctx->wsel)
+			return 2;	/* collision */
+
+		ctx->wsel = proc;
+		return 0;
+	}
+
+	return 0;
+}
+
+static void _cdecl
+aio_unselect (FILEPTR *f, long proc, int mode)
+{
+	struct aio_ctx *ctx = (struct aio_ctx *) f->devinfo;
+
+	if (mode == O_RDONLY && ctx->rsel == proc)
+		ctx->rsel = 0;
+	else if (mode == O_WRONLY && ctx->wsel == proc)
+		ctx->wsel = 0;
+}
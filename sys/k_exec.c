@@ -663,7 +663,7 @@ exec_region(struct proc *p, MEMREGION *mem, int thread)
 	fd->dta = (DTABUF *)(b->p_dta = &b->p_cmdlin[0]);
 
 	/* close extra open files */
-	for (i = MIN_OPEN; i < fd->nfiles; i++)
+	for (i = MIN_OPEN; i < fd->lastfile; i++)
 	{
 		FILEPTR *f = fd->ofiles[i];
 
@@ -73,6 +73,17 @@ terminate(struct proc *pcurproc, short code, short que)
 	struct proc *p;
 	int i, wakemint = 0;
 
+	/* killed right after wake_one() picked us; the wakeup was meant
+	 * for whoever waits next, pass it on before anything can sleep
+	 */
+	if (pcurproc->handoff_cond)
+	{
+		long cond = pcurproc->handoff_cond;
+
+		pcurproc->handoff_cond = 0;
+		wake_one (pcurproc->handoff_q, cond);
+	}
+
 	/* notify proc extensions */
 	proc_ext_on_exit(pcurproc, code);
 
@@ -110,6 +121,10 @@ terminate(struct proc *pcurproc, short code, short que)
 	/* release all semaphores owned by this process */
 	free_semaphores (pcurproc->pid);
 
+	/* stop waiting in Pmsg() and Pfutex() */
+	free_mailbox (pcurproc);
+	free_futex (pcurproc);
+
 	/* make sure that any open files that refer to this process are
 	 * closed
 	 */
@@ -332,7 +347,12 @@ sys_ptermres(long save, short code)
 		{
 			/* only the TSR is owner */
 			if (get_prot_mode (m) == PROT_P)
+			{
+# ifdef COW_FORK
+				cow_unshare (m);
+# endif
 				mark_region (m, PROT_G, 0);
+			}
 		}
 	}
 
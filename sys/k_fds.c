@@ -50,32 +50,136 @@
 # include "tty.h"
 
 
+/* size of a heap allocated handle table with n entries >= 0 */
+# define FDTAB_SIZE(n) \
+	(((n) - MIN_HANDLE) * (sizeof (FILEPTR *) + sizeof (uchar)) + ((n) / 32) * sizeof (ulong))
+
+/* grow the handle table of fd so that it covers at least
+ * handle n; the size is rounded up to NDEXTENT
+ */
 long
-fd_alloc (struct proc *p, short *fd, short min, const char *func)
+fd_extend (struct filedesc *fd, short n)
 {
-	short i;
+	FILEPTR **files;
+	uchar *flags;
+	ulong *map;
+	short nfiles;
 
-	assert (p->p_fd);
+	if (n < fd->nfiles)
+		return 0;
+
+	if (n >= NOFILE)
+		return EMFILE;
+
+	nfiles = (n + NDEXTENT) & ~(NDEXTENT - 1);
+	if (nfiles > NOFILE)
+		nfiles = NOFILE;
 
-	for (i = min; i < p->p_fd->nfiles; i++)
+	files = kmalloc (FDTAB_SIZE (nfiles));
+	if (!files)
 	{
-		if (!p->p_fd->ofiles[i])
+		DEBUG (("fd_extend: out of memory for %i handles", nfiles));
+		return ENOMEM;
+	}
+
+	map = (ulong *) (files + (nfiles - MIN_HANDLE));
+	flags = (uchar *) (map + nfiles / 32);
+
+	mint_bzero (files, FDTAB_SIZE (nfiles));
+	bcopy (fd->ofiles + MIN_HANDLE, files, (fd->nfiles - MIN_HANDLE) * sizeof (*files));
+	bcopy (fd->ofileflags + MIN_HANDLE, flags, fd->nfiles - MIN_HANDLE);
+	bcopy (fd->omap, map, (fd->nfiles / 32) * sizeof (*map));
+
+	if (fd->ofiles != &fd->dfiles[-MIN_HANDLE])
+		kfree (fd->ofiles + MIN_HANDLE);
+
+	fd->ofiles = files - MIN_HANDLE;
+	fd->ofileflags = flags - MIN_HANDLE;
+	fd->omap = map;
+
+	TRACE (("fd_extend: %i -> %i handles", fd->nfiles, nfiles));
+	fd->nfiles = nfiles;
+
+	return 0;
+}
+
+/* find a free handle >= min in the bitmap; a clear bit is only
+ * a hint as some places still store the standard handles
+ * directly into ofiles
+ */
+static short
+fd_search (struct filedesc *fd, short min)
+{
+	short i = min;
+
+	while (i < fd->nfiles)
+	{
+		ulong bits = fd->omap[i >> 5];
+
+		if (bits == 0xffffffffUL)
 		{
-			/* reserve the handle */
-			p->p_fd->ofiles[i] = (FILEPTR *) 1;
+			i = (i | 31) + 1;
+			continue;
+		}
 
-			*fd = i;
+		if (!(bits & (1UL << (i & 31))))
+		{
+			if (!fd->ofiles[i])
+				return i;
 
-			TRACE (("%s: fd_alloc -> %i", func, i));
-			return 0;
+			fd->omap[i >> 5] |= 1UL << (i & 31);
 		}
+
+		i++;
 	}
 
+	return -1;
+}
+
+long
+fd_alloc (struct proc *p, short *fd, short min, const char *func)
+{
+	struct filedesc *p_fd = p->p_fd;
+	short i;
+
+	assert (p_fd);
+
+	/* the standard handles are not in the bitmap */
+	for (i = min; i < 0; i++)
+	{
+		if (!p_fd->ofiles[i])
+			goto found;
+	}
+
+	if (min < 0)
+		min = 0;
+
+	i = fd_search (p_fd, min < p_fd->freefile ? p_fd->freefile : min);
+	if (i >= 0)
+		goto found;
+
+	/* the bitmap may contain stale bits, rebuild it */
+	for (i = min; i < p_fd->nfiles; i++)
+	{
+		if (p_fd->ofiles[i])
+			p_fd->omap[i >> 5] |= 1UL << (i & 31);
+		else
+			p_fd->omap[i >> 5] &= ~(1UL << (i & 31));
+	}
+
+	i = fd_search (p_fd, min);
+	if (i >= 0)
+		goto found;
+
+	i = p_fd->nfiles > min ? p_fd->nfiles : min;
+	if (fd_extend (p_fd, i) == 0)
+		goto found;
+
 	DEBUG (("%s: process out of handles", func));
 # ifdef DEBUG_INFO
-	for (i = min; i < p->p_fd->nfiles; i++)
+	for (i = min; i < p_fd->nfiles; i++)
 	{
-		FILEPTR *f = p->p_fd->ofiles[i];
+		FILEPTR *f = p_fd->ofiles[i];
 
 		if (f && (f != (FILEPTR *) 1))
 			DEBUG (("%i -> %p, links %i, flags %x, dev = %p", i, f, f->links, f->flags, f->dev));
@@ -84,14 +188,67 @@ fd_alloc (struct proc *p, short *fd, short min, const char *func)
 	}
 # endif
 	return EMFILE;
+
+found:
+	/* reserve the handle */
+	p_fd->ofiles[i] = (FILEPTR *) 1;
+
+	if (i >= 0)
+	{
+		p_fd->omap[i >> 5] |= 1UL << (i & 31);
+
+		if (i == p_fd->freefile)
+			p_fd->freefile = i + 1;
+
+		if (i >= p_fd->lastfile)
+			p_fd->lastfile = i + 1;
+	}
+
+	*fd = i;
+
+	TRACE (("%s: fd_alloc -> %i", func, i));
+	return 0;
 }
 
 void
 fd_remove (struct proc *p, short fd, const char *func)
 {
-	assert (p->p_fd);
+	struct filedesc *p_fd = p->p_fd;
+
+	assert (p_fd);
+
+	p_fd->ofiles[fd] = NULL;
+
+	if (fd < 0)
+		return;
+
+	p_fd->omap[fd >> 5] &= ~(1UL << (fd & 31));
+
+	if (fd < p_fd->freefile)
+		p_fd->freefile = fd;
+
+	if (fd >= MIN_OPEN && fd + 1 == p_fd->lastfile)
+	{
+		short i = fd;
+
+		while (i > MIN_OPEN && !p_fd->ofiles[i - 1])
+			i--;
+
+		p_fd->lastfile = i;
+	}
+}
+
+/* mark handle fd as used after it was set directly (Fforce) */
+void
+fd_mark (struct filedesc *fd, short n)
+{
+	if (n < 0)
+		return;
+
+	fd->omap[n >> 5] |= 1UL << (n & 31);
 
-	p->p_fd->ofiles[fd] = NULL;
+	if (n >= fd->lastfile)
+		fd->lastfile = n + 1;
 }
 
 
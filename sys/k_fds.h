@@ -35,9 +35,12 @@
 # include "mint/mint.h"
 # include "mint/file.h"
 
+struct filedesc;
 
 long fd_alloc	(struct proc *p, short *fd, short min, const char *func);
 void fd_remove	(struct proc *p, short fd, const char *func);
+long fd_extend	(struct filedesc *fd, short n);
+void fd_mark	(struct filedesc *fd, short n);
 
 # define FD_ALLOC(p, fd, min)      fd_alloc  (p, fd, min, __FUNCTION__)
 # define FD_REMOVE(p, fd)          fd_remove (p, fd, __FUNCTION__)
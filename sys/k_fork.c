@@ -315,6 +315,8 @@ sys_pvfork (void)
  * address space is duplicated using a shadow region descriptor and a save
  * region, so both the parent and the child can be run. On a context switch
  * the parent's and child's address spaces will be exchanged (see proc.c).
+ * On kernels with COW_FORK the save region is filled lazily, page by page,
+ * when either process first writes to a page (see cow_fault()).
  *
  * "txtsize" is the size of the process' TEXT area, if it has a valid one;
  * this is part of the second memory region attached (the basepage one)
@@ -426,8 +428,23 @@ sys_pfork (void)
 	 * points to its grandparent's basepage.
 	 */
 	b = (BASEPAGE *) p->p_mem->mem[1]->loc;
+# ifdef COW_FORK
+	cow_break (get_curproc(), (ulong) &b->p_parent, sizeof (b->p_parent));
+# endif
 	b->p_parent = (BASEPAGE *) get_curproc()->p_mem->mem[1]->loc;
 
+# ifdef COW_FORK
+	/* The child owns the contents now, write protect the pages
+	 * still shared with the parent's save regions.
+	 */
+	for (i = 0; i < p->p_mem->num_reg; i++)
+	{
+		n = p->p_mem->mem[i];
+		if (n && (n->mflags & M_COW) && n->shadow)
+			cow_protect (p->p_mem, n);
+	}
+# endif
+
 	p->ctxt[CURRENT] = p->ctxt[SYSCALL];
 	p->ctxt[CURRENT].regs[0] = 0;		/* child returns a 0 from call */
 	p->ctxt[CURRENT].sr &= ~(0x2000);	/* child must be in user mode */
@@ -28,6 +28,10 @@
 
 # include "k_semaphore.h"
 
+# include "libkern/libkern.h"
+
+# include "arch/timer.h"	/* jiffies */
+
 # include "proc.h"
 
 
@@ -38,28 +42,89 @@
 # endif
 
 
+static struct lockstat *lockstat_list = NULL;
+
+INLINE void
+stat_acquired(struct lockstat *st, ulong start)
+{
+	st->acquired++;
+
+	if (start)
+	{
+		ulong waited = jiffies - start;
+
+		st->contended++;
+		st->wait_ticks += waited;
+		if (waited > st->max_wait)
+			st->max_wait = waited;
+	}
+}
+
+INLINE void
+stat_released(struct lockstat *st, ulong since)
+{
+	ulong held = jiffies - since;
+
+	st->hold_ticks += held;
+	if (held > st->max_hold)
+		st->max_hold = held;
+}
+
 void _cdecl
 sema_init(struct sema *s)
 {
 	s->lock = 0;
 	s->sleepers = 0;
+	s->since = 0;
+	s->stat = NULL;
+}
+
+static void
+stat_register(struct lockstat *stat, const char *name)
+{
+	mint_bzero(stat, sizeof(*stat));
+	stat->name = name;
+	stat->next = lockstat_list;
+	lockstat_list = stat;
+}
+
+/*
+ * like sema_init, but the semaphore collects contention statistics
+ * in stat, which is listed in /kern/locks
+ */
+void
+sema_init_stat(struct sema *s, struct lockstat *stat, const char *name)
+{
+	sema_init(s);
+	stat_register(stat, name);
+
+	s->stat = stat;
 }
 
 void _cdecl
 sema_lock(struct sema *s)
 {
+	ulong start = 0;
+
 	SEMA_DEBUG(("sema_lock: enter"));
 	
 	while (s->lock)
 	{
 		SEMA_DEBUG(("sema_lock: semaphore locked, sleeping"));
 		
+		if (!start)
+			start = jiffies | 1;
+
 		s->sleepers++;
 		sleep(IO_Q, (long) s);
 		s->sleepers--;
 	}
 	
 	s->lock = 1;
+	s->since = jiffies;
+
+	if (s->stat)
+		stat_acquired(s->stat, start);
 }
 
 void _cdecl
@@ -70,7 +135,149 @@ sema_unlock(struct sema *s)
 	assert(s->lock);
 	
 	s->lock = 0;
+
+	if (s->stat)
+		stat_released(s->stat, s->since);
 	
+	/* only one sleeper can get the semaphore, the others would
+	 * just run to find it taken and go back to sleep; if the one
+	 * woken is killed before it gets here, wake_one() passes the
+	 * wakeup on to the next
+	 */
 	if (s->sleepers)
-		wake(IO_Q, (long) s);
+		wake_one(IO_Q, (long) s);
+}
+
+/*
+ * set up a reader/writer lock; if stat is given, it collects
+ * contention statistics and is listed in /kern/locks
+ */
+void
+rw_init(struct rwlock *l, struct lockstat *stat, const char *name)
+{
+	l->readers = 0;
+	l->rsleepers = 0;
+	l->wsleepers = 0;
+	l->rpass = 0;
+	l->since = 0;
+	l->stat = stat;
+
+	if (stat)
+		stat_register(stat, name);
+}
+
+void
+rw_rlock(struct rwlock *l)
+{
+	ulong start = 0;
+
+	while (l->readers < 0 || (l->wsleepers && !l->rpass))
+	{
+		SEMA_DEBUG(("rw_rlock: %lx locked, sleeping", (long) l));
+
+		if (!start)
+			start = jiffies | 1;
+
+		l->rsleepers++;
+		sleep(IO_Q, (long) &l->rsleepers);
+		l->rsleepers--;
+	}
+
+	if (l->rpass)
+		l->rpass--;
+
+	if (l->readers++ == 0)
+		l->since = jiffies;
+
+	if (l->stat)
+		stat_acquired(l->stat, start);
+}
+
+void
+rw_runlock(struct rwlock *l)
+{
+	assert(l->readers > 0);
+
+	if (--l->readers == 0)
+	{
+		if (l->stat)
+			stat_released(l->stat, l->since);
+
+		if (l->wsleepers)
+			wake_one(IO_Q, (long) &l->wsleepers);
+	}
+}
+
+void
+rw_wlock(struct rwlock *l)
+{
+	ulong start = 0;
+
+	while (l->readers)
+	{
+		SEMA_DEBUG(("rw_wlock: %lx locked, sleeping", (long) l));
+
+		if (!start)
+			start = jiffies | 1;
+
+		l->wsleepers++;
+		sleep(IO_Q, (long) &l->wsleepers);
+		l->wsleepers--;
+	}
+
+	l->readers = -1;
+	l->rpass = 0;
+	l->since = jiffies;
+
+	if (l->stat)
+		stat_acquired(l->stat, start);
+}
+
+void
+rw_wunlock(struct rwlock *l)
+{
+	assert(l->readers < 0);
+
+	l->readers = 0;
+
+	if (l->stat)
+		stat_released(l->stat, l->since);
+
+	/* the readers that queued up behind this writer go first, all of
+	 * them can run; only as many as were waiting get past the waiting
+	 * writers, so new readers can't keep the writers out for good.
+	 * Without waiting readers hand over to the next writer.
+	 */
+	if (l->rsleepers)
+	{
+		l->rpass = l->rsleepers;
+		wake(IO_Q, (long) &l->rsleepers);
+	}
+	else if (l->wsleepers)
+		wake_one(IO_Q, (long) &l->wsleepers);
+}
+
+/*
+ * /kern/locks
+ */
+long
+lockstat_dump(char *buf, long len)
+{
+	struct lockstat *st;
+	char *crs = buf;
+	long i;
+
+	i = ksprintf(crs, len, "name              acquired contended wait_ticks max_wait hold_ticks max_hold\n");
+	crs += i; len -= i;
+
+	for (st = lockstat_list; st && len > 100; st = st->next)
+	{
+		i = ksprintf(crs, len, "%-16s %9lu %9lu %10lu %8lu %10lu %8lu\n",
+			     st->name, st->acquired, st->contended,
+			     st->wait_ticks, st->max_wait,
+			     st->hold_ticks, st->max_hold);
+		crs += i; len -= i;
+	}
+
+	return crs - buf;
 }
@@ -32,14 +32,52 @@
 # include "mint/mint.h"
 
 
+/* optional contention statistics, times are in 200 Hz ticks
+ */
+struct lockstat
+{
+	struct lockstat	*next;		/* link in lockstat_list */
+	const char	*name;
+	ulong	acquired;		/* successful lock operations */
+	ulong	contended;		/* of those, had to sleep first */
+	ulong	wait_ticks;		/* total time spent sleeping */
+	ulong	max_wait;
+	ulong	hold_ticks;		/* total time held (by any reader) */
+	ulong	max_hold;
+};
+
 struct sema
 {
 	volatile ushort	lock;
 	volatile ushort	sleepers;
+	ulong		since;		/* time the lock was taken */
+	struct lockstat	*stat;		/* NULL if not accounted */
+};
+
+/* reader/writer lock; waiting writers block new readers so a steady
+ * stream of readers can't starve them
+ */
+struct rwlock
+{
+	volatile short	readers;	/* active readers, -1 if write locked */
+	volatile ushort	rsleepers;	/* readers sleeping on &rsleepers */
+	volatile ushort	wsleepers;	/* writers sleeping on &wsleepers */
+	volatile ushort	rpass;		/* readers let in ahead of waiting writers */
+	ulong		since;		/* time the lock was taken */
+	struct lockstat	*stat;		/* NULL if not accounted */
 };
 
 void _cdecl sema_init(struct sema *s);
+void sema_init_stat(struct sema *s, struct lockstat *stat, const char *name);
 void _cdecl sema_lock(struct sema *s);
 void _cdecl sema_unlock(struct sema *s);
 
+void rw_init(struct rwlock *l, struct lockstat *stat, const char *name);
+void rw_rlock(struct rwlock *l);
+void rw_runlock(struct rwlock *l);
+void rw_wlock(struct rwlock *l);
+void rw_wunlock(struct rwlock *l);
+
+long lockstat_dump(char *buf, long len);
+
 # endif /* _k_semaphore_h */
@@ -43,6 +43,8 @@
 # include "info.h"
 # include "k_prot.h"
 # include "keyboard.h"
+# include "kprof.h"
+# include "ktrace.h"
 # include "memory.h"
 # include "proc.h"
 # include "time.h"
@@ -219,6 +221,28 @@ kern_sysctl (long *name, ulong namelen, void *oldp, ulong *oldlenp,
 
 		case KERN_SYSDIR:
 			return sysctl_rdstring (oldp, oldlenp, newp, sysdir);
+
+		case KERN_PROFILE:
+		{
+			long on = kprof_on;
+
+			ret = sysctl_long (oldp, oldlenp, newp, newlen, &on);
+			if (ret || newp == NULL)
+				return ret;
+
+			return kprof_control (on);
+		}
+
+		case KERN_TRACE:
+		{
+			long mask = ktrace_on;
+
+			ret = sysctl_long (oldp, oldlenp, newp, newlen, &mask);
+			if (ret || newp == NULL)
+				return ret;
+
+			return ktrace_control (mask);
+		}
 	}
 
 	return EOPNOTSUPP;
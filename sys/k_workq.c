@@ -0,0 +1,243 @@
+/*
+ * This file belongs to FreeMiNT. It's not in the original MiNT 1.12
+ * distribution. See the file CHANGES for a detailed log of changes.
+ * 
+ * 
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ * 
+ * This file is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ * 
+ * 
+ * Kernel work queue, see mint/workq.h for the interface.
+ * 
+ * The worker threads sleep on WAIT_Q with the 0x100 protocol of
+ * sleep(): queue_work() clears the wait_cond of one idle worker and
+ * puts it on the ready queue if it got there already, so a wakeup
+ * between finding the queue empty and going to sleep isn't lost.
+ * 
+ * The CPU time of an item is taken from the systime of the worker,
+ * the time it spent sleeping inside func isn't counted.
+ * 
+ */
+
+# include "k_workq.h"
+
+# include "libkern/libkern.h"
+# include "mint/asm.h"
+# include "mint/proc.h"
+
+# include "arch/timer.h"	/* jiffies */
+
+# include "k_kthread.h"
+# include "proc.h"
+
+
+# define WQ_THREADS	2
+# define WQ_COND	((long) &wq_all)
+
+/* queued items, urgent ones in front */
+static struct work *wq_urgent, *wq_urgent_tail;
+static struct work *wq_normal, *wq_normal_tail;
+
+/* all items set up with work_init */
+static struct work *wq_all;
+
+static struct proc *wq_thread[WQ_THREADS];
+
+
+void _cdecl
+work_init (struct work *w, const char *name, void _cdecl (*func)(struct work *), ushort flags)
+{
+	ushort sr;
+
+	mint_bzero (w, sizeof (*w));
+	w->func = func;
+	w->name = name;
+	w->flags = flags & ~WORK_PENDING;
+
+	sr = splhigh ();
+	w->all = wq_all;
+	wq_all = w;
+	spl (sr);
+}
+
+/* make one idle worker runnable; called with interrupts off
+ */
+static void
+wq_kick (void)
+{
+	int i;
+
+	for (i = 0; i < WQ_THREADS; i++)
+	{
+		struct proc *p = wq_thread[i];
+
+		if (p && p->wait_cond == WQ_COND)
+		{
+			p->wait_cond = 0;
+			if (p->wait_q == WAIT_Q)
+			{
+				rm_q (WAIT_Q, p);
+				add_q (READY_Q, p);
+			}
+			break;
+		}
+	}
+}
+
+/*
+ * queue w for one of the worker threads; returns 1 if it was queued,
+ * 0 if it is pending already
+ */
+long _cdecl
+queue_work (struct work *w)
+{
+	ushort sr;
+
+	sr = splhigh ();
+
+	if (w->flags & WORK_PENDING)
+	{
+		spl (sr);
+		return 0;
+	}
+
+	w->flags |= WORK_PENDING;
+	w->queued = jiffies;
+	w->next = NULL;
+
+	if (w->flags & WORK_URGENT)
+	{
+		if (wq_urgent)
+			wq_urgent_tail->next = w;
+		else
+			wq_urgent = w;
+		wq_urgent_tail = w;
+	}
+	else
+	{
+		if (wq_normal)
+			wq_normal_tail->next = w;
+		else
+			wq_normal = w;
+		wq_normal_tail = w;
+	}
+
+	wq_kick ();
+
+	spl (sr);
+	return 1;
+}
+
+/* take the next item off the queue; called with interrupts off
+ */
+static struct work *
+wq_get (void)
+{
+	struct work *w;
+
+	if ((w = wq_urgent))
+		wq_urgent = w->next;
+	else if ((w = wq_normal))
+		wq_normal = w->next;
+
+	if (w)
+	{
+		w->flags &= ~WORK_PENDING;
+		w->next = NULL;
+	}
+
+	return w;
+}
+
+static void _cdecl
+workq_thread (void *arg)
+{
+	struct proc *p = get_curproc ();
+
+	UNUSED (arg);
+
+	for (;;)
+	{
+		struct work *w;
+		ulong wait, cpu;
+		ushort sr;
+
+		sr = splhigh ();
+
+		w = wq_get ();
+		if (!w)
+		{
+			p->wait_cond = WQ_COND;
+			spl (sr);
+
+			sleep (WAIT_Q | 0x100, WQ_COND);
+			p->wait_cond = 0;
+			continue;
+		}
+
+		wait = jiffies - w->queued;
+		spl (sr);
+
+		if (wait > w->max_wait)
+			w->max_wait = wait;
+
+		cpu = p->systime;
+		(*w->func)(w);
+		cpu = p->systime - cpu;
+
+		w->runs++;
+		w->cpu += cpu;
+		if (cpu > w->max_cpu)
+			w->max_cpu = cpu;
+	}
+
+	kthread_exit (0);
+	/* not reached */
+}
+
+void
+workq_init (void)
+{
+	int i;
+
+	for (i = 0; i < WQ_THREADS; i++)
+	{
+		long r;
+
+		r = kthread_create (NULL, workq_thread, NULL, &wq_thread[i], "worker%d", i);
+		if (r != 0)
+			FATAL ("can't create \"worker%d\" kernel thread", i);
+	}
+}
+
+long
+workq_dump (char *buf, long len)
+{
+	struct work *w;
+	char *crs = buf;
+	long i;
+
+	i = ksprintf (crs, len, "name                 runs    cpu_ms max_cpu max_wait pending\n");
+	crs += i; len -= i;
+
+	for (w = wq_all; w && len > 80; w = w->all)
+	{
+		i = ksprintf (crs, len, "%-16s %8lu %9lu %7lu %8lu %s\n",
+			      w->name, w->runs, w->cpu, w->max_cpu,
+			      w->max_wait, (w->flags & WORK_PENDING) ? "yes" : "no");
+		crs += i; len -= i;
+	}
+
+	return crs - buf;
+}
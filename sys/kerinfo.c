@@ -41,8 +41,10 @@
 # include "filesys.h"		/* changedrv, denyshare, denylock */
 # include "ipc_socketutil.h"	/* so_* */
 # include "k_kthread.h"		/* kthread_create, kthread_exit */
+# include "k_workq.h"		/* work_init, queue_work */
 # include "kmemory.h"		/* kmalloc, kfree */
 # include "module.h"		/* load_modules */
+# include "pcache.h"		/* pcache */
 # include "proc.h"		/* sleep, wake, wakeselect, iwake */
 # include "signal.h"		/* ikill */
 # include "syscall_vectors.h"	/* bios_tab, dos_tab */
@@ -89,7 +91,7 @@ struct kerinfo kernelinfo =
 	MINT_MAJ_VERSION,
 	MINT_MIN_VERSION,
 	DEFAULT_MODE,
-	2, /* MINT_KVERSION */
+	3, /* MINT_KVERSION */
 	bios_tab, dos_tab,
 	m_changedrv,
 	Trace, Debug, ALERT, FATAL,
@@ -141,7 +143,11 @@ struct kerinfo kernelinfo =
 
 	remaining_proc_time,
 
-	{
-		0
-	}
+	&pcache,
+
+	/* version 3
+	 */
+
+	work_init,
+	queue_work
 };
@@ -234,6 +234,13 @@ struct ktab
 # define ROOTDIR_BUILDINFO	0x12
 # define ROOTDIR_STAT       	0x13
 # define ROOTDIR_SYSDIR		0x14
+# define ROOTDIR_EXECCACHE	0x15
+# define ROOTDIR_SYSVMSG	0x16
+# define ROOTDIR_LOCKS		0x17
+# define ROOTDIR_KPROF		0x18
+# define ROOTDIR_KTRACE		0x19
+# define ROOTDIR_WORKQ		0x1a
+# define ROOTDIR_SCHEDLAT	0x1b
 
 static KENTRY __rootdir [] =
 {
@@ -245,20 +252,27 @@ static KENTRY __rootdir [] =
 	{ ROOTDIR_CPUINFO,	S_IFREG | 0444,	"cpuinfo",	kern_get_cpuinfo	},
 	{ ROOTDIR_DEVICES,	S_IFREG | 0444,	"devices",	kern_get_unimplemented	},
 	{ ROOTDIR_DMA,		S_IFREG | 0444,	"dma",		kern_get_unimplemented	},
+	{ ROOTDIR_EXECCACHE,	S_IFREG | 0444,	"execcache",	kern_get_execcache	},
 	{ ROOTDIR_FILESYSTEMS,	S_IFREG | 0444,	"filesystems",	kern_get_filesystems	},
 	{ ROOTDIR_HZ,		S_IFREG | 0444,	"hz",		kern_get_hz		},
+	{ ROOTDIR_KPROF,	S_IFREG | 0444,	"kprof",	kern_get_kprof		},
+	{ ROOTDIR_KTRACE,	S_IFREG | 0444,	"ktrace",	kern_get_ktrace		},
 	{ ROOTDIR_LOADAVG,	S_IFREG | 0444,	"loadavg",	kern_get_loadavg	},
+	{ ROOTDIR_LOCKS,	S_IFREG | 0444,	"locks",	kern_get_locks		},
 # ifdef DEBUG_INFO
 	{ ROOTDIR_MEMDEBUG,	S_IFREG | 0444,	"memdebug",	kern_get_memdebug	},
 # endif
 	{ ROOTDIR_MEMINFO,	S_IFREG | 0444,	"meminfo",	kern_get_meminfo	},
+	{ ROOTDIR_SCHEDLAT,	S_IFREG | 0444,	"schedlat",	kern_get_schedlat	},
 	{ ROOTDIR_SELF,		S_IFLNK | 0777,	"self",		kern_get_unimplemented	},
 	{ ROOTDIR_STAT,		S_IFREG | 0444,	"stat",		kern_get_stat		},
 	{ ROOTDIR_SYSDIR,	S_IFREG | 0444, "sysdir",	kern_get_sysdir		},
+	{ ROOTDIR_SYSVMSG,	S_IFREG | 0444,	"sysvmsg",	kern_get_sysvmsg	},
 	{ ROOTDIR_TIME,		S_IFREG | 0444,	"time",		kern_get_time		},
 	{ ROOTDIR_UPTIME,	S_IFREG | 0444,	"uptime",	kern_get_uptime		},
 	{ ROOTDIR_VERSION,	S_IFREG | 0444,	"version",	kern_get_version	},
-	{ ROOTDIR_WELCOME,	S_IFREG | 0444,	"welcome",	kern_get_welcome	}
+	{ ROOTDIR_WELCOME,	S_IFREG | 0444,	"welcome",	kern_get_welcome	},
+	{ ROOTDIR_WORKQ,	S_IFREG | 0444,	"workq",	kern_get_workq		}
 };
 
 static KTAB _rootdir =
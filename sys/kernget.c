@@ -60,16 +60,22 @@
 # include "biosfs.h"
 # include "cookie.h"
 # include "delay.h"
+# include "execcache.h"
 # include "filesys.h"
 # include "info.h"
+# include "k_semaphore.h"
+# include "k_workq.h"
 # include "kernfs.h"
 # include "kmemory.h"
+# include "kprof.h"
+# include "ktrace.h"
 # include "memory.h"
 # include "pipefs.h"
 # include "proc.h"
 # include "procfs.h"
 # include "random.h"
 # include "shmfs.h"
+# include "sysv_msg.h"
 # include "time.h"
 # include "timeout.h"
 # include "unifs.h"
@@ -225,6 +231,24 @@ kern_get_cookiejar (SIZEBUF **buffer, const struct proc *p)
 	return 0;
 }
 
+long
+kern_get_execcache (SIZEBUF **buffer, const struct proc *p)
+{
+	SIZEBUF *info;
+	ulong len = 4096;
+
+	UNUSED(p);
+
+	info = kmalloc (sizeof (*info) + len);
+	if (!info)
+		return ENOMEM;
+
+	info->len = exec_cache_dump (info->buf, len);
+
+	*buffer = info;
+	return 0;
+}
+
 long
 kern_get_filesystems (SIZEBUF **buffer, const struct proc *p)
 {
@@ -315,6 +339,42 @@ kern_get_hz (SIZEBUF **buffer, const struct proc *p)
 	return 0;
 }
 
+long
+kern_get_kprof (SIZEBUF **buffer, const struct proc *p)
+{
+	SIZEBUF *info;
+	ulong len = kprof_size ();
+
+	UNUSED(p);
+
+	info = kmalloc (sizeof (*info) + len);
+	if (!info)
+		return ENOMEM;
+
+	info->len = kprof_dump (info->buf, len);
+
+	*buffer = info;
+	return 0;
+}
+
+long
+kern_get_ktrace (SIZEBUF **buffer, const struct proc *p)
+{
+	SIZEBUF *info;
+	ulong len = ktrace_size ();
+
+	UNUSED(p);
+
+	info = kmalloc (sizeof (*info) + len);
+	if (!info)
+		return ENOMEM;
+
+	info->len = ktrace_dump (info->buf, len);
+
+	*buffer = info;
+	return 0;
+}
+
 /* Functions that fill our read buffers */
 # define FSHIFT		11
 # define FIXED_1	(1 << FSHIFT)		/* 1.0 as fixed-point */
@@ -358,6 +418,24 @@ kern_get_loadavg (SIZEBUF **buffer, const struct proc *p)
 	return 0;
 }
 
+long
+kern_get_locks (SIZEBUF **buffer, const struct proc *p)
+{
+	SIZEBUF *info;
+	ulong len = 1024;
+
+	UNUSED(p);
+
+	info = kmalloc (sizeof (*info) + len);
+	if (!info)
+		return ENOMEM;
+
+	info->len = lockstat_dump (info->buf, len);
+
+	*buffer = info;
+	return 0;
+}
+
 
 /*
   /kern/meminfo
@@ -440,6 +518,24 @@ kern_get_meminfo (SIZEBUF **buffer, const struct proc *p)
 	return 0;
 }
 
+long
+kern_get_schedlat (SIZEBUF **buffer, const struct proc *p)
+{
+	SIZEBUF *info;
+	ulong len = 512;
+
+	UNUSED(p);
+
+	info = kmalloc (sizeof (*info) + len);
+	if (!info)
+		return ENOMEM;
+
+	info->len = schedlat_dump (info->buf, len);
+
+	*buffer = info;
+	return 0;
+}
+
 
 /**
  * /kern/stat
@@ -509,6 +605,24 @@ kern_get_sysdir (SIZEBUF **buffer, const struct proc *p)
 	return 0;
 }
 
+long
+kern_get_sysvmsg (SIZEBUF **buffer, const struct proc *p)
+{
+	SIZEBUF *info;
+	ulong len = 2048;
+
+	UNUSED(p);
+
+	info = kmalloc (sizeof (*info) + len);
+	if (!info)
+		return ENOMEM;
+
+	info->len = msg_dump (info->buf, len);
+
+	*buffer = info;
+	return 0;
+}
+
 /*
  *
  */
@@ -651,6 +765,24 @@ kern_get_welcome (SIZEBUF **buffer, const struct proc *p)
 	return 0;
 }
 
+long
+kern_get_workq (SIZEBUF **buffer, const struct proc *p)
+{
+	SIZEBUF *info;
+	ulong len = 1024;
+
+	UNUSED(p);
+
+	info = kmalloc (sizeof (*info) + len);
+	if (!info)
+		return ENOMEM;
+
+	info->len = workq_dump (info->buf, len);
+
+	*buffer = info;
+	return 0;
+}
+
 
 long
 kern_procdir_get_cmdline (SIZEBUF **buffer, const struct proc *p)
@@ -1017,9 +1149,9 @@ kern_procdir_get_stat (SIZEBUF **buffer, const struct proc *p)
 			break;
 	}
 
-	if (p->p_fd && p->p_fd->control)
+	if (p->p_fd && FD_CONTROL(p->p_fd))
 	{
-		struct tty *tty = (struct tty *) p->p_fd->control->devinfo;
+		struct tty *tty = (struct tty *) FD_CONTROL(p->p_fd)->devinfo;
 		ttypgrp = tty->pgrp;
 	}
 
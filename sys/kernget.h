@@ -45,16 +45,23 @@ long kern_get_unimplemented	(SIZEBUF **buffer, const struct proc *p);
 long kern_get_bootlog (SIZEBUF **buffer, const struct proc *p);
 long kern_get_buildinfo		(SIZEBUF **buffer, const struct proc *p);
 long kern_get_cookiejar		(SIZEBUF **buffer, const struct proc *p);
+long kern_get_execcache		(SIZEBUF **buffer, const struct proc *p);
 long kern_get_filesystems	(SIZEBUF **buffer, const struct proc *p);
 long kern_get_hz		(SIZEBUF **buffer, const struct proc *p);
+long kern_get_kprof		(SIZEBUF **buffer, const struct proc *p);
+long kern_get_ktrace		(SIZEBUF **buffer, const struct proc *p);
 long kern_get_loadavg		(SIZEBUF **buffer, const struct proc *p);
+long kern_get_locks		(SIZEBUF **buffer, const struct proc *p);
 long kern_get_meminfo		(SIZEBUF **buffer, const struct proc *p);
+long kern_get_schedlat		(SIZEBUF **buffer, const struct proc *p);
 long kern_get_stat              (SIZEBUF **buffer, const struct proc *p);
 long kern_get_sysdir		(SIZEBUF **buffer, const struct proc *p);
+long kern_get_sysvmsg		(SIZEBUF **buffer, const struct proc *p);
 long kern_get_time		(SIZEBUF **buffer, const struct proc *p);
 long kern_get_uptime		(SIZEBUF **buffer, const struct proc *p);
 long kern_get_version		(SIZEBUF **buffer, const struct proc *p);
 long kern_get_welcome		(SIZEBUF **buffer, const struct proc *p);
+long kern_get_workq		(SIZEBUF **buffer, const struct proc *p);
 
 long kern_procdir_get_cmdline	(SIZEBUF **buffer, const struct proc *p);
 long kern_procdir_get_environ	(SIZEBUF **buffer,       const struct proc *p);
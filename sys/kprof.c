@@ -0,0 +1,222 @@
+/*
+ * This file belongs to FreeMiNT. It's not in the original MiNT 1.12
+ * distribution. See the file CHANGES for a detailed log of changes.
+ * 
+ * 
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ * 
+ * This file is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ * 
+ * 
+ * Statistical kernel profiler.
+ * 
+ * Unlike gmon/mcount this needs no special kernel build: when switched
+ * on (sysctl kern.profile=1) the 200 Hz timer interrupt hands the
+ * interrupted PC to kprof_tick().  Samples taken inside the kernel are
+ * counted in a histogram over the kernel text with KPROF_SHIFT
+ * granularity, and against the GEMDOS/BIOS/XBIOS call curproc is
+ * executing.  kern.profile=0 stops sampling, the counts stay readable
+ * until the next start.
+ * 
+ * /kern/kprof is plain text; tools/kprof resolves the offsets against
+ * the kernel map (map.txt) into a flat profile:
+ * 
+ *	# kprof hz 200 text <base> <len> shift <KPROF_SHIFT>
+ *	# samples <all> kernel <in text> user <in user mode> other <rest>
+ *	pc <offset from text base> <count>
+ *	...
+ *	sys <gemdos|bios|xbios> <function number> <count>
+ *	...
+ * 
+ */
+
+# include "kprof.h"
+
+# include "libkern/libkern.h"
+# include "mint/basepage.h"
+
+# include "arch/kernel.h"	/* in_kernel */
+
+# include "global.h"
+# include "kmemory.h"
+# include "proc.h"
+# include "syscall_vectors.h"
+
+
+/* 32 byte buckets keep a 512k kernel below 64k of counters
+ */
+# define KPROF_SHIFT	5
+
+ushort kprof_on = 0;
+
+static ulong *pc_hist;		/* text histogram */
+static ulong *sys_hist;		/* dos_max + bios_max + xbios_max counters */
+static ulong nbuckets;
+static ulong text_base;
+static ulong text_len;
+
+static ulong nsamples;
+static ulong nkernel;
+static ulong nuser;
+
+
+/* called from the 5ms timer interrupt while kprof_on is set
+ */
+void
+kprof_tick (void *pc)
+{
+	ulong off;
+	
+	nsamples++;
+	
+	if (!in_kernel)
+	{
+		nuser++;
+		return;
+	}
+	
+	off = (ulong) pc - text_base;
+	if (off < text_len)
+	{
+		pc_hist[off >> KPROF_SHIFT]++;
+		nkernel++;
+	}
+	
+	if (curproc && curproc->sys_tab)
+	{
+		ushort nr = curproc->sys_nr;
+		
+		if (curproc->sys_tab == dos_tab)
+		{
+			if (nr < dos_max)
+				sys_hist[nr]++;
+		}
+		else if (curproc->sys_tab == bios_tab)
+		{
+			if (nr < bios_max)
+				sys_hist[dos_max + nr]++;
+		}
+		else if (curproc->sys_tab == xbios_tab)
+		{
+			if (nr < xbios_max)
+				sys_hist[dos_max + bios_max + nr]++;
+		}
+	}
+}
+
+/* kern.profile sysctl: 1 clears the counters and starts sampling, 0 stops
+ */
+long
+kprof_control (long on)
+{
+	if (!on)
+	{
+		kprof_on = 0;
+		return 0;
+	}
+	
+	if (kprof_on)
+		return 0;
+	
+	if (!pc_hist)
+	{
+		ulong size;
+		
+		text_base = _base->p_tbase;
+		text_len = _base->p_tlen;
+		nbuckets = (text_len + (1UL << KPROF_SHIFT) - 1) >> KPROF_SHIFT;
+		
+		size = (nbuckets + dos_max + bios_max + xbios_max) * sizeof (*pc_hist);
+		
+		pc_hist = kmalloc (size);
+		if (!pc_hist)
+			return ENOMEM;
+		
+		sys_hist = pc_hist + nbuckets;
+	}
+	
+	mint_bzero (pc_hist, (nbuckets + dos_max + bios_max + xbios_max) * sizeof (*pc_hist));
+	nsamples = nkernel = nuser = 0;
+	
+	kprof_on = 1;
+	return 0;
+}
+
+/* upper bound for the kprof_dump() output
+ */
+long
+kprof_size (void)
+{
+	long lines = 0;
+	ulong i;
+	
+	if (!pc_hist)
+		return 128;
+	
+	for (i = 0; i < nbuckets + dos_max + bios_max + xbios_max; i++)
+		if (pc_hist[i])
+			lines++;
+	
+	/* the counters keep running, leave room for new buckets */
+	return 128 + (lines + 64) * 32;
+}
+
+/*
+ * /kern/kprof
+ */
+long
+kprof_dump (char *buf, long len)
+{
+	static const char *trap[] = { "gemdos", "bios", "xbios" };
+	ushort max[3];
+	char *crs = buf;
+	ulong i, base;
+	long l;
+	int t;
+	
+	l = ksprintf (crs, len, "# kprof hz 200 text 0x%08lx 0x%06lx shift %d\n"
+			"# samples %lu kernel %lu user %lu other %lu\n",
+			text_base, text_len, KPROF_SHIFT,
+			nsamples, nkernel, nuser, nsamples - nkernel - nuser);
+	crs += l; len -= l;
+	
+	if (!pc_hist)
+		return crs - buf;
+	
+	for (i = 0; i < nbuckets && len > 32; i++)
+	{
+		if (pc_hist[i])
+		{
+			l = ksprintf (crs, len, "pc 0x%06lx %lu\n", i << KPROF_SHIFT, pc_hist[i]);
+			crs += l; len -= l;
+		}
+	}
+	
+	max[0] = dos_max;
+	max[1] = bios_max;
+	max[2] = xbios_max;
+	
+	for (t = 0, base = 0; t < 3; base += max[t], t++)
+	{
+		for (i = 0; i < max[t] && len > 32; i++)
+		{
+			if (sys_hist[base + i])
+			{
+				l = ksprintf (crs, len, "sys %s 0x%03lx %lu\n", trap[t], i, sys_hist[base + i]);
+				crs += l; len -= l;
+			}
+		}
+	}
+	
+	return crs - buf;
+}
@@ -0,0 +1,38 @@
+/*
+ * This file belongs to FreeMiNT. It's not in the original MiNT 1.12
+ * distribution. See the file CHANGES for a detailed log of changes.
+ * 
+ * 
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ * 
+ * This file is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ * 
+ * 
+ * Statistical kernel profiler, see kprof.c
+ * 
+ */
+
+# ifndef _kprof_h
+# define _kprof_h
+
+# include "mint/mint.h"
+
+
+extern ushort kprof_on;
+
+void kprof_tick (void *pc);
+long kprof_control (long on);
+long kprof_size (void);
+long kprof_dump (char *buf, long len);
+
+# endif /* _kprof_h */
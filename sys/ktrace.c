@@ -0,0 +1,184 @@
+/*
+ * This file belongs to FreeMiNT. It's not in the original MiNT 1.12
+ * distribution. See the file CHANGES for a detailed log of changes.
+ * 
+ * 
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ * 
+ * This file is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ * 
+ * 
+ * Kernel event trace buffer.
+ * 
+ * A ring of KTRACE_EVENTS fixed size binary records (mint/ktrace.h),
+ * the oldest get overwritten.  sysctl kern.trace sets the mask of event
+ * classes to record, 0 switches tracing off; going from off to on
+ * empties the ring.  /kern/ktrace returns the header and the ring
+ * contents oldest first, tools/ktrace prints them.
+ * 
+ */
+
+# include "ktrace.h"
+
+# include "libkern/libkern.h"
+# include "mint/asm.h"
+
+# include "arch/timer.h"	/* jiffies */
+
+# include "kmemory.h"
+# include "proc.h"
+# include "syscall_vectors.h"
+
+
+# define KTRACE_EVENTS	4096	/* power of 2 */
+
+ushort ktrace_on = 0;
+
+static struct ktrace_event *ring;
+static ulong head;		/* next slot to fill */
+static ulong count;		/* valid events in ring */
+static ulong lost;
+
+
+/* may be called from interrupts (wake)
+ */
+void
+ktrace_log (int type, int arg, long a, long b, long c)
+{
+	struct ktrace_event *e;
+	ushort sr;
+	
+	sr = splhigh ();
+	
+	e = &ring[head];
+	head = (head + 1) & (KTRACE_EVENTS - 1);
+	
+	if (count < KTRACE_EVENTS)
+		count++;
+	else
+		lost++;
+	
+	e->time = jiffies;
+	e->pid = curproc ? curproc->pid : -1;
+	e->type = type;
+	e->arg = arg;
+	e->a = a;
+	e->b = b;
+	e->c = c;
+	
+	spl (sr);
+}
+
+static int
+trap_index (Func *tab)
+{
+	if (tab == dos_tab)
+		return 0;
+	if (tab == bios_tab)
+		return 1;
+	
+	return 2;
+}
+
+/* called from the trap dispatcher while ktrace_on is set
+ */
+void
+ktrace_sysenter (void)
+{
+	if (!(ktrace_on & KTC_SYSCALL))
+		return;
+	
+	curproc->sys_start = jiffies;
+	ktrace_log (KT_SYSENTER, trap_index (curproc->sys_tab), curproc->sys_nr, 0, 0);
+}
+
+void
+ktrace_sysexit (long ret)
+{
+	if (!(ktrace_on & KTC_SYSCALL) || !curproc->sys_tab)
+		return;
+	
+	ktrace_log (KT_SYSEXIT, trap_index (curproc->sys_tab), curproc->sys_nr, ret,
+		    jiffies - curproc->sys_start);
+}
+
+/* kern.trace sysctl
+ */
+long
+ktrace_control (long mask)
+{
+	mask &= (KTC_SYSCALL | KTC_SCHED | KTC_BIO);
+	
+	if (mask && !ktrace_on)
+	{
+		if (!ring)
+		{
+			ring = kmalloc (KTRACE_EVENTS * sizeof (*ring));
+			if (!ring)
+				return ENOMEM;
+		}
+		
+		head = count = lost = 0;
+	}
+	
+	ktrace_on = mask;
+	return 0;
+}
+
+long
+ktrace_size (void)
+{
+	return sizeof (struct ktrace_header) + count * sizeof (struct ktrace_event);
+}
+
+/*
+ * /kern/ktrace
+ */
+long
+ktrace_dump (char *buf, long len)
+{
+	struct ktrace_header *h = (struct ktrace_header *) buf;
+	struct ktrace_event *e = (struct ktrace_event *)(h + 1);
+	ulong n, i, first;
+	ushort sr;
+	
+	if (len < sizeof (*h))
+		return 0;
+	
+	/* events logged while copying may overwrite the oldest ones,
+	 * that's acceptable for a trace
+	 */
+	sr = splhigh ();
+	n = count;
+	first = (head - n) & (KTRACE_EVENTS - 1);
+	spl (sr);
+	
+	if (n > (len - sizeof (*h)) / sizeof (*e))
+	{
+		ulong skip = n - (len - sizeof (*h)) / sizeof (*e);
+		
+		first = (first + skip) & (KTRACE_EVENTS - 1);
+		n -= skip;
+	}
+	
+	h->magic = KTRACE_MAGIC;
+	h->version = KTRACE_VERSION;
+	h->hz = 200;
+	h->nevents = n;
+	h->lost = lost;
+	
+	for (i = 0; i < n; i++)
+		e[i] = ring[(first + i) & (KTRACE_EVENTS - 1)];
+	
+	return sizeof (*h) + n * sizeof (*e);
+}
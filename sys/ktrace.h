@@ -0,0 +1,45 @@
+/*
+ * This file belongs to FreeMiNT. It's not in the original MiNT 1.12
+ * distribution. See the file CHANGES for a detailed log of changes.
+ * 
+ * 
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ * 
+ * This file is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ * 
+ * 
+ * Kernel event trace buffer, see ktrace.c
+ * 
+ */
+
+# ifndef _ktrace_h
+# define _ktrace_h
+
+# include "mint/mint.h"
+# include "mint/ktrace.h"
+
+
+extern ushort ktrace_on;
+
+/* a test and a branch while tracing is off */
+# define KTRACE(class, type, arg, a, b, c) \
+	do { if (ktrace_on & (class)) ktrace_log (type, arg, a, b, c); } while (0)
+
+void ktrace_log (int type, int arg, long a, long b, long c);
+void ktrace_sysenter (void);
+void ktrace_sysexit (long ret);
+long ktrace_control (long mask);
+long ktrace_size (void);
+long ktrace_dump (char *buf, long len);
+
+# endif /* _ktrace_h */
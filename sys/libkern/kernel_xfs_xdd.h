@@ -728,6 +728,9 @@ INLINE long p_sysctl(long *name, ulong namelen, void *old, ulong *oldlenp, const
 # define ikill			(*KERNEL->ikill)
 # define iwake			(*KERNEL->iwake)
 # define bio			(*KERNEL->bio)
+# define pcache			(*KERNEL->pagecache)
+# define work_init		(*KERNEL->work_init)	/* MINT_KVERSION >= 3 */
+# define queue_work		(*KERNEL->queue_work)	/* MINT_KVERSION >= 3 */
 # define utc			(*KERNEL->xtime)
 # define add_rsvfentry		(*KERNEL->add_rsvfentry)
 # define del_rsvfentry		(*KERNEL->del_rsvfentry)
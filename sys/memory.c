@@ -25,6 +25,7 @@
 # include "arch/user_things.h"
 
 # include "bios.h"
+# include "execcache.h"
 # include "filesys.h"
 # include "info.h"
 # include "init.h"		/* boot_printf() */
@@ -105,6 +106,9 @@ static void sanity_check	(MMAP map, ulong line);
 
 short forcefastload = 0;		/* for MINT.CNF keyword */
 unsigned long initialmem = 1024;	/* ditto */
+# ifdef COW_FORK
+short cow_fork = 1;			/* ditto */
+# endif
 
 /*
  * memory.c:: routines for managing memory regions
@@ -495,6 +499,9 @@ change_prot_status (PROC *proc, long start, short newmode)
 	return EACCES;
 
 found:
+# ifdef COW_FORK
+	cow_unshare(*mr);
+# endif
 	mark_region(*mr, newmode, 0);
 	return E_OK;
 }
@@ -799,6 +806,312 @@ win:
 	return n;
 }
 
+# ifdef COW_FORK
+/*
+ * Copy-on-write fork
+ *
+ * Instead of copying a region into its save region on Pfork(), the
+ * save region gets a map of the pages that are still identical to the
+ * contents of the region itself, i.e. of the process that currently
+ * owns the region memory (the one whose descriptor has no save region).
+ * These pages are write protected for that process; the first write
+ * faults into cow_fault(), which copies the page into every save region
+ * still sharing it. On a context switch only the pages the incoming
+ * process doesn't share are exchanged (see swap_in_curproc()).
+ */
+
+struct cowmap
+{
+	long	shared;		/* number of bits set in map */
+	ulong	map[1];		/* bit set: page equals the region contents */
+};
+
+# define COW_PAGES(reg)		((reg)->len / QUANTUM)
+# define COW_SHARED(cow, pg)	((cow)->map[(pg) >> 5] & (1UL << ((pg) & 31)))
+
+/* number of save regions with a cowmap */
+static long cow_saves = 0;
+
+static struct cowmap *
+cow_alloc (MEMREGION *reg)
+{
+	struct cowmap *cow;
+	ulong n;
+
+	if (!cow_fork || no_mem_prot)
+		return NULL;
+
+	/* global memory can be written without faulting */
+	if (get_prot_mode (reg) != PROT_P)
+		return NULL;
+
+	if ((reg->loc & MASKBITS) || (reg->len & MASKBITS) || !reg->len)
+		return NULL;
+
+	n = (COW_PAGES (reg) + 31) / 32;
+	cow = kmalloc (sizeof (*cow) + (n - 1) * sizeof (ulong));
+	if (cow)
+	{
+		memset (cow->map, 0xff, n * sizeof (ulong));
+		cow->shared = COW_PAGES (reg);
+	}
+
+	return cow;
+}
+
+/* give every save region of the shadow ring that still shares page pg
+ * with the region contents its own copy (except skip)
+ */
+static void
+cow_copy (MEMREGION *reg, ulong pg, MEMREGION *skip)
+{
+	ulong offset = pg * QUANTUM;
+	MEMREGION *m = reg;
+
+	do {
+		MEMREGION *save = m->save;
+
+		if (save && save != skip && save->cow && COW_SHARED (save->cow, pg))
+		{
+			quickmove ((char *)save->loc + offset, (char *)reg->loc + offset, QUANTUM);
+			save->cow->map[pg >> 5] &= ~(1UL << (pg & 31));
+			save->cow->shared--;
+		}
+
+		m = m->shadow;
+	}
+	while (m && m != reg);
+}
+
+static int
+cow_shared (MEMREGION *reg, ulong pg)
+{
+	MEMREGION *m = reg;
+
+	do {
+		MEMREGION *save = m->save;
+
+		if (save && save->cow && COW_SHARED (save->cow, pg))
+			return 1;
+
+		m = m->shadow;
+	}
+	while (m && m != reg);
+
+	return 0;
+}
+
+/*
+ * cow_protect(mem, reg): reg has become the owner of the region
+ * contents; write protect the shared pages in the page table of mem
+ * and unprotect the others
+ */
+void
+cow_protect (struct memspace *mem, MEMREGION *reg)
+{
+	ulong pg, start, npages = COW_PAGES (reg);
+	int shared, s;
+
+	if (!npages)
+		return;
+
+	start = 0;
+	shared = cow_shared (reg, 0);
+
+	for (pg = 1; pg <= npages; pg++)
+	{
+		s = (pg < npages) ? cow_shared (reg, pg) : -1;
+		if (s != shared)
+		{
+			prot_cow (mem, reg->loc + start * QUANTUM, (pg - start) * QUANTUM, shared);
+			start = pg;
+			shared = s;
+		}
+	}
+}
+
+static void
+cow_protect_owners (MEMREGION *reg)
+{
+	PROC *p;
+	int i;
+
+	for (p = proclist; p; p = p->gl_next)
+	{
+		struct memspace *mem = p->p_mem;
+
+		if (p->wait_q == ZOMBIE_Q || p->wait_q == TSR_Q)
+			continue;
+		if (!mem || !mem->mem)
+			continue;
+
+		for (i = 0; i < mem->num_reg; i++)
+		{
+			if (mem->mem[i] == reg)
+			{
+				cow_protect (mem, reg);
+				break;
+			}
+		}
+	}
+}
+
+/*
+ * cow_swap(mem, m, save): called on a context switch after the
+ * save region of m was given to the previous owner; exchange the
+ * pages the incoming process doesn't share. Returns 0 if save is
+ * an ordinary save region that must be swapped completely.
+ */
+int
+cow_swap (struct memspace *mem, MEMREGION *m, MEMREGION *save)
+{
+	struct cowmap *cow = save->cow;
+	ulong pg, npages = COW_PAGES (m);
+
+	if (!cow)
+	{
+		cow_unshare (m);
+		return 0;
+	}
+
+	/* other save regions lose the contents they share with the
+	 * outgoing process
+	 */
+	for (pg = 0; pg < npages; pg++)
+	{
+		if (!COW_SHARED (cow, pg))
+			cow_copy (m, pg, save);
+	}
+
+	cow_protect (mem, m);
+
+	if (!cow->shared)
+	{
+		quickswap ((char *)m->loc, (char *)save->loc, m->len);
+		return 1;
+	}
+
+	for (pg = 0; pg < npages; pg++)
+	{
+		if (!COW_SHARED (cow, pg))
+			quickswap ((char *)m->loc + pg * QUANTUM,
+				   (char *)save->loc + pg * QUANTUM, QUANTUM);
+	}
+
+	return 1;
+}
+
+/*
+ * cow_restore(reg, save): the region owning the contents is freed,
+ * copy the pages the owner of save doesn't share back. Returns 0 if
+ * save is an ordinary save region.
+ */
+int
+cow_restore (MEMREGION *reg, MEMREGION *save)
+{
+	struct cowmap *cow = save->cow;
+	ulong pg;
+
+	if (!cow)
+	{
+		cow_unshare (reg);
+		return 0;
+	}
+
+	for (pg = 0; pg < COW_PAGES (reg); pg++)
+	{
+		if (!COW_SHARED (cow, pg))
+		{
+			cow_copy (reg, pg, save);
+			quickmove ((char *)reg->loc + pg * QUANTUM,
+				   (char *)save->loc + pg * QUANTUM, QUANTUM);
+		}
+	}
+
+	return 1;
+}
+
+/*
+ * cow_unshare(reg): copy all pages shared with the contents of reg;
+ * needed before they are changed without the write protection
+ */
+void
+cow_unshare (MEMREGION *reg)
+{
+	ulong pg;
+
+	if (!(reg->mflags & M_COW) || !reg->shadow)
+		return;
+
+	for (pg = 0; pg < COW_PAGES (reg); pg++)
+		cow_copy (reg, pg, NULL);
+}
+
+/*
+ * cow_fault(p, addr): write access of p to addr faulted; returns 1
+ * if this was a write to a page shared after Pfork()
+ */
+int
+cow_fault (PROC *p, ulong addr)
+{
+	MEMREGION *m;
+	ulong pg;
+
+	m = proc_addr2region (p, addr);
+	if (!m || !(m->mflags & M_COW))
+		return 0;
+
+	pg = (addr - m->loc) / QUANTUM;
+
+	TRACELOW (("cow_fault: pid %d, page %lu of %lx", p->pid, pg, m->loc));
+
+	if (m->shadow)
+		cow_copy (m, pg, NULL);
+
+	prot_cow (p->p_mem, m->loc + pg * QUANTUM, QUANTUM, 0);
+	return 1;
+}
+
+/*
+ * cow_break(p, addr, len): copy the shared pages in the range before
+ * the memory is written behind the MMU's back (DMA)
+ */
+void
+cow_break (PROC *p, ulong addr, long len)
+{
+	ulong end = addr + len;
+
+	if (!cow_saves || len <= 0)
+		return;
+
+	while (addr < end)
+	{
+		MEMREGION *m;
+		ulong first, last, pg;
+
+		m = proc_addr2region (p, addr);
+		if (!m)
+		{
+			addr = (addr + QUANTUM) & ~MASKBITS;
+			continue;
+		}
+
+		if ((m->mflags & M_COW) && m->shadow)
+		{
+			first = (addr - m->loc) / QUANTUM;
+			last = ((end < m->loc + m->len ? end : m->loc + m->len) - 1 - m->loc) / QUANTUM;
+
+			for (pg = first; pg <= last; pg++)
+				cow_copy (m, pg, NULL);
+
+			prot_cow (p->p_mem, m->loc + first * QUANTUM, (last - first + 1) * QUANTUM, 0);
+		}
+
+		addr = m->loc + m->len;
+	}
+}
+# endif /* COW_FORK */
+
 /**
  * Free a memory region.
  * @param reg This region should be freed.
@@ -818,6 +1131,9 @@ free_region (MEMREGION *reg)
 	MEMREGION *m, *shdw, *save;
 	long txtsize;
 	int prot_hold;
+# ifdef COW_FORK
+	MEMREGION *resident = NULL;
+# endif
 
 	if (!reg)
 		return;
@@ -854,6 +1170,11 @@ free_region (MEMREGION *reg)
 			assert (prot_hold < 0);
 
 			txtsize = (long)save->save;
+# ifdef COW_FORK
+			if (cow_restore (reg, save))
+				;	/* only the unshared pages were copied */
+			else
+# endif
 			if (!txtsize)
 				quickmove((char *)reg->loc, (char *)save->loc,
 					  reg->len);
@@ -867,6 +1188,9 @@ free_region (MEMREGION *reg)
 					  reg->len - (txtsize+256));
 			}
 			shdw->save = 0;
+# ifdef COW_FORK
+			resident = shdw;
+# endif
 
 			if (prot_hold != -1)
 				prot_temp(reg->loc, reg->len, prot_hold);
@@ -897,6 +1221,21 @@ free_region (MEMREGION *reg)
 			free_region (reg);
 		}
 
+# ifdef COW_FORK
+		/* the new owner of the contents may share pages
+		 * with the remaining save regions
+		 */
+		if (resident && resident->shadow)
+			cow_protect_owners (resident);
+
+		if (save->cow)
+		{
+			kfree (save->cow);
+			save->cow = NULL;
+			cow_saves--;
+		}
+# endif
+
 		/* Free the save region instead of the original region */
 		save->mflags &= ~M_FSAVED;
 		save->save = 0;
@@ -1286,9 +1625,18 @@ fork_region (MEMREGION *reg, long txtsize)
 {
 	long len;
 	MEMREGION *shdw, *save;
+# ifdef COW_FORK
+	struct cowmap *cow = NULL;
+# endif
 
 	assert (reg != 0);
 	len = reg->len;
+# ifdef COW_FORK
+	/* the text pages are never written, so they are never copied */
+	cow = cow_alloc (reg);
+	if (cow)
+		txtsize = 0;
+# endif
 	if (txtsize)
 	{
 		len -= txtsize;
@@ -1300,7 +1648,7 @@ fork_region (MEMREGION *reg, long txtsize)
 	 */
 	shdw = kmr_get ();
 	if (!shdw)
-		return 0;
+		goto nomem;
 
 	save = get_region(alt, len, PROT_S);
 	if (!save)
@@ -1309,7 +1657,7 @@ fork_region (MEMREGION *reg, long txtsize)
 		if (!save)
 		{
 			kmr_free (shdw);
-			return 0;
+			goto nomem;
 		}
 	}
 
@@ -1324,6 +1672,17 @@ fork_region (MEMREGION *reg, long txtsize)
 	reg->next = shdw;
 	reg->shadow = shdw;
 
+# ifdef COW_FORK
+	if (cow)
+	{
+		/* Nothing to copy now, all pages are shared until written */
+		reg->mflags |= M_COW;
+		shdw->mflags |= M_COW;
+		save->cow = cow;
+		cow_saves++;
+	}
+	else
+# endif
 	/* Now copy the contents of the region into the saveplace region */
 	if (!txtsize)
 		quickmove((char *)save->loc, (char *)reg->loc, len);
@@ -1345,8 +1704,16 @@ fork_region (MEMREGION *reg, long txtsize)
 
 	SANITY_CHECK_MAPS ();
 	return shdw;
+
+nomem:
+# ifdef COW_FORK
+	if (cow)
+		kfree (cow);
+# endif
+	return 0;
 }
 
+
 /*
  * routines for creating a copy of an environment, and a new basepage.
  * note that the memory regions created should immediately be attached to
@@ -1551,6 +1918,9 @@ load_region (const char *filename, MEMREGION *env, const char *cmdlin, XATTR *xp
 	BASEPAGE *b;
 	long size, start;
 	FILEHEAD fh;
+	XATTR xattr;
+	struct exec_image *img = NULL;
+	struct exec_fixups fix = { NULL, 0, 0 };
 
 	*err = FP_ALLOC (get_curproc(), &f);
 	if (*err) return NULL;
@@ -1560,9 +1930,9 @@ load_region (const char *filename, MEMREGION *env, const char *cmdlin, XATTR *xp
 	 * TOS file system brain-damage
 	 */
 # if 0
- 	*err = do_open (&f, filename, O_DENYNONE | O_EXEC, 0, xp);
+ 	*err = do_open (&f, filename, O_DENYNONE | O_EXEC, 0, &xattr);
 # else
-	*err = do_open (&f, filename, O_DENYW | O_EXEC, 0, xp);
+	*err = do_open (&f, filename, O_DENYW | O_EXEC, 0, &xattr);
 # endif
 
 	if (*err)
@@ -1572,6 +1942,13 @@ load_region (const char *filename, MEMREGION *env, const char *cmdlin, XATTR *xp
 		return NULL;
 	}
 
+	if (xp) *xp = xattr;
+
+	/* a cached image comes with the already checked header */
+	img = exec_cache_get (&xattr, &fh);
+	if (img)
+		goto header;
+
 	size = xdd_read (f, (void *)&fh, (long)sizeof(fh));
 	if (size != sizeof(fh) || fh.fmagic != GEMDOS_MAGIC)
 	{
@@ -1581,6 +1958,10 @@ failed:
 		if (*err == E_OK)
 			*err = ENOEXEC ;
 
+		if (img)
+			exec_cache_put (img);
+		exec_fixup_free (&fix);
+
 		do_close (get_curproc(), f);
 		return NULL;
 	}
@@ -1591,6 +1972,7 @@ failed:
 		fh.flag = (fh.flag & ~F_PROTMODE) | F_PROT_P;
 	}
 
+header:
 	if (fp) *fp = fh.flag;
 
 	size = fh.ftext + fh.fdata + fh.fbss;
@@ -1626,11 +2008,22 @@ failed:
 	size = fh.ftext + fh.fdata;
 	start = 0;
 
-	*err = load_and_reloc (f, &fh, (char *)b + 256, start, size, b);
-	if (*err)
+	if (img)
 	{
-		detach_region (get_curproc(), reg);
-		goto failed;
+		exec_cache_load (img, (char *)b + 256, b);
+		exec_cache_put (img);
+		img = NULL;
+	}
+	else
+	{
+		*err = load_and_reloc (f, &fh, (char *)b + 256, start, size, b, &fix);
+		if (*err)
+		{
+			detach_region (get_curproc(), reg);
+			goto failed;
+		}
+
+		exec_cache_enter (&xattr, &fh, (char *)b + 256, b, &fix);
 	}
 
 	/* Draco: if the user has set FASTLOAD=YES in the CNF file, the actual
@@ -1685,10 +2078,12 @@ failed:
  * byte of the actual program image in the file). "where" is the address
  * in (physical) memory into which the loaded image must be placed; it is
  * assumed that "where" is big enough to hold "nbytes" bytes!
+ * If "fix" is not NULL, the offsets of the relocated longs are collected
+ * there for the executable image cache.
  */
 
 long
-load_and_reloc (FILEPTR *f, FILEHEAD *fh, char *where, long start, long nbytes, BASEPAGE *base)
+load_and_reloc (FILEPTR *f, FILEHEAD *fh, char *where, long start, long nbytes, BASEPAGE *base, struct exec_fixups *fix)
 {
 	uchar c, *next;
 	long r;
@@ -1768,6 +2163,9 @@ load_and_reloc (FILEPTR *f, FILEHEAD *fh, char *where, long start, long nbytes,
 				    return ENOEXEC;
 			}
 			*((long *)(where + fixup - start)) = reloc;
+
+			if (fix)
+				exec_fixup_add (fix, fixup - start);
 		}
 		do {
 			if (!bytes_read)
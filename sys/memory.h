@@ -10,6 +10,8 @@
 # include "mint/mem.h"
 # include "mint/proc.h"
 
+struct exec_fixups;
+
 
 extern MMAP core, alt, swap;
 
@@ -38,13 +40,22 @@ long	tot_rsize (MMAP map, short flag);
 long	freephysmem (void);
 long 	alloc_region (MMAP map, ulong size, short mode);
 MEMREGION *fork_region (MEMREGION *reg, long txtsize);
+# ifdef COW_FORK
+extern short cow_fork;
+void	cow_protect (struct memspace *mem, MEMREGION *reg);
+int	cow_swap (struct memspace *mem, MEMREGION *m, MEMREGION *save);
+int	cow_restore (MEMREGION *reg, MEMREGION *save);
+void	cow_unshare (MEMREGION *reg);
+int	cow_fault (struct proc *p, ulong addr);
+void	cow_break (struct proc *p, ulong addr, long len);
+# endif
 MEMREGION *create_env (const char *env, ulong flags);
 MEMREGION *create_base (const char *cmd, MEMREGION *env,
 			unsigned long flags, unsigned long prgsize, long *err);
 MEMREGION *load_region (const char *name, MEMREGION *env, const char *cmdlin, XATTR *x,
 			long *fp, long *err);
 long	load_and_reloc (FILEPTR *f, FILEHEAD *fh, char *where, long start,
-			long nbytes, BASEPAGE *base);
+			long nbytes, BASEPAGE *base, struct exec_fixups *fix);
 long	memused (const struct proc *p);
 void	recalc_maxmem (struct proc *p, long size);
 int	valid_address (long addr);
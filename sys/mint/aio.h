@@ -0,0 +1,89 @@
+/*
+ * This file belongs to FreeMiNT. It's not in the original MiNT 1.12
+ * distribution. See the file CHANGES for a detailed log of changes.
+ *
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This file is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *
+ * Asynchronous I/O submission/completion ring, shared between
+ * a process and the kernel (Faio system call).
+ *
+ */
+
+# ifndef _mint_aio_h
+# define _mint_aio_h
+
+# ifdef __KERNEL__
+# include "ktypes.h"
+# endif
+
+
+/* Faio() modes */
+# define AIO_SETUP	0	/* arg1 = struct aio_ring *, arg2 = workers; returns handle */
+# define AIO_ENTER	1	/* arg1 = min. completions to wait for; returns submitted */
+
+/* request opcodes */
+# define AIO_OP_NOP	0
+# define AIO_OP_READ	1
+# define AIO_OP_WRITE	2
+# define AIO_OP_SEND	3	/* sqe.flags are the send flags */
+# define AIO_OP_RECV	4	/* sqe.flags are the recv flags */
+
+# define AIO_MAXENTRIES	256	/* ring size limit, must be a power of 2 */
+# define AIO_MAXWORKERS	4	/* kernel threads per ring */
+
+/* submission queue entry */
+struct aio_sqe
+{
+	short	opcode;		/* AIO_OP_* */
+	short	fd;		/* file handle */
+	long	flags;		/* send/recv flags */
+	void	*buf;		/* user buffer */
+	long	nbytes;		/* transfer size */
+	long	offset;		/* file offset, -1 for current position */
+	long	user_data;	/* passed back unchanged in the completion */
+};
+
+/* completion queue entry */
+struct aio_cqe
+{
+	long	user_data;	/* from the submission entry */
+	long	res;		/* bytes transferred or negative error */
+};
+
+/* ring header; the process owns sq_tail and cq_head,
+ * the kernel owns sq_head and cq_tail
+ *
+ * the entries follow the header:
+ * struct aio_sqe sq[entries];
+ * struct aio_cqe cq[entries];
+ */
+struct aio_ring
+{
+	volatile ulong	sq_head;
+	volatile ulong	sq_tail;
+	volatile ulong	cq_head;
+	volatile ulong	cq_tail;
+	ulong		entries;	/* number of entries in both queues */
+	ulong		res[3];		/* reserved, must be zero */
+};
+
+# define AIO_RING_SQ(r)		((struct aio_sqe *)((r) + 1))
+# define AIO_RING_CQ(r)		((struct aio_cqe *)(AIO_RING_SQ(r) + (r)->entries))
+# define AIO_RING_SIZE(n)	(sizeof(struct aio_ring) + (n) * (sizeof(struct aio_sqe) + sizeof(struct aio_cqe)))
+
+
+# endif /* _mint_aio_h */
@@ -66,6 +66,16 @@
 # define DEV_RANDOM
 #endif
 
+/*
+ * share the memory of a Pfork()'ed child with its parent and copy
+ * the pages only when one of them writes to it; needs the MMU
+ * page tables and the extended bus error handler
+ */
+
+#if defined(WITH_MMU_SUPPORT) && !defined(NO_FAKE_SUPER)
+# define COW_FORK
+#endif
+
 /*
  * MAXPID is the maxium PID MiNT will generate
  * 
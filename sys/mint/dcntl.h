@@ -275,4 +275,16 @@ struct fs_usage
 # define FS_UNLIMITED	-1
 };
 
+# define FS_FRAG	0xf102		/* xfs fill out the following struct */
+
+struct fs_frag
+{
+	unsigned long blocksize;/* 32bit: size in bytes of a block */
+	llong	free_blocks;	/* 64bit: number of free blocks */
+	llong	free_runs;	/* 64bit: number of contiguous free areas */
+	llong	free_max;	/* 64bit: blocks in the largest free area */
+	llong	file_blocks;	/* 64bit: data blocks of the named file or -1 */
+	llong	file_runs;	/* 64bit: contiguous areas of the named file or -1 */
+};
+
 # endif /* _mint_dcntl_h */
@@ -34,22 +34,26 @@
 
 # include "ktypes.h"
 # include "file.h"
+# include "proc.h"
 
 
 struct file;
+struct srchx;
 
-# define NDFILE		1024
-# define NDEXTENT	50
+# define NDFILE		32	/* handles embedded in struct filedesc */
+# define NDEXTENT	64	/* table grows in steps of this (multiple of 32) */
+# define NOFILE		1024	/* max. number of handles per process */
 
 struct filedesc
 {
 	struct file	**ofiles;	/* file structures for open files */
 	uchar		*ofileflags;	/* per-process open file flags */
 	short		nfiles;		/* number of open files allocated */
-	short		pad2;
-// XXX	short		lastfile;	/* high-water mark of ofiles */
-// XXX	short		freefile;	/* approx. next free file */
+	short		lastfile;	/* high-water mark of ofiles */
 	long		links;		/* reference count */
+	ulong		*omap;		/* bitmap of allocated handles >= 0 */
+	short		freefile;	/* approx. next free file */
+	short		pad2;
 	
 	
 	DIR		*searches;	/* open directory searches	*/
@@ -61,24 +65,27 @@ struct filedesc
 	DTABUF *srchdta[NUM_SEARCH];	/* for Fsfirst/next		*/
 	DIR	srchdir[NUM_SEARCH];	/* for Fsfirst/next		*/
 	long	srchtim[NUM_SEARCH];	/* for Fsfirst/next		*/
+	struct srchx *srchx[NUM_SEARCH];/* for Fsfirst/next		*/
 	
-	/* XXX total crap
-	 * there are something like this "ofiles[-3]" over the src
-	 * before we dynamically alloc the ofiles we have
-	 * to fix all the places
-	 */
 	short		pad1;
 	short		bconmap;	/* Bconmap mapping */
-	struct file	*midiout;	/* MIDI output */
-	struct file	*midiin;	/* MIDI input */
-	struct file	*prn;		/* printer */
-	struct file	*aux;		/* auxiliary tty */
-	struct file	*control;	/* control tty */
 	
-	struct file	*dfiles [NDFILE];
-	uchar		dfileflags [NDFILE];
+	/* the standard handles MIN_HANDLE..-1 are stored in front
+	 * of ofiles[0]; the embedded table is used until a process
+	 * needs more than NDFILE handles
+	 */
+	struct file	*dfiles [NDFILE - MIN_HANDLE];
+	uchar		dfileflags [NDFILE - MIN_HANDLE];
+	ulong		dmap [NDFILE / 32];
 };
 
+/* the special handles */
+# define FD_MIDIOUT(fd)		((fd)->ofiles[-5])	/* MIDI output */
+# define FD_MIDIIN(fd)		((fd)->ofiles[-4])	/* MIDI input */
+# define FD_PRN(fd)		((fd)->ofiles[-3])	/* printer */
+# define FD_AUX(fd)		((fd)->ofiles[-2])	/* auxiliary tty */
+# define FD_CONTROL(fd)		((fd)->ofiles[-1])	/* control tty */
+
 struct cwd
 {
 	long		links;		/* reference count */
@@ -40,6 +40,18 @@ struct dirstruct
 	short	fd;		/* associated fd, for use with dirfd */
 };
 
+/* one entry as stored by Dgetdents(); followed by the XATTR (or STAT
+ * with DGD_STAT) of the entry and the name as Dreaddir() returns it,
+ * NUL terminated and padded so that reclen is even
+ */
+struct dgdent
+{
+	ushort	reclen;		/* size of the whole record */
+	ushort	namlen;		/* strlen of the name, without index */
+	long	xret;		/* result of getting the attributes */
+};
+# define DGD_STAT	0x01	/* return STAT instead of XATTR */
+
 struct devdrv
 {
 	long _cdecl (*open)	(FILEPTR *f);
@@ -82,6 +94,8 @@ struct filesys
 # define FS_EXT_1		0x0200	/* extensions level 1 - mknod & unmount */
 # define FS_EXT_2		0x0400	/* extensions level 2 - additional place at the end */
 # define FS_EXT_3		0x0800	/* extensions level 3 - stat & native UTC timestamps */
+# define FS_SHARED_READ		0x1000	/* lookup, getxattr, readdir & co. may run concurrently */
+# define FS_EXT_4		0x2000	/* extensions level 4 - readdirs */
 	
 	/* filesystem functions
 	 */
@@ -126,6 +140,16 @@ struct filesys
 	ulong	sleepers;		/* sleepers on this filesystem */
 	void	_cdecl (*block)		(FILESYS *fs, ushort dev, const char *);
 	void	_cdecl (*deblock)	(FILESYS *fs, ushort dev, const char *);
+	
+	/* FS_EXT_4: fill buf with struct dgdent records like Dgetdents()
+	 * does, but with the XATTR times as getxattr returns them; return
+	 * the bytes used, 0 at the end of the directory, EBADARG if not
+	 * even one entry fits or ENOSYS to let the kernel fall back to
+	 * readdir & getxattr. Entries whose name doesn't start with
+	 * prefix (see pat_compile) may be left out, prefix is NULL to
+	 * get all of them
+	 */
+	long	_cdecl (*readdirs)	(DIR *dirh, char *buf, long len, int flags, const char *prefix);
 };
 
 
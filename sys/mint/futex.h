@@ -0,0 +1,34 @@
+/*
+ * This file belongs to FreeMiNT. It's not in the original MiNT 1.12
+ * distribution. See the file CHANGES for a detailed log of changes.
+ *
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This file is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *
+ * Wait/wake on a user space word (Pfutex system call).
+ *
+ */
+
+# ifndef _mint_futex_h
+# define _mint_futex_h
+
+
+/* Pfutex() operations */
+# define FUTEX_WAIT	0	/* sleep if *addr == val; arg = timeout in ms, 0 = forever */
+# define FUTEX_WAKE	1	/* wake up to val waiters on addr; returns # woken */
+
+
+# endif /* _mint_futex_h */
@@ -274,6 +274,7 @@ struct pmeminfo
 # define EXT2_IOC_SETFLAGS	(('f'<< 8) | 2)
 # define EXT2_IOC_GETVERSION	(('v'<< 8) | 1)
 # define EXT2_IOC_SETVERSION	(('v'<< 8) | 2)
+# define EXT2_IOC_DELALLOC	(('f'<< 8) | 3)	/* Dcntl: delayed allocation 0/1, < 0 asks */
 
 
 /*
@@ -19,6 +19,8 @@
 # include "kcompiler.h"
 # include "ktypes.h"
 # include "block_IO.h"		/* eXtended kernelinterface */
+# include "pcache.h"		/* file data page cache */
+# include "workq.h"		/* kernel work queue */
 
 struct basepage;
 struct nf_ops;
@@ -322,8 +324,18 @@ struct kerinfo
 	 */
 	ulong	_cdecl	(*remaining_proc_time)(void);
 
-	/* reserved, set to 0 */
-	long	res2 [1];
+	/* file data page cache, see mint/pcache.h;
+	 * NULL on older kernels
+	 */
+	PCACHE	*pagecache;
+
+	/* version 3 extension
+	 * older kernels end before this point, check version >= 3
+	 */
+
+	/* kernel work queue, see mint/workq.h */
+	void	_cdecl	(*work_init)(struct work *w, const char *name, void _cdecl (*func)(struct work *), ushort flags);
+	long	_cdecl	(*queue_work)(struct work *w);
 };
 
 
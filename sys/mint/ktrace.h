@@ -0,0 +1,65 @@
+/*
+ * This file belongs to FreeMiNT. It's not in the original MiNT 1.12
+ * distribution. See the file CHANGES for a detailed log of changes.
+ *
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This file is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *
+ * Binary format of /kern/ktrace, the kernel event trace buffer.
+ * All fields are big endian; tools/ktrace decodes it.
+ *
+ */
+
+# ifndef _mint_ktrace_h
+# define _mint_ktrace_h
+
+
+/* event classes, the value of sysctl kern.trace is a mask of these */
+# define KTC_SYSCALL	0x0001	/* GEMDOS/BIOS/XBIOS entry and exit */
+# define KTC_SCHED	0x0002	/* context switches, sleep and wake */
+# define KTC_BIO	0x0004	/* block_IO device reads and writes */
+
+/* event types */
+# define KT_SYSENTER	1	/* arg = trap (0 GEMDOS, 1 BIOS, 2 XBIOS), a = function */
+# define KT_SYSEXIT	2	/* like KT_SYSENTER, b = return value, c = ticks spent */
+# define KT_SWITCH	3	/* arg = wait_q of pid, a = pid switched to */
+# define KT_SLEEP	4	/* a = wait_q, b = wait_cond */
+# define KT_WAKE	5	/* a = wait_q, b = wait_cond, c = pid woken */
+# define KT_BIO		6	/* arg = drv << 1 | write, a = sector, b = bytes, c = ticks */
+
+# define KTRACE_MAGIC	0x4b545243L	/* 'KTRC' */
+# define KTRACE_VERSION	1
+
+struct ktrace_header
+{
+	long	magic;			/* KTRACE_MAGIC */
+	short	version;		/* KTRACE_VERSION */
+	short	hz;			/* unit of the time stamps */
+	long	nevents;		/* events following, oldest first */
+	long	lost;			/* overwritten since tracing started */
+};
+
+struct ktrace_event
+{
+	unsigned long	time;		/* 200 Hz ticks */
+	short		pid;		/* process that was running */
+	unsigned char	type;		/* KT_* */
+	unsigned char	arg;
+	long		a, b, c;
+};
+
+
+# endif /* _mint_ktrace_h */
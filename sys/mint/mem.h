@@ -31,6 +31,7 @@ struct memregion
         MEMREGION *save;	///< Used to save inactive shadows.
         MEMREGION *shadow;	///< Ring of shadows or 0.
         MEMREGION *next;	///< Next region in memory map.
+        struct cowmap *cow;	///< Pages a save region still shares (COW fork).
 };
 
 # define M_CORE		0x0001	///< Region came from core map.
@@ -43,7 +44,7 @@ struct memregion
 # define M_FSAVED	0x0040	///< Region is saved memory of a forked process
 # define M_SHARED	0x0080	///< Region is shared memory region
 # define M_KEEP		0x0100	///< don't free region on process termination
-                     /* 0x0200  unused */
+# define M_COW		0x0200	///< Region was shared copy-on-write by Pfork
                      /* 0x0400  unused */
                      /* 0x0800  unused */
 # define M_UMALLOC	0x1000	///< Region used by umalloc
@@ -33,9 +33,46 @@
 # define _mint_msg_h
 
 # include "ktypes.h"
+# include "ipc.h"
 
+struct __msg;
 
-struct msqid_ds;
+struct msqid_ds
+{
+	struct ipc_perm	msg_perm;	/* msg queue permission bits */
+	struct __msg	*msg_first;	/* first message in the queue */
+	struct __msg	*msg_last;	/* last message in the queue */
+	ulong		msg_cbytes;	/* number of bytes in use on the queue */
+	ulong		msg_qnum;	/* number of msgs in the queue */
+	ulong		msg_qbytes;	/* max # of bytes on the queue */
+	short		msg_lspid;	/* pid of last msgsnd() */
+	short		msg_lrpid;	/* pid of last msgrcv() */
+	
+	long		msg_stime;	/* time of last msgsnd() */
+	long		msg_pad1;
+	long		msg_rtime;	/* time of last msgrcv() */
+	long		msg_pad2;
+	long		msg_ctime;	/* time of last msgctl() */
+	long		msg_pad3;
+	long		msg_pad4[4];
+};
+
+/*
+ * msgrcv flags
+ */
+# define MSG_NOERROR	010000		/* don't complain about too long msgs */
+
+/*
+ * message info struct
+ */
+struct msginfo
+{
+	long		msgmax;		/* max chars in a message */
+	long		msgmni;		/* max message queue identifiers */
+	long		msgmnb;		/* max chars in a queue */
+	long		msgtql;		/* max messages in system */
+	long		msgpool;	/* max chars in all messages */
+};
 
 
 # endif /* _mint_msg_h */
@@ -0,0 +1,79 @@
+/*
+ * This file belongs to FreeMiNT. It's not in the original MiNT 1.12
+ * distribution. See the file CHANGES for a detailed log of changes.
+ *
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This file is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *
+ * File data page cache, shared by all filesystems.
+ *
+ * The cache holds file contents by (filesystem, file, offset), so a
+ * filesystem can satisfy reads of hot files without mapping the file
+ * offsets to device blocks again. The filesystem chooses the keys:
+ * "id" identifies the filesystem instance (e.g. the superblock of a
+ * drive), "ino" the file within it (e.g. the inode number); ino must
+ * not be PC_ALLFILES.
+ *
+ * The filesystem is responsible for the consistency; every change
+ * of the file contents or size that doesn't go through the cached
+ * read path must invalidate the affected range, and the whole file
+ * when the file is deleted (so a reused ino doesn't see old data).
+ *
+ */
+
+# ifndef _mint_pcache_h
+# define _mint_pcache_h
+
+# include "kcompiler.h"
+# include "ktypes.h"
+
+
+typedef struct pcache	PCACHE;
+
+struct pcache
+{
+	ushort	version;		/* page cache version */
+	ushort	revision;		/* page cache revision */
+
+# define PCACHE_VERS	1		/* incompatible interface change */
+# define PCACHE_REV	0		/* compatible interface change */
+
+	long	pagesize;		/* size of a cache page */
+
+	/* copy cached data starting at file offset pos to buf; stops at
+	 * the first page not in the cache, returns the number of bytes
+	 * copied
+	 */
+	long	_cdecl (*read)		(const void *id, ulong ino, long pos, char *buf, long len);
+
+	/* enter the len bytes of file data at pos read from the device;
+	 * only complete pages are taken over, and the page holding the
+	 * end of the file (size)
+	 */
+	void	_cdecl (*fill)		(const void *id, ulong ino, long pos, const char *buf, long len, long size);
+
+	/* drop the cached data from pos to pos + len (to the end of
+	 * file if len < 0); ino == PC_ALLFILES drops all files of id
+	 */
+	void	_cdecl (*invalidate)	(const void *id, ulong ino, long pos, long len);
+
+# define PC_ALLFILES	0xffffffffUL
+
+	long	res[4];			/* reserved for future */
+};
+
+
+# endif /* _mint_pcache_h */
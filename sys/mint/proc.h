@@ -271,6 +271,7 @@ struct proc
 	long	mb_mbid;		/* p_msg id being waited for	*/
 	short	mb_mode;		/* p_msg mode being waiting in	*/
 	short	mb_writer;		/* p_msg pid of writer of msg	*/
+	PROC	*mb_next;		/* p_msg mailbox hash chain	*/
 
 	/* GEMDOS extension: Pusrval() */
 	long	usrdata;		/* p_usrval user-supplied data	*/
@@ -283,6 +284,18 @@ struct proc
 	ushort	exception_mmusr;	/* result from ptest insn	*/
 	ushort	exception_access;	/* cause of the bus error (read, write, read/write) */
 
+	Func	*sys_tab;		/* table of the trap in progress, for kprof */
+	ushort	sys_nr;			/* its function number		*/
+	ulong	sys_start;		/* time it started, for ktrace	*/
+
+	ulong	ready_since;		/* when it became runnable	*/
+	ulong	sleep_since;		/* when it went to sleep, or 0	*/
+	ushort	sleep_credit;		/* recent sleep time, in ticks	*/
+	short	rq_level;		/* run queue level on READY_Q	*/
+
+	long	handoff_cond;		/* wake_one() wakeup not yet used */
+	short	handoff_q;		/* and its queue		*/
+
 
 	ulong	stack_magic;		/* to detect stack overflows	*/
 	char	stack[STKSIZE+4];	/* stack for system calls	*/
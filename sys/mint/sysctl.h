@@ -124,7 +124,9 @@ struct ctlname
 # define KERN_BOOTTIME		13	/* struct: time kernel was booted */
 # define KERN_INITIALTPA	14	/* int: max TPA size of a process */
 # define KERN_SYSDIR		15	/* the system directory */
-# define KERN_MAXID		16	/* number of valid kern ids */
+# define KERN_PROFILE		16	/* int: kernel profiler on/off */
+# define KERN_TRACE		17	/* int: mask of traced event classes */
+# define KERN_MAXID		18	/* number of valid kern ids */
 
 # define CTL_KERN_NAMES \
 { \
@@ -144,6 +146,8 @@ struct ctlname
 	{ "boottime", CTLTYPE_STRUCT }, \
 	{ "initialtpa", CTLTYPE_LONG }, \
 	{ "sysdir", CTLTYPE_STRING }, \
+	{ "profile", CTLTYPE_LONG }, \
+	{ "trace", CTLTYPE_LONG }, \
 }
 
 
@@ -0,0 +1,65 @@
+/*
+ * This file belongs to FreeMiNT. It's not in the original MiNT 1.12
+ * distribution. See the file CHANGES for a detailed log of changes.
+ *
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This file is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *
+ * Kernel work queue.
+ *
+ * Work queued with queue_work() is run by a small pool of kernel
+ * threads, so unlike a roottimeout callback it may sleep, e.g. wait
+ * for disk I/O. A work item is owned by the caller (usually a static
+ * variable), set up once with work_init() and may be queued again as
+ * soon as its function has been entered, so func may run in two
+ * threads at once if it doesn't guard against that itself. Queueing a
+ * pending item is a no-op. queue_work() may be called from interrupts
+ * and timeouts.
+ *
+ * Items with WORK_URGENT are run before all others.
+ *
+ */
+
+# ifndef _mint_workq_h
+# define _mint_workq_h
+
+# include "kcompiler.h"
+# include "ktypes.h"
+
+
+struct work
+{
+	struct work	*next;		/* queue link */
+	struct work	*all;		/* list of all items, for /kern/workq */
+	void	_cdecl	(*func)(struct work *);
+	const char	*name;
+	ushort		flags;
+
+# define WORK_URGENT	0x0001		/* run before the other items */
+# define WORK_PENDING	0x8000		/* internal: on the queue */
+
+	ushort		pad;
+
+	/* statistics */
+	ulong		queued;		/* 200 Hz tick it was queued at */
+	ulong		max_wait;	/* longest time on the queue, ticks */
+	ulong		runs;		/* number of runs */
+	ulong		cpu;		/* CPU time used by func, ms */
+	ulong		max_cpu;	/* most CPU time of one run, ms */
+};
+
+
+# endif /* _mint_workq_h */
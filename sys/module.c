@@ -268,7 +268,7 @@ load_module(const char *path, const char *filename, long *err)
 	b->p_bbase = b->p_dbase + b->p_dlen;
 	b->p_blen = fh.fbss;
 
-	*err = load_and_reloc(f, &fh, (char *)b + 256, 0, fh.ftext + fh.fdata, b);
+	*err = load_and_reloc(f, &fh, (char *)b + 256, 0, fh.ftext + fh.fdata, b, NULL);
 
 	/* close file */
 // 	kernel_close(f);
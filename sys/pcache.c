@@ -0,0 +1,352 @@
+/*
+ * This file belongs to FreeMiNT. It's not in the original MiNT 1.12
+ * distribution. See the file CHANGES for a detailed log of changes.
+ *
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This file is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *
+ * File data page cache (see mint/pcache.h).
+ *
+ * The block cache (block_IO.c) caches device units; a filesystem
+ * still has to map every file offset to a block before it can find
+ * the unit. This cache sits in front of that mapping: pages of file
+ * data are found by (id, ino, page index) through a hash table and
+ * are recycled in LRU order.
+ *
+ * Pages are allocated on demand up to the configured size
+ * (FS_PAGECACHE in mint.cnf).
+ *
+ */
+
+# include "pcache.h"
+
+# include "libkern/libkern.h"
+
+# include "kmemory.h"
+
+
+# define PC_PAGESIZE	4096L
+# define PC_PAGESHIFT	12
+# define PC_PAGEMASK	(PC_PAGESIZE - 1)
+
+# define PC_HASHBITS	8
+# define PC_HASHSIZE	(1 << PC_HASHBITS)
+# define PC_HASHMASK	(PC_HASHSIZE - 1)
+
+/* default cache size in kb */
+# define PC_DEFAULT	128L
+
+
+typedef struct pc_page PC_PAGE;
+
+struct pc_page
+{
+	PC_PAGE		*hnext;		/* hash chain */
+	PC_PAGE		*prev;		/* LRU list, most recently used first */
+	PC_PAGE		*next;
+
+	const void	*id;		/* key */
+	ulong		ino;
+	ulong		index;		/* page number within the file */
+
+	long		len;		/* valid bytes, less only at end of file */
+	char		*data;
+};
+
+static PC_PAGE *table [PC_HASHSIZE];
+
+static PC_PAGE *lru_head;		/* used pages */
+static PC_PAGE *lru_tail;
+static PC_PAGE *free_list;		/* allocated but unused pages */
+
+static long pc_pages;			/* allocated pages */
+static long pc_used;			/* pages in the hash table */
+static long pc_max = (PC_DEFAULT * 1024L) / PC_PAGESIZE;
+
+
+static long	_cdecl pc_read		(const void *id, ulong ino, long pos, char *buf, long len);
+static void	_cdecl pc_fill		(const void *id, ulong ino, long pos, const char *buf, long len, long size);
+static void	_cdecl pc_invalidate	(const void *id, ulong ino, long pos, long len);
+
+PCACHE pcache =
+{
+	PCACHE_VERS,
+	PCACHE_REV,
+
+	PC_PAGESIZE,
+
+	pc_read,
+	pc_fill,
+	pc_invalidate,
+
+	{ 0, 0, 0, 0 }
+};
+
+
+INLINE ushort
+pc_hash (const void *id, ulong ino, ulong index)
+{
+	register ulong hash = ((ulong) id >> 4) + ino * 31 + index;
+
+	return (hash ^ (hash >> PC_HASHBITS)) & PC_HASHMASK;
+}
+
+static PC_PAGE *
+pc_lookup (const void *id, ulong ino, ulong index)
+{
+	register PC_PAGE *pg;
+
+	for (pg = table [pc_hash (id, ino, index)]; pg; pg = pg->hnext)
+	{
+		if (pg->index == index && pg->ino == ino && pg->id == id)
+			return pg;
+	}
+
+	return NULL;
+}
+
+static void
+lru_remove (PC_PAGE *pg)
+{
+	if (pg->prev)	pg->prev->next = pg->next;
+	else		lru_head = pg->next;
+
+	if (pg->next)	pg->next->prev = pg->prev;
+	else		lru_tail = pg->prev;
+}
+
+static void
+lru_insert (PC_PAGE *pg)
+{
+	pg->prev = NULL;
+	pg->next = lru_head;
+
+	if (lru_head)	lru_head->prev = pg;
+	else		lru_tail = pg;
+
+	lru_head = pg;
+}
+
+/* take a page out of the hash table and put it on the free list */
+static void
+pc_release (PC_PAGE *pg)
+{
+	PC_PAGE **list = &table [pc_hash (pg->id, pg->ino, pg->index)];
+
+	while (*list != pg)
+		list = &(*list)->hnext;
+
+	*list = pg->hnext;
+	lru_remove (pg);
+
+	pg->hnext = free_list;
+	free_list = pg;
+	pc_used--;
+}
+
+/* get an unused page; recycles the least recently used one */
+static PC_PAGE *
+pc_getpage (void)
+{
+	PC_PAGE *pg;
+
+	if (!free_list && pc_pages < pc_max)
+	{
+		pg = kmalloc (sizeof (*pg) + PC_PAGESIZE);
+		if (pg)
+		{
+			pg->data = (char *) (pg + 1);
+			pg->hnext = free_list;
+			free_list = pg;
+			pc_pages++;
+		}
+	}
+
+	if (!free_list && lru_tail)
+		pc_release (lru_tail);
+
+	pg = free_list;
+	if (pg)
+		free_list = pg->hnext;
+
+	return pg;
+}
+
+static long _cdecl
+pc_read (const void *id, ulong ino, long pos, char *buf, long len)
+{
+	long done = 0;
+
+	if (!pc_used || pos < 0)
+		return 0;
+
+	while (len > 0)
+	{
+		PC_PAGE *pg;
+		long offset = pos & PC_PAGEMASK;
+		long data;
+
+		pg = pc_lookup (id, ino, (ulong) pos >> PC_PAGESHIFT);
+		if (!pg || offset >= pg->len)
+			break;
+
+		if (pg != lru_head)
+		{
+			lru_remove (pg);
+			lru_insert (pg);
+		}
+
+		data = MIN (len, pg->len - offset);
+		memcpy (buf, pg->data + offset, data);
+
+		buf += data;
+		pos += data;
+		len -= data;
+		done += data;
+
+		/* end of file */
+		if (pg->len < PC_PAGESIZE)
+			break;
+	}
+
+	return done;
+}
+
+static void _cdecl
+pc_fill (const void *id, ulong ino, long pos, const char *buf, long len, long size)
+{
+	long offset;
+
+	if (!pc_max || pos < 0 || len <= 0)
+		return;
+
+	/* skip to the first page boundary */
+	offset = (PC_PAGESIZE - (pos & PC_PAGEMASK)) & PC_PAGEMASK;
+	buf += offset;
+	pos += offset;
+	len -= offset;
+
+	while (len > 0)
+	{
+		PC_PAGE *pg;
+		ulong index = (ulong) pos >> PC_PAGESHIFT;
+		long data = MIN (PC_PAGESIZE, size - pos);
+
+		/* incomplete page that isn't the last one */
+		if (data <= 0 || len < data)
+			break;
+
+		pg = pc_lookup (id, ino, index);
+		if (pg)
+		{
+			lru_remove (pg);
+		}
+		else
+		{
+			pg = pc_getpage ();
+			if (!pg)
+				break;
+
+			pg->id = id;
+			pg->ino = ino;
+			pg->index = index;
+
+			pg->hnext = table [pc_hash (id, ino, index)];
+			table [pc_hash (id, ino, index)] = pg;
+			pc_used++;
+		}
+
+		lru_insert (pg);
+
+		memcpy (pg->data, buf, data);
+		pg->len = data;
+
+		buf += data;
+		pos += data;
+		len -= data;
+	}
+}
+
+static void _cdecl
+pc_invalidate (const void *id, ulong ino, long pos, long len)
+{
+	PC_PAGE *pg, *next;
+	ulong first, last;
+
+	if (!pc_used || len == 0)
+		return;
+
+	if (pos < 0)
+		pos = 0;
+
+	first = (ulong) pos >> PC_PAGESHIFT;
+	last = (len < 0) ? 0xffffffffUL : (ulong) (pos + len - 1) >> PC_PAGESHIFT;
+
+	/* small ranges are looked up directly */
+	if (ino != PC_ALLFILES && (last - first) < (ulong) pc_used)
+	{
+		ulong index;
+
+		for (index = first; index <= last; index++)
+		{
+			pg = pc_lookup (id, ino, index);
+			if (pg)
+				pc_release (pg);
+		}
+
+		return;
+	}
+
+	for (pg = lru_head; pg; pg = next)
+	{
+		next = pg->next;
+
+		if (pg->id != id)
+			continue;
+
+		if (ino == PC_ALLFILES
+		    || (pg->ino == ino && pg->index >= first && pg->index <= last))
+		{
+			pc_release (pg);
+		}
+	}
+}
+
+long
+pc_set_cache_size (long size)
+{
+	if (size < 0)
+		return (pc_max * PC_PAGESIZE) / 1024L;
+
+	pc_max = (size * 1024L) / PC_PAGESIZE;
+
+	/* give back memory above the new limit */
+	while (pc_pages > pc_max)
+	{
+		PC_PAGE *pg;
+
+		if (!free_list)
+			pc_release (lru_tail);
+
+		pg = free_list;
+		free_list = pg->hnext;
+
+		kfree (pg);
+		pc_pages--;
+	}
+
+	return E_OK;
+}
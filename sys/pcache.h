@@ -0,0 +1,44 @@
+/*
+ * This file belongs to FreeMiNT. It's not in the original MiNT 1.12
+ * distribution. See the file CHANGES for a detailed log of changes.
+ *
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This file is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+# ifndef _pcache_h
+# define _pcache_h
+
+# include "mint/mint.h"
+# include "mint/pcache.h"
+
+
+/*
+ * exported data structures
+ */
+
+extern	PCACHE			pcache;
+
+
+/*
+ * exported functions
+ */
+
+/* extended configuration */
+long	pc_set_cache_size	(long size);
+
+
+# endif /* _pcache_h */
@@ -1088,6 +1088,42 @@ pty_writeb (FILEPTR *f, const char *buf, long nbytes)
 	return pipe_write (f, buf, nbytes);
 }
 
+/* Read the characters of a pty slave input pipe (one long per
+ * character) into a byte buffer; like a RAW tty_read this waits for
+ * the first character only.
+ */
+static long
+pty_unpack (FILEPTR *f, struct pipe *p, unsigned char *buf, long nbytes)
+{
+	long bytes_read = 0;
+
+	while (!p->len)
+	{
+		if (p->writers <= 0 || p->writers == VIRGIN_PIPE
+		    || (f->flags & O_NDELAY))
+			return 0;
+
+		if (sleep (IO_Q, (long)p))
+			return EINTR;
+	}
+
+	while (bytes_read < nbytes && p->len >= 4)
+	{
+		*buf++ = p->buf[p->start + 3];
+		bytes_read++;
+
+		p->start = (p->start + 4) & (PIPESIZ - 1);
+		p->len -= 4;
+	}
+
+	if (p->len == 0)
+		p->start = 0;
+
+	pipe_wake_writers (p);
+
+	return bytes_read;
+}
+
 static long _cdecl
 pty_readb (FILEPTR *f, char *buf, long nbytes)
 {
@@ -1100,11 +1136,11 @@ pty_readb (FILEPTR *f, char *buf, long nbytes)
 	{
 		struct tty *tty = this->tty;
 
-		/* we don't do pty slave reads yet (they need long -> byte
-		 * conversion for every char) but we still want to support
-		 * VMIN > 1...  so sleep first and then return ENODEV,
-		 * then VMIN chars (well longs :) are ready when
-		 * tty_read starts reading them one at a time
+		/* cooked pty slave reads go through tty_getchar (they need
+		 * long -> byte conversion and processing for every char)
+		 * but we still want to support VMIN > 1...  so sleep first
+		 * and then return ENODEV, then VMIN chars (well longs :)
+		 * are ready when tty_read starts reading them one at a time
 		 */
 		while (tty->vmin > 1 && !tty->vtime &&
 		    !(f->flags & O_NDELAY) &&
@@ -1114,7 +1150,14 @@ pty_readb (FILEPTR *f, char *buf, long nbytes)
 			if (sleep (IO_Q, (long)this->inp))
 				return EINTR;
 
-		return ENODEV;
+		/* ...except for RAW reads without echo or escape sequence
+		 * translation, there only the low bytes of the longs
+		 * are wanted and we can unpack them in one go
+		 */
+		if ((tty->sg.sg_flags & (T_RAW|T_ECHO|T_XKEY)) != T_RAW)
+			return ENODEV;
+
+		return pty_unpack (f, this->inp, (unsigned char *) buf, nbytes);
 	}
 
 	/* pty master reads are always RAW
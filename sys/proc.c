@@ -27,6 +27,7 @@
 # include "arch/context.h"	/* save_context, change_context */
 # include "arch/kernel.h"
 # include "arch/mprot.h"
+# include "arch/timer.h"	/* jiffies */
 # include "arch/tosbind.h"
 # include "arch/user_things.h"	/* trampoline */
 
@@ -35,6 +36,7 @@
 # include "dosfile.h"
 # include "filesys.h"
 # include "k_exit.h"
+# include "ktrace.h"
 # include "kmemory.h"
 # include "memory.h"
 # include "proc_help.h"
@@ -105,9 +107,11 @@ init_proc(void)
 	rootproc0.p_sigacts	= &sigacts0;	sigacts0.links = 1;
 //	rootproc0.p_limits	= &limits0;	limits0.links = 1;
 
-	fd0.ofiles = fd0.dfiles;
-	fd0.ofileflags = (unsigned char *)fd0.dfileflags;
+	fd0.ofiles = &fd0.dfiles[-MIN_HANDLE];
+	fd0.ofileflags = &fd0.dfileflags[-MIN_HANDLE];
+	fd0.omap = fd0.dmap;
 	fd0.nfiles = NDFILE;
+	fd0.lastfile = MIN_OPEN;
 
 	DEBUG(("init_proc() inf : %p, %p, %p, %p, %p, %p, %p",
 		&rootproc0, &mem0, &pcred0, &ucred0, &fd0, &cwd0, &sigacts0));
@@ -254,6 +258,222 @@ reset_priorities(void)
 	}
 }
 
+/*
+ * The ready queue is kept sorted by run queue level, highest first and
+ * in FIFO order within a level, so the scheduler just takes the head.
+ * rq_tail[] is the last process of each non-empty level and rq_bits
+ * the set of non-empty levels; a process is linked in after the tail
+ * of its own level, or of the next higher non-empty one.
+ *
+ * The level follows curpri at the time the process is queued (it may
+ * be one below MIN_NICE after preempt()); RQ_NEXT is above all of them
+ * and used by run_next(). shutdown & halt empty the queue by clearing
+ * sysq[READY_Q], so an empty list also means empty levels.
+ */
+# define RQ_LEVEL(pri)	((pri) - (MIN_NICE - 1))
+# define RQ_NEXT	(RQ_LEVEL(MAX_NICE + 1) + 1)
+# define RQ_WORDS	((RQ_NEXT + 32) / 32)
+
+static struct proc *rq_tail[RQ_NEXT + 1];
+static ulong rq_bits[RQ_WORDS];
+
+# define RQ_ISSET(l)	(rq_bits[(l) >> 5] & (1UL << ((l) & 31)))
+# define RQ_SET(l)	(rq_bits[(l) >> 5] |= (1UL << ((l) & 31)))
+# define RQ_CLR(l)	(rq_bits[(l) >> 5] &= ~(1UL << ((l) & 31)))
+
+/*
+ * Sleep credit: the time a process sleeps is credited to it, up to
+ * SLEEP_CREDIT_MAX ticks, and used up again by preemptions. On wakeup
+ * it gets up to SLEEP_BONUS levels above its base priority, in
+ * proportion to its credit; so interactive programs, which mostly
+ * wait for input, get ahead of CPU bound jobs of the same priority.
+ */
+# define SLEEP_CREDIT_MAX	200	/* 1 second */
+# define SLEEP_BONUS		5
+
+/*
+ * A process that gives up the CPU before its time slice is used up
+ * (Syield, short waits) is never preempted and so keeps its level; to
+ * keep it from starving everybody below, a process that has been ready
+ * for more than STARVE_TICKS is run next regardless of its level.
+ */
+# define STARVE_TICKS		100	/* 0.5 seconds */
+
+static int
+rq_level(struct proc *p)
+{
+	int pri = p->curpri;
+
+	if (pri < MIN_NICE - 1)
+		pri = MIN_NICE - 1;
+	else if (pri > MAX_NICE + 1)
+		pri = MAX_NICE + 1;
+
+	return RQ_LEVEL(pri);
+}
+
+/* lowest non-empty level above lvl, or -1 */
+static int
+rq_above(int lvl)
+{
+	int i;
+
+	lvl++;
+	for (i = lvl >> 5; i < RQ_WORDS; i++)
+	{
+		ulong m = rq_bits[i];
+
+		if (i == (lvl >> 5))
+			m &= ~0UL << (lvl & 31);
+
+		if (m)
+			return (i << 5) + __builtin_ffsl(m) - 1;
+	}
+
+	return -1;
+}
+
+static void
+rq_insert(struct proc *p, int lvl)
+{
+	struct proc *prev;
+
+	if (!sysq[READY_Q].head)
+		mint_bzero(rq_bits, sizeof(rq_bits));
+
+	if (RQ_ISSET(lvl))
+		prev = rq_tail[lvl];
+	else
+	{
+		int above = rq_above(lvl);
+
+		prev = (above < 0) ? NULL : rq_tail[above];
+		RQ_SET(lvl);
+	}
+
+	p->q_prev = prev;
+	if (prev)
+	{
+		p->q_next = prev->q_next;
+		prev->q_next = p;
+	}
+	else
+	{
+		p->q_next = sysq[READY_Q].head;
+		sysq[READY_Q].head = p;
+	}
+
+	if (p->q_next)
+		p->q_next->q_prev = p;
+	else
+		sysq[READY_Q].tail = p;
+
+	rq_tail[lvl] = p;
+	p->rq_level = lvl;
+	p->ready_since = jiffies;
+}
+
+/*
+ * The process to run next: the head of the list, unless the first
+ * process of some lower level (the one waiting longest there, as levels
+ * are FIFO) is starving; of those the highest one wins. Only the first
+ * process of each level is looked at, so this is bounded by the number
+ * of levels, not of ready processes.
+ */
+static struct proc *
+rq_pick(void)
+{
+	struct proc *p = sysq[READY_Q].head;
+	ulong now = jiffies;
+
+	/* run_next() wants it to run now */
+	if (p && p->rq_level == RQ_NEXT)
+		return p;
+
+	while (p)
+	{
+		struct proc *q = rq_tail[p->rq_level]->q_next;
+
+		if (q && now - q->ready_since > STARVE_TICKS)
+			return q;
+
+		p = q;
+	}
+
+	return sysq[READY_Q].head;
+}
+
+static void
+rq_remove(struct proc *p)
+{
+	int lvl = p->rq_level;
+
+	if (rq_tail[lvl] == p)
+	{
+		if (p->q_prev && p->q_prev->rq_level == lvl)
+			rq_tail[lvl] = p->q_prev;
+		else
+			RQ_CLR(lvl);
+	}
+}
+
+/*
+ * histogram of the time from becoming runnable to running; bucket
+ * 0 counts 0 ticks, bucket n > 0 up to 2^n - 1 ticks, the last one
+ * everything above
+ */
+# define SCHEDLAT_BUCKETS	12
+
+static ulong schedlat[SCHEDLAT_BUCKETS];
+static ulong schedlat_max;
+
+static void
+schedlat_add(ulong t)
+{
+	ulong v = t;
+	int b = 0;
+
+	while (v && b < SCHEDLAT_BUCKETS - 1)
+	{
+		v >>= 1;
+		b++;
+	}
+
+	schedlat[b]++;
+	if (t > schedlat_max)
+		schedlat_max = t;
+}
+
+long
+schedlat_dump(char *buf, long len)
+{
+	char *crs = buf;
+	ulong lo = 0;
+	long i;
+	int b;
+
+	i = ksprintf(crs, len, "# runnable to running, 200 Hz ticks\n");
+	crs += i; len -= i;
+
+	for (b = 0; b < SCHEDLAT_BUCKETS; b++)
+	{
+		ulong hi = (1UL << b) - 1;
+
+		if (b == SCHEDLAT_BUCKETS - 1)
+			i = ksprintf(crs, len, "%5lu+      %10lu\n", lo, schedlat[b]);
+		else
+			i = ksprintf(crs, len, "%5lu-%-5lu %10lu\n", lo, hi, schedlat[b]);
+		crs += i; len -= i;
+
+		lo = hi + 1;
+	}
+
+	i = ksprintf(crs, len, "max %lu\n", schedlat_max);
+	crs += i; len -= i;
+
+	return crs - buf;
+}
+
 /* run_next(p, slices):
  *
  * schedule process "p" to run next, with "slices" initial time slices;
@@ -267,6 +487,11 @@ run_next(struct proc *p, int slices)
 	p->slices = -slices;
 	p->curpri = MAX_NICE;
 	p->wait_q = READY_Q;
+
+	if (!sysq[READY_Q].head)
+		mint_bzero(rq_bits, sizeof(rq_bits));
+
+	/* in front of everybody, even others on RQ_NEXT */
 	p->q_next = sysq[READY_Q].head;
 	sysq[READY_Q].head = p;
 	if (!p->q_next)
@@ -275,6 +500,14 @@ run_next(struct proc *p, int slices)
 		p->q_next->q_prev = p;
 	p->q_prev = NULL;
 
+	if (!RQ_ISSET(RQ_NEXT))
+	{
+		rq_tail[RQ_NEXT] = p;
+		RQ_SET(RQ_NEXT);
+	}
+	p->rq_level = RQ_NEXT;
+	p->ready_since = jiffies;
+
 	spl(sr);
 }
 
@@ -294,7 +527,8 @@ fresh_slices(int slices)
 /*
  * add a process to a wait (or ready) queue.
  *
- * processes go onto a queue in first in-first out order
+ * processes go onto a queue in first in-first out order; on the ready
+ * queue within their priority level
  */
 void
 add_q(int que, struct proc *proc)
@@ -303,18 +537,37 @@ add_q(int que, struct proc *proc)
 	assert(proc->wait_q == 0);
 	assert(proc->q_next == 0);
 
-	if (sysq[que].tail) {
-		proc->q_prev = sysq[que].tail;
-		sysq[que].tail->q_next = proc;
+	if (que == READY_Q) {
+		if (proc->sleep_since) {
+			ulong credit = proc->sleep_credit + (jiffies - proc->sleep_since);
+
+			proc->sleep_credit = (credit > SLEEP_CREDIT_MAX) ? SLEEP_CREDIT_MAX : credit;
+			proc->sleep_since = 0;
+
+			if (proc->slices >= 0) {
+				proc->curpri = proc->pri + (proc->sleep_credit * SLEEP_BONUS) / SLEEP_CREDIT_MAX;
+				if (proc->curpri > MAX_NICE)
+					proc->curpri = MAX_NICE;
+			}
+		}
+		rq_insert(proc, rq_level(proc));
 	} else {
-		proc->q_prev = NULL;
-		sysq[que].head = proc;
+		if (sysq[que].tail) {
+			proc->q_prev = sysq[que].tail;
+			sysq[que].tail->q_next = proc;
+		} else {
+			proc->q_prev = NULL;
+			sysq[que].head = proc;
+		}
+		sysq[que].tail = proc;
 	}
-	sysq[que].tail = proc;
 	proc->wait_q = que;
-	if (que != READY_Q && proc->slices >= 0) {
-		proc->curpri = proc->pri;	/* reward the process */
-		proc->slices = SLICES(proc->curpri);
+	if (que != READY_Q) {
+		if (proc->slices >= 0) {
+			proc->curpri = proc->pri;	/* reward the process */
+			proc->slices = SLICES(proc->curpri);
+		}
+		proc->sleep_since = jiffies;
 	}
 }
 
@@ -326,6 +579,9 @@ rm_q(int que, struct proc *proc)
 {
 	assert(proc->wait_q == que);
 
+	if (que == READY_Q)
+		rq_remove(proc);
+
 	if (proc->q_prev)
 		proc->q_prev->q_next = proc->q_next;
 	else
@@ -359,9 +615,15 @@ preempt(void)
 	}
 	else
 	{
+		/* proc_clock runs at 50 Hz */
+		ushort used = time_slice * 4;
+
 		/* punish the pre-empted process */
 		if (curproc->curpri >= MIN_NICE)
 			curproc->curpri -= 1;
+
+		/* and use up its sleep credit */
+		curproc->sleep_credit = (curproc->sleep_credit > used) ? curproc->sleep_credit - used : 0;
 	}
 
 	sleep(READY_Q, curproc->wait_cond);
@@ -395,6 +657,10 @@ swap_in_curproc(void)
 
 			shdw->save = save;
 			m->save = 0;
+# ifdef COW_FORK
+			if (cow_swap (mem, m, save))
+				continue;
+# endif
 			if (i != 1 || txtsize == 0)
 			{
 				quickswap((char *)m->loc, (char *)save->loc, m->len);
@@ -552,6 +818,7 @@ sleep(int _que, long cond)
 
 		spl(sr);
 		do_wakeup_things(sr, newslice, cond);
+		curproc->handoff_cond = 0;
 
 		return (onsigs != curproc->nsigs);
 	}
@@ -566,6 +833,7 @@ sleep(int _que, long cond)
 		curproc->wait_cond = cond;
 
 	add_q(que, curproc);
+	KTRACE(KTC_SCHED, KT_SLEEP, 0, que, cond, 0);
 
 	/* alright curproc is on que now... maybe there's an
 	 * interrupt pending that will wakeselect or signal someone
@@ -592,45 +860,21 @@ sleep(int _que, long cond)
 	}
 
 	/*
-	 * Walk through the ready list, to find what process should run next.
-	 * Lower priority processes don't get to run every time through this
-	 * loop; if "p->slices" is positive, it's the number of times that
-	 * they will have to miss a turn before getting to run again
-	 *
-	 * Loop structure:
-	 *	while (we haven't picked anybody)
-	 *	{
-	 *		for (each process)
-	 *		{
-	 *			if (sleeping off a penalty)
-	 *			{
-	 *				decrement penalty counter
-	 *			}
-	 *			else
-	 *			{
-	 *				pick this one and break out of
-	 *				both loops
-	 *			}
-	 *		}
-	 *	}
+	 * The ready list is sorted by priority and the head normally runs
+	 * next. Lower levels get their turn when the processes above sink
+	 * down to them through preemption, and at the latest after
+	 * STARVE_TICKS, see rq_pick().
 	 */
 
 	sr = splhigh();
-	p = 0;
-	while (!p)
-	{
-		for (p = sysq[READY_Q].head; p; p = p->q_next)
-		{
-			if (p->slices > 0)
-				p->slices--;
-			else
-				break;
-		}
-	}
+	p = rq_pick();
+
 	/* p is our victim */
 	rm_q(READY_Q, p);
 	spl(sr);
 
+	schedlat_add(jiffies - p->ready_since);
+
 	if (save_context(&(curproc->ctxt[CURRENT])))
 	{
 		/*
@@ -638,6 +882,7 @@ sleep(int _que, long cond)
 		 */
 		swap_in_curproc();
 		do_wakeup_things(sr, 1, cond);
+		curproc->handoff_cond = 0;
 
 		return (onsigs != curproc->nsigs);
 	}
@@ -645,6 +890,8 @@ sleep(int _que, long cond)
 	/*
 	 * save per-process variables here
 	 */
+	KTRACE(KTC_SCHED, KT_SWITCH, curproc->wait_q, p->pid, 0, 0);
+
 	curproc->ctxt[CURRENT].regs[0] = 1;
 	curproc = p;
 
@@ -696,6 +943,7 @@ top:
 			{
 				rm_q(que, q);
 				add_q(READY_Q, q);
+				KTRACE(KTC_SCHED, KT_WAKE, 0, que, cond, q->pid);
 			}
 		}
 
@@ -718,6 +966,53 @@ wake(int que, long cond)
 	do_wake(que, cond);
 }
 
+/*
+ * wake_one(que, cond): like wake(), but only the first process on the
+ * queue that waits for cond is made runnable; returns 1 if there was one
+ *
+ * meant for locks where only one waiter can make progress anyway, the
+ * woken process must recheck its condition and wake the next one when
+ * it is done. Until its sleep() returns the wakeup is remembered in
+ * handoff_cond; if it is killed before (in do_wakeup_things()),
+ * terminate() passes the wakeup on to the next waiter.
+ */
+
+int _cdecl
+wake_one(int que, long cond)
+{
+	struct proc *p;
+	unsigned short s;
+
+	if (que == READY_Q)
+	{
+		ALERT("wake_one: why wake up ready processes??");
+		return 0;
+	}
+
+	if (sleepcond == cond)
+		sleepcond = 0;
+
+	s = splhigh();
+
+	for (p = sysq[que].head; p; p = p->q_next)
+	{
+		if (p->wait_cond == cond)
+		{
+			rm_q(que, p);
+			add_q(READY_Q, p);
+			p->handoff_cond = cond;
+			p->handoff_q = que;
+			KTRACE(KTC_SCHED, KT_WAKE, 0, que, cond, p->pid);
+
+			spl(s);
+			return 1;
+		}
+	}
+
+	spl(s);
+	return 0;
+}
+
 /*
  * iwake(que, cond, pid): special version of wake() for IO interrupt
  * handlers and such.  the normal wake() would lose when its
@@ -801,6 +1096,31 @@ wakeselect(struct proc *p)
 	spl(s);
 }
 
+/*
+ * abort_sleep(p): make the sleep() process p is in return nonzero, as
+ * if a signal had been handled, but without delivering one. Code that
+ * sleeps returns EINTR then, so this cancels blocking I/O a kernel
+ * thread does on behalf of somebody else (kernel threads don't take
+ * signals). p must not be curproc; as kernel code isn't preempted, p
+ * is always inside sleep(), on a wait queue or already on READY_Q.
+ */
+
+void
+abort_sleep(struct proc *p)
+{
+	unsigned short s = splhigh();
+
+	p->nsigs++;
+
+	if (p->wait_q && p->wait_q != READY_Q)
+	{
+		rm_q(p->wait_q, p);
+		add_q(READY_Q, p);
+	}
+
+	spl(s);
+}
+
 /*
  * dump out information about processes
  */
@@ -38,6 +38,7 @@ void		init_proc	(void);
 void		reset_priorities(void);
 void		run_next	(struct proc *p, int slices);
 void		fresh_slices	(int slices);
+long		schedlat_dump	(char *buf, long len);
 
 void		add_q		(int que, struct proc *proc);
 void		rm_q		(int que, struct proc *proc);
@@ -45,8 +46,10 @@ void		rm_q		(int que, struct proc *proc);
 void	_cdecl	preempt		(void);
 int	_cdecl	sleep		(int que, long cond);
 void	_cdecl	wake		(int que, long cond);
+int	_cdecl	wake_one	(int que, long cond);
 void	_cdecl	iwake		(int que, long cond, short pid);
 void	_cdecl	wakeselect	(struct proc *p);
+void		abort_sleep	(struct proc *p);
 
 void		DUMPPROC	(void);
 void		calc_load_average (void);
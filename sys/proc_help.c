@@ -42,6 +42,7 @@
 # include "cookie.h"
 # endif
 
+# include "dosdir.h"
 # include "filesys.h"
 # include "k_fds.h"
 # include "kmemory.h"
@@ -419,40 +420,52 @@ copy_fd (struct proc *p)
 	bcopy (org_fd, fd, sizeof (*fd));
 	fd->links = 1;
 	
-# if 0
-	if (!(fd->lastfile < NDFILE))
-	{
-		i = fd->nfiles;
-		while (i >= 2 * NDEXTENT && i > fd->lastfile * 2)
-			i /= 2;
-		
-		fd->ofiles = kmalloc (i * OFILESIZE);
-		fd->ofileflags = (char *) &fd->ofiles[i];
-	}
-	else
-# endif
+	/* start with the embedded table and grow it only
+	 * if the parent uses more than NDFILE handles
+	 */
+	fd->ofiles = &fd->dfiles[-MIN_HANDLE];
+	fd->ofileflags = &fd->dfileflags[-MIN_HANDLE];
+	fd->omap = fd->dmap;
+	fd->nfiles = NDFILE;
+	
+	mint_bzero (fd->dfiles, sizeof (fd->dfiles));
+	mint_bzero (fd->dfileflags, sizeof (fd->dfileflags));
+	mint_bzero (fd->dmap, sizeof (fd->dmap));
+	
+	if (org_fd->lastfile > NDFILE && fd_extend (fd, org_fd->lastfile - 1))
 	{
-		fd->ofiles = &fd->dfiles[0];
-		fd->ofileflags = (unsigned char *)&fd->dfileflags[0];
-		i = NDFILE;
+		DEBUG(("copy_fd: fd_extend failed -> NULL"));
+		kfree (fd);
+		return NULL;
 	}
 	
-	fd->nfiles = i;
-	
-	//mint_bcopy (org_fd->ofiles, fd->ofiles, i * sizeof (FILEPTR **));
-	//mint_bcopy (org_fd->ofileflags, fd->ofileflags, i * sizeof (char));
+	/* only the part up to the high-water mark is in use */
+	bcopy (org_fd->ofiles + MIN_HANDLE, fd->ofiles + MIN_HANDLE,
+		(fd->lastfile - MIN_HANDLE) * sizeof (*fd->ofiles));
+	bcopy (org_fd->ofileflags + MIN_HANDLE, fd->ofileflags + MIN_HANDLE,
+		fd->lastfile - MIN_HANDLE);
+	bcopy (org_fd->omap, fd->omap, ((fd->lastfile + 31) / 32) * sizeof (*fd->omap));
 	
-	for (i = MIN_HANDLE; i < fd->nfiles; i++)
+	for (i = MIN_HANDLE; i < fd->lastfile; i++)
 	{
 		FILEPTR *f = fd->ofiles[i];
 		
 		if (f)
 		{
 			if ((f == (FILEPTR *) 1L) || (f->flags & O_NOINHERIT))
+			{
 				/* oops, we didn't really want to copy this
 				 * handle
 				 */
 				fd->ofiles[i] = NULL;
+				
+				if (i >= 0)
+				{
+					fd->omap[i >> 5] &= ~(1UL << (i & 31));
+					if (i < fd->freefile)
+						fd->freefile = i;
+				}
+			}
 			else
 				f->links++;
 		}
@@ -461,6 +474,7 @@ copy_fd (struct proc *p)
 	/* clear directory search info */
 	mint_bzero (fd->srchdta, NUM_SEARCH * sizeof (DTABUF *));
 	mint_bzero (fd->srchdir, sizeof (fd->srchdir));
+	mint_bzero (fd->srchx, sizeof (fd->srchx));
 	fd->searches = NULL;
 	
 	TRACE (("copy_fd: ok (%p)", fd));
@@ -486,7 +500,7 @@ free_fd (struct proc *p)
 	/* release the controlling terminal,
 	 * if we're the last member of this pgroup
 	 */
-	f = p_fd->control;
+	f = FD_CONTROL(p_fd);
 	if (f && is_terminal (f))
 	{
 		struct tty *tty = (struct tty *) f->devinfo;
@@ -506,7 +520,7 @@ free_fd (struct proc *p)
 					
 					if (p1->pgrp == pgrp
 						&& p1 != p
-						&& ((pfp = p1->p_fd->control) != NULL)
+						&& ((pfp = FD_CONTROL(p1->p_fd)) != NULL)
 						&& pfp->fc.index == f->fc.index
 						&& pfp->fc.dev == f->fc.dev)
 					{
@@ -523,7 +537,7 @@ free_fd (struct proc *p)
 					
 					if (p1->pgrp == pgrp
 						&& p1 != p
-						&& p1->p_fd->control == f)
+						&& FD_CONTROL(p1->p_fd) == f)
 					{
 						goto found;
 					}
@@ -537,7 +551,7 @@ found:
 	}
 	
 	/* close all files */
-	for (i = MIN_HANDLE; i < p_fd->nfiles; i++)
+	for (i = MIN_HANDLE; i < p_fd->lastfile; i++)
 	{
 		f = p_fd->ofiles[i];
 		
@@ -558,6 +572,7 @@ found:
 			release_cookie (&dirh->fc);
 			dirh->fc.fs = 0;
 		}
+		srch_free (p_fd, i);
 	}
 	
 	/* close pending opendir/readdir searches */
@@ -579,8 +594,8 @@ found:
 		}
 	}
 	
-	if (p_fd->nfiles > NDFILE)
-		kfree (p_fd->ofiles);
+	if (p_fd->ofiles != &p_fd->dfiles[-MIN_HANDLE])
+		kfree (p_fd->ofiles + MIN_HANDLE);
 	
 	kfree (p_fd);
 }
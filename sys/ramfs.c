@@ -152,6 +152,7 @@
 
 # include "dev-null.h"
 # include "dos.h"
+# include "dosdir.h"
 # include "filesys.h"
 # include "init.h"
 # include "k_prot.h"
@@ -289,6 +290,7 @@ static long	_cdecl ram_rename	(fcookie *olddir, char *oldname, fcookie *newdir,
 
 static long	_cdecl ram_opendir	(DIR *dirh, int flags);
 static long	_cdecl ram_readdir	(DIR *dirh, char *nm, int nmlen, fcookie *);
+static long	_cdecl ram_readdirs	(DIR *dirh, char *buf, long len, int flags, const char *prefix);
 static long	_cdecl ram_rewinddir	(DIR *dirh);
 static long	_cdecl ram_closedir	(DIR *dirh);
 
@@ -325,6 +327,7 @@ FILESYS ramfs_filesys =
 	 * FS_EXT_1		extensions level 1 - mknod & unmount
 	 * FS_EXT_2		extensions level 2 - additional place at the end
 	 * FS_EXT_3		extensions level 3 - stat & native UTC timestamps
+	 * FS_EXT_4		extensions level 4 - readdirs
 	 */
 	FS_CASESENSITIVE	|
 	FS_LONGPATH		|
@@ -333,7 +336,8 @@ FILESYS ramfs_filesys =
 	FS_REENTRANT_L1		|
 	FS_REENTRANT_L2		|
 	FS_EXT_2		|
-	FS_EXT_3		,
+	FS_EXT_3		|
+	FS_EXT_4		,
 
 	root:			ram_root,
 	lookup:			ram_lookup,
@@ -379,7 +383,10 @@ FILESYS ramfs_filesys =
 	res3:			0,
 
 	lock: 0, sleepers: 0,
-	block: NULL, deblock: NULL
+	block: NULL, deblock: NULL,
+
+	/* FS_EXT_4 */
+	readdirs:		ram_readdirs
 };
 
 /*
@@ -1521,6 +1528,53 @@ ram_readdir (DIR *dirh, char *nm, int nmlen, fcookie *fc)
 	return r;
 }
 
+/* Dgetdents() straight from the directory list, without the
+ * readdir/getxattr round trip per entry
+ */
+static long _cdecl
+ram_readdirs (DIR *dirh, char *buf, long len, int flags, const char *prefix)
+{
+	union { char *c; DIRLST **d;} ptr;
+	DIRLST *l;
+	long done = 0;
+
+	ptr.c = dirh->fsstuff;
+
+	l = *ptr.d;
+	while (l)
+	{
+		/* Fsnext doesn't want these, save the attribute lookup */
+		if (prefix_match (l->name, prefix))
+		{
+			fcookie fc;
+			long r;
+
+			fc.fs = &ramfs_filesys;
+			fc.dev = l->cookie->stat.dev;
+			fc.aux = 0;
+			fc.index = (long) l->cookie;
+
+			r = dgdent_put (buf + done, len - done, dirh, flags, (long) l->cookie, l->name, &fc, 1);
+			if (!r)
+				break;
+
+			done += r;
+		}
+
+		l->lock = 0;
+		l = __dir_next ((COOKIE *) dirh->fc.index, l);
+		if (l) l->lock = 1;
+	}
+
+	*ptr.d = l;
+
+	/* not even the first entry fits */
+	if (!done && l)
+		return EBADARG;
+
+	return done;
+}
+
 static long _cdecl
 ram_rewinddir (DIR *dirh)
 {
@@ -105,6 +105,12 @@ dosleep:
  * calls (Pgetpid, Fwrite, Pause, plus synchronization worries about having
  * the reader get the message and Pkill you before you've Paused).
  *
+ * Processes waiting in Pmsg() are kept in a small hash table keyed by
+ * mboxid, so finding the other side of a rendezvous doesn't have to walk
+ * the whole process list.  A process is entered when it goes to sleep
+ * and removed by the process that satisfies its rendezvous, or when it
+ * terminates.
+ *
  * Note: Say PID 33 writes in mode 2 to MBXX and it blocks. Then somebody
  * writes to PD33, and blocks because you're not waiting for it.  Then your
  * write is satisfied, so you become a reader on PD33.  We should check to
@@ -116,12 +122,73 @@ dosleep:
 # include "rendez.h"
 
 # include "mint/asm.h"
+# include "mint/futex.h"
 
 # include "kmemory.h"
 # include "proc.h"
 # include "timeout.h"
 
 
+/* hash table of processes waiting in Pmsg() */
+# define MB_HASHBITS	5
+# define MB_HASHSIZE	(1 << MB_HASHBITS)
+# define MB_HASH(id)	((int)((id) ^ ((id) >> MB_HASHBITS) ^ ((id) >> 16)) & (MB_HASHSIZE - 1))
+
+static PROC *mb_table[MB_HASHSIZE];
+
+/* enter p under p->mb_mbid; at the end of the chain, so that
+ * processes waiting on the same mailbox are served in order
+ */
+static void
+mb_link(PROC *p)
+{
+    PROC **pp = &mb_table[MB_HASH(p->mb_mbid)];
+
+    while (*pp)
+	pp = &(*pp)->mb_next;
+
+    p->mb_next = NULL;
+    *pp = p;
+}
+
+static void
+mb_unlink(PROC *p)
+{
+    PROC **pp = &mb_table[MB_HASH(p->mb_mbid)];
+
+    for (; *pp; pp = &(*pp)->mb_next) {
+	if (*pp == p) {
+	    *pp = p->mb_next;
+	    p->mb_next = NULL;
+	    break;
+	}
+    }
+}
+
+/* find a process waiting on mbid to read (reader != 0) or to write */
+static PROC *
+mb_lookup(long mbid, int reader)
+{
+    PROC *p;
+
+    for (p = mb_table[MB_HASH(mbid)]; p; p = p->mb_next) {
+	if (p->mb_mbid == mbid && (reader ? p->mb_mode == 0 : p->mb_mode > 0))
+	    return p;
+    }
+
+    return NULL;
+}
+
+/* called from terminate() */
+void
+free_mailbox(PROC *p)
+{
+    if (p->mb_mode >= 0) {
+	mb_unlink(p);
+	p->mb_mode = -1;
+    }
+}
+
 long _cdecl
 sys_p_msg(int mode, long mbid, char *ptr)
 {
@@ -135,24 +202,22 @@ sys_p_msg(int mode, long mbid, char *ptr)
 
     if (mode == 0) {
 	/* read */
-	/* walk the whole process list looking for a writer */
-	for (p = proclist; p; p = p->gl_next) {
-	    if ((p->mb_mode == 1 || p->mb_mode == 2) && p->mb_mbid == mbid) {
-		/* this process is trying to write this mbox */
-		goto got_rendezvous;
-	    }
+	/* look for a writer */
+	p = mb_lookup(mbid, 0);
+	if (p) {
+	    /* this process is trying to write this mbox */
+	    goto got_rendezvous;
 	}
 	/* nobody is writing just now */
 	goto dosleep;
     }
     else if (mode == 1 || mode == 2) {
 	/* write, or write/read */
-	/* walk the whole process list looking for a reader */
-	for (p = proclist; p; p = p->gl_next) {
-	    if (p->mb_mode == 0 && p->mb_mbid == mbid) {
-		/* this process is reading this mbox */
-		goto got_rendezvous;
-	    }
+	/* look for a reader */
+	p = mb_lookup(mbid, 1);
+	if (p) {
+	    /* this process is reading this mbox */
+	    goto got_rendezvous;
 	}
 	/* nobody is reading just now */
 	get_curproc()->mb_long1 = *(long *)ptr;	/* copy the message */
@@ -166,6 +231,8 @@ sys_p_msg(int mode, long mbid, char *ptr)
  */
 
 got_rendezvous:
+    mb_unlink(p);
+
     if (!mode) {
 	/* curproc is reading */
 	*(long *)(ptr) = p->mb_long1;		/* copy the message */
@@ -179,6 +246,7 @@ got_rendezvous:
 	     */
 	    p->mb_mbid = 0xFFFF0000L | p->pid;
 	    p->mb_mode = 0;
+	    mb_link(p);
 	}
 	else {
 	    short sr = spl7();
@@ -232,6 +300,7 @@ dosleep:
 	}
 	get_curproc()->mb_mbid = mbid;	/* and ID waited for */
 	get_curproc()->mb_mode = mode;	/* save mode */
+	mb_link(get_curproc());
 
 /*
  * OK: now we sleep until a rendezvous has occured. The loop is because we
@@ -506,3 +575,182 @@ free_semaphores(int pid)
 		wake(WAIT_Q, WAIT_SEMA);
 	}
 }
+
+/*
+ * long Pfutex(short op, long *addr, long val, long arg)
+ *
+ *	OP		ACTION
+ *	FUTEX_WAIT	If *addr still equals val, sleep until a FUTEX_WAKE
+ *			on addr, a signal, or after arg milliseconds
+ *			(0 means forever).
+ *	FUTEX_WAKE	Wake up to val processes waiting on addr.
+ *
+ * RETURNS
+ *
+ *	FUTEX_WAIT: 0 when woken, EAGAIN if *addr != val, ETIMEDOUT,
+ *	or EINTR.  FUTEX_WAKE: the number of processes woken.
+ *
+ * This is the kernel half of a user space lock: taking and releasing an
+ * uncontended lock is done with an atomic instruction on the lock word,
+ * only a process that has to wait and the one that releases a lock with
+ * waiters enter the kernel.  The value test in FUTEX_WAIT closes the
+ * window between a process seeing the lock busy and going to sleep.
+ *
+ * Each waiter sleeps on its own wait channel, so FUTEX_WAKE wakes exactly
+ * the processes it takes off the hash chain.  Addresses are physical, so
+ * processes sharing memory (threads, shared memory blocks) can use a lock
+ * word together.
+ */
+
+# define FUTEX_HASHBITS	5
+# define FUTEX_HASHSIZE	(1 << FUTEX_HASHBITS)
+# define FUTEX_HASH(a)	((int)(((long)(a) >> 2) ^ ((long)(a) >> (2 + FUTEX_HASHBITS))) & (FUTEX_HASHSIZE - 1))
+
+struct futex_waiter
+{
+	struct futex_waiter *next;
+	long *addr;
+	struct proc *p;
+	short woken;
+};
+
+static struct futex_waiter *futex_table[FUTEX_HASHSIZE];
+static long futex_waiters;
+
+static void
+futex_unlink(struct futex_waiter *w)
+{
+	struct futex_waiter **wp;
+
+	for (wp = &futex_table[FUTEX_HASH(w->addr)]; *wp; wp = &(*wp)->next)
+	{
+		if (*wp == w)
+		{
+			*wp = w->next;
+			futex_waiters--;
+			break;
+		}
+	}
+}
+
+long _cdecl
+sys_p_futex(int op, long *addr, long val, long arg)
+{
+	TRACELOW(("Pfutex(%d,%p,%lx,%lx)", op, addr, val, arg));
+
+	if (!addr || ((long) addr & 1))
+		return EINVAL;
+
+	switch (op)
+	{
+		case FUTEX_WAIT:
+		{
+			struct futex_waiter w, **wp;
+			TIMEOUT *timeout_ptr = NULL;
+			long r;
+
+			if (*addr != val)
+				return EAGAIN;
+
+			/* at the end of the chain, waiters are woken in order */
+			w.next = NULL;
+			w.addr = addr;
+			w.p = get_curproc();
+			w.woken = 0;
+
+			for (wp = &futex_table[FUTEX_HASH(addr)]; *wp; wp = &(*wp)->next)
+				;
+			*wp = &w;
+			futex_waiters++;
+
+			if (arg > 0)
+				timeout_ptr = addtimeout(get_curproc(), arg, unsemame);
+
+			for (;;)
+			{
+				if (sleep(WAIT_Q, (long) &w))
+				{
+					r = EINTR;
+					break;
+				}
+
+				if (w.woken)
+				{
+					r = E_OK;
+					break;
+				}
+
+				if (get_curproc()->wait_cond != (long) &w)
+				{
+					TRACE(("Pfutex(%d,%p) timed out", op, addr));
+					r = ETIMEDOUT;
+					break;
+				}
+			}
+
+			/* a wake may have come in with the signal or timeout */
+			if (w.woken)
+				r = E_OK;
+			else
+				futex_unlink(&w);
+
+			if (timeout_ptr)
+				canceltimeout(timeout_ptr);
+
+			return r;
+		}
+		case FUTEX_WAKE:
+		{
+			struct futex_waiter *w, **wp;
+			long n = 0;
+
+			wp = &futex_table[FUTEX_HASH(addr)];
+			while ((w = *wp) && n < val)
+			{
+				if (w->addr == addr)
+				{
+					*wp = w->next;
+					futex_waiters--;
+
+					w->woken = 1;
+					wake(WAIT_Q, (long) w);
+					n++;
+				}
+				else
+					wp = &w->next;
+			}
+
+			return n;
+		}
+	}
+
+	DEBUG(("Pfutex(%d,%p): invalid op", op, addr));
+	return ENOSYS;
+}
+
+/*
+ * Called from terminate(): a process killed while waiting in Pfutex()
+ * leaves its waiter (on its kernel stack) in the table.
+ */
+void
+free_futex(struct proc *p)
+{
+	int i;
+
+	for (i = 0; futex_waiters && i < FUTEX_HASHSIZE; i++)
+	{
+		struct futex_waiter *w, **wp;
+
+		wp = &futex_table[i];
+		while ((w = *wp))
+		{
+			if (w->p == p)
+			{
+				*wp = w->next;
+				futex_waiters--;
+			}
+			else
+				wp = &w->next;
+		}
+	}
+}
@@ -10,8 +10,11 @@
 
 
 long _cdecl sys_p_msg (int mode, long mbid, char *ptr);
+void free_mailbox (struct proc *p);
 long _cdecl sys_p_semaphore (int mode, long id, long timeout);
 void free_semaphores (int pid);
+long _cdecl sys_p_futex (int op, long *addr, long val, long arg);
+void free_futex (struct proc *p);
 
 
 # endif /* _rendez_h */
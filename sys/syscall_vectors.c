@@ -55,6 +55,7 @@
 # include "dossig.h"
 # include "filesys.h"
 # include "ipc_socket.h"
+# include "k_aio.h"
 # include "k_exec.h"
 # include "k_exit.h"
 # include "k_fork.h"
@@ -507,10 +508,10 @@ Func dos_tab [DOS_MAX] =
 	/* 0x175 */		sys_p_semctl,	/* not implemented */
 	/* 0x176 */		sys_p_semop,	/* not implemented */
 	/* 0x177 */		sys_p_semconfig,/* not implemented */
-	/* 0x178 */		sys_p_msgget,	/* not implemented */
-	/* 0x179 */		sys_p_msgctl,	/* not implemented */
-	/* 0x17a */		sys_p_msgsnd,	/* not implemented */
-	/* 0x17b */		sys_p_msgrcv,	/* not implemented */
+	/* 0x178 */		sys_p_msgget,
+	/* 0x179 */		sys_p_msgctl,
+	/* 0x17a */		sys_p_msgsnd,
+	/* 0x17b */		sys_p_msgrcv,
 	/* 0x17c */		sys_enosys,		/* reserved */
 	/* 0x17d */		sys_m_access,	/* 1.15.12 */
 	/* 0x17e */		sys_enosys,		/* sys_mmap */
@@ -520,9 +521,9 @@ Func dos_tab [DOS_MAX] =
 	/* 0x181 */	(Func)	sys_f_chdir,	/* 1.17 */
 	/* 0x182 */	(Func)	sys_f_opendir,	/* 1.17 */
 	/* 0x183 */		sys_f_dirfd,	/* 1.17 */
-	/* 0x184 */		sys_enosys,		/* reserved */
-	/* 0x185 */		sys_enosys,		/* reserved */
-	/* 0x186 */		sys_enosys,		/* reserved */
+	/* 0x184 */		sys_f_aio,	/* 1.19 */
+	/* 0x185 */		sys_p_futex,	/* 1.19 */
+	/* 0x186 */		sys_d_getdents,	/* 1.19 */
 	/* 0x187 */		sys_enosys,		/* reserved */
 	/* 0x188 */		sys_enosys,		/* reserved */
 	/* 0x189 */		sys_enosys,		/* reserved */
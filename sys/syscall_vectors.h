@@ -35,4 +35,8 @@ extern Func dos_tab [];
 extern Func bios_tab [];
 extern Func xbios_tab [];
 
+extern ushort dos_max;
+extern ushort bios_max;
+extern ushort xbios_max;
+
 # endif /* _syscall_vector_h */
@@ -39,6 +39,7 @@
 
 # define IPCID_TO_IX(id)	((id) & 0xffff)
 # define IPCID_TO_SEQ(id)	(((id) >> 16) & 0xffff)
+# define IXSEQ_TO_IPCID(ix,perm) (((perm)._seq << 16L) | ((ix) & 0xffff))
 
 /* Common access type bits, used with ipcperm(). */
 # define IPC_R			000400	/* read permission */
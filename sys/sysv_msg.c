@@ -29,29 +29,520 @@
  * 
  */
 
+
 # include "sysv_msg.h"
+# include "sysv_ipc.h"
+
+# include "libkern/libkern.h"
+# include "mint/credentials.h"
+
+# include "k_prot.h"
+# include "kmemory.h"
+# include "proc.h"
+# include "time.h"
+
+
+/*
+ * Limits
+ */
+# define MSGMAX		2048		/* max chars in a message */
+# define MSGMNB		2048		/* default max chars in a queue */
+# define MSGMNI		16		/* max message queue identifiers */
+# define MSGTQL		64		/* max messages in system */
+# define MSGPOOL	16384L		/* max chars in all messages */
+
+# define MSG_THASH	8		/* type hash buckets per queue */
+
+/*
+ * A queued message; on the queue in sending order and, through its
+ * type entry, in sending order among the messages of the same type.
+ */
+struct kmsg
+{
+	struct kmsg	*next;		/* queue order */
+	struct kmsg	*prev;
+	struct kmsg	*tnext;		/* next message of the same type */
+	struct msgtype	*mt;		/* type entry */
+	long		size;		/* size of text */
+	char		text[0];
+};
+
+/*
+ * One per message type present on a queue; msgrcv() with a positive
+ * msgtyp finds it through the hash, with a negative msgtyp the lowest
+ * type is the first of the sorted list.
+ */
+struct msgtype
+{
+	struct msgtype	*hnext;		/* hash chain */
+	struct msgtype	*next;		/* ascending by type */
+	long		type;
+	struct kmsg	*first, *last;	/* messages of this type */
+};
+
+struct msqueue
+{
+	struct msqid_ds	ds;
+	struct kmsg	*first, *last;	/* all messages */
+	struct msgtype	*types;		/* ascending by type */
+	struct msgtype	*thash[MSG_THASH];
+	
+	/* wait channels */
+	char		rchan;		/* readers waiting for a message */
+	char		wchan;		/* writers waiting for space */
+	
+	/* statistics */
+	ulong		nsnd, nrcv;	/* messages sent, received */
+	ulong		nwait;		/* sleeps in msgsnd/msgrcv */
+};
+
+# define THASH(type)	((int)(type) & (MSG_THASH - 1))
+
+static struct msqueue *msqids[MSGMNI];
+static ushort msq_seq;
+
+static long msg_total;			/* messages in the system */
+static long msg_bytes;			/* chars in the system */
+
+
+static struct msqueue *
+msq_lookup (long msqid)
+{
+	long ix = IPCID_TO_IX (msqid);
+	struct msqueue *q;
+	
+	if (msqid < 0 || ix >= MSGMNI)
+		return NULL;
+	
+	q = msqids[ix];
+	if (!q || q->ds.msg_perm._seq != IPCID_TO_SEQ (msqid))
+		return NULL;
+	
+	return q;
+}
+
+static struct msgtype *
+type_lookup (struct msqueue *q, long type)
+{
+	struct msgtype *t;
+	
+	for (t = q->thash[THASH (type)]; t; t = t->hnext)
+		if (t->type == type)
+			break;
+	
+	return t;
+}
+
+static void
+msg_free (struct msqueue *q, struct kmsg *m)
+{
+	struct msgtype *t = m->mt;
+	
+	/* off the queue */
+	if (m->prev)
+		m->prev->next = m->next;
+	else
+		q->first = m->next;
+	
+	if (m->next)
+		m->next->prev = m->prev;
+	else
+		q->last = m->prev;
+	
+	/* off its type, always the first one */
+	t->first = m->tnext;
+	if (!t->first)
+	{
+		struct msgtype **tp;
+		
+		for (tp = &q->thash[THASH (t->type)]; *tp != t; tp = &(*tp)->hnext)
+			;
+		*tp = t->hnext;
+		
+		for (tp = &q->types; *tp != t; tp = &(*tp)->next)
+			;
+		*tp = t->next;
+		
+		kfree (t);
+	}
+	
+	q->ds.msg_cbytes -= m->size;
+	q->ds.msg_qnum--;
+	
+	msg_total--;
+	msg_bytes -= m->size;
+	
+	kfree (m);
+}
+
+static void
+msq_remove (long ix)
+{
+	struct msqueue *q = msqids[ix];
+	
+	while (q->first)
+		msg_free (q, q->first);
+	
+	msqids[ix] = NULL;
+	
+	/* sleepers find the queue gone */
+	wake (IO_Q, (long) &q->rchan);
+	wake (IO_Q, (long) &q->wchan);
+	
+	kfree (q);
+}
 
 
 long _cdecl
 sys_p_msgctl (long msqid, long cmd, struct msqid_ds *buf)
 {
-	return ENOSYS;
+	struct ucred *cred = get_curproc()->p_cred->ucr;
+	struct msqueue *q;
+	long r;
+	
+	TRACE (("Pmsgctl (%lx, %ld, %p)", msqid, cmd, buf));
+	
+	q = msq_lookup (msqid);
+	if (!q)
+		return EINVAL;
+	
+	switch (cmd)
+	{
+		case IPC_RMID:
+		{
+			r = ipcperm (cred, &q->ds.msg_perm, IPC_M);
+			if (r)
+				return r;
+			
+			msq_remove (IPCID_TO_IX (msqid));
+			return E_OK;
+		}
+		case IPC_SET:
+		{
+			r = ipcperm (cred, &q->ds.msg_perm, IPC_M);
+			if (r)
+				return r;
+			
+			if (!buf)
+				return EFAULT;
+			
+			if (buf->msg_qbytes > q->ds.msg_qbytes && !suser (cred))
+				return EPERM;
+			
+			if (buf->msg_qbytes == 0)
+				return EINVAL;
+			
+			q->ds.msg_perm.uid = buf->msg_perm.uid;
+			q->ds.msg_perm.gid = buf->msg_perm.gid;
+			q->ds.msg_perm.mode = (q->ds.msg_perm.mode & ~0777)
+						| (buf->msg_perm.mode & 0777);
+			q->ds.msg_qbytes = MIN (buf->msg_qbytes, MSGPOOL);
+			q->ds.msg_ctime = xtime.tv_sec;
+			
+			/* there may be room now */
+			wake (IO_Q, (long) &q->wchan);
+			return E_OK;
+		}
+		case IPC_STAT:
+		{
+			r = ipcperm (cred, &q->ds.msg_perm, IPC_R);
+			if (r)
+				return r;
+			
+			if (!buf)
+				return EFAULT;
+			
+			*buf = q->ds;
+			buf->msg_first = NULL;
+			buf->msg_last = NULL;
+			return E_OK;
+		}
+	}
+	
+	return EINVAL;
 }
 
 long _cdecl
 sys_p_msgget (long key, long msgflg)
 {
-	return ENOSYS;
+	struct ucred *cred = get_curproc()->p_cred->ucr;
+	struct msqueue *q;
+	long ix;
+	
+	TRACE (("Pmsgget (%lx, %lo)", key, msgflg));
+	
+	if (key != IPC_PRIVATE)
+	{
+		for (ix = 0; ix < MSGMNI; ix++)
+		{
+			q = msqids[ix];
+			if (q && q->ds.msg_perm._key == key)
+			{
+				long r;
+				
+				if ((msgflg & (IPC_CREAT | IPC_EXCL)) == (IPC_CREAT | IPC_EXCL))
+					return EEXIST;
+				
+				r = ipcperm (cred, &q->ds.msg_perm, msgflg & 0700);
+				if (r)
+					return r;
+				
+				return IXSEQ_TO_IPCID (ix, q->ds.msg_perm);
+			}
+		}
+		
+		if (!(msgflg & IPC_CREAT))
+			return ENOENT;
+	}
+	
+	for (ix = 0; ix < MSGMNI; ix++)
+		if (!msqids[ix])
+			break;
+	
+	if (ix == MSGMNI)
+		return ENOSPC;
+	
+	q = kmalloc (sizeof (*q));
+	if (!q)
+		return ENOMEM;
+	
+	bzero (q, sizeof (*q));
+	
+	q->ds.msg_perm.uid = q->ds.msg_perm.cuid = cred->euid;
+	q->ds.msg_perm.gid = q->ds.msg_perm.cgid = cred->egid;
+	q->ds.msg_perm.mode = msgflg & 0777;
+	q->ds.msg_perm._seq = msq_seq++ & 0x7fff;
+	q->ds.msg_perm._key = key;
+	q->ds.msg_qbytes = MSGMNB;
+	q->ds.msg_ctime = xtime.tv_sec;
+	
+	msqids[ix] = q;
+	
+	return IXSEQ_TO_IPCID (ix, q->ds.msg_perm);
 }
 
 long _cdecl
 sys_p_msgsnd (long msqid, const void *msgp, long msgsz, long msgflg)
 {
-	return ENOSYS;
+	struct msqueue *q;
+	struct msgtype *t;
+	struct kmsg *m;
+	long type;
+	long r;
+	
+	TRACE (("Pmsgsnd (%lx, %p, %ld, %lo)", msqid, msgp, msgsz, msgflg));
+	
+	if (msgsz < 0 || msgsz > MSGMAX)
+		return EINVAL;
+	
+	if (!msgp)
+		return EFAULT;
+	
+	type = *(const long *) msgp;
+	if (type < 1)
+		return EINVAL;
+	
+	for (;;)
+	{
+		q = msq_lookup (msqid);
+		if (!q)
+			return EIDRM;
+		
+		r = ipcperm (get_curproc()->p_cred->ucr, &q->ds.msg_perm, IPC_W);
+		if (r)
+			return r;
+		
+		if (msgsz > q->ds.msg_qbytes)
+			return EINVAL;
+		
+		if (q->ds.msg_cbytes + msgsz <= q->ds.msg_qbytes
+		    && msg_total < MSGTQL && msg_bytes + msgsz <= MSGPOOL)
+			break;
+		
+		if (msgflg & IPC_NOWAIT)
+			return EAGAIN;
+		
+		q->nwait++;
+		if (sleep (IO_Q, (long) &q->wchan))
+			return EINTR;
+	}
+	
+	m = kmalloc (sizeof (*m) + msgsz);
+	if (!m)
+		return ENOMEM;
+	
+	t = type_lookup (q, type);
+	if (!t)
+	{
+		struct msgtype **tp;
+		
+		t = kmalloc (sizeof (*t));
+		if (!t)
+		{
+			kfree (m);
+			return ENOMEM;
+		}
+		
+		t->type = type;
+		t->first = NULL;
+		
+		t->hnext = q->thash[THASH (type)];
+		q->thash[THASH (type)] = t;
+		
+		for (tp = &q->types; *tp && (*tp)->type < type; tp = &(*tp)->next)
+			;
+		t->next = *tp;
+		*tp = t;
+	}
+	
+	m->size = msgsz;
+	m->mt = t;
+	memcpy (m->text, (const char *) msgp + sizeof (long), msgsz);
+	
+	/* on the queue */
+	m->next = NULL;
+	m->prev = q->last;
+	if (q->last)
+		q->last->next = m;
+	else
+		q->first = m;
+	q->last = m;
+	
+	/* behind the others of its type */
+	m->tnext = NULL;
+	if (t->first)
+		t->last->tnext = m;
+	else
+		t->first = m;
+	t->last = m;
+	
+	q->ds.msg_cbytes += msgsz;
+	q->ds.msg_qnum++;
+	q->ds.msg_lspid = get_curproc()->pid;
+	q->ds.msg_stime = xtime.tv_sec;
+	q->nsnd++;
+	
+	msg_total++;
+	msg_bytes += msgsz;
+	
+	wake (IO_Q, (long) &q->rchan);
+	return E_OK;
 }
 
 long _cdecl
 sys_p_msgrcv (long msqid, void *msgp, long msgsz, long msgtyp, long msgflg)
 {
-	return ENOSYS;
+	struct msqueue *q;
+	struct kmsg *m;
+	long type;
+	long r;
+	
+	TRACE (("Pmsgrcv (%lx, %p, %ld, %ld, %lo)", msqid, msgp, msgsz, msgtyp, msgflg));
+	
+	if (msgsz < 0)
+		return EINVAL;
+	
+	if (!msgp)
+		return EFAULT;
+	
+	for (;;)
+	{
+		q = msq_lookup (msqid);
+		if (!q)
+			return EIDRM;
+		
+		r = ipcperm (get_curproc()->p_cred->ucr, &q->ds.msg_perm, IPC_R);
+		if (r)
+			return r;
+		
+		if (msgtyp == 0)
+		{
+			/* the oldest message */
+			m = q->first;
+		}
+		else if (msgtyp > 0)
+		{
+			/* the oldest message of type msgtyp */
+			struct msgtype *t = type_lookup (q, msgtyp);
+			
+			m = t ? t->first : NULL;
+		}
+		else
+		{
+			/* the oldest message of the lowest type <= -msgtyp */
+			m = NULL;
+			if (q->types && q->types->type <= -msgtyp)
+				m = q->types->first;
+		}
+		
+		if (m)
+			break;
+		
+		if (msgflg & IPC_NOWAIT)
+			return ENOMSG;
+		
+		q->nwait++;
+		if (sleep (IO_Q, (long) &q->rchan))
+			return EINTR;
+	}
+	
+	if (m->size > msgsz)
+	{
+		if (!(msgflg & MSG_NOERROR))
+			return E2BIG;
+	}
+	else
+		msgsz = m->size;
+	
+	type = m->mt->type;
+	*(long *) msgp = type;
+	memcpy ((char *) msgp + sizeof (long), m->text, msgsz);
+	
+	q->ds.msg_lrpid = get_curproc()->pid;
+	q->ds.msg_rtime = xtime.tv_sec;
+	q->nrcv++;
+	
+	msg_free (q, m);
+	
+	wake (IO_Q, (long) &q->wchan);
+	return msgsz;
+}
+
+/*
+ * /kern/sysvmsg
+ */
+long
+msg_dump (char *buf, long len)
+{
+	char *crs = buf;
+	long i, ix;
+	
+	i = ksprintf (crs, len,
+		      "messages:\t%ld/%d\nbytes:\t\t%ld/%ld\n\n"
+		      "   msqid        key  mode qnum cbytes qbytes types lspid lrpid     sent     rcvd    waits\n",
+		      msg_total, MSGTQL, msg_bytes, MSGPOOL);
+	crs += i; len -= i;
+	
+	for (ix = 0; ix < MSGMNI && len > 100; ix++)
+	{
+		struct msqueue *q = msqids[ix];
+		struct msgtype *t;
+		long types = 0;
+		
+		if (!q)
+			continue;
+		
+		for (t = q->types; t; t = t->next)
+			types++;
+		
+		i = ksprintf (crs, len, "%8lx %10lx %5lo %4lu %6lu %6lu %5ld %5d %5d %8lu %8lu %8lu\n",
+			      IXSEQ_TO_IPCID (ix, q->ds.msg_perm), q->ds.msg_perm._key,
+			      q->ds.msg_perm.mode & 0777,
+			      q->ds.msg_qnum, q->ds.msg_cbytes, q->ds.msg_qbytes, types,
+			      q->ds.msg_lspid, q->ds.msg_lrpid,
+			      q->nsnd, q->nrcv, q->nwait);
+		crs += i; len -= i;
+	}
+	
+	return crs - buf;
 }
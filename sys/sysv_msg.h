@@ -41,5 +41,7 @@ long _cdecl sys_p_msgget (long key, long msgflg);
 long _cdecl sys_p_msgsnd (long msqid, const void *msgp, long msgsz, long msgflg);
 long _cdecl sys_p_msgrcv (long msqid, void *msgp, long msgsz, long msgtyp, long msgflg);
 
+long msg_dump (char *buf, long len);
+
 
 # endif	/* _sysv_msg_h  */
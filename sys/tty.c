@@ -223,8 +223,8 @@ tty_read(FILEPTR *f, void *buf, long nbytes)
 		&& ((f->flags & O_HEAD)
 			|| ((tty->state &= ~TS_COOKED), !tty->pgrp)
 			|| tty->pgrp == get_curproc()->pgrp
-			|| f->fc.dev != get_curproc()->p_fd->control->fc.dev
-			|| f->fc.index != get_curproc()->p_fd->control->fc.index)
+			|| f->fc.dev != FD_CONTROL(get_curproc()->p_fd)->fc.dev
+			|| f->fc.index != FD_CONTROL(get_curproc()->p_fd)->fc.index)
 		&& !(tty->state & TS_BLIND)
 		&& (r = (*f->dev->readb)(f, buf, nbytes)) != ENODEV)
 	{
@@ -434,8 +434,8 @@ tty_checkttou (FILEPTR *f, struct tty *tty)
 		&& (tty->sg.sg_flags & T_TOSTOP)
 		&& (SIGACTION(get_curproc(), SIGTTOU).sa_handler != SIG_IGN)
 		&& ((get_curproc()->p_sigmask & (1L << SIGTTOU)) == 0L)
-		&& (f->fc.dev == get_curproc()->p_fd->control->fc.dev)
-		&& (f->fc.index == get_curproc()->p_fd->control->fc.index))
+		&& (f->fc.dev == FD_CONTROL(get_curproc()->p_fd)->fc.dev)
+		&& (f->fc.index == FD_CONTROL(get_curproc()->p_fd)->fc.index))
 	{
 		TRACE (("job control: tty pgrp is %d proc pgrp is %d", tty->pgrp, get_curproc()->pgrp));
 		killgroup (get_curproc()->pgrp, SIGTTOU, 1);
@@ -483,6 +483,34 @@ tty_write (FILEPTR *f, const void *buf, long nbytes)
 	
 	if (nbytes == 0)
 		return bytes_written;
+	
+	/* pty master and the slave isn't reading cooked: none of the
+	 * characters is special then, so move them into the pipe a
+	 * buffer at a time instead of one tty_putchar per character
+	 */
+	if ((f->flags & O_HEAD) && !(tty->state & TS_COOKED))
+	{
+		while (nbytes > 0)
+		{
+			long n = (nbytes < LBUFSIZ) ? nbytes : LBUFSIZ;
+			long i;
+			
+			for (i = 0; i < n; i++)
+				lbuf[i] = *ptr++;
+			
+			c = (*f->dev->write)(f, (char *) lbuf, n * 4);
+			if (c < E_OK)
+				return bytes_written ? bytes_written : c;
+			
+			bytes_written += c >> 2;
+			if (c != n * 4)
+				break;
+			
+			nbytes -= n;
+		}
+		
+		return bytes_written;
+	}
 # if 1
 	/* see if we can do fast RAW byte IO thru the device driver... */
 	if (!use_putchar && HAS_WRITEB(f))
@@ -1209,11 +1237,11 @@ tty_ioctl (FILEPTR *f, int mode, void *arg)
 		case TIOCNOTTY:
 		{
 			/* Disassociate from controlling tty.  */
-			if (get_curproc()->p_fd->control == NULL)
+			if (FD_CONTROL(get_curproc()->p_fd) == NULL)
 				return ENOTTY;
 				
-			if (get_curproc()->p_fd->control->fc.index != f->fc.index ||
-			    get_curproc()->p_fd->control->fc.dev != f->fc.dev)
+			if (FD_CONTROL(get_curproc()->p_fd)->fc.index != f->fc.index ||
+			    FD_CONTROL(get_curproc()->p_fd)->fc.dev != f->fc.dev)
 		    		return ENOTTY;
 		    	
 		    	/* Session leader.  Disassociate from controlling
@@ -1231,8 +1259,8 @@ tty_ioctl (FILEPTR *f, int mode, void *arg)
 				}
 			}
 			
-			do_close (get_curproc(), get_curproc()->p_fd->control);
-			get_curproc()->p_fd->control = NULL;
+			do_close (get_curproc(), FD_CONTROL(get_curproc()->p_fd));
+			FD_CONTROL(get_curproc()->p_fd) = NULL;
 			
 			return 0;
 		}
@@ -1250,7 +1278,7 @@ tty_ioctl (FILEPTR *f, int mode, void *arg)
 			if (f->flags & O_HEAD)
 				return ENOTTY;
 				
-			if (get_curproc()->pgrp != get_curproc()->pid || get_curproc()->p_fd->control)
+			if (get_curproc()->pgrp != get_curproc()->pid || FD_CONTROL(get_curproc()->p_fd))
 				return EPERM;
 
 			f->links++;
@@ -1269,10 +1297,10 @@ tty_ioctl (FILEPTR *f, int mode, void *arg)
 					if (p->wait_q == ZOMBIE_Q || p->wait_q == TSR_Q)
 						continue;
 
-					if (p->p_fd->control &&
+					if (FD_CONTROL(p->p_fd) &&
 					    p->pgrp == p->pid &&
-					    p->p_fd->control->fc.index == f->fc.index &&
-					    p->p_fd->control->fc.dev == f->fc.dev)
+					    FD_CONTROL(p->p_fd)->fc.index == f->fc.index &&
+					    FD_CONTROL(p->p_fd)->fc.dev == f->fc.dev)
 					{
 						    if (!suser (get_curproc()->p_cred->ucr) ||
 							(long)arg != 1)
@@ -1280,13 +1308,13 @@ tty_ioctl (FILEPTR *f, int mode, void *arg)
 							    do_close (get_curproc(), f);
 							    return EPERM;
 						    }
-						    do_close (get_curproc(), p->p_fd->control);
-						    p->p_fd->control = NULL;
+						    do_close (get_curproc(), FD_CONTROL(p->p_fd));
+						    FD_CONTROL(p->p_fd) = NULL;
 					}
 				}
 			}
 			
-			get_curproc()->p_fd->control = f;
+			FD_CONTROL(get_curproc()->p_fd) = f;
 			tty->pgrp = get_curproc()->pgrp;
 			DEBUG (("TIOCSCTTY: assigned tty->pgrp = %i", tty->pgrp));
 			
@@ -1483,8 +1511,8 @@ tty_getchar (FILEPTR *f, int mode)
 	 */
 	
 	if ((tty->pgrp && tty->pgrp != get_curproc()->pgrp)
-		&& (f->fc.dev == get_curproc()->p_fd->control->fc.dev)
-		&& (f->fc.index == get_curproc()->p_fd->control->fc.index))
+		&& (f->fc.dev == FD_CONTROL(get_curproc()->p_fd)->fc.dev)
+		&& (f->fc.index == FD_CONTROL(get_curproc()->p_fd)->fc.index))
 	{
 		TRACE (("job control: tty pgrp is %d proc pgrp is %d", tty->pgrp, get_curproc()->pgrp));
 		killgroup (get_curproc()->pgrp, SIGTTIN, 1);
@@ -63,14 +63,27 @@ update (void *arg)
 
 # else
 
+# include "filesys.h"
+# include "k_workq.h"
 # include "timeout.h"
 
-/* do_sync: sync all filesystems at regular intervals
+/* the sync may have to wait for the disk, so it is done by a
+ * worker thread rather than in the timeout itself
  */
-static void
-do_sync (struct proc *p)
+static struct work sync_work;
+
+static void _cdecl
+sync_func (struct work *w)
 {
 	sys_s_ync ();
+}
+
+/* do_sync: sync all filesystems at regular intervals
+ */
+static void _cdecl
+do_sync (struct proc *p, long arg)
+{
+	queue_work (&sync_work);
 
 	addroottimeout (1000L * sync_time, do_sync, 0);
 }
@@ -82,6 +95,7 @@ start_sysupdate (void)
 {
 # ifndef SYSUPDATE_DAEMON
 
+	work_init (&sync_work, "sync", sync_func, 0);
 	addroottimeout (1000L * sync_time, do_sync, 0);
 
 # else
@@ -139,7 +139,7 @@ sys_b_midiws (int cnt, const char *buf)
 	FILEPTR *f;
 	long towrite = cnt+1;
 
-	f = get_curproc()->p_fd->midiout;	/* MIDI output handle */
+	f = FD_MIDIOUT(get_curproc()->p_fd);	/* MIDI output handle */
 	if (!f)
 		return EBADF;
 
@@ -418,7 +418,7 @@ sys_b_cursconf (int cmd, int op)
 	FILEPTR *f;
 	long r;
 
-	f = get_curproc()->p_fd->control;
+	f = FD_CONTROL(get_curproc()->p_fd);
 	if (!f || !is_terminal(f))
 		return ENOSYS;
 
@@ -452,6 +452,9 @@ sys_b_dosound (const char *p)
 		if (r && get_prot_mode (r) == PROT_P)
 		{
 			DEBUG (("Dosound: changing protection to Super"));
+# ifdef COW_FORK
+			cow_unshare (r);
+# endif
 			mark_region (r, PROT_S, 0);
 		}
 	}
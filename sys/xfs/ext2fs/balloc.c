@@ -34,6 +34,7 @@
 # include <mint/endian.h>
 
 # include "bitmap.h"
+# include "journal.h"
 # include "super.h"
 
 
@@ -161,10 +162,14 @@ do_more:
 		}
 	}
 	
-	bio_MARK_MODIFIED (&bio, u);
-	bio_MARK_MODIFIED (&bio, u2);
-	bio_MARK_MODIFIED (&bio, s->sbi.s_sb_unit);
-	
+	ext2_mark_modified (s, u);
+	ext2_mark_modified (s, u2);
+	ext2_mark_modified (s, s->sbi.s_sb_unit);
+
+	/* logged copies must not be replayed over the next user */
+	if (s->sbi.s_journal)
+		ext2_journal_revoke (s, block, count);
+
 	if (overflow)
 	{
 		block += count;
@@ -208,7 +213,22 @@ ext2_new_block (COOKIE *inode, ulong goal, ulong *prealloc_count, ulong *preallo
 	
 	/* lock_super (s); */
 	
-	if (le2cpu32 (s->sbi.s_sb->s_free_blocks_count) <= le2cpu32 (s->sbi.s_sb->s_r_blocks_count)
+	/* the flush of a delayed allocation buffer takes the blocks that
+	 * were reserved for it when the data was buffered, everybody
+	 * else has to leave them alone
+	 */
+	if (!inode->i_da_flushing
+		&& le2cpu32 (s->sbi.s_sb->s_free_blocks_count)
+			<= s->sbi.s_da_reserved + s->sbi.s_da_reserved / EXT2_ADDR_PER_BLOCK (s) + 3)
+	{
+		DEBUG (("ext2_new_block: free blocks reserved for delayed allocation!"));
+		
+		/* unlock_super (s); */
+		return 0;
+	}
+	
+	if (!inode->i_da_flushing
+		&& le2cpu32 (s->sbi.s_sb->s_free_blocks_count) <= le2cpu32 (s->sbi.s_sb->s_r_blocks_count)
 # if 1
 		&& ((s->sbi.s_resuid != p_geteuid ())
 			&& (s->sbi.s_resgid == 0 || s->sbi.s_resgid != p_getegid ()))
@@ -436,7 +456,7 @@ got_block:
 	
 	j = tmp;
 	
-	bio_MARK_MODIFIED (&bio, u);
+	ext2_mark_modified (s, u);
 	
 	if (j >= s->sbi.s_blocks_count)
 	{
@@ -450,10 +470,10 @@ got_block:
 	DEBUG (("allocating block %ld: Goal hits %ld of %ld", j, goal_hits, goal_attempts));
 	
 	gdp->bg_free_blocks_count = cpu2le16 (le2cpu16 (gdp->bg_free_blocks_count) - 1);
-	bio_MARK_MODIFIED (&bio, u2);
+	ext2_mark_modified (s, u2);
 	
 	s->sbi.s_sb->s_free_blocks_count = cpu2le32 (le2cpu32 (s->sbi.s_sb->s_free_blocks_count) - 1);
-	bio_MARK_MODIFIED (&bio, s->sbi.s_sb_unit);
+	ext2_mark_modified (s, s->sbi.s_sb_unit);
 	
 	s->sbi.s_dirty = 1;
 	*err = E_OK;
@@ -33,6 +33,7 @@
 
 # include "ext2sys.h"
 # include "inode.h"
+# include "journal.h"
 # include "truncate.h"
 
 
@@ -105,9 +106,10 @@ e_open (FILEPTR *f)
 	{
 		DEBUG (("e_open: truncate file to 0 bytes"));
 		
+		ext2_journal_start (c->s);
 		ext2_truncate (c, 0);
 		
-		bio_SYNC_DRV ((&bio), c->s->di);
+		ext2_sync_drv (c->s);
 	}
 	
 	c->i_size = le2cpu32 (c->in.i_size);
@@ -126,6 +128,7 @@ static long _cdecl
 e_close (FILEPTR *f, int pid)
 {
 	COOKIE *c = (COOKIE *) f->fc.index;
+	long r = E_OK;
 	
 	DEBUG (("Ext2-FS: e_close: enter #%li", c->inode));
 	
@@ -157,6 +160,8 @@ e_close (FILEPTR *f, int pid)
 		}
 	}
 	
+	ext2_journal_start (super [f->fc.dev]);
+	
 	if (f->links <= 0)
 	{
 		register FILEPTR **temp;
@@ -182,15 +187,18 @@ e_close (FILEPTR *f, int pid)
 		}
 		
 		if (((f->flags & O_RWMODE) == O_WRONLY) || ((f->flags & O_RWMODE) == O_RDWR))
+		{
+			r = ext2_da_release (c);
 			ext2_discard_prealloc (c);
+		}
 		
 		rel_cookie (c);
 	}
 	
-	bio_SYNC_DRV ((&bio), super [f->fc.dev]->di);
+	ext2_sync_drv (super [f->fc.dev]);
 	
-	DEBUG (("Ext2-FS: e_close: leave #%li", c->inode));
-	return E_OK;
+	DEBUG (("Ext2-FS: e_close: leave #%li (%li)", c->inode, r));
+	return r;
 }
 
 INLINE void
@@ -238,6 +246,12 @@ e_write (FILEPTR *f, const char *buf, long bytes)
 	if ((s->s_flags & MS_RDONLY) || IS_IMMUTABLE (c))
 		return 0;
 	
+	/* data of an earlier write that couldn't be put on the disk */
+	if (c->i_da_err)
+		return ext2_da_error (c);
+	
+	ext2_journal_start (s);
+	
 	remove_suid (c);
 	
 	if (IS_APPEND (c))	pos = c->i_size;
@@ -257,6 +271,9 @@ e_write (FILEPTR *f, const char *buf, long bytes)
 		UNIT *u;
 		ulong data;
 		
+		if (c->i_da_count && ext2_da_flush (c))
+			goto out;
+		
 		tmp = ext2_getblk (c, block++, &err, 1);
 		if (!tmp)
 		{
@@ -275,7 +292,7 @@ e_write (FILEPTR *f, const char *buf, long bytes)
 		data = MIN (todo, data);
 		
 		memcpy (u->data + offset, buf, data);
-		bio_MARK_MODIFIED (&bio, u);
+		ext2_mark_data (s, u);
 		
 		buf += data;
 		todo -= data;
@@ -291,6 +308,25 @@ e_write (FILEPTR *f, const char *buf, long bytes)
 		long data = EXT2_BLOCK_SIZE (s);
 		ulong tmp;
 		
+		/* appended blocks get their disk blocks later */
+		blocks = ext2_da_write (c, block, buf, todo >> EXT2_BLOCK_SIZE_BITS (s));
+		if (c->i_da_err)
+			goto out;
+		
+		if (blocks > 0)
+		{
+			data = blocks << EXT2_BLOCK_SIZE_BITS (s);
+			block += blocks;
+			
+			buf += data;
+			todo -= data;
+			written += data;
+			pos += data;
+			
+			continue;
+		}
+		
+		blocks = 1;
 		tmp = ext2_getblk (c, block++, &err, 0);
 		if (!tmp)
 			goto out;
@@ -325,6 +361,9 @@ e_write (FILEPTR *f, const char *buf, long bytes)
 			goto out;
 		}
 		
+		if (s->sbi.s_journal)
+			ext2_journal_data (s, tmp, blocks);
+		
 		buf += data;
 		todo -= data;
 		written += data;
@@ -340,6 +379,9 @@ e_write (FILEPTR *f, const char *buf, long bytes)
 		ulong tmp;
 		UNIT *u;
 		
+		if (c->i_da_count && ext2_da_flush (c))
+			goto out;
+		
 		tmp = ext2_getblk (c, block, &err, 1);
 		if (!tmp)
 		{
@@ -355,19 +397,32 @@ e_write (FILEPTR *f, const char *buf, long bytes)
 		}
 		
 		memcpy (u->data, buf, todo);
-		bio_MARK_MODIFIED (&bio, u);
+		ext2_mark_data (s, u);
 		
 		written += todo;
 		pos += todo;
 	}
 	
 out:
-	if (pos > c->i_size)
+	if (c->i_da_err)
+	{
+		/* a failed flush cut the file back to what is on the disk */
+		long start = pos - written;
+		long end = le2cpu32 (c->in.i_size);
+		
+		if (pos > end)
+		{
+			written = (end > start) ? end - start : 0;
+			pos = start + written;
+		}
+	}
+	
+	if (written && pos > c->i_size)
 	{
 		c->i_size = pos;
 	}
 
-	if (pos > le2cpu32(c->in.i_size)) 
+	if (written && pos > le2cpu32(c->in.i_size)) 
 	{
 		c->in.i_size = cpu2le32(pos);
 	}
@@ -375,9 +430,20 @@ out:
 	c->in.i_ctime = c->in.i_mtime = cpu2le32 (CURRENT_TIME);
 	mark_inode_dirty (c);
 	
+	pc_inval (s, c->inode, pos - written, written);
+	
 	f->pos = pos;
 	
+	ext2_journal_stop (s);
+	
 	DEBUG (("Ext2-FS [%c]: e_write: leave (#%li: pos = %li, written = %li)", f->fc.dev+'A', c->inode, f->pos, written));
+	
+	/* nothing written because the delayed blocks failed; otherwise
+	 * the error is left for the next call
+	 */
+	if (!written && c->i_da_err)
+		return ext2_da_error (c);
+	
 	return written;
 }
 
@@ -393,11 +459,17 @@ e_read (FILEPTR *f, char *buf, long bytes)
 	ulong block = f->pos >> EXT2_BLOCK_SIZE_BITS (s);
 	ulong offset = f->pos & EXT2_BLOCK_SIZE_MASK (s);
 
+	long fill_pos;		/* start of the data read from disk */
+	char *fill_buf;
+
 	DEBUG (("Ext2-FS [%c]: e_read: enter (#%li: pos = %li, bytes = %li [%lu, %lu])", f->fc.dev+'A', c->inode, f->pos, bytes, block, offset));
 
 	if (EXT2_ISDIR (le2cpu16 (c->in.i_mode)))
 		return EISDIR;
 	
+	if (c->i_da_count)
+		ext2_da_flush (c);
+	
 	todo = MAX(0, MIN ((long)(c->i_size - f->pos), bytes));
 	done = 0;
 	
@@ -413,6 +485,27 @@ e_read (FILEPTR *f, char *buf, long bytes)
 		todo = 2147483647L; /* LONG_MAX */
 		DEBUG (("Ext2-FS [%c]: e_read: negative fix (todo = %li)", f->fc.dev+'A', todo));
 	}
+	else if (PCACHE_OK)
+	{
+		/* cached file data doesn't need the block mapping
+		 */
+		done = pcache.read (s, c->inode, f->pos, buf, todo);
+		if (done)
+		{
+			buf += done;
+			todo -= done;
+			f->pos += done;
+			
+			if (todo == 0)
+				goto out;
+			
+			block = f->pos >> EXT2_BLOCK_SIZE_BITS (s);
+			offset = f->pos & EXT2_BLOCK_SIZE_MASK (s);
+		}
+	}
+	
+	fill_pos = f->pos;
+	fill_buf = buf;
 	
 	/* partial block copy
 	 */
@@ -425,6 +518,8 @@ e_read (FILEPTR *f, char *buf, long bytes)
 		if (!u && data)
 		{
 			DEBUG (("Ext2-FS: partial part: ext2_read failure (r = %li)", data));
+			if (!done)
+				done = data;
 			goto out;
 		}
 		
@@ -444,42 +539,52 @@ e_read (FILEPTR *f, char *buf, long bytes)
 	 */
 	while (todo >> EXT2_BLOCK_SIZE_BITS (s))
 	{
-		long blocks = 1;
-		long data = EXT2_BLOCK_SIZE (s);
-		ulong tmp;
+		long blocks = todo >> EXT2_BLOCK_SIZE_BITS (s);
+		long data;
+		long run;
+		long tmp;
+		
+		/* one request per contiguous run
+		 */
+		tmp = ext2_bmap_run (c, block, &run);
+		if (tmp < 0)
+		{
+			DEBUG (("Ext2-FS: blocks part: ext2_bmap_run failure (r = %li)", tmp));
+			if (!done)
+				done = tmp;
+			goto out;
+		}
+		
+		if (run < blocks)
+			blocks = run;
 		
-		tmp = ext2_bmap (c, block++);
+		/* linear read optimization across runs
+		 */
 		if (tmp)
 		{
-			long r;
+			long left = (todo >> EXT2_BLOCK_SIZE_BITS (s)) - blocks;
 			
-			if ((todo - data) >= EXT2_BLOCK_SIZE (s))
+			while (left > 0 && ext2_bmap_run (c, block + blocks, &run) == tmp + blocks)
 			{
-				register ulong tmp_new = ext2_bmap (c, block);
-				register long tmp_old = tmp;
-				
-				/* linear read optimization
-				 */
-				while (tmp_new && ((tmp_new - tmp_old) == 1))
-				{
-					data += EXT2_BLOCK_SIZE (s);
-					block++;
-					blocks++;
-					
-					if ((todo - data) >= EXT2_BLOCK_SIZE (s))
-					{
-						tmp_old = tmp_new;
-						tmp_new = ext2_bmap (c, block);
-					}
-					else
-						break;
-				}
+				run = MIN (run, left);
+				blocks += run;
+				left -= run;
 			}
+		}
+		
+		data = blocks << EXT2_BLOCK_SIZE_BITS (s);
+		block += blocks;
+		
+		if (tmp)
+		{
+			long r;
 			
 			r = bio.l_read (s->di, tmp, blocks, EXT2_BLOCK_SIZE (s), buf);
 			if (r)
 			{
 				DEBUG (("Ext2-FS: blocks part: bio.l_read failure (r = %li)", r));
+				if (!done)
+					done = r;
 				goto out;
 			}
 		}
@@ -505,6 +610,8 @@ e_read (FILEPTR *f, char *buf, long bytes)
 		if (!u && r)
 		{
 			DEBUG (("Ext2-FS: left part: ext2_read failure (r = %li)", r));
+			if (!done)
+				done = r;
 			goto out;
 		}
 		
@@ -515,6 +622,9 @@ e_read (FILEPTR *f, char *buf, long bytes)
 		f->pos += todo;
 	}
 	
+	if (PCACHE_OK)
+		pcache.fill (s, c->inode, fill_pos, fill_buf, f->pos - fill_pos, c->i_size);
+	
 out:
 	if (!((f->flags & O_NOATIME) 
 	     || (s->s_flags & MS_NOATIME) 
@@ -612,6 +722,8 @@ e_ioctl (FILEPTR *f, int mode, void *arg)
 			if (IS_IMMUTABLE (c))
 				return EACCES;
 			
+			ext2_journal_start (c->s);
+			
 			c->in.i_ctime = cpu2le32 (CURRENT_TIME);
 			
 			if (arg)
@@ -638,7 +750,7 @@ e_ioctl (FILEPTR *f, int mode, void *arg)
 			
 			mark_inode_dirty (c);
 			
-			bio_SYNC_DRV ((&bio), c->s->di);
+			ext2_sync_drv (c->s);
 			return E_OK;
 		}
 		case FTRUNCATE:
@@ -660,13 +772,14 @@ e_ioctl (FILEPTR *f, int mode, void *arg)
 			if (c->i_size < *((long *) arg))
 				return EACCES;
 			
+			ext2_journal_start (c->s);
 			ext2_truncate (c, *(unsigned long *)arg);
 			
 			pos = f->pos;
 			(void) e_lseek (f, 0, SEEK_SET);
 			(void) e_lseek (f, pos, SEEK_SET);
 			
-			bio_SYNC_DRV ((&bio), c->s->di);
+			ext2_sync_drv (c->s);
 			return E_OK;
 		}
 		case FIBMAP:
@@ -679,9 +792,14 @@ e_ioctl (FILEPTR *f, int mode, void *arg)
 			if (!arg)
 				return EINVAL;
 			
-			block = *(long *) arg;
-			*(long *) arg = ext2_bmap (c, block);
+			if (c->i_da_count)
+				ext2_da_flush (c);
 			
+			block = ext2_bmap (c, *(long *) arg);
+			if (block < 0)
+				return block;
+			
+			*(long *) arg = block;
 			return E_OK;
 		}
 		case F_SETLK:
@@ -872,6 +990,8 @@ e_ioctl (FILEPTR *f, int mode, void *arg)
 			if (inode->s->s_flags & MS_RDONLY)
 				return EROFS;
 			
+			ext2_journal_start (inode->s);
+			
 			if (flags & EXT2_SYNC_FL)
 				inode->i_flags |= MS_SYNCHRONOUS;
 			else
@@ -899,7 +1019,7 @@ e_ioctl (FILEPTR *f, int mode, void *arg)
 			inode->in.i_ctime = cpu2le32 (CURRENT_TIME);
 			mark_inode_dirty (inode);
 			
-			bio_SYNC_DRV ((&bio), inode->s->di);
+			ext2_sync_drv (inode->s);
 			return E_OK;
 		}
 		case EXT2_IOC_GETVERSION:
@@ -920,11 +1040,13 @@ e_ioctl (FILEPTR *f, int mode, void *arg)
 			if (inode->s->s_flags & MS_RDONLY)
 				return EROFS;
 			
+			ext2_journal_start (inode->s);
+			
 			inode->in.i_version = cpu2le32 (*(long *) arg);
 			inode->in.i_ctime = cpu2le32 (CURRENT_TIME);
 			mark_inode_dirty (inode);
 			
-			bio_SYNC_DRV ((&bio), inode->s->di);
+			ext2_sync_drv (inode->s);
 			return E_OK;
 		}
 	}
@@ -959,6 +1081,8 @@ e_datime (FILEPTR *f, ushort *timeptr, int flag)
 			if (IS_IMMUTABLE (c))
 				return EACCES;
 			
+			ext2_journal_start (c->s);
+			
 			if (native_utc)
 				c->in.i_mtime = cpu2le32 (*((long *) timeptr));
 			else
@@ -968,7 +1092,7 @@ e_datime (FILEPTR *f, ushort *timeptr, int flag)
 			c->in.i_ctime = cpu2le32 (CURRENT_TIME);
 			mark_inode_dirty (c);
 			
-			bio_SYNC_DRV ((&bio), c->s->di);
+			ext2_sync_drv (c->s);
 			break;
 		}
 		default:
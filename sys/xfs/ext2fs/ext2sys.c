@@ -36,9 +36,11 @@
 # include "mint/pathconf.h"
 # include "mint/stat.h"
 
+# include "bitmap.h"
 # include "ext2dev.h"
 # include "inode.h"
 # include "ialloc.h"
+# include "journal.h"
 # include "namei.h"
 # include "super.h"
 # include "truncate.h"
@@ -497,11 +499,13 @@ e_chattr (fcookie *fc, int attr)
 	return E_OK;
 
 write:
+	ext2_journal_start (c->s);
+
 	c->in.i_mode = cpu2le16 (mode);
 	c->in.i_ctime = cpu2le32 (CURRENT_TIME);
 	mark_inode_dirty (c);
 
-	bio_SYNC_DRV (&bio, c->s->di);
+	ext2_sync_drv (c->s);
 
 	DEBUG (("Ext2-FS [%c]: e_chattr: done (%x), return E_OK", fc->dev+'A', mode));
 	return E_OK;
@@ -520,6 +524,8 @@ e_chown (fcookie *fc, int uid, int gid)
 	if (IS_IMMUTABLE (c))
 		return EACCES;
 
+	ext2_journal_start (c->s);
+
 	if (uid != -1) c->in.i_uid = cpu2le16 (uid);
 	if (gid != -1) c->in.i_gid = cpu2le16 (gid);
 
@@ -527,7 +533,7 @@ e_chown (fcookie *fc, int uid, int gid)
 
 	mark_inode_dirty (c);
 
-	bio_SYNC_DRV (&bio, c->s->di);
+	ext2_sync_drv (c->s);
 	return E_OK;
 }
 
@@ -544,12 +550,14 @@ e_chmod (fcookie *fc, unsigned mode)
 	if (IS_IMMUTABLE (c))
 		return EACCES;
 
+	ext2_journal_start (c->s);
+
 	c->in.i_mode = cpu2le16 ((le2cpu16 (c->in.i_mode) & S_IFMT) | (mode & S_IALLUGO));
 	c->in.i_ctime = cpu2le32 (CURRENT_TIME);
 
 	mark_inode_dirty (c);
 
-	bio_SYNC_DRV (&bio, c->s->di);
+	ext2_sync_drv (c->s);
 	return E_OK;
 }
 
@@ -578,9 +586,14 @@ e_mkdir (fcookie *dir, const char *name, unsigned mode)
 	if (ext2_search_entry (dirc, name, namelen))
 		return EEXIST;
 
+	ext2_journal_start (s);
+
 	inode = ext2_new_inode (dirc, EXT2_IFDIR, &err);
 	if (!inode)
+	{
+		ext2_journal_stop (s);
 		return EIO;
+	}
 
 	inode->in.i_size = cpu2le32 (EXT2_BLOCK_SIZE (s));
 	inode->in.i_blocks = 0;
@@ -619,7 +632,7 @@ e_mkdir (fcookie *dir, const char *name, unsigned mode)
 			de2->file_type = EXT2_FT_DIR;
 		}
 
-		bio_MARK_MODIFIED (&bio, u);
+		ext2_mark_modified (s, u);
 	}
 
 	inode->in.i_links_count = cpu2le16 (2);
@@ -642,12 +655,11 @@ e_mkdir (fcookie *dir, const char *name, unsigned mode)
 		if (EXT2_HAS_INCOMPAT_FEATURE (s, EXT2_FEATURE_INCOMPAT_FILETYPE))
 			de->file_type = EXT2_FT_DIR;
 
-		bio_MARK_MODIFIED (&bio, u);
+		ext2_mark_modified (s, u);
 	}
 
 	dirc->in.i_version = cpu2le32 (++event);
 	dirc->in.i_links_count = cpu2le16 (le2cpu16 (dirc->in.i_links_count) + 1);
-	dirc->in.i_flags = cpu2le32 (le2cpu32 (dirc->in.i_flags) & ~EXT2_BTREE_FL);
 	mark_inode_dirty (dirc);
 
 	/* update directory cache */
@@ -665,7 +677,7 @@ out:
 	/* release the cookie */
 	rel_cookie (inode);
 
-	bio_SYNC_DRV (&bio, s->di);
+	ext2_sync_drv (s);
 
 	DEBUG (("Ext2-FS [%c]: e_mkdir: leave (%li)", dir->dev+'A', err));
 	return err;
@@ -768,6 +780,8 @@ e_rmdir (fcookie *dir, const char *name)
 	if (retval)
 		return retval;
 
+	ext2_journal_start (s);
+
 	if (IS_IMMUTABLE (inode))
 	{
 		retval = EACCES;
@@ -810,7 +824,7 @@ e_rmdir (fcookie *dir, const char *name)
 			goto out;
 		}
 
-		retval = ext2_delete_entry (de, u);
+		retval = ext2_delete_entry (dirc->s, de, u);
 		dirc->in.i_version = cpu2le32 (++event);
 
 		if (retval)
@@ -846,14 +860,13 @@ e_rmdir (fcookie *dir, const char *name)
 
 	dirc->in.i_links_count = cpu2le16 (le2cpu16 (dirc->in.i_links_count) - 1);
 	dirc->in.i_ctime = dirc->in.i_mtime = inode->in.i_ctime;
-	dirc->in.i_flags = cpu2le32 (le2cpu32 (dirc->in.i_flags) & ~EXT2_BTREE_FL);
 	mark_inode_dirty (dirc);
 
 out:
 	/* release the cookie */
 	rel_cookie (inode);
 
-	bio_SYNC_DRV (&bio, s->di);
+	ext2_sync_drv (s);
 
 	DEBUG (("Ext2-FS [%c]: e_rmdir: leave (%li)", dir->dev+'A', retval));
 	return retval;
@@ -880,9 +893,14 @@ e_creat (fcookie *dir, const char *name, unsigned mode, int attr, fcookie *fc)
 	if (ext2_search_entry (dirc, name, namelen))
 		return EEXIST;
 
+	ext2_journal_start (dirc->s);
+
 	inode = ext2_new_inode (dirc, mode, &err);
 	if (!inode)
+	{
+		ext2_journal_stop (dirc->s);
 		return err;
+	}
 
 	/* add name to directory */
 	{
@@ -898,6 +916,7 @@ e_creat (fcookie *dir, const char *name, unsigned mode, int attr, fcookie *fc)
 			/* release cookie (also delete the inode) */
 			rel_cookie (inode);
 
+			ext2_journal_stop (dirc->s);
 			return err;
 		}
 		de->inode = cpu2le32 (inode->inode);
@@ -905,7 +924,7 @@ e_creat (fcookie *dir, const char *name, unsigned mode, int attr, fcookie *fc)
 		if (EXT2_HAS_INCOMPAT_FEATURE (dirc->s, EXT2_FEATURE_INCOMPAT_FILETYPE))
 			de->file_type = EXT2_FT_REG_FILE;
 
-		bio_MARK_MODIFIED (&bio, u);
+		ext2_mark_modified (dirc->s, u);
 	}
 
 	dirc->in.i_version = cpu2le32 (++event);
@@ -917,7 +936,7 @@ e_creat (fcookie *dir, const char *name, unsigned mode, int attr, fcookie *fc)
 	*fc = *dir;
 	fc->index = (long) inode;
 
-	bio_SYNC_DRV (&bio, inode->s->di);
+	ext2_sync_drv (inode->s);
 
 	DEBUG (("Ext2-FS [%c]: e_creat leave OK (#%li, uid = %i, gid = %i)", dir->dev+'A', inode->inode, le2cpu16 (inode->in.i_uid), le2cpu16 (inode->in.i_gid)));
 	return E_OK;
@@ -954,6 +973,8 @@ e_remove (fcookie *dir, const char *name)
 	if (retval)
 		return retval;
 
+	ext2_journal_start (dirc->s);
+
 	if (EXT2_ISDIR (le2cpu16 (inode->in.i_mode))
 		|| IS_APPEND (inode)
 		|| IS_IMMUTABLE (inode))
@@ -986,7 +1007,7 @@ e_remove (fcookie *dir, const char *name)
 			goto out;
 		}
 
-		retval = ext2_delete_entry (de, u);
+		retval = ext2_delete_entry (dirc->s, de, u);
 		if (retval)
 		{
 			retval = EACCES;
@@ -999,7 +1020,6 @@ e_remove (fcookie *dir, const char *name)
 
 	dirc->in.i_version = cpu2le32 (++event);
 	dirc->in.i_ctime = dirc->in.i_mtime = cpu2le32 (CURRENT_TIME);
-	dirc->in.i_flags = cpu2le32 (le2cpu32 (dirc->in.i_flags) & ~EXT2_BTREE_FL);
 	mark_inode_dirty (dirc);
 
 	inode->in.i_links_count = cpu2le16 (le2cpu16 (inode->in.i_links_count) - 1);
@@ -1012,7 +1032,7 @@ out:
 	/* release cookie (also delete the inode if neccessary) */
 	rel_cookie (inode);
 
-	bio_SYNC_DRV (&bio, dirc->s->di);
+	ext2_sync_drv (dirc->s);
 
 	DEBUG (("Ext2-FS [%c]: e_remove: leave (%li)", dir->dev+'A', retval));
 	return retval;
@@ -1163,6 +1183,8 @@ e_rename (fcookie *olddir, char *oldname, fcookie *newdir, const char *newname)
 		return EACCES;
 	}
 
+	ext2_journal_start (s);
+
 	olddentry = ext2_search_entry (olddirc, oldname, strlen (oldname));
 	if (!olddentry)
 		goto end_rename;
@@ -1278,17 +1300,16 @@ e_rename (fcookie *olddir, char *oldname, fcookie *newdir, const char *newname)
 	if (EXT2_HAS_INCOMPAT_FEATURE (s, EXT2_FEATURE_INCOMPAT_FILETYPE))
 		new_de->file_type = old_de->file_type;
 
-	bio_MARK_MODIFIED (&bio, new_u);
+	ext2_mark_modified (s, new_u);
 	bio.unlock (new_u); new_u = NULL;
 
-	ext2_delete_entry (old_de, old_u);
+	ext2_delete_entry (s, old_de, old_u);
 	bio.unlock (old_u); old_u = NULL;
 
 	if (newdirc != olddirc)
 	{
 		newdirc->in.i_version = cpu2le32 (++event);
 		newdirc->in.i_ctime = newdirc->in.i_mtime = cpu2le32 (CURRENT_TIME);
-		newdirc->in.i_flags = cpu2le32 (le2cpu32 (newdirc->in.i_flags) & ~EXT2_BTREE_FL);
 
 		if (EXT2_ISDIR (le2cpu16 (inode->in.i_mode)))
 		{
@@ -1297,7 +1318,7 @@ e_rename (fcookie *olddir, char *oldname, fcookie *newdir, const char *newname)
 
 			PARENT_INO (dir_u->data) = cpu2le32 (newdirc->inode);
 
-			bio_MARK_MODIFIED (&bio, dir_u);
+			ext2_mark_modified (s, dir_u);
 			bio.unlock (dir_u); dir_u = NULL;
 		}
 
@@ -1306,7 +1327,6 @@ e_rename (fcookie *olddir, char *oldname, fcookie *newdir, const char *newname)
 
 	olddirc->in.i_version = cpu2le32 (++event);
 	olddirc->in.i_ctime = olddirc->in.i_mtime = cpu2le32 (CURRENT_TIME);
-	olddirc->in.i_flags = cpu2le32 (le2cpu32 (olddirc->in.i_flags) & ~EXT2_BTREE_FL);
 	mark_inode_dirty (olddirc);
 
 	/* update directory cache */
@@ -1323,6 +1343,8 @@ end_rename:
 	if (new_u) bio.unlock (new_u);
 	if (dir_u) bio.unlock (dir_u);
 
+	ext2_journal_stop (s);
+
 	DEBUG (("Ext2-FS [%c]: e_rename: leave r = %li", olddir->dev+'A', retval));
 	return retval;
 }
@@ -1613,10 +1635,12 @@ e_wlabel (fcookie *dir, const char *name)
 		}
 		else
 		{
+			ext2_journal_start (s);
+
 			strncpy (s->sbi.s_sb->s_volume_name, name, 16);
-			bio_MARK_MODIFIED (&bio, s->sbi.s_sb_unit);
+			ext2_mark_modified (s, s->sbi.s_sb_unit);
 
-			bio_SYNC_DRV (&bio, s->di);
+			ext2_sync_drv (s);
 		}
 	}
 
@@ -1680,9 +1704,14 @@ e_symlink (fcookie *dir, const char *name, const char *to)
 	if (tolen > EXT2_BLOCK_SIZE (dirc->s))
 		return EACCES;
 
+	ext2_journal_start (dirc->s);
+
 	inode = ext2_new_inode (dirc, EXT2_IFLNK, &err);
 	if (!inode)
+	{
+		ext2_journal_stop (dirc->s);
 		return err;
+	}
 
 	inode->in.i_mode = cpu2le16 (EXT2_IFLNK | S_IRWXUGO);
 
@@ -1716,7 +1745,7 @@ e_symlink (fcookie *dir, const char *name, const char *to)
 		inode->in.i_size = cpu2le32 (i);
 		mark_inode_dirty (inode);
 
-		if (u) bio_MARK_MODIFIED (&bio, u);
+		if (u) ext2_mark_modified (dirc->s, u);
 	}
 
 	/* add name to directory */
@@ -1738,7 +1767,7 @@ e_symlink (fcookie *dir, const char *name, const char *to)
 		dirc->in.i_version = cpu2le32 (++event);
 		mark_inode_dirty (dirc);
 
-		bio_MARK_MODIFIED (&bio, u);
+		ext2_mark_modified (dirc->s, u);
 	}
 
 	/* update directory cache */
@@ -1756,7 +1785,7 @@ out:
 	/* release the cookie */
 	rel_cookie (inode);
 
-	bio_SYNC_DRV (&bio, dirc->s->di);
+	ext2_sync_drv (dirc->s);
 
 	DEBUG (("Ext2-FS [%c]: e_symlink: leave (%li)", dir->dev+'A', err));
 	return err;
@@ -1838,6 +1867,8 @@ e_hardlink (fcookie *fromdir, const char *fromname, fcookie *todir, const char *
 	if (err)
 		return err;
 
+	ext2_journal_start (fromdirc->s);
+
 	i_mode = le2cpu16 (inode->in.i_mode);
 
 	if (EXT2_ISDIR (i_mode))
@@ -1895,7 +1926,7 @@ e_hardlink (fcookie *fromdir, const char *fromname, fcookie *todir, const char *
 				de->file_type = EXT2_FT_UNKNOWN;
 		}
 
-		bio_MARK_MODIFIED (&bio, u);
+		ext2_mark_modified (todirc->s, u);
 	}
 
 	todirc->in.i_version = cpu2le32 (++event);
@@ -1911,12 +1942,131 @@ out:
 	/* release cookie */
 	rel_cookie (inode);
 
-	bio_SYNC_DRV (&bio, fromdirc->s->di);
+	ext2_sync_drv (fromdirc->s);
 
 	DEBUG (("Ext2-FS [%c]: e_hardlink: leave (%li)", fromdir->dev+'A', err));
 	return err;
 }
 
+/* free space fragmentation from the block bitmaps */
+static long
+frag_free (SI *s, struct fs_frag *frag)
+{
+	ulong bpg = EXT2_BLOCKS_PER_GROUP (s);
+	ulong left = s->sbi.s_blocks_count - s->sbi.s_first_data_block;
+	long run = 0;
+	long g;
+
+	for (g = 0; g < s->sbi.s_groups_count; g++)
+	{
+		ulong n = MIN (bpg, left);
+		ulong i;
+		ext2_gd *gdp;
+		UNIT *u;
+
+		gdp = ext2_get_group_desc (s, g, NULL);
+		if (!gdp)
+			return EIO;
+
+		u = bio.read (s->di, le2cpu32 (gdp->bg_block_bitmap), EXT2_BLOCK_SIZE (s));
+		if (!u)
+			return EREAD;
+
+		for (i = 0; i < n; i++)
+		{
+			/* skip the whole byte if it can't change anything */
+			if (!(i & 7) && i + 8 <= n)
+			{
+				uchar b = u->data [i >> 3];
+
+				if (b == 0xff && !run)
+				{
+					i += 7;
+					continue;
+				}
+
+				if (b == 0)
+				{
+					if (!run)
+						frag->free_runs++;
+
+					run += 8;
+					frag->free_blocks += 8;
+					i += 7;
+					continue;
+				}
+			}
+
+			if (ext2_test_bit (i, u->data))
+			{
+				if (run > frag->free_max)
+					frag->free_max = run;
+
+				run = 0;
+			}
+			else
+			{
+				if (!run)
+					frag->free_runs++;
+
+				run++;
+				frag->free_blocks++;
+			}
+		}
+
+		left -= n;
+	}
+
+	if (run > frag->free_max)
+		frag->free_max = run;
+
+	return E_OK;
+}
+
+/* data block runs of a file */
+static long
+frag_file (COOKIE *c, struct fs_frag *frag)
+{
+	long nblocks;
+	long block;
+	long next = 0;
+
+	if (c->i_da_count)
+		ext2_da_flush (c);
+
+	nblocks = (le2cpu32 (c->in.i_size) + EXT2_BLOCK_SIZE (c->s) - 1) >> EXT2_BLOCK_SIZE_BITS (c->s);
+
+	frag->file_blocks = 0;
+	frag->file_runs = 0;
+
+	for (block = 0; block < nblocks; )
+	{
+		long len;
+		long tmp;
+
+		tmp = ext2_bmap_run (c, block, &len);
+		if (tmp < 0)
+			return tmp;
+
+		if (len > nblocks - block)
+			len = nblocks - block;
+
+		if (tmp)
+		{
+			/* runs end at the indirect blocks, join them again */
+			if (tmp != next)
+				frag->file_runs++;
+
+			frag->file_blocks += len;
+			next = tmp + len;
+		}
+
+		block += len;
+	}
+
+	return E_OK;
+}
+
 static long _cdecl
 e_fscntl (fcookie *dir, const char *name, int cmd, long arg)
 {
@@ -1962,6 +2112,66 @@ e_fscntl (fcookie *dir, const char *name, int cmd, long arg)
 
 			return E_OK;
 		}
+		case FS_FRAG:
+		{
+			struct fs_frag *frag = (struct fs_frag *) arg;
+			long r;
+
+			if (!frag)
+				return EINVAL;
+
+			frag->blocksize = EXT2_BLOCK_SIZE (s);
+			frag->free_blocks = 0;
+			frag->free_runs = 0;
+			frag->free_max = 0;
+			frag->file_blocks = -1;
+			frag->file_runs = -1;
+
+			r = frag_free (s, frag);
+			if (r)
+				return r;
+
+			if (name && *name)
+			{
+				fcookie fc;
+				COOKIE *c;
+
+				r = e_lookup (dir, name, &fc);
+				if (r)
+					return r;
+
+				c = (COOKIE *) fc.index;
+
+				if (EXT2_ISREG (le2cpu16 (c->in.i_mode)) || EXT2_ISDIR (le2cpu16 (c->in.i_mode)))
+					r = frag_file (c, frag);
+
+				e_release (&fc);
+			}
+
+			return r;
+		}
+		case EXT2_IOC_DELALLOC:
+		{
+			ulong opt = s->sbi.s_mount_opt;
+
+			if (arg < 0)
+				return test_opt (s, DELALLOC) ? 1 : 0;
+
+			if (arg)
+			{
+				set_opt (s->sbi.s_mount_opt, DELALLOC);
+			}
+			else
+			{
+				clear_opt (s->sbi.s_mount_opt, DELALLOC);
+
+				/* the buffered data goes out now */
+				if (opt & EXT2_MOUNT_DELALLOC)
+					sync_cookies ();
+			}
+
+			return E_OK;
+		}
 		case V_CNTR_WP:
 		{
 			long r;
@@ -1973,10 +2183,13 @@ e_fscntl (fcookie *dir, const char *name, int cmd, long arg)
 			r = EINVAL;
 			if (BIO_WP_CHECK (s->di) && !(s->s_flags & MS_RDONLY))
 			{
+				sync_cookies ();
+				ext2_journal_release (s);
+
 				if (!(s->s_flags & S_NOT_CLEAN_MOUNTED))
 				{
 					s->sbi.s_sb->s_state = cpu2le16 (le2cpu16 (s->sbi.s_sb->s_state) | EXT2_VALID_FS);
-					bio_MARK_MODIFIED (&bio, s->sbi.s_sb_unit);
+					ext2_mark_modified (s, s->sbi.s_sb_unit);
 				}
 
 				bio.sync_drv (s->di);
@@ -1988,12 +2201,17 @@ e_fscntl (fcookie *dir, const char *name, int cmd, long arg)
 			}
 			else if (s->s_flags & MS_RDONLY)
 			{
-				s->sbi.s_sb->s_state = cpu2le16 (le2cpu16 (s->sbi.s_sb->s_state) & ~EXT2_VALID_FS);
-				bio_MARK_MODIFIED (&bio, s->sbi.s_sb_unit);
+				s->s_flags &= ~MS_RDONLY;
+
+				ext2_journal_load (s);
+				if (!s->sbi.s_journal)
+				{
+					s->sbi.s_sb->s_state = cpu2le16 (le2cpu16 (s->sbi.s_sb->s_state) & ~EXT2_VALID_FS);
+					ext2_mark_modified (s, s->sbi.s_sb_unit);
+				}
 
 				bio.sync_drv (s->di);
 
-				s->s_flags &= ~MS_RDONLY;
 				ALERT (("Ext2-FS [%c]: remounted read/write!", dir->dev+'A'));
 
 				r = E_OK;
@@ -2039,6 +2257,8 @@ e_fscntl (fcookie *dir, const char *name, int cmd, long arg)
 				return EROFS;
 			}
 
+			ext2_journal_start (s);
+
 			c->in.i_ctime = cpu2le32 (CURRENT_TIME);
 
 			if (arg)
@@ -2067,7 +2287,7 @@ e_fscntl (fcookie *dir, const char *name, int cmd, long arg)
 			mark_inode_dirty (c);
 			e_release (&fc);
 
-			bio_SYNC_DRV ((&bio), s->di);
+			ext2_sync_drv (s);
 			return E_OK;
 		}
 		case FTRUNCATE:
@@ -2105,10 +2325,12 @@ e_fscntl (fcookie *dir, const char *name, int cmd, long arg)
 				return EACCES;
 			}
 
+			ext2_journal_start (s);
+
 			ext2_truncate (c, *(unsigned long *)arg);
 			e_release (&fc);
 
-			bio_SYNC_DRV ((&bio), s->di);
+			ext2_sync_drv (s);
 			return E_OK;
 		}
 # ifdef EXT2FS_DEBUG
@@ -2150,6 +2372,9 @@ e_dskchng (int drv, int mode)
 
 	DEBUG (("Ext2-FS [%c]: e_dskchng (mode = %i): invalidate drv (change = %li, memory = %li)", drv+'A', mode, change, memory));
 
+	/* the journal of the old medium is lost */
+	ext2_journal_drop (s);
+
 	/* free the DI (invalidate also the cache units) */
 	bio.free_di (s->di);
 
@@ -2159,6 +2384,9 @@ e_dskchng (int drv, int mode)
 	/* clear inode cache */
 	inv_ctable (drv);
 
+	/* clear file data cache */
+	pc_inval (s, PC_ALLFILES, 0, -1);
+
 	/* free allocated memory */
 	kfree (s->sbi.s_group_desc, s->sbi.s_group_desc_size);
 	kfree (s, sizeof (*s));
@@ -2193,11 +2421,10 @@ e_dupcookie (fcookie *dst, fcookie *src)
 static long _cdecl
 e_sync (void)
 {
-	/* sync the inode cache */
-	sync_cookies ();
-
-	/* buffer cache automatically synced */
-	return E_OK;
+	/* sync the inode cache, writing out the delayed blocks;
+	 * buffer cache automatically synced
+	 */
+	return sync_cookies ();
 }
 
 static long _cdecl
@@ -2283,7 +2510,7 @@ e_unmount (int drv)
 	if (!(s->s_flags & MS_RDONLY) && !(s->s_flags & S_NOT_CLEAN_MOUNTED))
 	{
 		s->sbi.s_sb->s_state = cpu2le16 (le2cpu16 (s->sbi.s_sb->s_state) | EXT2_VALID_FS);
-		bio_MARK_MODIFIED (&bio, s->sbi.s_sb_unit);
+		ext2_mark_modified (s, s->sbi.s_sb_unit);
 	}
 	else
 	{
@@ -2293,6 +2520,9 @@ e_unmount (int drv)
 	/* sync the inode cache */
 	sync_cookies ();
 
+	/* empty the log, the fs doesn't need recovery anymore */
+	ext2_journal_release (s);
+
 	/* sync the buffer cache */
 	bio.sync_drv (s->di);
 
@@ -2305,6 +2535,9 @@ e_unmount (int drv)
 	/* clear inode cache */
 	inv_ctable (drv);
 
+	/* clear file data cache */
+	pc_inval (s, PC_ALLFILES, 0, -1);
+
 	/* free allocated memory */
 	kfree (s->sbi.s_group_desc, s->sbi.s_group_desc_size);
 	kfree (s, sizeof (*s));
@@ -0,0 +1,195 @@
+/*
+ * Filename:     extents.c
+ * Project:      ext2 file system driver for MiNT
+ *
+ * Note:         Please send suggestions, patches or bug reports to
+ *               the MiNT mailing list <freemint-discuss@lists.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*
+ * ext4 extent trees, read side.
+ *
+ * Filesystems with extents are mounted read-only, so the tree is only
+ * ever searched here; blocks beyond 2^32 can't be addressed and are
+ * treated as errors.  A damaged tree is an error (EIO), never a hole.
+ */
+
+# include "extents.h"
+
+# include <mint/endian.h>
+
+
+# define EXT4_EXT_MAX_DEPTH	5
+
+
+INLINE long
+ext4_ext_check (SI *s, struct ext4_extent_header *eh, long depth, long size)
+{
+	long max = (size - sizeof (*eh)) / sizeof (struct ext4_extent);
+
+	if (le2cpu16 (eh->eh_magic) != EXT4_EXT_MAGIC
+	    || le2cpu16 (eh->eh_depth) != depth
+	    || le2cpu16 (eh->eh_max) > max
+	    || le2cpu16 (eh->eh_entries) > le2cpu16 (eh->eh_max))
+	{
+		ALERT (("Ext2-FS [%c]: bad extent header (depth %li)", s->dev+'A', depth));
+		return 0;
+	}
+
+	return 1;
+}
+
+/*
+ * ext4_ext_bmap: map logical block of an extent mapped inode
+ *
+ * Returns the device block, 0 for a hole (or an uninitialized extent,
+ * which reads as zeros) or a negative error code for a damaged tree.
+ * len is set to the number of blocks from block on that continue the
+ * run, for holes up to the next extent.
+ */
+long
+ext4_ext_bmap (COOKIE *inode, long block, long *len)
+{
+	SI *s = inode->s;
+	struct ext4_extent_header *eh = (struct ext4_extent_header *) inode->in.i_block;
+	long depth;
+	long size = sizeof (inode->in.i_block);
+	ulong next = 0xffffffffUL;	/* first block of the following extent */
+
+	*len = 1;
+
+	depth = le2cpu16 (eh->eh_depth);
+	if (depth > EXT4_EXT_MAX_DEPTH)
+	{
+		ALERT (("Ext2-FS [%c]: #%li: extent tree too deep (%li)", s->dev+'A', inode->inode, depth));
+		return EIO;
+	}
+	
+	if (!ext4_ext_check (s, eh, depth, size))
+		return EIO;
+
+	/* walk down the index levels */
+	while (depth > 0)
+	{
+		struct ext4_extent_idx *first = (struct ext4_extent_idx *) (eh + 1);
+		struct ext4_extent_idx *p = first + 1;
+		struct ext4_extent_idx *q = first + le2cpu16 (eh->eh_entries) - 1;
+		ulong leaf;
+		UNIT *u;
+
+		if (!eh->eh_entries)
+		{
+			ALERT (("Ext2-FS [%c]: #%li: empty extent index", s->dev+'A', inode->inode));
+			return EIO;
+		}
+
+		/* last index that starts at or before block */
+		while (p <= q)
+		{
+			struct ext4_extent_idx *m = p + (q - p) / 2;
+
+			if (le2cpu32 (m->ei_block) > (ulong) block)
+				q = m - 1;
+			else
+				p = m + 1;
+		}
+		p--;
+
+		if (p + 1 < first + le2cpu16 (eh->eh_entries))
+			next = le2cpu32 (p[1].ei_block);
+
+		leaf = le2cpu32 (p->ei_leaf_lo);
+		if (p->ei_leaf_hi || leaf < s->sbi.s_first_data_block || leaf >= s->sbi.s_blocks_count)
+		{
+			ALERT (("Ext2-FS [%c]: #%li: extent index out of range", s->dev+'A', inode->inode));
+			return EIO;
+		}
+
+		u = bio.read (s->di, leaf, EXT2_BLOCK_SIZE (s));
+		if (!u)
+			return EIO;
+
+		eh = (struct ext4_extent_header *) u->data;
+		size = EXT2_BLOCK_SIZE (s);
+
+		if (!ext4_ext_check (s, eh, --depth, size))
+			return EIO;
+	}
+
+	/* search the leaf */
+	{
+		struct ext4_extent *first = (struct ext4_extent *) (eh + 1);
+		struct ext4_extent *p = first;
+		struct ext4_extent *q = first + le2cpu16 (eh->eh_entries) - 1;
+		ulong start, elen;
+
+		if (!eh->eh_entries)
+			goto hole;
+
+		/* last extent that starts at or before block */
+		while (p <= q)
+		{
+			struct ext4_extent *m = p + (q - p) / 2;
+
+			if (le2cpu32 (m->ee_block) > (ulong) block)
+				q = m - 1;
+			else
+				p = m + 1;
+		}
+
+		/* p is the first extent after block */
+		if (p < first + le2cpu16 (eh->eh_entries))
+			next = le2cpu32 (p->ee_block);
+
+		if (p == first)
+			goto hole;
+		p--;
+
+		start = le2cpu32 (p->ee_block);
+		elen = le2cpu16 (p->ee_len);
+
+		if ((ulong) block - start >= (elen > EXT4_EXT_INIT_MAX_LEN ? elen - EXT4_EXT_INIT_MAX_LEN : elen))
+			goto hole;
+
+		if (elen > EXT4_EXT_INIT_MAX_LEN)
+		{
+			/* allocated but never written */
+			*len = elen - EXT4_EXT_INIT_MAX_LEN - (block - start);
+			return 0;
+		}
+
+		if (p->ee_start_hi)
+			goto range;
+
+		*len = elen - (block - start);
+		start = le2cpu32 (p->ee_start_lo) + (block - start);
+
+		if (start < s->sbi.s_first_data_block || start + *len > s->sbi.s_blocks_count)
+			goto range;
+
+		return start;
+	}
+
+hole:
+	if (next > (ulong) block && next != 0xffffffffUL)
+		*len = next - block;
+	return 0;
+
+range:
+	ALERT (("Ext2-FS [%c]: #%li: extent out of range", s->dev+'A', inode->inode));
+	return EIO;
+}
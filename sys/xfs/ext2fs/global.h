@@ -105,6 +105,14 @@ current_time (void)
 }
 # define CURRENT_TIME	current_time ()
 
+/* the file data page cache of the kernel is optional;
+ * files are keyed by super info and inode number
+ */
+# define PCACHE_OK	(KERNEL->pagecache != NULL)
+
+# define pc_inval(s, ino, pos, len) \
+	do { if (PCACHE_OK) pcache.invalidate (s, ino, pos, len); } while (0)
+
 
 typedef struct cookie	COOKIE;	/* */
 typedef struct si	SI;	/* */
@@ -137,6 +145,17 @@ struct cookie
 	ulong	i_next_alloc_goal;
 	ulong	i_prealloc_block;
 	ulong	i_prealloc_count;
+	
+	ulong	i_map_lblk;	/* last mapped run: logical block */
+	ulong	i_map_pblk;	/* device block */
+	ulong	i_map_len;	/* length in blocks, 0 if none */
+	
+	char	*i_da_buf;	/* delayed allocation: appended blocks (own alloc) */
+	ulong	i_da_lblk;	/* logical block of the first one */
+	ulong	i_da_count;	/* number of blocks, 0 if none */
+	long	i_da_err;	/* failed flush, not yet reported */
+	short	i_da_flushing;	/* allocating the reserved blocks */
+	short	i_da_pad;
 };
 
 INLINE void
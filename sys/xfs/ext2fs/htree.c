@@ -0,0 +1,365 @@
+/*
+ * Filename:     htree.c
+ * Project:      ext2 file system driver for MiNT
+ *
+ * Note:         Please send suggestions, patches or bug reports to
+ *               the MiNT mailing list <freemint-discuss@lists.sourceforge.net>
+ *
+ * Portions copyright 2002 Daniel Phillips and Theodore Ts'o
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*
+ * Hash-indexed directories (read side).
+ *
+ * The index is only walked here; the leaf blocks are ordinary
+ * directory blocks and are searched by namei.c. Anything that looks
+ * wrong makes the caller fall back to the linear scan, which always
+ * works because the index is invisible to the linear format.
+ */
+
+# include "htree.h"
+
+# include "inode.h"
+
+
+# define DX_MAX_LEVELS		3		/* root + 2 (largedir) */
+# define DX_BLOCK_MASK		0x0fffffffUL
+# define DX_HASH_EOF		0x7fffffffUL
+
+
+/*
+ * hash functions, identical to the ones of e2fsprogs
+ */
+
+INLINE __u32
+rol32 (__u32 x, short s)
+{
+	return (x << s) | (x >> (32 - s));
+}
+
+static __u32
+dx_hack_hash (const char *name, long len, long unsig)
+{
+	__u32 hash, hash0 = 0x12a3fe2dUL, hash1 = 0x37abe8f9UL;
+
+	while (len--)
+	{
+		long c = unsig ? (long)(uchar) *name : (long)(signed char) *name;
+
+		name++;
+
+		hash = hash1 + (hash0 ^ (__u32)(c * 7152373L));
+		if (hash & 0x80000000UL)
+			hash -= 0x7fffffffUL;
+
+		hash1 = hash0;
+		hash0 = hash;
+	}
+
+	return hash0 << 1;
+}
+
+static void
+str2hashbuf (const char *msg, long len, __u32 *buf, long num, long unsig)
+{
+	__u32 pad, val;
+	long i;
+
+	pad = (__u32) len | ((__u32) len << 8);
+	pad |= pad << 16;
+
+	val = pad;
+	if (len > num * 4)
+		len = num * 4;
+
+	for (i = 0; i < len; i++)
+	{
+		long c = unsig ? (long)(uchar) msg[i] : (long)(signed char) msg[i];
+
+		val = (__u32) c + (val << 8);
+		if ((i % 4) == 3)
+		{
+			*buf++ = val;
+			val = pad;
+			num--;
+		}
+	}
+
+	if (--num >= 0)
+		*buf++ = val;
+
+	while (--num >= 0)
+		*buf++ = pad;
+}
+
+# define F(x, y, z)	((z) ^ ((x) & ((y) ^ (z))))
+# define G(x, y, z)	(((x) & (y)) + (((x) ^ (y)) & (z)))
+# define H(x, y, z)	((x) ^ (y) ^ (z))
+
+# define MD4_ROUND(f, a, b, c, d, x, s)	(a += f (b, c, d) + x, a = rol32 (a, s))
+
+# define K1	0UL
+# define K2	013240474631UL
+# define K3	015666365641UL
+
+static void
+half_md4_transform (__u32 buf[4], const __u32 in[8])
+{
+	__u32 a = buf[0], b = buf[1], c = buf[2], d = buf[3];
+
+	/* round 1 */
+	MD4_ROUND (F, a, b, c, d, in[0] + K1,  3);
+	MD4_ROUND (F, d, a, b, c, in[1] + K1,  7);
+	MD4_ROUND (F, c, d, a, b, in[2] + K1, 11);
+	MD4_ROUND (F, b, c, d, a, in[3] + K1, 19);
+	MD4_ROUND (F, a, b, c, d, in[4] + K1,  3);
+	MD4_ROUND (F, d, a, b, c, in[5] + K1,  7);
+	MD4_ROUND (F, c, d, a, b, in[6] + K1, 11);
+	MD4_ROUND (F, b, c, d, a, in[7] + K1, 19);
+
+	/* round 2 */
+	MD4_ROUND (G, a, b, c, d, in[1] + K2,  3);
+	MD4_ROUND (G, d, a, b, c, in[3] + K2,  5);
+	MD4_ROUND (G, c, d, a, b, in[5] + K2,  9);
+	MD4_ROUND (G, b, c, d, a, in[7] + K2, 13);
+	MD4_ROUND (G, a, b, c, d, in[0] + K2,  3);
+	MD4_ROUND (G, d, a, b, c, in[2] + K2,  5);
+	MD4_ROUND (G, c, d, a, b, in[4] + K2,  9);
+	MD4_ROUND (G, b, c, d, a, in[6] + K2, 13);
+
+	/* round 3 */
+	MD4_ROUND (H, a, b, c, d, in[3] + K3,  3);
+	MD4_ROUND (H, d, a, b, c, in[7] + K3,  9);
+	MD4_ROUND (H, c, d, a, b, in[2] + K3, 11);
+	MD4_ROUND (H, b, c, d, a, in[6] + K3, 15);
+	MD4_ROUND (H, a, b, c, d, in[1] + K3,  3);
+	MD4_ROUND (H, d, a, b, c, in[5] + K3,  9);
+	MD4_ROUND (H, c, d, a, b, in[0] + K3, 11);
+	MD4_ROUND (H, b, c, d, a, in[4] + K3, 15);
+
+	buf[0] += a;
+	buf[1] += b;
+	buf[2] += c;
+	buf[3] += d;
+}
+
+static void
+tea_transform (__u32 buf[4], const __u32 in[4])
+{
+	__u32 sum = 0;
+	__u32 b0 = buf[0], b1 = buf[1];
+	__u32 a = in[0], b = in[1], c = in[2], d = in[3];
+	short n = 16;
+
+	do {
+		sum += 0x9e3779b9UL;
+		b0 += ((b1 << 4) + a) ^ (b1 + sum) ^ ((b1 >> 5) + b);
+		b1 += ((b0 << 4) + c) ^ (b0 + sum) ^ ((b0 >> 5) + d);
+	}
+	while (--n);
+
+	buf[0] += b0;
+	buf[1] += b1;
+}
+
+/*
+ * ext2_dx_hash: hash of a name for the given DX_HASH_* version;
+ * returns EINVAL for an unknown version
+ */
+long
+ext2_dx_hash (long version, const __u32 *seed, const char *name, long len, __u32 *hash)
+{
+	__u32 buf[4];
+	__u32 in[8];
+	__u32 h;
+	long unsig = 0;
+
+	buf[0] = 0x67452301UL;
+	buf[1] = 0xefcdab89UL;
+	buf[2] = 0x98badcfeUL;
+	buf[3] = 0x10325476UL;
+
+	if (seed && (seed[0] | seed[1] | seed[2] | seed[3]))
+		memcpy (buf, seed, sizeof (buf));
+
+	switch (version)
+	{
+		case DX_HASH_LEGACY_UNSIGNED:
+			unsig = 1;
+		case DX_HASH_LEGACY:
+			h = dx_hack_hash (name, len, unsig);
+			break;
+
+		case DX_HASH_HALF_MD4_UNSIGNED:
+			unsig = 1;
+		case DX_HASH_HALF_MD4:
+			while (len > 0)
+			{
+				str2hashbuf (name, len, in, 8, unsig);
+				half_md4_transform (buf, in);
+				len -= 32;
+				name += 32;
+			}
+			h = buf[1];
+			break;
+
+		case DX_HASH_TEA_UNSIGNED:
+			unsig = 1;
+		case DX_HASH_TEA:
+			while (len > 0)
+			{
+				str2hashbuf (name, len, in, 4, unsig);
+				tea_transform (buf, in);
+				len -= 16;
+				name += 16;
+			}
+			h = buf[0];
+			break;
+
+		default:
+			return EINVAL;
+	}
+
+	h &= ~1UL;
+	if (h == (DX_HASH_EOF << 1))
+		h = (DX_HASH_EOF - 1) << 1;
+
+	*hash = h;
+	return E_OK;
+}
+
+/*
+ * dx_search: binary search for the last index entry whose hash is not
+ * greater than hash; entries[0] holds count and limit instead of a hash
+ */
+INLINE struct dx_entry *
+dx_search (struct dx_entry *entries, long count, __u32 hash)
+{
+	struct dx_entry *p = entries + 1;
+	struct dx_entry *q = entries + count - 1;
+
+	while (p <= q)
+	{
+		struct dx_entry *m = p + (q - p) / 2;
+
+		if (le2cpu32 (m->hash) > hash)
+			q = m - 1;
+		else
+			p = m + 1;
+	}
+
+	return p - 1;
+}
+
+/*
+ * ext2_dx_probe: walk the index of dir down to the leaf block for name
+ *
+ * On success the logical leaf block is returned in block; cont is set
+ * if the entries with this hash may continue in the following leaf
+ * (hash collision at a split), in which case a miss in the leaf isn't
+ * final. Any inconsistency returns EINVAL and the caller falls back to
+ * the linear scan.
+ */
+long
+ext2_dx_probe (COOKIE *dir, const char *name, long namelen, long *block, short *cont)
+{
+	SI *s = dir->s;
+	ulong blocksize = EXT2_BLOCK_SIZE (s);
+	ulong nblocks = le2cpu32 (dir->in.i_size) >> EXT2_BLOCK_SIZE_BITS (s);
+	struct dx_root_info *info;
+	struct dx_countlimit *cl;
+	struct dx_entry *entries, *at;
+	long version, levels, level;
+	long count, limit;
+	long blk;
+	__u32 hash, next_hash = 0;
+	short have_next = 0;
+	UNIT *u;
+
+	u = ext2_read (dir, 0, NULL);
+	if (!u)
+		return EINVAL;
+
+	/* "." (12 bytes) and ".." (rest of the block) precede the root */
+	info = (struct dx_root_info *) (u->data + EXT2_DIR_REC_LEN (1) + EXT2_DIR_REC_LEN (2));
+
+	version = info->hash_version;
+	levels = info->indirect_levels;
+
+	if (version > DX_HASH_TEA
+	    || (info->unused_flags & 1)
+	    || info->info_length != sizeof (*info)
+	    || levels >= DX_MAX_LEVELS)
+	{
+		DEBUG (("Ext2-FS: ext2_dx_probe: bad root in #%li", dir->inode));
+		return EINVAL;
+	}
+
+	version += s->sbi.s_hash_unsigned;
+
+	if (ext2_dx_hash (version, s->sbi.s_hash_seed, name, namelen, &hash))
+		return EINVAL;
+
+	entries = (struct dx_entry *) ((char *) info + info->info_length);
+	limit = (blocksize - ((char *) entries - (char *) u->data)) / sizeof (*entries);
+
+	for (level = 0; ; level++)
+	{
+		cl = (struct dx_countlimit *) entries;
+		count = le2cpu16 (cl->count);
+
+		if (count == 0 || count > le2cpu16 (cl->limit) || le2cpu16 (cl->limit) > limit)
+		{
+			DEBUG (("Ext2-FS: ext2_dx_probe: bad count/limit in #%li", dir->inode));
+			return EINVAL;
+		}
+
+		at = dx_search (entries, count, hash);
+
+		/* lowest hash of the following subtree, the deepest
+		 * level that has one knows the leaf right after ours
+		 */
+		if (at + 1 < entries + count)
+		{
+			next_hash = le2cpu32 (at[1].hash);
+			have_next = 1;
+		}
+
+		blk = le2cpu32 (at->block) & DX_BLOCK_MASK;
+		if (blk == 0 || blk >= nblocks)
+			return EINVAL;
+
+		if (level == levels)
+			break;
+
+		u = ext2_read (dir, blk, NULL);
+		if (!u)
+			return EINVAL;
+
+		/* skip the empty entry that hides the node */
+		entries = (struct dx_entry *) (u->data + EXT2_DIR_REC_LEN (0));
+		limit = (blocksize - EXT2_DIR_REC_LEN (0)) / sizeof (*entries);
+	}
+
+	/* the next leaf continues this hash only if its index hash is
+	 * ours with the collision bit set
+	 */
+	*cont = have_next && ((next_hash & ~1UL) == hash);
+
+	*block = blk;
+	return E_OK;
+}
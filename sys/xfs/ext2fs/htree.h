@@ -0,0 +1,53 @@
+/*
+ * Filename:     htree.h
+ * Project:      ext2 file system driver for MiNT
+ *
+ * Note:         Please send suggestions, patches or bug reports to
+ *               the MiNT mailing list <freemint-discuss@lists.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+# ifndef _htree_h
+# define _htree_h
+
+# include "global.h"
+
+# include <mint/endian.h>
+
+
+/* use the hash index for this lookup?
+ * "." and ".." live in block 0 and are not indexed
+ */
+INLINE long
+ext2_dx_dir (COOKIE *dir, const char *name, long namelen)
+{
+	if (!EXT2_HAS_COMPAT_FEATURE (dir->s, EXT2_FEATURE_COMPAT_DIR_INDEX))
+		return 0;
+
+	if (!(le2cpu32 (dir->in.i_flags) & EXT2_INDEX_FL))
+		return 0;
+
+	if (name[0] == '.' && (namelen == 1 || (namelen == 2 && name[1] == '.')))
+		return 0;
+
+	return 1;
+}
+
+long	ext2_dx_hash	(long version, const __u32 *seed, const char *name, long len, __u32 *hash);
+long	ext2_dx_probe	(COOKIE *dir, const char *name, long namelen, long *block, short *cont);
+
+
+# endif /* _htree_h */
@@ -35,6 +35,7 @@
 
 # include "bitmap.h"
 # include "inode.h"
+# include "journal.h"
 # include "super.h"
 
 
@@ -97,6 +98,9 @@ ext2_free_inode (COOKIE *inode)
 		return;
 	}
 	
+	/* the inode number may come back with another file */
+	pc_inval (s, ino, 0, -1);
+	
 	block_group = (ino - 1) / EXT2_INODES_PER_GROUP (s);
 	bit = (ino - 1) % EXT2_INODES_PER_GROUP (s);
 	
@@ -114,7 +118,7 @@ ext2_free_inode (COOKIE *inode)
 	{
 		ext2_gd *gdp;
 		
-		bio_MARK_MODIFIED (&bio, u);
+		ext2_mark_modified (s, u);
 		
 		gdp = ext2_get_group_desc (s, block_group, &u);
 		if (gdp)
@@ -129,17 +133,18 @@ ext2_free_inode (COOKIE *inode)
 			}
 		}
 		
-		bio_MARK_MODIFIED (&bio, u);
+		ext2_mark_modified (s, u);
 		
 		s->sbi.s_sb->s_free_inodes_count =
 			cpu2le32 (le2cpu32 (s->sbi.s_sb->s_free_inodes_count) + 1);
 		
-		bio_MARK_MODIFIED (&bio, s->sbi.s_sb_unit);
+		ext2_mark_modified (s, s->sbi.s_sb_unit);
 		
 		s->sbi.s_dirty = 1;
 	}
 	
-	/* remove from inode cache */
+	/* remove from inode cache, the file is gone */
+	ext2_da_drop (inode);
 	del_cookie (inode);
 
 error_return:
@@ -157,11 +162,165 @@ inc_inode_version (COOKIE *inode, ext2_gd *gdp, long mode)
 	mark_inode_dirty (inode);
 }
 
+/* Orlov's allocator for directories.
+ *
+ * Top-level directories (children of the root or of a directory with
+ * EXT2_TOPDIR_FL) are spread out: starting at a pseudo-random group,
+ * the group with the fewest directories among those with at least
+ * average free inodes and free blocks is chosen.
+ *
+ * Other directories stay close to their parent, unless the parent's
+ * group is already crowded: a group qualifies if it has not too many
+ * directories, not too few free inodes and blocks, and its debt (the
+ * directories created there without files following them) is below
+ * the limit. If no group qualifies, the first one from the parent on
+ * with average free inodes is taken, then any with a free inode.
+ */
+
+# define INODE_COST	64
+# define BLOCK_COST	256
+
+static long
+find_group_orlov (SI *s, COOKIE *parent)
+{
+	static ulong seed = 0;
+	
+	long ngroups = s->sbi.s_groups_count;
+	long inodes_per_group = EXT2_INODES_PER_GROUP (s);
+	long blocks_per_group = EXT2_BLOCKS_PER_GROUP (s);
+	ulong freei = le2cpu32 (s->sbi.s_sb->s_free_inodes_count);
+	ulong freeb = le2cpu32 (s->sbi.s_sb->s_free_blocks_count);
+	long avefreei = freei / ngroups;
+	long avefreeb = freeb / ngroups;
+	long group = parent->i_block_group;
+	ulong ndirs = 0;
+	ext2_gd *desc;
+	long i;
+	
+	for (i = 0; i < ngroups; i++)
+	{
+		desc = ext2_get_group_desc (s, i, NULL);
+		if (desc)
+			ndirs += le2cpu16 (desc->bg_used_dirs_count);
+	}
+	
+	if (parent->inode == EXT2_ROOT_INO
+		|| (le2cpu32 (parent->in.i_flags) & EXT2_TOPDIR_FL))
+	{
+		long best_ndir = inodes_per_group;
+		long best_group = -1;
+		
+		seed = seed * 1103515245UL + 12345UL + CURRENT_TIME;
+		group = (seed >> 8) % ngroups;
+		
+		for (i = 0; i < ngroups; i++, group++)
+		{
+			if (group >= ngroups)
+				group = 0;
+			
+			desc = ext2_get_group_desc (s, group, NULL);
+			if (!desc || !desc->bg_free_inodes_count)
+				continue;
+			
+			if (le2cpu16 (desc->bg_used_dirs_count) >= best_ndir)
+				continue;
+			
+			if (le2cpu16 (desc->bg_free_inodes_count) < avefreei)
+				continue;
+			
+			if (le2cpu16 (desc->bg_free_blocks_count) < avefreeb)
+				continue;
+			
+			best_group = group;
+			best_ndir = le2cpu16 (desc->bg_used_dirs_count);
+		}
+		
+		if (best_group >= 0)
+			return best_group;
+		
+		goto fallback;
+	}
+	else
+	{
+		ulong blocks_per_dir;
+		long max_dirs, min_inodes, min_blocks, max_debt;
+		
+		blocks_per_dir = ndirs ? (s->sbi.s_blocks_count - freeb) / ndirs : 0;
+		
+		max_dirs = ndirs / ngroups + inodes_per_group / 16;
+		
+		min_inodes = avefreei - inodes_per_group / 4;
+		if (min_inodes < 1)
+			min_inodes = 1;
+		
+		min_blocks = avefreeb - blocks_per_group / 4;
+		if (min_blocks < 1)
+			min_blocks = 1;
+		
+		max_debt = blocks_per_group / MAX (blocks_per_dir, BLOCK_COST);
+		if (max_debt * INODE_COST > inodes_per_group)
+			max_debt = inodes_per_group / INODE_COST;
+		if (max_debt > 255)
+			max_debt = 255;
+		if (max_debt == 0)
+			max_debt = 1;
+		
+		for (i = 0; i < ngroups; i++, group++)
+		{
+			if (group >= ngroups)
+				group = 0;
+			
+			desc = ext2_get_group_desc (s, group, NULL);
+			if (!desc || !desc->bg_free_inodes_count)
+				continue;
+			
+			if (s->sbi.s_debts [group] >= max_debt)
+				continue;
+			
+			if (le2cpu16 (desc->bg_used_dirs_count) >= max_dirs)
+				continue;
+			
+			if (le2cpu16 (desc->bg_free_inodes_count) < min_inodes)
+				continue;
+			
+			if (le2cpu16 (desc->bg_free_blocks_count) < min_blocks)
+				continue;
+			
+			return group;
+		}
+	}
+	
+fallback:
+	for (;;)
+	{
+		group = parent->i_block_group;
+		
+		for (i = 0; i < ngroups; i++, group++)
+		{
+			if (group >= ngroups)
+				group = 0;
+			
+			desc = ext2_get_group_desc (s, group, NULL);
+			if (desc
+				&& desc->bg_free_inodes_count
+				&& le2cpu16 (desc->bg_free_inodes_count) >= avefreei)
+			{
+				return group;
+			}
+		}
+		
+		/* may happen if the free inodes are all in one group */
+		if (!avefreei)
+			break;
+		
+		avefreei = 0;
+	}
+	
+	return -1;
+}
+
 /* There are two policies for allocating an inode.  If the new inode is
- * a directory, then a forward search is made for a block group with both
- * free space and a low directory-to-inode ratio; if that fails, then of
- * the groups with above-average free space, that group with the fewest
- * directories already is chosen.
+ * a directory, find_group_orlov () picks the block group.
  *
  * For other inodes, search forward from the parent directory's block
  * group to find a free inode.
@@ -180,7 +339,6 @@ ext2_new_inode (COOKIE *dir, long mode, long *err)
 	
 	long i;
 	long j;
-	long avefreei;
 	
 	
 	/* Cannot create files in a deleted directory
@@ -209,24 +367,9 @@ repeat:
 	*err = ENOSPC;
 	if (EXT2_ISDIR (mode))
 	{
-		avefreei = le2cpu32 (s->sbi.s_sb->s_free_inodes_count) / s->sbi.s_groups_count;
-		if (!gdp)
-		{
-			for (j = 0; j < s->sbi.s_groups_count; j++)
-			{
-				tmp = ext2_get_group_desc (s, j, &u2);
-				if (tmp
-					&& le2cpu16 (tmp->bg_free_inodes_count)
-					&& le2cpu16 (tmp->bg_free_inodes_count) >= avefreei)
-				{
-					if (!gdp || (le2cpu16 (tmp->bg_free_blocks_count) > le2cpu16 (gdp->bg_free_blocks_count)))
-					{
-						i = j;
-						gdp = tmp;
-					}
-				}
-			}
-		}
+		i = find_group_orlov (s, dir);
+		if (i >= 0)
+			gdp = ext2_get_group_desc (s, i, &u2);
 	}
 	else 
 	{
@@ -299,7 +442,7 @@ repeat:
 			goto repeat;
 		}
 		
-		bio_MARK_MODIFIED (&bio, u);
+		ext2_mark_modified (s, u);
 	}
 	else
 	{
@@ -328,15 +471,22 @@ repeat:
 		cpu2le16 (le2cpu16 (gdp->bg_free_inodes_count) - 1);
 	
 	if (EXT2_ISDIR (mode))
+	{
 		gdp->bg_used_dirs_count =
 			cpu2le16 (le2cpu16 (gdp->bg_used_dirs_count) + 1);
+		
+		if (s->sbi.s_debts [i] < 255)
+			s->sbi.s_debts [i]++;
+	}
+	else if (s->sbi.s_debts [i])
+		s->sbi.s_debts [i]--;
 	
-	bio_MARK_MODIFIED (&bio, u2);
+	ext2_mark_modified (s, u2);
 	
 	s->sbi.s_sb->s_free_inodes_count =
 		cpu2le32 (le2cpu32 (s->sbi.s_sb->s_free_inodes_count) - 1);
 	
-	bio_MARK_MODIFIED (&bio, s->sbi.s_sb_unit);
+	ext2_mark_modified (s, s->sbi.s_sb_unit);
 	
 	s->sbi.s_dirty = 1;
 	
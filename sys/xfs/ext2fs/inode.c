@@ -31,7 +31,9 @@
 # include <mint/endian.h>
 
 # include "balloc.h"
+# include "extents.h"
 # include "ialloc.h"
+# include "journal.h"
 # include "super.h"
 # include "truncate.h"
 
@@ -132,6 +134,9 @@ get_new_cookie (void)
 			{
 				register long r;
 			
+				if (c->i_da_count)
+					ext2_da_flush (c);
+				
 				r = SYNC_COOKIE (c);
 				if (r)
 				{
@@ -173,6 +178,13 @@ new_cookie (const ulong inode)
 void
 del_cookie (COOKIE *c)
 {
+	/* callers throwing the data away drop it before */
+	if (c->inode && c->i_da_count)
+	{
+		ext2_da_flush (c);
+		SYNC_COOKIE (c);
+	}
+	
 	if (c->inode)
 	{
 		if (c->dirty)
@@ -181,6 +193,9 @@ del_cookie (COOKIE *c)
 		cookie_remove (c);
 	}
 	
+	if (c->i_da_buf)
+		ext2_da_drop (c);
+	
 	if (c->open)
 	{
 		DEBUG (("Ext2-FS [%c]: open FILEPTR detect in: del_cookie #%li", c->dev+'A', c->inode));
@@ -212,6 +227,14 @@ inv_ctable (ushort drv)
 		{
 			if (c->dev == drv && c->inode)
 			{
+				/* not for the new medium */
+				if (c->i_da_count)
+				{
+					ALERT (("Ext2-FS [%c]: medium changed, %li unwritten blocks of #%li lost",
+						drv+'A', c->i_da_count, c->inode));
+					ext2_da_drop (c);
+				}
+				
 				del_cookie (c);
 			}
 		}
@@ -395,7 +418,7 @@ put_cookie (COOKIE *c)
 		*((ext2_in *) (u->data + offset)) = c->in;
 		
 		/* and write back */
-		bio_MARK_MODIFIED (&bio, u);
+		ext2_mark_modified (s, u);
 		
 		DEBUG (("Ext2-FS: put_inode leave ok"));
 		return E_OK;
@@ -428,9 +451,10 @@ rel_cookie (COOKIE *c)
 	}
 }
 
-void
+long
 sync_cookies (void)
 {
+	long ret = E_OK;
 	long i;
 	
 	for (i = 0; i < COOKIE_SIZE; i++)
@@ -441,11 +465,24 @@ sync_cookies (void)
 		{
 			register long r;
 			
+			if (c->i_da_count)
+			{
+				r = ext2_da_flush (c);
+				if (r && !ret)
+					ret = r;
+			}
+			
 			r = SYNC_COOKIE (c);
 			if (r)
+			{
 				ALERT (("Ext2-FS: failed to update inode #%li (r = %li)", c->inode, r));
+				if (!ret)
+					ret = r;
+			}
 		}
 	}
+	
+	return ret;
 }
 
 # ifdef EXT2FS_DEBUG
@@ -557,6 +594,8 @@ ext2_delete_inode (COOKIE *inode)
 		return;
 	}
 	
+	ext2_journal_start (inode->s);
+	
 	inode->in.i_dtime = cpu2le32 (CURRENT_TIME);
 	mark_inode_dirty (inode);
 	
@@ -564,11 +603,27 @@ ext2_delete_inode (COOKIE *inode)
 		ext2_truncate (inode, 0);
 	
 	ext2_free_inode (inode);
+	
+	ext2_journal_stop (inode->s);
 }
 
 
+/* count the blocks following table[nr] that are contiguous on disk,
+ * up to the end of the table
+ */
+INLINE long
+bmap_run (const __u32 *table, long nr, long n, long tmp)
+{
+	long len = 1;
+	
+	while (++nr < n && le2cpu32 (table[nr]) == tmp + len)
+		len++;
+	
+	return len;
+}
+
 static long
-inode_bmap (COOKIE *inode, long nr)
+inode_bmap (COOKIE *inode, long nr, long *len)
 {
 	register long tmp;
 	
@@ -586,13 +641,16 @@ inode_bmap (COOKIE *inode, long nr)
 			ALERT (("Ext2-FS: inode_bmap: tmp (%li), illegal value", tmp));
 			return 0;
 		}
+		
+		if (len)
+			*len = bmap_run (inode->in.i_block, nr, EXT2_NDIR_BLOCKS, tmp);
 	}
 	
 	return tmp;
 }
 
 static long
-block_bmap (COOKIE *inode, long block, long nr)
+block_bmap (COOKIE *inode, long block, long nr, long *len)
 {
 	register long blocksize = EXT2_BLOCK_SIZE (inode->s);
 	register long tmp;
@@ -624,26 +682,21 @@ block_bmap (COOKIE *inode, long block, long nr)
 			ALERT (("Ext2-FS: block_bmap: tmp (%li), illegal value", tmp));
 			return 0;
 		}
+		
+		if (len)
+			*len = bmap_run ((__u32 *) u->data, nr, blocksize >> 2, tmp);
 	}
 	
 	return tmp;
 }
 
-long
-ext2_bmap (COOKIE *inode, long block)
+static long
+ext2_ind_bmap (COOKIE *inode, long block, long *len)
 {
 	long addr_per_block = EXT2_ADDR_PER_BLOCK (inode->s);
 	long addr_per_block_bits = EXT2_ADDR_PER_BLOCK_BITS (inode->s);
 	long i;
 	
-	DEBUG (("Ext2-FS: ext2_bmap enter (%li)", block));
-	
-	if (block < 0)
-	{
-		ALERT (("Ext2-FS: ext2_bmap: block < 0"));
-		return 0;
-	}
-	
 	if (block >= EXT2_NDIR_BLOCKS + addr_per_block +
 		(1UL << (addr_per_block_bits << 1)) +
 		((1UL << (addr_per_block_bits << 1)) << addr_per_block_bits))
@@ -661,15 +714,15 @@ ext2_bmap (COOKIE *inode, long block)
 	/* direct blocks */
 	
 	if (block < EXT2_NDIR_BLOCKS)
-		return inode_bmap (inode, block);
+		return inode_bmap (inode, block, len);
 	
 	/* indirect blocks */
 	
 	block -= EXT2_NDIR_BLOCKS;
 	if (block < addr_per_block)
 	{
-		i = inode_bmap (inode, EXT2_IND_BLOCK);
-		return block_bmap (inode, i, block);
+		i = inode_bmap (inode, EXT2_IND_BLOCK, NULL);
+		return block_bmap (inode, i, block, len);
 	}
 	
 	/* double indirect blocks */
@@ -677,18 +730,73 @@ ext2_bmap (COOKIE *inode, long block)
 	block -= addr_per_block;
 	if (block < (1UL << (addr_per_block_bits << 1)))
 	{
-		i = inode_bmap (inode, EXT2_DIND_BLOCK);
-		i = block_bmap (inode, i, block >> addr_per_block_bits);
-		return block_bmap (inode, i, block & (addr_per_block - 1));
+		i = inode_bmap (inode, EXT2_DIND_BLOCK, NULL);
+		i = block_bmap (inode, i, block >> addr_per_block_bits, NULL);
+		return block_bmap (inode, i, block & (addr_per_block - 1), len);
 	}
 	
 	/* triple indirect blocks */
 	
 	block -= (1UL << (addr_per_block_bits << 1));
-	i = inode_bmap (inode, EXT2_TIND_BLOCK);
-	i = block_bmap (inode, i, block >> (addr_per_block_bits << 1));
-	i = block_bmap (inode, i, (block >> addr_per_block_bits) & (addr_per_block - 1));
-	return block_bmap (inode, i, block & (addr_per_block - 1));
+	i = inode_bmap (inode, EXT2_TIND_BLOCK, NULL);
+	i = block_bmap (inode, i, block >> (addr_per_block_bits << 1), NULL);
+	i = block_bmap (inode, i, (block >> addr_per_block_bits) & (addr_per_block - 1), NULL);
+	return block_bmap (inode, i, block & (addr_per_block - 1), len);
+}
+
+/*
+ * ext2_bmap_run: map the logical block of inode to the device
+ *
+ * Returns the device block (0 for a hole, < 0 for a damaged extent
+ * tree) and in len the number of blocks from there on that continue
+ * contiguously on the device (or stay a hole). The last mapped run is
+ * remembered in the cookie, so sequential access resolves each run
+ * only once.
+ */
+long
+ext2_bmap_run (COOKIE *inode, long block, long *len)
+{
+	long tmp;
+	
+	DEBUG (("Ext2-FS: ext2_bmap enter (%li)", block));
+	
+	if (block < 0)
+	{
+		ALERT (("Ext2-FS: ext2_bmap: block < 0"));
+		return 0;
+	}
+	
+	if ((ulong) block - inode->i_map_lblk < inode->i_map_len)
+	{
+		tmp = block - inode->i_map_lblk;
+		
+		*len = inode->i_map_len - tmp;
+		return inode->i_map_pblk + tmp;
+	}
+	
+	*len = 1;
+	
+	if (le2cpu32 (inode->in.i_flags) & EXT4_EXTENTS_FL)
+		tmp = ext4_ext_bmap (inode, block, len);
+	else
+		tmp = ext2_ind_bmap (inode, block, len);
+	
+	if (tmp > 0)
+	{
+		inode->i_map_lblk = block;
+		inode->i_map_pblk = tmp;
+		inode->i_map_len = *len;
+	}
+	
+	return tmp;
+}
+
+long
+ext2_bmap (COOKIE *inode, long block)
+{
+	long len;
+	
+	return ext2_bmap_run (inode, block, &len);
 }
 
 UNIT *
@@ -698,7 +806,7 @@ ext2_read (COOKIE *inode, long block, long *err)
 	UNIT *u = NULL;
 	
 	tmp = ext2_bmap (inode, block);
-	if (tmp)
+	if (tmp > 0)
 	{
 		u = bio.read (inode->s->di, tmp, EXT2_BLOCK_SIZE (inode->s));
 		if (!u && err)
@@ -706,7 +814,7 @@ ext2_read (COOKIE *inode, long block, long *err)
 	}
 	else if (err)
 	{
-		*err = E_OK;
+		*err = tmp;
 	}
 	
 	return u;
@@ -871,7 +979,10 @@ inode_getblk (COOKIE *inode, long nr, long new_block, long *err, ushort clear_fl
 		if (u)
 		{
 			bzero (u->data, EXT2_BLOCK_SIZE (inode->s));
-			bio_MARK_MODIFIED (&bio, u);
+			if (EXT2_ISREG (le2cpu16 (inode->in.i_mode)))
+				ext2_mark_data (inode->s, u);
+			else
+				ext2_mark_modified (inode->s, u);
 		}
 		else
 		{
@@ -978,7 +1089,7 @@ block_getblk (COOKIE *inode, long block, long nr, long new_block, long *err, ush
 	}
 	
 	((long *) u->data)[nr] = cpu2le32 (tmp);
-	bio_MARK_MODIFIED (&bio, u);
+	ext2_mark_modified (inode->s, u);
 	
 	inode->i_next_alloc_block = new_block;
 	inode->i_next_alloc_goal = tmp;
@@ -992,7 +1103,10 @@ block_getblk (COOKIE *inode, long block, long nr, long new_block, long *err, ush
 		if (u)
 		{
 			bzero (u->data, EXT2_BLOCK_SIZE (inode->s));
-			bio_MARK_MODIFIED (&bio, u);
+			if (EXT2_ISREG (le2cpu16 (inode->in.i_mode)))
+				ext2_mark_data (inode->s, u);
+			else
+				ext2_mark_modified (inode->s, u);
 		}
 		else
 		{
@@ -1023,6 +1137,14 @@ ext2_getblk (COOKIE *inode, long block, long *err, ushort clear_flag)
 		return 0;
 	}
 	
+	/* i_block holds an extent tree, not block pointers */
+	if (le2cpu32 (inode->in.i_flags) & EXT4_EXTENTS_FL)
+	{
+		ALERT (("Ext2-FS: ext2_getblk: #%li is extent mapped", inode->inode));
+		*err = EROFS;
+		return 0;
+	}
+	
 	if (block > EXT2_NDIR_BLOCKS + addr_per_block +
 		(1UL << (addr_per_block_bits << 1)) +
 		((1UL << (addr_per_block_bits << 1)) << addr_per_block_bits))
@@ -1133,3 +1255,204 @@ ext2_bread (COOKIE *inode, long block, long *err)
 	DEBUG (("ext2_bread: leave (%li, %li -> %lx)", nr, EXT2_BLOCK_SIZE (inode->s), u));
 	return u;
 }
+
+
+/*
+ * delayed allocation
+ *
+ * Full blocks appended to a regular file are collected in a buffer of
+ * the cookie instead of being mapped one at a time by e_write. They get
+ * their disk blocks all at once when the buffer is written out (full,
+ * on a write elsewhere in the file, on read, truncate, close and sync),
+ * so a file written in small pieces or next to other growing files
+ * still ends up in long contiguous runs.
+ *
+ * The blocks are reserved against the free blocks count of the
+ * superblock when they are buffered and ext2_new_block keeps them for
+ * the flush; if the filesystem gets too full the data is written
+ * through as before.
+ *
+ * If the flush fails anyway (I/O error) the file is cut back to the
+ * data that made it to the disk, and the error is kept in i_da_err
+ * until the next write, close or sync can report it.
+ */
+
+long
+ext2_da_write (COOKIE *inode, long block, const char *buf, long blocks)
+{
+	SI *s = inode->s;
+	long bits = EXT2_BLOCK_SIZE_BITS (s);
+	long max = EXT2_DA_SIZE >> bits;
+	ulong need;
+	long n;
+	
+	if (!test_opt (s, DELALLOC)
+		|| (inode->i_flags & MS_SYNCHRONOUS)
+		|| !EXT2_ISREG (le2cpu16 (inode->in.i_mode))
+		|| max == 0)
+	{
+		return 0;
+	}
+	
+	if (inode->i_da_count
+		&& (block != inode->i_da_lblk + inode->i_da_count || inode->i_da_count == max))
+	{
+		if (ext2_da_flush (inode))
+			return 0;
+	}
+	
+	if (!inode->i_da_count)
+	{
+		ulong size = le2cpu32 (inode->in.i_size);
+		
+		/* only blocks past the end of the file are unmapped for sure */
+		if ((ulong) block < ((size + EXT2_BLOCK_SIZE (s) - 1) >> bits)
+			|| ext2_bmap (inode, block))
+		{
+			return 0;
+		}
+		
+		if (!inode->i_da_buf)
+		{
+			inode->i_da_buf = kmalloc (EXT2_DA_SIZE);
+			if (!inode->i_da_buf)
+				return 0;
+		}
+		
+		inode->i_da_lblk = block;
+	}
+	
+	n = MIN (blocks, max - (long) inode->i_da_count);
+	
+	/* room for the data, the indirect blocks and the reserved blocks */
+	need = s->sbi.s_da_reserved + n;
+	need += need / EXT2_ADDR_PER_BLOCK (s) + 3 + s->sbi.s_r_blocks_count;
+	if (le2cpu32 (s->sbi.s_sb->s_free_blocks_count) < need)
+	{
+		if (inode->i_da_count)
+			ext2_da_flush (inode);
+		
+		return 0;
+	}
+	
+	memcpy (inode->i_da_buf + (inode->i_da_count << bits), buf, n << bits);
+	
+	inode->i_da_count += n;
+	s->sbi.s_da_reserved += n;
+	
+	return n;
+}
+
+long
+ext2_da_flush (COOKIE *inode)
+{
+	SI *s = inode->s;
+	long bits = EXT2_BLOCK_SIZE_BITS (s);
+	long n = inode->i_da_count;
+	long i = 0;
+	long err = E_OK;
+	
+	DEBUG (("ext2_da_flush: #%li, %li blocks at %li", inode->inode, n, inode->i_da_lblk));
+	
+	ext2_journal_start (s);
+	inode->i_da_flushing = 1;
+	
+	while (i < n)
+	{
+		ulong first;
+		long run = 1;
+		
+		first = ext2_getblk (inode, inode->i_da_lblk + i, &err, 0);
+		if (!first)
+			break;
+		
+		/* the blocks were allocated in a row, write them in one go */
+		while (i + run < n)
+		{
+			ulong next = ext2_getblk (inode, inode->i_da_lblk + i + run, &err, 0);
+			
+			if (next != first + run)
+				break;
+			
+			run++;
+		}
+		
+		err = bio.l_write (s->di, first, run, EXT2_BLOCK_SIZE (s), inode->i_da_buf + (i << bits));
+		if (err)
+			break;
+		
+		if (s->sbi.s_journal)
+			ext2_journal_data (s, first, run);
+		
+		i += run;
+	}
+	
+	inode->i_da_flushing = 0;
+	s->sbi.s_da_reserved -= n;
+	inode->i_da_count = 0;
+	
+	if (i < n)
+	{
+		ulong end = (inode->i_da_lblk + i) << bits;
+		
+		ALERT (("Ext2-FS [%c]: ext2_da_flush: can't write %li blocks of #%li (err = %li)",
+			s->dev+'A', n - i, inode->inode, err));
+		
+		/* no hole of never written blocks at the end of the file */
+		if (le2cpu32 (inode->in.i_size) > end)
+		{
+			ext2_truncate (inode, end);
+			if (inode->i_size > end)
+				inode->i_size = end;
+		}
+		
+		if (!err)
+			err = EIO;
+		
+		if (!inode->i_da_err)
+			inode->i_da_err = err;
+	}
+	else
+		err = E_OK;
+	
+	ext2_journal_stop (s);
+	return err;
+}
+
+/* return and clear the error of an earlier flush */
+long
+ext2_da_error (COOKIE *inode)
+{
+	long err = inode->i_da_err;
+	
+	inode->i_da_err = E_OK;
+	return err;
+}
+
+/* write out and free the buffer, return the first error not yet reported */
+long
+ext2_da_release (COOKIE *inode)
+{
+	if (inode->i_da_count)
+		ext2_da_flush (inode);
+	
+	ext2_da_drop (inode);
+	
+	return ext2_da_error (inode);
+}
+
+/* forget the buffered data, only for data that is gone anyway
+ * (truncated, deleted file, medium changed)
+ */
+void
+ext2_da_drop (COOKIE *inode)
+{
+	inode->s->sbi.s_da_reserved -= inode->i_da_count;
+	inode->i_da_count = 0;
+	
+	if (inode->i_da_buf)
+	{
+		kfree (inode->i_da_buf, EXT2_DA_SIZE);
+		inode->i_da_buf = NULL;
+	}
+}
@@ -55,7 +55,7 @@ SYNC_COOKIE (COOKIE *c)
 	return r;
 }
 
-void	sync_cookies		(void);
+long	sync_cookies		(void);
 
 INLINE void
 mark_inode_dirty (COOKIE *c)
@@ -63,6 +63,13 @@ mark_inode_dirty (COOKIE *c)
 	c->dirty = 1;
 }
 
+/* forget the cached block mapping (blocks were freed) */
+INLINE void
+ext2_bmap_inval (COOKIE *c)
+{
+	c->i_map_len = 0;
+}
+
 # ifdef EXT2FS_DEBUG
 void	dump_inode_cache	(char *buf, long bufsize);
 # endif
@@ -73,6 +80,7 @@ void	dump_inode_cache	(char *buf, long bufsize);
 
 void	ext2_delete_inode	(COOKIE *inode);
 
+long	ext2_bmap_run		(COOKIE *inode, long block, long *len);
 long	ext2_bmap		(COOKIE *inode, long block);
 UNIT *	ext2_read		(COOKIE *inode, long block, long *err);
 
@@ -80,5 +88,14 @@ void	ext2_discard_prealloc	(COOKIE *inode);
 long	ext2_getblk		(COOKIE *inode, long block, long *err, ushort clear_flag);
 UNIT *	ext2_bread		(COOKIE *inode, long block, long *err);
 
+/* delayed allocation buffer per file */
+# define EXT2_DA_SIZE		(64 * 1024L)
+
+long	ext2_da_write		(COOKIE *inode, long block, const char *buf, long blocks);
+long	ext2_da_flush		(COOKIE *inode);
+long	ext2_da_error		(COOKIE *inode);
+long	ext2_da_release		(COOKIE *inode);
+void	ext2_da_drop		(COOKIE *inode);
+
 
 # endif /* _inode_h */
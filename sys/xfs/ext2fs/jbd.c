@@ -0,0 +1,318 @@
+/*
+ * Filename:     jbd.c
+ * Project:      ext2 file system driver for MiNT
+ *
+ * Note:         Please send suggestions, patches or bug reports to
+ *               the MiNT mailing list <freemint-discuss@lists.sourceforge.net>
+ *
+ * Portions copyright 1998-2000 Stephen C. Tweedie
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*
+ * Journal replay, the usual three passes: find the last committed
+ * transaction, collect the revoke records, copy the logged blocks home.
+ * All I/O goes through the callbacks in struct jbd_replay.
+ */
+
+# include "jbd.h"
+
+
+struct jrevoke
+{
+	struct jrevoke *next;
+	__u32	block;
+	__u32	tid;
+};
+
+# define REVOKE_HASH	64
+
+enum { PASS_SCAN, PASS_REVOKE, PASS_REPLAY };
+
+/* tid a is after b, sequence numbers wrap */
+# define TID_GT(a, b)	((__s32) ((a) - (b)) > 0)
+
+static long
+revoke_set (struct jrevoke **table, __u32 block, __u32 tid)
+{
+	struct jrevoke **p = &table [block & (REVOKE_HASH - 1)];
+	struct jrevoke *r;
+
+	for (r = *p; r; r = r->next)
+	{
+		if (r->block == block)
+		{
+			if (TID_GT (tid, r->tid))
+				r->tid = tid;
+
+			return E_OK;
+		}
+	}
+
+	r = kmalloc (sizeof (*r));
+	if (!r)
+		return ENOMEM;
+
+	r->block = block;
+	r->tid = tid;
+	r->next = *p;
+	*p = r;
+
+	return E_OK;
+}
+
+INLINE long
+revoked (struct jrevoke **table, __u32 block, __u32 tid)
+{
+	struct jrevoke *r;
+
+	for (r = table [block & (REVOKE_HASH - 1)]; r; r = r->next)
+		if (r->block == block)
+			return !TID_GT (tid, r->tid);
+
+	return 0;
+}
+
+static void
+revoke_free (struct jrevoke **table)
+{
+	long i;
+
+	for (i = 0; i < REVOKE_HASH; i++)
+	{
+		while (table [i])
+		{
+			struct jrevoke *r = table [i];
+
+			table [i] = r->next;
+			kfree (r, sizeof (*r));
+		}
+	}
+}
+
+INLINE __u32
+log_next (struct jbd_replay *j, __u32 log)
+{
+	if (++log >= j->maxlen)
+		log = j->first;
+
+	return log;
+}
+
+static long
+jbd_pass (struct jbd_replay *j, long pass, struct jrevoke **table)
+{
+	struct jbd_sb *jsb = (struct jbd_sb *) j->sb;
+	__u32 incompat = be2cpu32 (jsb->s_feature_incompat);
+	long tag_bytes = 8;
+	long tail = 0;
+	__u32 log = be2cpu32 (jsb->s_start);
+	__u32 tid = be2cpu32 (jsb->s_sequence);
+	long r;
+
+	if (be2cpu32 (jsb->s_header.h_blocktype) == JBD_SUPERBLOCK_V1)
+		incompat = 0;
+
+	if (incompat & JBD_FEATURE_INCOMPAT_CSUM_V3)
+		tag_bytes = 16;
+	else
+	{
+		if (incompat & JBD_FEATURE_INCOMPAT_64BIT)
+			tag_bytes += 4;
+		if (incompat & JBD_FEATURE_INCOMPAT_CSUM_V2)
+			tag_bytes += 2;
+	}
+
+	if (incompat & (JBD_FEATURE_INCOMPAT_CSUM_V2 | JBD_FEATURE_INCOMPAT_CSUM_V3))
+		tail = 4;
+
+	for (;;)
+	{
+		struct jbd_header *h = (struct jbd_header *) j->buf;
+
+		if (pass != PASS_SCAN && !TID_GT (j->end_tid, tid))
+			break;
+
+		r = (*j->read)(j, log, j->buf);
+		if (r)
+			return r;
+
+		if (be2cpu32 (h->h_magic) != JBD_MAGIC || be2cpu32 (h->h_sequence) != tid)
+			break;
+
+		log = log_next (j, log);
+
+		switch (be2cpu32 (h->h_blocktype))
+		{
+			case JBD_DESCRIPTOR_BLOCK:
+			{
+				char *tag = j->buf + sizeof (*h);
+				char *end = j->buf + j->bsize - tail;
+
+				while (tag + tag_bytes <= end)
+				{
+					__u32 block = be2cpu32 (((struct jbd_tag *) tag)->t_blocknr);
+					__u32 flags = be2cpu32 (((struct jbd_tag *) tag)->t_flags) & 0xffff;
+
+					if (tag_bytes > 8 && (incompat & JBD_FEATURE_INCOMPAT_64BIT)
+						&& ((__u32 *) tag) [2])
+					{
+						/* can't be one of ours */
+						block = 0;
+					}
+
+					if (pass == PASS_REPLAY && block && !revoked (table, block, tid))
+					{
+						r = (*j->read)(j, log, j->data);
+						if (r)
+							return r;
+
+						if (flags & JBD_FLAG_ESCAPE)
+							*(__u32 *) j->data = cpu2be32 (JBD_MAGIC);
+
+						r = (*j->write)(j, block, j->data);
+						if (r)
+							return r;
+
+						j->replayed++;
+					}
+
+					log = log_next (j, log);
+
+					tag += tag_bytes;
+					if (!(flags & JBD_FLAG_SAME_UUID))
+						tag += 16;
+
+					if (flags & JBD_FLAG_LAST_TAG)
+						break;
+				}
+
+				continue;
+			}
+			case JBD_COMMIT_BLOCK:
+			{
+				tid++;
+				continue;
+			}
+			case JBD_REVOKE_BLOCK:
+			{
+				if (pass == PASS_REVOKE)
+				{
+					struct jbd_revoke_header *rh = (struct jbd_revoke_header *) j->buf;
+					long size = (incompat & JBD_FEATURE_INCOMPAT_64BIT) ? 8 : 4;
+					long off = sizeof (*rh);
+					long max = be2cpu32 (rh->r_count);
+
+					if (max > j->bsize - tail)
+						max = j->bsize - tail;
+
+					for (; off + size <= max; off += size)
+					{
+						__u32 *rec = (__u32 *) (j->buf + off);
+
+						/* high word of a 64bit record */
+						if (size == 8 && rec [0])
+							continue;
+
+						r = revoke_set (table, be2cpu32 (rec [size == 8 ? 1 : 0]), tid);
+						if (r)
+							return r;
+					}
+				}
+
+				continue;
+			}
+		}
+
+		/* unknown block type: end of the log */
+		break;
+	}
+
+	if (pass == PASS_SCAN)
+		j->end_tid = tid;
+
+	return E_OK;
+}
+
+/*
+ * jbd_recover: replay the log described by the journal superblock;
+ * on return end_tid is the sequence number the next transaction gets
+ */
+long
+jbd_recover (struct jbd_replay *j)
+{
+	struct jbd_sb *jsb = (struct jbd_sb *) j->sb;
+	struct jrevoke *table [REVOKE_HASH];
+	long r;
+
+	j->end_tid = be2cpu32 (jsb->s_sequence);
+	j->replayed = 0;
+
+	if (!jsb->s_start)
+		return E_OK;
+
+	bzero (table, sizeof (table));
+
+	r = jbd_pass (j, PASS_SCAN, table);
+	if (!r)
+		r = jbd_pass (j, PASS_REVOKE, table);
+	if (!r)
+		r = jbd_pass (j, PASS_REPLAY, table);
+
+	revoke_free (table);
+	return r;
+}
+
+
+/*
+ * checksums
+ */
+
+/* CRC32c (Castagnoli), bitwise; only used for the superblock */
+__u32
+jbd_crc32c (__u32 crc, const void *buf, long len)
+{
+	const __u8 *p = buf;
+
+	while (len--)
+	{
+		long i;
+
+		crc ^= *p++;
+		for (i = 0; i < 8; i++)
+			crc = (crc >> 1) ^ (0x82f63b78UL & -(crc & 1));
+	}
+
+	return crc;
+}
+
+/* update the checksum of a journal superblock before it's written */
+void
+jbd_sb_csum (char *sb)
+{
+	struct jbd_sb *jsb = (struct jbd_sb *) sb;
+	__u32 *csum = (__u32 *) (sb + JBD_SB_CHECKSUM);
+
+	if (be2cpu32 (jsb->s_header.h_blocktype) != JBD_SUPERBLOCK_V2
+		|| !(be2cpu32 (jsb->s_feature_incompat)
+		     & (JBD_FEATURE_INCOMPAT_CSUM_V2 | JBD_FEATURE_INCOMPAT_CSUM_V3)))
+	{
+		return;
+	}
+
+	*csum = 0;
+	*csum = cpu2be32 (jbd_crc32c (0xffffffffUL, sb, 1024));
+}
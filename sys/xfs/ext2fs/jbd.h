@@ -0,0 +1,189 @@
+/*
+ * Filename:     jbd.h
+ * Project:      ext2 file system driver for MiNT
+ *
+ * Note:         Please send suggestions, patches or bug reports to
+ *               the MiNT mailing list <freemint-discuss@lists.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*
+ * ext3 journal (JBD) on-disk format and replay.
+ *
+ * jbd.c doesn't depend on the rest of the driver, with JBD_HOST
+ * defined it's also compiled into tools/jbdcheck, which checks the
+ * replay against journals written by Linux and e2fsprogs.
+ */
+
+# ifndef _jbd_h
+# define _jbd_h
+
+# ifdef JBD_HOST
+
+# include <stdlib.h>
+# include <string.h>
+# include <stdint.h>
+# include <arpa/inet.h>
+
+typedef uint8_t		__u8;
+typedef uint32_t	__u32;
+typedef int32_t		__s32;
+
+# define INLINE		static inline
+# define E_OK		0
+# define ENOMEM		-39
+# define EBADARG	-64
+
+# define be2cpu32(x)	ntohl (x)
+# define cpu2be32(x)	htonl (x)
+# define kmalloc(n)	malloc (n)
+# define kfree(p, n)	free (p)
+# define bzero(p, n)	memset ((p), 0, (n))
+
+# else
+
+# include "global.h"
+# include <mint/endian.h>
+
+# endif
+
+
+/*
+ * on-disk format, big endian
+ */
+
+# define JBD_MAGIC			0xc03b3998UL
+
+# define JBD_DESCRIPTOR_BLOCK		1
+# define JBD_COMMIT_BLOCK		2
+# define JBD_SUPERBLOCK_V1		3
+# define JBD_SUPERBLOCK_V2		4
+# define JBD_REVOKE_BLOCK		5
+
+# define JBD_FLAG_ESCAPE		1	/* on-disk block is escaped */
+# define JBD_FLAG_SAME_UUID		2	/* block has same uuid as previous */
+# define JBD_FLAG_DELETED		4	/* block deleted by this transaction */
+# define JBD_FLAG_LAST_TAG		8	/* last tag in this descriptor block */
+
+# define JBD_FEATURE_COMPAT_CHECKSUM		0x00000001
+
+# define JBD_FEATURE_INCOMPAT_REVOKE		0x00000001
+# define JBD_FEATURE_INCOMPAT_64BIT		0x00000002
+# define JBD_FEATURE_INCOMPAT_ASYNC_COMMIT	0x00000004
+# define JBD_FEATURE_INCOMPAT_CSUM_V2		0x00000008
+# define JBD_FEATURE_INCOMPAT_CSUM_V3		0x00000010
+
+/* understood on replay */
+# define JBD_INCOMPAT_REPLAY	( JBD_FEATURE_INCOMPAT_REVOKE		\
+				| JBD_FEATURE_INCOMPAT_64BIT		\
+				| JBD_FEATURE_INCOMPAT_ASYNC_COMMIT	\
+				| JBD_FEATURE_INCOMPAT_CSUM_V2		\
+				| JBD_FEATURE_INCOMPAT_CSUM_V3		)
+
+/* what we write ourself */
+# define JBD_INCOMPAT_WRITE	( JBD_FEATURE_INCOMPAT_REVOKE		\
+				| JBD_FEATURE_INCOMPAT_ASYNC_COMMIT	)
+
+struct jbd_header
+{
+	__u32	h_magic;
+	__u32	h_blocktype;
+	__u32	h_sequence;
+};
+
+struct jbd_sb
+{
+	struct jbd_header s_header;
+
+	/* static information describing the journal */
+	__u32	s_blocksize;		/* journal device blocksize */
+	__u32	s_maxlen;		/* total blocks in journal file */
+	__u32	s_first;		/* first block of log information */
+
+	/* dynamic information describing the current state of the log */
+	__u32	s_sequence;		/* first commit ID expected in log */
+	__u32	s_start;		/* blocknr of start of log, 0 if clean */
+	__s32	s_errno;		/* error value, as set by journal_abort() */
+
+	/* remaining fields are only valid in a version-2 superblock */
+	__u32	s_feature_compat;	/* compatible feature set */
+	__u32	s_feature_incompat;	/* incompatible feature set */
+	__u32	s_feature_ro_compat;	/* readonly-compatible feature set */
+	__u8	s_uuid[16];		/* 128-bit uuid for journal */
+	__u32	s_nr_users;		/* nr of filesystems sharing log */
+};
+
+/* classic tag, the 64BIT and CSUM features make it longer;
+ * the flags are always the low word of the second long
+ */
+struct jbd_tag
+{
+	__u32	t_blocknr;		/* the on-disk block number */
+	__u32	t_flags;		/* see above */
+};
+
+struct jbd_revoke_header
+{
+	struct jbd_header r_header;
+	__u32	r_count;		/* count of bytes used in the block */
+};
+
+struct jbd_commit
+{
+	struct jbd_header h;
+	__u8	h_chksum_type;
+	__u8	h_chksum_size;
+	__u8	h_padding[2];
+	__u32	h_chksum[8];
+	__u32	h_commit_sec_hi;	/* 64bit seconds */
+	__u32	h_commit_sec;
+	__u32	h_commit_nsec;
+};
+
+
+/*
+ * replay
+ */
+
+struct jbd_replay
+{
+	char	*sb;			/* journal superblock */
+	char	*buf;			/* one block each */
+	char	*data;
+	long	bsize;
+	__u32	first;			/* first log block */
+	__u32	maxlen;			/* end of the log */
+
+	/* read a log block, put a replayed block home */
+	long	(*read)(struct jbd_replay *r, __u32 log, char *buf);
+	long	(*write)(struct jbd_replay *r, __u32 block, char *data);
+	void	*arg;
+
+	/* results */
+	__u32	end_tid;		/* first transaction not committed */
+	long	replayed;		/* blocks put home */
+};
+
+long	jbd_recover	(struct jbd_replay *r);
+
+/* checksummed journal superblock (CSUM_V2/V3) */
+# define JBD_SB_CHECKSUM	0xfc	/* offset of s_checksum */
+
+__u32	jbd_crc32c	(__u32 crc, const void *buf, long len);
+void	jbd_sb_csum	(char *sb);
+
+
+# endif /* _jbd_h */
@@ -0,0 +1,1225 @@
+/*
+ * Filename:     journal.c
+ * Project:      ext2 file system driver for MiNT
+ *
+ * Note:         Please send suggestions, patches or bug reports to
+ *               the MiNT mailing list <freemint-discuss@lists.sourceforge.net>
+ *
+ * Portions copyright 1998-2000 Stephen C. Tweedie
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*
+ * ext3 journal (JBD format, internal journal inode only).
+ *
+ * On mount a journal left behind by an unclean shutdown is replayed
+ * (jbd.c).
+ *
+ * While mounted read/write the driver logs metadata in ordered mode:
+ *
+ * - every modifying operation is bracketed by ext2_journal_start() and
+ *   ext2_journal_stop() (usually through ext2_sync_drv()); handles nest,
+ *   a transaction is only committed while no handle is open, so it
+ *   always holds complete operations
+ *
+ * - metadata blocks are registered in the running transaction by
+ *   ext2_mark_modified(), blocks of file data by ext2_mark_data() and
+ *   ext2_journal_data()
+ *
+ * - the rwabs vector of the device is overloaded; before block_IO
+ *   writes a block of the running transaction home, the transaction is
+ *   committed: the file data of the transaction still in the cache goes
+ *   out, then the descriptor blocks with the copies of the metadata,
+ *   revoke records and finally the commit block; while a handle is
+ *   open the block is held back in memory instead (pinned) and goes
+ *   home after the commit
+ *
+ * - when the last handle is closed a large transaction is committed,
+ *   and if the log is getting full, everything is written home and the
+ *   log starts over (checkpoint); the first handle of a transaction
+ *   makes sure there is room for a complete operation
+ *
+ * The log is never wrapped, it's emptied before it runs full. Only an
+ * operation that doesn't fit into a transaction at all, or a block that
+ * can't be pinned for lack of memory, splits an operation over two
+ * transactions; that is reported, and as the fs isn't marked valid
+ * while mounted, e2fsck checks it after a crash.
+ */
+
+# include "journal.h"
+
+# include <mint/endian.h>
+
+# include "inode.h"
+# include "jbd.h"
+
+
+/*
+ * in-core journal
+ */
+
+# define JBD_MAX_TRANS		512		/* metadata blocks per transaction */
+# define JBD_ORDERED		32		/* ordered data extents */
+# define JBD_STAGE_SIZE		(16 * 1024L)	/* log write buffer */
+# define JBD_FREE		0xffffffffUL	/* empty hash slot */
+
+struct jrun
+{
+	ulong	lblk;			/* log block */
+	ulong	pblk;			/* device block */
+	ulong	len;
+};
+
+struct jextent
+{
+	ulong	start;
+	ulong	count;
+};
+
+/* a block of the running transaction block_IO wanted to write home
+ * while an operation was in progress, the data follows
+ */
+struct jpin
+{
+	struct jpin *next;
+	ulong	block;
+};
+
+struct ext2_journal
+{
+	struct ext2_journal *next;	/* all journals with an overloaded DI */
+
+	SI	*s;
+	DI	*di;
+	long	_cdecl (*rwabs)(DI *di, ushort rw, void *buf, ulong size, ulong lrecno);
+
+	ulong	bsize;
+	ulong	bits;
+	ulong	first;			/* first log block */
+	ulong	maxlen;			/* end of the log */
+	ulong	head;			/* next free log block */
+	ulong	start;			/* start of the log on disk, 0 if empty */
+	ulong	tid;			/* sequence of the running transaction */
+	ulong	start_tid;		/* sequence of the first transaction in the log */
+	long	tag_space;		/* tags per descriptor */
+	long	revoke_space;		/* records per revoke block */
+
+	struct jrun *runs;		/* log to device mapping */
+	long	nruns;
+
+	/* the running transaction */
+	ulong	*blocks;
+	long	nblocks;
+	long	max_blocks;
+	ulong	*hash;			/* blocks, open addressing */
+	long	hash_mask;
+	ulong	*revoke;
+	long	nrevoke;
+	long	max_revoke;
+	struct jpin *pinned;		/* held back from block_IO */
+	struct jextent ordered [JBD_ORDERED];
+	long	nordered;
+
+	/* blocks logged since the log was emptied,
+	 * freeing them needs a revoke record
+	 */
+	ulong	*logged;
+	long	nlogged;
+	long	max_logged;
+	long	logged_mask;
+
+	char	*buf;			/* one block */
+	char	*sb;			/* journal superblock, one block */
+	char	*stage;			/* log writes */
+	long	stage_max;
+	long	nstage;
+	ulong	stage_log;
+
+	short	committing;
+	short	handles;		/* open operations */
+
+	long	memsize;
+};
+
+static struct ext2_journal *journals;
+
+
+INLINE long
+hash_find (ulong *table, long mask, ulong block)
+{
+	long i = (block ^ (block >> 9)) & mask;
+
+	while (table [i] != JBD_FREE)
+	{
+		if (table [i] == block)
+			return 1;
+
+		i = (i + 1) & mask;
+	}
+
+	return 0;
+}
+
+/* returns 1 if the block is new */
+INLINE long
+hash_insert (ulong *table, long mask, ulong block)
+{
+	long i = (block ^ (block >> 9)) & mask;
+
+	while (table [i] != JBD_FREE)
+	{
+		if (table [i] == block)
+			return 0;
+
+		i = (i + 1) & mask;
+	}
+
+	table [i] = block;
+	return 1;
+}
+
+INLINE void
+hash_clear (ulong *table, long mask)
+{
+	long i;
+
+	for (i = 0; i <= mask; i++)
+		table [i] = JBD_FREE;
+}
+
+
+/*
+ * log I/O, always direct to the device
+ */
+
+static long
+journal_io (struct ext2_journal *j, ushort rw, ulong log, char *buf, ulong n)
+{
+	long i = 0;
+
+	while (n)
+	{
+		ulong len;
+		long r;
+
+		while (i < j->nruns && log >= j->runs [i].lblk + j->runs [i].len)
+			i++;
+
+		if (i == j->nruns || log < j->runs [i].lblk)
+			return EBADARG;
+
+		len = j->runs [i].lblk + j->runs [i].len - log;
+		if (len > n)
+			len = n;
+
+		r = (*j->rwabs)(j->di, rw, buf, len << j->bits, j->runs [i].pblk + (log - j->runs [i].lblk));
+		if (r)
+			return r;
+
+		log += len;
+		buf += len << j->bits;
+		n -= len;
+	}
+
+	return E_OK;
+}
+
+static long
+stage_flush (struct ext2_journal *j)
+{
+	long r = E_OK;
+
+	if (j->nstage)
+	{
+		r = journal_io (j, 1, j->stage_log, j->stage, j->nstage);
+
+		j->stage_log += j->nstage;
+		j->nstage = 0;
+	}
+
+	return r;
+}
+
+/* next log block, returns the buffer to fill */
+static char *
+stage_get (struct ext2_journal *j, long *r)
+{
+	if (j->nstage == j->stage_max)
+		*r |= stage_flush (j);
+
+	return j->stage + (j->nstage++ << j->bits);
+}
+
+static long
+journal_write_sb (struct ext2_journal *j)
+{
+	struct jbd_sb *jsb = (struct jbd_sb *) j->sb;
+
+	jsb->s_start = cpu2be32 (j->start);
+	jsb->s_sequence = cpu2be32 (j->start ? j->start_tid : j->tid);
+	jbd_sb_csum (j->sb);
+
+	return journal_io (j, 1, 0, j->sb, 1);
+}
+
+
+/*
+ * commit
+ */
+
+/* log blocks needed to commit a transaction of this size */
+INLINE ulong
+trans_space (struct ext2_journal *j, long nblocks, long nrevoke)
+{
+	return nblocks
+		+ (nblocks + j->tag_space - 1) / j->tag_space
+		+ (nrevoke + j->revoke_space - 1) / j->revoke_space
+		+ 1;
+}
+
+/* ordered mode: file data before the metadata referencing it */
+static void
+journal_write_ordered (struct ext2_journal *j)
+{
+	long i;
+
+	for (i = 0; i < j->nordered; i++)
+	{
+		ulong block = j->ordered [i].start;
+		ulong end = block + j->ordered [i].count;
+
+		for (; block < end; block++)
+		{
+			UNIT *u = bio.lookup (j->di, block, j->bsize);
+
+			/* not cached or clean: on disk already */
+			if (u && (u->dirty & 1))
+				(*j->rwabs)(j->di, 1, u->data, j->bsize, block);
+		}
+	}
+
+	j->nordered = 0;
+}
+
+static struct jpin *
+pin_find (struct ext2_journal *j, ulong block)
+{
+	struct jpin *p;
+
+	for (p = j->pinned; p; p = p->next)
+		if (p->block == block)
+			break;
+
+	return p;
+}
+
+static void
+pin_drop (struct ext2_journal *j, ulong block)
+{
+	struct jpin **pp;
+
+	for (pp = &j->pinned; *pp; pp = &(*pp)->next)
+	{
+		struct jpin *p = *pp;
+
+		if (p->block == block)
+		{
+			*pp = p->next;
+			kfree (p, sizeof (*p) + j->bsize);
+			break;
+		}
+	}
+}
+
+/* after the commit: the pinned blocks may go home now */
+static long
+pin_flush (struct ext2_journal *j)
+{
+	long r = E_OK;
+
+	while (j->pinned)
+	{
+		struct jpin *p = j->pinned;
+
+		r |= (*j->rwabs)(j->di, 1, p + 1, j->bsize, p->block);
+
+		j->pinned = p->next;
+		kfree (p, sizeof (*p) + j->bsize);
+	}
+
+	return r;
+}
+
+/* the current contents of a metadata block */
+static void
+journal_copy (struct ext2_journal *j, ulong block, char *dst)
+{
+	UNIT *u = bio.lookup (j->di, block, j->bsize);
+	struct jpin *p;
+
+	if (u)
+		memcpy (dst, u->data, j->bsize);
+	else if ((p = pin_find (j, block)))
+		memcpy (dst, p + 1, j->bsize);
+	else
+		(*j->rwabs)(j->di, 0, dst, j->bsize, block);
+}
+
+static long
+journal_commit (struct ext2_journal *j)
+{
+	struct jbd_header *h;
+	long first_desc = 1;
+	long was_empty;
+	long r = E_OK;
+	long i, n;
+
+	if (!j->nblocks && !j->nrevoke)
+	{
+		j->nordered = 0;
+		return E_OK;
+	}
+
+	DEBUG (("Ext2-FS [%c]: journal_commit: tid %lu, %li blocks, %li revoked",
+		j->s->dev+'A', j->tid, j->nblocks, j->nrevoke));
+
+	j->committing = 1;
+
+	journal_write_ordered (j);
+
+	was_empty = !j->start;
+	if (was_empty)
+	{
+		j->start = j->head;
+		j->start_tid = j->tid;
+	}
+
+	j->stage_log = j->head;
+	j->nstage = 0;
+
+	/* descriptors, each followed by the blocks it describes; the
+	 * descriptor is filled in j->buf while its blocks are staged
+	 * and goes to its reserved log block once complete
+	 */
+	for (i = 0; i < j->nblocks; i += n)
+	{
+		ulong desc_log;
+		char *tag;
+		long k;
+
+		r |= stage_flush (j);
+		desc_log = j->stage_log++;
+
+		n = MIN (j->tag_space, j->nblocks - i);
+
+		h = (struct jbd_header *) j->buf;
+		h->h_magic = cpu2be32 (JBD_MAGIC);
+		h->h_blocktype = cpu2be32 (JBD_DESCRIPTOR_BLOCK);
+		h->h_sequence = cpu2be32 (j->tid);
+
+		tag = j->buf + sizeof (*h);
+		bzero (tag, j->bsize - sizeof (*h));
+
+		for (k = 0; k < n; k++)
+		{
+			struct jbd_tag *t = (struct jbd_tag *) tag;
+			char *copy = stage_get (j, &r);
+			ulong flags = 0;
+
+			journal_copy (j, j->blocks [i + k], copy);
+
+			/* a copy must not look like a journal block */
+			if (*(__u32 *) copy == cpu2be32 (JBD_MAGIC))
+			{
+				*(__u32 *) copy = 0;
+				flags |= JBD_FLAG_ESCAPE;
+			}
+
+			if (!first_desc || k)
+				flags |= JBD_FLAG_SAME_UUID;
+
+			if (k == n - 1)
+				flags |= JBD_FLAG_LAST_TAG;
+
+			t->t_blocknr = cpu2be32 (j->blocks [i + k]);
+			t->t_flags = cpu2be32 (flags);
+
+			tag += sizeof (*t);
+			if (!(flags & JBD_FLAG_SAME_UUID))
+			{
+				memcpy (tag, ((struct jbd_sb *) j->sb)->s_uuid, 16);
+				tag += 16;
+			}
+
+			j->nlogged += hash_insert (j->logged, j->logged_mask, j->blocks [i + k]);
+		}
+
+		r |= journal_io (j, 1, desc_log, j->buf, 1);
+		first_desc = 0;
+	}
+
+	/* revoke records */
+	for (i = 0; i < j->nrevoke; i += n)
+	{
+		struct jbd_revoke_header *rh = (struct jbd_revoke_header *) stage_get (j, &r);
+		__u32 *rec = (__u32 *) (rh + 1);
+		long k;
+
+		n = MIN (j->revoke_space, j->nrevoke - i);
+
+		rh->r_header.h_magic = cpu2be32 (JBD_MAGIC);
+		rh->r_header.h_blocktype = cpu2be32 (JBD_REVOKE_BLOCK);
+		rh->r_header.h_sequence = cpu2be32 (j->tid);
+		rh->r_count = cpu2be32 (sizeof (*rh) + n * sizeof (*rec));
+
+		bzero (rec, j->bsize - sizeof (*rh));
+		for (k = 0; k < n; k++)
+			rec [k] = cpu2be32 (j->revoke [i + k]);
+	}
+
+	/* everything before the commit block must be on disk */
+	r |= stage_flush (j);
+
+	{
+		struct jbd_commit *c = (struct jbd_commit *) stage_get (j, &r);
+
+		bzero (c, j->bsize);
+		c->h.h_magic = cpu2be32 (JBD_MAGIC);
+		c->h.h_blocktype = cpu2be32 (JBD_COMMIT_BLOCK);
+		c->h.h_sequence = cpu2be32 (j->tid);
+		c->h_commit_sec = cpu2be32 (CURRENT_TIME);
+	}
+
+	r |= stage_flush (j);
+
+	j->head = j->stage_log;
+
+	/* the transaction is safe in the log */
+	r |= pin_flush (j);
+
+	/* first transaction in an empty log, make it visible */
+	if (was_empty)
+		r |= journal_write_sb (j);
+
+	if (r)
+	{
+		ALERT (("Ext2-FS [%c]: journal commit of transaction %lu failed (%li)",
+			j->s->dev+'A', j->tid, r));
+	}
+
+	j->tid++;
+	j->nblocks = 0;
+	j->nrevoke = 0;
+	hash_clear (j->hash, j->hash_mask);
+
+	j->committing = 0;
+	return r;
+}
+
+/* write everything home and empty the log */
+static void
+journal_checkpoint (struct ext2_journal *j)
+{
+	journal_commit (j);
+
+	bio.sync_drv (j->di);
+
+	if (j->start)
+	{
+		j->start = 0;
+		journal_write_sb (j);
+	}
+
+	j->head = j->first;
+	j->nlogged = 0;
+	hash_clear (j->logged, j->logged_mask);
+}
+
+/*
+ * between operations: commit a large transaction, and checkpoint if
+ * the log can't take a transaction of the maximal size anymore
+ */
+static void
+journal_room (struct ext2_journal *j)
+{
+	if (j->nblocks > j->max_blocks / 4)
+		journal_commit (j);
+
+	if (j->nlogged + j->max_blocks > j->max_logged
+		|| j->head + trans_space (j, j->max_blocks, j->max_revoke) > j->maxlen)
+	{
+		journal_checkpoint (j);
+	}
+}
+
+/* an operation outgrows the transaction, it can't be kept atomic */
+static void
+journal_overflow (struct ext2_journal *j)
+{
+	ALERT (("Ext2-FS [%c]: journal: operation too large for one transaction, committed in parts",
+		j->s->dev+'A'));
+
+	journal_commit (j);
+	journal_room (j);
+}
+
+/* hold back blocks of the running transaction until the commit */
+static long
+journal_hold (struct ext2_journal *j, char *buf, ulong n, ulong rec)
+{
+	long r = E_OK;
+
+	for (; n; n--, rec++, buf += j->bsize)
+	{
+		if (hash_find (j->hash, j->hash_mask, rec))
+		{
+			struct jpin *p = pin_find (j, rec);
+
+			if (!p)
+			{
+				p = kmalloc (sizeof (*p) + j->bsize);
+				if (p)
+				{
+					p->block = rec;
+					p->next = j->pinned;
+					j->pinned = p;
+				}
+			}
+
+			if (p)
+			{
+				memcpy (p + 1, buf, j->bsize);
+				continue;
+			}
+
+			ALERT (("Ext2-FS [%c]: journal: out of memory, block %lu written before the commit",
+				j->s->dev+'A', rec));
+		}
+
+		r |= (*j->rwabs)(j->di, 1, buf, j->bsize, rec);
+	}
+
+	return r;
+}
+
+/*
+ * the overloaded rwabs: a block of the running transaction is going
+ * home, commit the transaction first, or hold the block back if an
+ * operation is in progress; reads see the held back blocks
+ */
+static long _cdecl
+journal_rwabs (DI *di, ushort rw, void *buf, ulong size, ulong rec)
+{
+	struct ext2_journal *j;
+	ulong n, i;
+	long r;
+
+	for (j = journals; j; j = j->next)
+		if (j->di == di)
+			break;
+
+	if (!j)
+		return ENODEV;
+
+	n = size >> j->bits;
+
+	if ((rw & 1) && j->nblocks && !j->committing)
+	{
+		for (i = 0; i < n; i++)
+		{
+			if (hash_find (j->hash, j->hash_mask, rec + i))
+			{
+				if (j->handles)
+					return journal_hold (j, buf, n, rec);
+
+				journal_commit (j);
+				break;
+			}
+		}
+	}
+
+	r = (*j->rwabs)(di, rw, buf, size, rec);
+
+	if (!(rw & 1) && !r && j->pinned)
+	{
+		struct jpin *p;
+
+		for (p = j->pinned; p; p = p->next)
+			if (p->block >= rec && p->block < rec + n)
+				memcpy ((char *) buf + ((p->block - rec) << j->bits), p + 1, j->bsize);
+	}
+
+	return r;
+}
+
+
+/*
+ * transaction interface
+ */
+
+void
+ext2_journal_dirty (SI *s, ulong block)
+{
+	struct ext2_journal *j = s->sbi.s_journal;
+	long i;
+
+	if (j->committing || hash_find (j->hash, j->hash_mask, block))
+		return;
+
+	/* logged again, an earlier revoke doesn't apply anymore */
+	for (i = 0; i < j->nrevoke; i++)
+	{
+		if (j->revoke [i] == block)
+		{
+			j->revoke [i] = j->revoke [--j->nrevoke];
+			break;
+		}
+	}
+
+	if (j->nblocks == j->max_blocks)
+		journal_overflow (j);
+
+	hash_insert (j->hash, j->hash_mask, block);
+	j->blocks [j->nblocks++] = block;
+
+	/* a change outside of any operation */
+	if (!j->handles)
+		journal_room (j);
+}
+
+void
+ext2_journal_data (SI *s, ulong block, ulong count)
+{
+	struct ext2_journal *j = s->sbi.s_journal;
+	struct jextent *e;
+
+	for (; count; block++, count--)
+	{
+		if (hash_find (j->hash, j->hash_mask, block))
+			continue;
+
+		/* an older copy in the log would come back on replay */
+		if (hash_find (j->logged, j->logged_mask, block))
+		{
+			ext2_journal_dirty (s, block);
+			continue;
+		}
+
+		e = j->nordered ? &j->ordered [j->nordered - 1] : NULL;
+		if (e && block == e->start + e->count)
+		{
+			e->count++;
+			continue;
+		}
+
+		if (j->nordered == JBD_ORDERED)
+			journal_write_ordered (j);
+
+		e = &j->ordered [j->nordered++];
+		e->start = block;
+		e->count = 1;
+	}
+}
+
+void
+ext2_journal_revoke (SI *s, ulong block, ulong count)
+{
+	struct ext2_journal *j = s->sbi.s_journal;
+
+	for (; count; block++, count--)
+	{
+		if (!hash_find (j->logged, j->logged_mask, block)
+			&& !hash_find (j->hash, j->hash_mask, block))
+		{
+			continue;
+		}
+
+		/* a held back copy must not overwrite the block's next use */
+		pin_drop (j, block);
+
+		if (j->nrevoke == j->max_revoke)
+			journal_overflow (j);
+
+		/* a checkpoint empties the log, nothing left to revoke */
+		if (j->nlogged == 0 && j->nblocks == 0)
+			continue;
+
+		j->revoke [j->nrevoke++] = block;
+
+		if (!j->handles)
+			journal_room (j);
+	}
+}
+
+/* begin of a modifying operation */
+void
+ext2_journal_start (SI *s)
+{
+	struct ext2_journal *j = s->sbi.s_journal;
+
+	if (!j)
+		return;
+
+	if (!j->handles)
+		journal_room (j);
+
+	j->handles++;
+}
+
+/* end of a modifying operation, the transaction may be committed if
+ * it was the last one running
+ */
+void
+ext2_journal_stop (SI *s)
+{
+	struct ext2_journal *j = s->sbi.s_journal;
+
+	if (!j)
+		return;
+
+	if (j->handles && --j->handles)
+		return;
+
+	journal_room (j);
+}
+
+
+/*
+ * recovery
+ */
+
+static long
+recover_read (struct jbd_replay *r, __u32 log, char *buf)
+{
+	return journal_io (r->arg, 0, log, buf, 1);
+}
+
+/* replayed blocks go through the cache, bio.sync_drv writes them */
+static long
+recover_write (struct jbd_replay *r, __u32 block, char *data)
+{
+	struct ext2_journal *j = r->arg;
+	UNIT *u;
+
+	u = bio.getunit (j->di, block, j->bsize);
+	if (!u)
+		return ENOMEM;
+
+	memcpy (u->data, data, j->bsize);
+	bio_MARK_MODIFIED (&bio, u);
+
+	return E_OK;
+}
+
+static long
+journal_recover (struct ext2_journal *j)
+{
+	struct jbd_sb *jsb = (struct jbd_sb *) j->sb;
+	struct jbd_replay rp;
+	long r;
+
+	j->tid = be2cpu32 (jsb->s_sequence);
+
+	if (!jsb->s_start)
+		return E_OK;
+
+	rp.data = kmalloc (j->bsize);
+	if (!rp.data)
+		return ENOMEM;
+
+	rp.sb = j->sb;
+	rp.buf = j->buf;
+	rp.bsize = j->bsize;
+	rp.first = j->first;
+	rp.maxlen = j->maxlen;
+	rp.read = recover_read;
+	rp.write = recover_write;
+	rp.arg = j;
+
+	r = jbd_recover (&rp);
+
+	kfree (rp.data, j->bsize);
+
+	if (r)
+	{
+		ALERT (("Ext2-FS [%c]: journal replay failed (%li)", j->s->dev+'A', r));
+		return r;
+	}
+
+	ALERT (("Ext2-FS [%c]: journal replayed, transactions %lu-%lu, %li blocks",
+		j->s->dev+'A', j->tid, (ulong) rp.end_tid - 1, rp.replayed));
+
+	bio.sync_drv (j->di);
+
+	/* the log is empty now; like Linux skip a sequence number, a
+	 * transaction left uncommitted in the log must not be taken for
+	 * the continuation of the next one
+	 */
+	j->tid = rp.end_tid + 1;
+	j->start = 0;
+
+	return journal_write_sb (j);
+}
+
+
+/*
+ * mount and unmount
+ */
+
+/* map the log onto device runs; without a runs array only count them */
+static long
+journal_map (struct ext2_journal *j, COOKIE *c, long max)
+{
+	ulong log = 0;
+	ulong last = 0;
+	long n = 0;
+
+	while (log < j->maxlen)
+	{
+		long len;
+		long tmp;
+
+		tmp = ext2_bmap_run (c, log, &len);
+		if (tmp < 0)
+			return tmp;
+		if (!tmp)
+			return EBADARG;
+
+		if (len > j->maxlen - log)
+			len = j->maxlen - log;
+
+		if (n && last == tmp)
+		{
+			if (j->runs)
+				j->runs [n - 1].len += len;
+		}
+		else
+		{
+			if (j->runs)
+			{
+				if (n == max)
+					return EBADARG;
+
+				j->runs [n].lblk = log;
+				j->runs [n].pblk = tmp;
+				j->runs [n].len = len;
+			}
+
+			n++;
+		}
+
+		last = tmp + len;
+		log += len;
+	}
+
+	return n;
+}
+
+/*
+ * ext2_journal_load: replay the journal if needed and start journaling
+ * for a read/write mount; a journal we can't write is left alone
+ */
+long
+ext2_journal_load (SI *s)
+{
+	ext2_sb *sb = s->sbi.s_sb;
+	ulong bsize = EXT2_BLOCK_SIZE (s);
+	struct ext2_journal *j;
+	struct jbd_sb *jsb;
+	COOKIE *c = NULL;
+	UNIT *u = NULL;
+	ulong incompat;
+	long nruns, hash_size, logged_size, max_blocks, max_revoke;
+	long memsize;
+	long recover = le2cpu32 (sb->s_feature_incompat) & EXT3_FEATURE_INCOMPAT_RECOVER;
+	long r;
+
+	if (!EXT2_HAS_COMPAT_FEATURE (s, EXT3_FEATURE_COMPAT_HAS_JOURNAL))
+	{
+		if (recover)
+			goto unusable;
+
+		return E_OK;
+	}
+
+	if (!sb->s_journal_inum || sb->s_journal_dev)
+	{
+		ALERT (("Ext2-FS [%c]: external journals are not supported", s->dev+'A'));
+		goto unusable;
+	}
+
+	r = get_cookie (s, le2cpu32 (sb->s_journal_inum), &c);
+	if (r)
+		goto unusable;
+
+	/* journal superblock */
+	u = ext2_read (c, 0, &r);
+	if (!u)
+		goto unusable;
+
+	jsb = (struct jbd_sb *) u->data;
+
+	if (be2cpu32 (jsb->s_header.h_magic) != JBD_MAGIC
+		|| (be2cpu32 (jsb->s_header.h_blocktype) != JBD_SUPERBLOCK_V1
+		    && be2cpu32 (jsb->s_header.h_blocktype) != JBD_SUPERBLOCK_V2)
+		|| be2cpu32 (jsb->s_blocksize) != bsize
+		|| be2cpu32 (jsb->s_first) == 0
+		|| be2cpu32 (jsb->s_first) >= be2cpu32 (jsb->s_maxlen)
+		|| be2cpu32 (jsb->s_maxlen) > le2cpu32 (c->in.i_size) / bsize)
+	{
+		ALERT (("Ext2-FS [%c]: invalid journal superblock", s->dev+'A'));
+		goto unusable;
+	}
+
+	incompat = 0;
+	if (be2cpu32 (jsb->s_header.h_blocktype) == JBD_SUPERBLOCK_V2)
+		incompat = be2cpu32 (jsb->s_feature_incompat);
+
+	if (incompat & ~JBD_INCOMPAT_REPLAY)
+	{
+		ALERT (("Ext2-FS [%c]: unsupported journal features %lx", s->dev+'A', incompat));
+		goto unusable;
+	}
+
+	/* sizes; a transaction of max_blocks must fit into the log
+	 * whatever was logged before it, see journal_room()
+	 */
+	max_blocks = (be2cpu32 (jsb->s_maxlen) - be2cpu32 (jsb->s_first)) / 2;
+	if (max_blocks > JBD_MAX_TRANS)
+		max_blocks = JBD_MAX_TRANS;
+	if (max_blocks < 16)
+		goto unusable;
+
+	for (hash_size = 16; hash_size < max_blocks * 2; hash_size <<= 1)
+		;
+	for (logged_size = 16; logged_size < max_blocks * 4; logged_size <<= 1)
+		;
+
+	/* every logged block may be revoked once */
+	max_revoke = logged_size / 2 + max_blocks;
+
+	{
+		struct ext2_journal tmp;
+
+		tmp.maxlen = be2cpu32 (jsb->s_maxlen);
+		tmp.runs = NULL;
+
+		nruns = journal_map (&tmp, c, 0);
+		if (nruns <= 0)
+		{
+			ALERT (("Ext2-FS [%c]: journal inode has holes", s->dev+'A'));
+			goto unusable;
+		}
+	}
+
+	memsize = sizeof (*j)
+		+ nruns * sizeof (struct jrun)
+		+ max_blocks * sizeof (ulong)
+		+ hash_size * sizeof (ulong)
+		+ logged_size * sizeof (ulong)
+		+ max_revoke * sizeof (ulong)
+		+ 2 * bsize
+		+ MAX (JBD_STAGE_SIZE, bsize);
+
+	j = kmalloc (memsize);
+	if (!j)
+	{
+		bio.remove (u);
+		rel_cookie (c);
+		return ENOMEM;
+	}
+
+	bzero (j, sizeof (*j));
+
+	j->memsize = memsize;
+	j->s = s;
+	j->di = s->di;
+	j->rwabs = s->di->rwabs;
+
+	j->bsize = bsize;
+	j->bits = EXT2_BLOCK_SIZE_BITS (s);
+	j->first = be2cpu32 (jsb->s_first);
+	j->maxlen = be2cpu32 (jsb->s_maxlen);
+	j->head = j->first;
+	j->tag_space = (bsize - sizeof (struct jbd_header) - 16) / sizeof (struct jbd_tag);
+	j->revoke_space = (bsize - sizeof (struct jbd_revoke_header)) / sizeof (__u32);
+
+	j->runs = (struct jrun *) (j + 1);
+	j->blocks = (ulong *) (j->runs + nruns);
+	j->max_blocks = max_blocks;
+	j->hash = j->blocks + max_blocks;
+	j->hash_mask = hash_size - 1;
+	j->logged = j->hash + hash_size;
+	j->logged_mask = logged_size - 1;
+	j->max_logged = logged_size / 2;
+	j->revoke = j->logged + logged_size;
+	j->max_revoke = max_revoke;
+	j->buf = (char *) (j->revoke + max_revoke);
+	j->sb = j->buf + bsize;
+	j->stage = j->sb + bsize;
+	j->stage_max = MAX (JBD_STAGE_SIZE, bsize) / bsize;
+
+	hash_clear (j->hash, j->hash_mask);
+	hash_clear (j->logged, j->logged_mask);
+
+	/* the journal superblock is only accessed directly from now on */
+	memcpy (j->sb, jsb, bsize);
+	jsb = (struct jbd_sb *) j->sb;
+	bio.remove (u);
+
+	j->nruns = journal_map (j, c, nruns);
+	rel_cookie (c);
+	c = NULL;
+
+	if (j->nruns != nruns)
+		goto free;
+
+	/* replay */
+	if (recover || jsb->s_start)
+	{
+		if (BIO_WP_CHECK (s->di))
+		{
+			ALERT (("Ext2-FS [%c]: journal needs recovery, but the device is write-protected", s->dev+'A'));
+			s->s_flags |= MS_RDONLY;
+			goto free;
+		}
+
+		if (journal_recover (j))
+		{
+			s->s_flags |= MS_RDONLY;
+			goto free;
+		}
+
+		/* inodes may have come back from the log */
+		inv_ctable (s->dev);
+
+		sb->s_feature_incompat = cpu2le32 (le2cpu32 (sb->s_feature_incompat) & ~EXT3_FEATURE_INCOMPAT_RECOVER);
+		bio.write (s->sbi.s_sb_unit);
+	}
+	else
+	{
+		j->tid = be2cpu32 (jsb->s_sequence);
+	}
+
+	if (s->s_flags & MS_RDONLY)
+		goto free;
+
+	if (incompat & ~JBD_INCOMPAT_WRITE)
+	{
+		ALERT (("Ext2-FS [%c]: journal format not supported for writing, journal disabled", s->dev+'A'));
+		goto free;
+	}
+
+	/* we write neither checksums nor 64bit tags */
+	if (be2cpu32 (jsb->s_header.h_blocktype) == JBD_SUPERBLOCK_V2)
+	{
+		jsb->s_feature_compat = cpu2be32 (be2cpu32 (jsb->s_feature_compat) & ~JBD_FEATURE_COMPAT_CHECKSUM);
+		jsb->s_feature_incompat = cpu2be32 (be2cpu32 (jsb->s_feature_incompat) | JBD_FEATURE_INCOMPAT_REVOKE);
+	}
+
+	j->start = 0;
+	if (journal_write_sb (j))
+		goto free;
+
+	/* the journal is in use from here on */
+	sb->s_feature_incompat = cpu2le32 (le2cpu32 (sb->s_feature_incompat) | EXT3_FEATURE_INCOMPAT_RECOVER);
+	bio.write (s->sbi.s_sb_unit);
+
+	j->next = journals;
+	journals = j;
+
+	s->di->rwabs = journal_rwabs;
+	s->sbi.s_journal = j;
+
+	DEBUG (("Ext2-FS [%c]: journal: %lu blocks, %li runs, transaction %lu",
+		s->dev+'A', j->maxlen, j->nruns, j->tid));
+
+	return E_OK;
+
+free:
+	kfree (j, j->memsize);
+	return E_OK;
+
+unusable:
+	if (u)
+		bio.remove (u);
+	if (c)
+		rel_cookie (c);
+
+	if (recover)
+	{
+		ALERT (("Ext2-FS [%c]: journal needs recovery but can't be used, mounting read-only", s->dev+'A'));
+		s->s_flags |= MS_RDONLY;
+	}
+
+	return E_OK;
+}
+
+static void
+journal_unhook (struct ext2_journal *j)
+{
+	struct ext2_journal **p;
+
+	for (p = &journals; *p; p = &(*p)->next)
+	{
+		if (*p == j)
+		{
+			*p = j->next;
+			break;
+		}
+	}
+
+	j->di->rwabs = j->rwabs;
+	j->s->sbi.s_journal = NULL;
+
+	while (j->pinned)
+	{
+		struct jpin *p = j->pinned;
+
+		j->pinned = p->next;
+		kfree (p, sizeof (*p) + j->bsize);
+	}
+
+	kfree (j, j->memsize);
+}
+
+/*
+ * ext2_journal_release: everything goes home, the log is emptied and
+ * the filesystem doesn't need recovery anymore
+ */
+void
+ext2_journal_release (SI *s)
+{
+	struct ext2_journal *j = s->sbi.s_journal;
+	ext2_sb *sb = s->sbi.s_sb;
+
+	if (!j)
+		return;
+
+	journal_checkpoint (j);
+	journal_unhook (j);
+
+	sb->s_feature_incompat = cpu2le32 (le2cpu32 (sb->s_feature_incompat) & ~EXT3_FEATURE_INCOMPAT_RECOVER);
+	bio.write (s->sbi.s_sb_unit);
+}
+
+/* media change: forget the journal, no I/O */
+void
+ext2_journal_drop (SI *s)
+{
+	if (s->sbi.s_journal)
+		journal_unhook (s->sbi.s_journal);
+}
@@ -0,0 +1,72 @@
+/*
+ * Filename:     journal.h
+ * Project:      ext2 file system driver for MiNT
+ *
+ * Note:         Please send suggestions, patches or bug reports to
+ *               the MiNT mailing list <freemint-discuss@lists.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+# ifndef _journal_h
+# define _journal_h
+
+# include "global.h"
+
+
+long	ext2_journal_load	(SI *s);
+void	ext2_journal_release	(SI *s);
+void	ext2_journal_drop	(SI *s);
+
+void	ext2_journal_dirty	(SI *s, ulong block);
+void	ext2_journal_data	(SI *s, ulong block, ulong count);
+void	ext2_journal_revoke	(SI *s, ulong block, ulong count);
+void	ext2_journal_start	(SI *s);
+void	ext2_journal_stop	(SI *s);
+
+
+/* a metadata block was modified */
+INLINE void
+ext2_mark_modified (SI *s, UNIT *u)
+{
+	if (s->sbi.s_journal)
+		ext2_journal_dirty (s, u->sector);
+
+	bio_MARK_MODIFIED (&bio, u);
+}
+
+/* a file data block was modified, it is written before the
+ * metadata that points to it
+ */
+INLINE void
+ext2_mark_data (SI *s, UNIT *u)
+{
+	if (s->sbi.s_journal)
+		ext2_journal_data (s, u->sector, 1);
+
+	bio_MARK_MODIFIED (&bio, u);
+}
+
+/* end of a modifying operation, closes the ext2_journal_start() handle */
+INLINE void
+ext2_sync_drv (SI *s)
+{
+	ext2_journal_stop (s);
+
+	bio_SYNC_DRV (&bio, s->di);
+}
+
+
+# endif /* _journal_h */
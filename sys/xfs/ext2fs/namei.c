@@ -30,7 +30,9 @@
 
 # include <mint/endian.h>
 
+# include "htree.h"
 # include "inode.h"
+# include "journal.h"
 # include "super.h"
 
 
@@ -353,6 +355,73 @@ ext2_match (long length, const char *name, ext2_d2 *de)
 	return !memcmp (name, de->name, length);
 }
 
+/* scan one directory block for name; used for the leaf blocks
+ * of hash-indexed directories
+ */
+static UNIT *
+ext2_search_block (COOKIE *dir, long block, const char *name, long namelen, ext2_d2 **res_dir)
+{
+	UNIT *u;
+	ext2_d2 *de;
+	char *upper;
+	ulong offset = block << EXT2_BLOCK_SIZE_BITS (dir->s);
+
+	u = ext2_read (dir, block, NULL);
+	if (!u)
+		return NULL;
+
+	de = (ext2_d2 *) u->data;
+	upper = (char *) de + EXT2_BLOCK_SIZE (dir->s);
+
+	while ((char *) de < upper)
+	{
+		long de_len;
+
+		if ((char *) de + namelen <= upper && ext2_match (namelen, name, de))
+		{
+			if (!ext2_check_dir_entry ("ext2_search_block", dir, de, u, offset))
+				return NULL;
+
+			*res_dir = de;
+			return u;
+		}
+
+		de_len = le2cpu16 (de->rec_len);
+		if (de_len <= 0)
+			return NULL;
+
+		offset += de_len;
+		de = (ext2_d2 *) ((char *) de + de_len);
+	}
+
+	return NULL;
+}
+
+/* lookup through the hash index
+ *
+ * returns the unit of the entry; if not found, err is ENOENT
+ * if the name is definitely not in the directory, otherwise the
+ * caller must fall back to the linear scan
+ */
+static UNIT *
+ext2_dx_find_entry (COOKIE *dir, const char *name, long namelen, ext2_d2 **res_dir, long *err)
+{
+	UNIT *u;
+	long block;
+	short cont;
+
+	*err = ext2_dx_probe (dir, name, namelen, &block, &cont);
+	if (*err)
+		return NULL;
+
+	u = ext2_search_block (dir, block, name, namelen, res_dir);
+	if (u)
+		return u;
+
+	*err = cont ? EAGAIN : ENOENT;
+	return NULL;
+}
+
 
 _DIR *
 ext2_search_entry (COOKIE *dir, const char *name, long namelen)
@@ -387,7 +456,28 @@ ext2_search_entry (COOKIE *dir, const char *name, long namelen)
 		}
 	}
 
-	/* 3. search on disk
+	/* 3. search through the hash index
+	 */
+	if (ext2_dx_dir (dir, name, namelen))
+	{
+		UNIT *u;
+		ext2_d2 *de;
+		long r;
+
+		u = ext2_dx_find_entry (dir, name, namelen, &de, &r);
+		if (u)
+		{
+			dentry = d_get_dir (dir, le2cpu32 (de->inode), de->name, de->name_len);
+			return dentry;
+		}
+
+		if (r == ENOENT)
+			goto failure;
+
+		DEBUG (("Ext2-FS: ext2_search_entry: index not usable, linear scan"));
+	}
+
+	/* 4. search on disk
 	 */
 	for (block = 0, offset = 0; offset < size; block++)
 	{
@@ -443,7 +533,7 @@ ext2_search_entry (COOKIE *dir, const char *name, long namelen)
 	}
 
 failure:
-	/* 4. update lookup fail cache
+	/* 5. update lookup fail cache
 	 */
 	update_lastlookup (dir, name, namelen);
 
@@ -544,6 +634,16 @@ ext2_find_entry (COOKIE *dir, const char *name, long namelen, ext2_d2 **res_dir)
 	s = super [dir->dev];
 	size = le2cpu32 (dir->in.i_size);
 
+	if (ext2_dx_dir (dir, name, namelen))
+	{
+		UNIT *u;
+		long r;
+
+		u = ext2_dx_find_entry (dir, name, namelen, res_dir, &r);
+		if (u || r == ENOENT)
+			return u;
+	}
+
 	for (block = 0, offset = 0; offset < size; block++)
 	{
 		UNIT *u;
@@ -593,6 +693,106 @@ failure:
 	return NULL;
 }
 
+/* does the new entry of rec_len fit into (or after) de? */
+INLINE long
+ext2_entry_fits (ext2_d2 *de, ushort rec_len)
+{
+	if (de->inode == 0)
+		return (le2cpu16 (de->rec_len) >= rec_len);
+
+	return (le2cpu16 (de->rec_len) >= EXT2_DIR_REC_LEN (de->name_len) + rec_len);
+}
+
+/* put name into the slot de found by ext2_entry_fits() */
+static ext2_d2 *
+ext2_insert_entry (COOKIE *dir, UNIT *u, ext2_d2 *de, const char *name, long namelen)
+{
+	if (de->inode)
+	{
+		ext2_d2 *de1;
+
+		de1 = (ext2_d2 *) ((char *) de + EXT2_DIR_REC_LEN (de->name_len));
+		de1->rec_len = cpu2le16 (le2cpu16 (de->rec_len) - EXT2_DIR_REC_LEN (de->name_len));
+		de->rec_len = cpu2le16 (EXT2_DIR_REC_LEN (de->name_len));
+		de = de1;
+	}
+
+	de->inode = 0;
+	de->name_len = namelen;
+	de->file_type = 0;
+	memcpy (de->name, name, namelen);
+
+	dir->in.i_mtime = dir->in.i_ctime = cpu2le32 (CURRENT_TIME);
+	dir->in.i_version = cpu2le32 (++event);
+	mark_inode_dirty (dir);
+
+	ext2_mark_modified (dir->s, u);
+
+	clear_lastlookup (dir);
+
+	return de;
+}
+
+/* add to the leaf block the hash index selects; the index stays
+ * valid as every leaf covers a hash range, not a set of names
+ *
+ * returns NULL if the leaf is full or the index not usable (err is
+ * E_OK then) or on EEXIST
+ */
+static UNIT *
+ext2_dx_add_entry (COOKIE *dir, const char *name, long namelen, ext2_d2 **res_dir, long *err)
+{
+	SI *s = dir->s;
+	UNIT *u;
+	ext2_d2 *de, *slot = NULL;
+	char *upper;
+	ulong offset;
+	ushort rec_len = EXT2_DIR_REC_LEN (namelen);
+	long block;
+	short cont;
+
+	*err = E_OK;
+
+	if (ext2_dx_probe (dir, name, namelen, &block, &cont))
+		return NULL;
+
+	u = ext2_read (dir, block, NULL);
+	if (!u)
+		return NULL;
+
+	offset = block << EXT2_BLOCK_SIZE_BITS (s);
+	de = (ext2_d2 *) u->data;
+	upper = (char *) de + EXT2_BLOCK_SIZE (s);
+
+	while ((char *) de < upper)
+	{
+		if (!ext2_check_dir_entry ("ext2_dx_add_entry", dir, de, u, offset))
+			return NULL;
+
+		if (ext2_match (namelen, name, de))
+		{
+			*err = EEXIST;
+			return NULL;
+		}
+
+		if (!slot && ext2_entry_fits (de, rec_len))
+			slot = de;
+
+		offset += le2cpu16 (de->rec_len);
+		de = (ext2_d2 *) ((char *) de + le2cpu16 (de->rec_len));
+	}
+
+	if (!slot)
+	{
+		/* splitting the leaf isn't supported */
+		DEBUG (("Ext2-FS: ext2_dx_add_entry: leaf %li of #%li full", block, dir->inode));
+		return NULL;
+	}
+
+	*res_dir = ext2_insert_entry (dir, u, slot, name, namelen);
+	return u;
+}
+
 /*
  *	ext2_add_entry()
  *
@@ -608,7 +808,7 @@ ext2_add_entry (COOKIE *dir, const char *name, long namelen, ext2_d2 **res_dir,
 {
 	SI *s;
 	UNIT *u;
-	ext2_d2 *de, *de1;
+	ext2_d2 *de;
 
 	ulong offset;
 	ushort rec_len;
@@ -644,6 +844,18 @@ ext2_add_entry (COOKIE *dir, const char *name, long namelen, ext2_d2 **res_dir,
 		return NULL;
 	}
 
+	if (ext2_dx_dir (dir, name, namelen))
+	{
+		u = ext2_dx_add_entry (dir, name, namelen, res_dir, err);
+		if (u || *err)
+			return u;
+
+		/* the linear insert below drops the index
+		 * (e2fsck -D rebuilds it)
+		 */
+		DEBUG (("Ext2-FS: ext2_add_entry: dropping index of #%li", dir->inode));
+	}
+
 	u = ext2_read (dir, 0, err);
 	if (!u)
 	{
@@ -703,33 +915,14 @@ ext2_add_entry (COOKIE *dir, const char *name, long namelen, ext2_d2 **res_dir,
 			return NULL;
 		}
 
-		if ((de->inode == 0 && le2cpu16 (de->rec_len) >= rec_len)
-			|| (le2cpu16 (de->rec_len) >= EXT2_DIR_REC_LEN (de->name_len) + rec_len))
+		if (ext2_entry_fits (de, rec_len))
 		{
-			offset += le2cpu16 (de->rec_len);
-			if (de->inode)
-			{
-				de1 = (ext2_d2 *) ((char *) de + EXT2_DIR_REC_LEN (de->name_len));
-				de1->rec_len = cpu2le16 (le2cpu16 (de->rec_len) - EXT2_DIR_REC_LEN (de->name_len));
-				de->rec_len = cpu2le16 (EXT2_DIR_REC_LEN (de->name_len));
-				de = de1;
-			}
-
-			de->inode = 0;
-			de->name_len = namelen;
-			de->file_type = 0;
-			memcpy (de->name, name, namelen);
-
-			dir->in.i_mtime = dir->in.i_ctime = cpu2le32 (CURRENT_TIME);
-			dir->in.i_flags = cpu2le32 (le2cpu32 (dir->in.i_flags) & ~EXT2_BTREE_FL);
-			dir->in.i_version = cpu2le32 (++event);
-			mark_inode_dirty (dir);
-
-			bio_MARK_MODIFIED (&bio, u);
-
-			clear_lastlookup (dir);
+			/* the slot may be anywhere, including the space
+			 * of the index root behind ".."
+			 */
+			dir->in.i_flags = cpu2le32 (le2cpu32 (dir->in.i_flags) & ~EXT2_INDEX_FL);
 
-			*res_dir = de;
+			*res_dir = ext2_insert_entry (dir, u, de, name, namelen);
 			*err = E_OK;
 
 			return u;
@@ -746,9 +939,12 @@ ext2_add_entry (COOKIE *dir, const char *name, long namelen, ext2_d2 **res_dir,
 /*
  * ext2_delete_entry deletes a directory entry by merging it with the
  * previous entry
+ *
+ * The entry stays in its block, so the hash index of the directory
+ * (if any) remains valid.
  */
 long
-ext2_delete_entry (ext2_d2 *dir, UNIT *u)
+ext2_delete_entry (SI *s, ext2_d2 *dir, UNIT *u)
 {
 	ext2_d2 *de = (ext2_d2 *) u->data;
 	ext2_d2 *pde = NULL;
@@ -768,7 +964,7 @@ ext2_delete_entry (ext2_d2 *dir, UNIT *u)
 
 			dir->inode = 0;
 
-			bio_MARK_MODIFIED (&bio, u);
+			ext2_mark_modified (s, u);
 			return 0;
 		}
 
@@ -58,7 +58,7 @@ _DIR *	ext2_search_entry	(COOKIE *dir, const char *name, long namelen);
 UNIT *	ext2_search_entry_i	(COOKIE *dir, long inode, ext2_d2 **res_dir);
 UNIT *	ext2_find_entry		(COOKIE *dir, const char *name, long namelen, ext2_d2 **res_dir);
 UNIT *	ext2_add_entry		(COOKIE *dir, const char *name, long namelen, ext2_d2 **res_dir, long *err);
-long	ext2_delete_entry	(ext2_d2 *dir, UNIT *u);
+long	ext2_delete_entry	(SI *s, ext2_d2 *dir, UNIT *u);
 
 
 # endif /* _namei_h */
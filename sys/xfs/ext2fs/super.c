@@ -33,6 +33,7 @@
 # include "balloc.h"
 # include "ialloc.h"
 # include "inode.h"
+# include "journal.h"
 
 
 INLINE ulong
@@ -99,7 +100,7 @@ ext2_setup_super (SI *s)
 		sb->s_mtime = cpu2le32 (CURRENT_TIME);
 		
 		DEBUG (("2: sb = %lx, u = %lx, u->data = %lx, u->size = %li", sb, s->sbi.s_sb_unit, s->sbi.s_sb_unit->data, s->sbi.s_sb_unit->size));
-		bio_MARK_MODIFIED (&bio, s->sbi.s_sb_unit);
+		ext2_mark_modified (s, s->sbi.s_sb_unit);
 		
 		s->sbi.s_dirty = 1;
 		
@@ -129,6 +130,7 @@ INLINE long
 ext2_check_descriptors (SI *s)
 {
 	ulong block = s->sbi.s_first_data_block;
+	ulong first, last;
 	ext2_gd *gdp = NULL;
 	long desc_block = 0;
 	long i;
@@ -144,8 +146,21 @@ ext2_check_descriptors (SI *s)
 			gdp = s->sbi.s_group_desc [desc_block++];
 		}
 		
+		/* flex_bg packs the metadata of several groups together
+		 */
+		if (s->sbi.s_feature_incompat & EXT4_FEATURE_INCOMPAT_FLEX_BG)
+		{
+			first = s->sbi.s_first_data_block;
+			last = s->sbi.s_blocks_count;
+		}
+		else
+		{
+			first = block;
+			last = block + EXT2_BLOCKS_PER_GROUP (s);
+		}
+		
 		tmp = le2cpu32 (gdp->bg_block_bitmap);
-		if (tmp < block || tmp >= block + EXT2_BLOCKS_PER_GROUP (s))
+		if (tmp < first || tmp >= last)
 		{
 			ALERT (("Ext2-FS: ext2_check_descriptors: Block bitmap for group %li"
 				" not in group (block %li)!", i, tmp));
@@ -154,7 +169,7 @@ ext2_check_descriptors (SI *s)
 		}
 		
 		tmp = le2cpu32 (gdp->bg_inode_bitmap);
-		if (tmp < block || tmp >= block + EXT2_BLOCKS_PER_GROUP (s))
+		if (tmp < first || tmp >= last)
 		{
 			ALERT (("Ext2-FS: ext2_check_descriptors: Inode bitmap for group %d"
 				" not in group (block %lu)!", i, tmp));
@@ -163,7 +178,7 @@ ext2_check_descriptors (SI *s)
 		}
 		
 		tmp = le2cpu32 (gdp->bg_inode_table);
-		if (tmp < block || tmp + s->sbi.s_itb_per_group >= block + EXT2_BLOCKS_PER_GROUP (s))
+		if (tmp < first || tmp + s->sbi.s_itb_per_group > last)
 		{
 			ALERT (("Ext2-FS: ext2_check_descriptors: Inode table for group %d"
 				" not in group (block %lu)!", i, tmp));
@@ -172,7 +187,7 @@ ext2_check_descriptors (SI *s)
 		}
 		
 		block += EXT2_BLOCKS_PER_GROUP (s);
-		gdp++;
+		gdp = (ext2_gd *) ((char *) gdp + s->sbi.s_desc_size);
 	}
 	
 	return 1;
@@ -189,6 +204,7 @@ read_ext2_sb_info (ushort drv)
 	ulong blocksize;
 	ulong sb_block;
 	ulong sb_offset;
+	short readonly = 0;
 	
 	
 	DEBUG (("Ext2-FS [%c]: read_ext2_sb_info enter", drv+'A'));
@@ -252,7 +268,7 @@ read_ext2_sb_info (ushort drv)
 		if (le2cpu32 (sb->s_rev_level) > EXT2_GOOD_OLD_REV)
 		{
 					
-			if (le2cpu32 (sb->s_feature_incompat) & ~EXT2_FEATURE_INCOMPAT_SUPP)
+			if (le2cpu32 (sb->s_feature_incompat) & ~(EXT2_FEATURE_INCOMPAT_SUPP | EXT2_FEATURE_INCOMPAT_RO))
 			{
 				ALERT (("Ext2-FS [%c]: couldn't mount because of "
 					"unsupported optional features.", drv+'A'));
@@ -260,13 +276,23 @@ read_ext2_sb_info (ushort drv)
 				goto leave;
 			}
 			
+			if ((le2cpu32 (sb->s_feature_incompat) & EXT4_FEATURE_INCOMPAT_64BIT)
+				&& sb->s_blocks_count_hi)
+			{
+				ALERT (("Ext2-FS [%c]: couldn't mount, filesystem "
+					"too large.", drv+'A'));
+				
+				goto leave;
+			}
+			
 			if (!BIO_WP_CHECK (di) &&
-				(le2cpu32 (sb->s_feature_ro_compat) & ~EXT2_FEATURE_RO_COMPAT_SUPP))
+				((le2cpu32 (sb->s_feature_ro_compat) & ~EXT2_FEATURE_RO_COMPAT_SUPP)
+				 || (le2cpu32 (sb->s_feature_incompat) & EXT2_FEATURE_INCOMPAT_RO)))
 			{
-				ALERT (("Ext2-FS [%c]: couldn't mount RDWR because of "
+				ALERT (("Ext2-FS [%c]: mounting read-only because of "
 					"unsupported optional features.", drv+'A'));
 				
-				goto leave;
+				readonly = 1;
 			}
 			
 		}
@@ -429,6 +455,29 @@ read_ext2_sb_info (ushort drv)
 		s->sbi.s_prealloc_blocks	= sb->s_prealloc_blocks;
 		s->sbi.s_prealloc_dir_blocks	= sb->s_prealloc_dir_blocks;
 		
+		/* hash-indexed directories
+		 */
+		for (i = 0; i < 4; i++)
+			s->sbi.s_hash_seed[i] = le2cpu32 (sb->s_hash_seed[i]);
+		s->sbi.s_def_hash_version	= sb->s_def_hash_version;
+		s->sbi.s_hash_unsigned		= (le2cpu32 (sb->s_flags) & EXT2_FLAGS_UNSIGNED_HASH) ? 3 : 0;
+		
+		s->sbi.s_desc_size = sizeof (ext2_gd);
+		if (s->sbi.s_feature_incompat & EXT4_FEATURE_INCOMPAT_64BIT)
+		{
+			s->sbi.s_desc_size = le2cpu16 (sb->s_desc_size);
+			
+			if ((s->sbi.s_desc_size < sizeof (ext2_gd)) ||
+			     !is_power_of_2 (s->sbi.s_desc_size))
+			{
+				ALERT (("Ext2-FS [%c]: unsupported group descriptor size: %d",
+					drv+'A', s->sbi.s_desc_size));
+				
+				kfree (s, sizeof (*s));
+				goto leave;
+			}
+		}
+		
 		
 		/* setup calculated values
 		 */
@@ -445,13 +494,13 @@ read_ext2_sb_info (ushort drv)
 		s->sbi.s_frags_per_block /= s->sbi.s_fragsize;
 		
 		s->sbi.s_inodes_per_block  = s->sbi.s_blocksize;
-		s->sbi.s_inodes_per_block /= sizeof (ext2_in);
+		s->sbi.s_inodes_per_block /= s->sbi.s_inode_size;
 		
 		s->sbi.s_itb_per_group  = s->sbi.s_inodes_per_group;
 		s->sbi.s_itb_per_group /= s->sbi.s_inodes_per_block;
 		
 		s->sbi.s_desc_per_block  = s->sbi.s_blocksize;
-		s->sbi.s_desc_per_block /= sizeof (ext2_gd);
+		s->sbi.s_desc_per_block /= s->sbi.s_desc_size;
 		s->sbi.s_desc_per_block_bits = _log2 (s->sbi.s_desc_per_block);
 		s->sbi.s_desc_per_block_mask = s->sbi.s_desc_per_block - 1;
 		
@@ -533,7 +582,8 @@ read_ext2_sb_info (ushort drv)
 		/* load group descriptor blocks
 		 */
 		
-		s->sbi.s_group_desc_size = s->sbi.s_db_per_group * 2 * sizeof (void *);
+		/* the Orlov debts share the allocation of the pointers */
+		s->sbi.s_group_desc_size = s->sbi.s_db_per_group * 2 * sizeof (void *) + s->sbi.s_groups_count;
 		s->sbi.s_group_desc = kmalloc (s->sbi.s_group_desc_size);
 		if (!s->sbi.s_group_desc)
 		{
@@ -544,6 +594,9 @@ read_ext2_sb_info (ushort drv)
 		}
 		
 		s->sbi.s_group_desc_units = (UNIT **) (s->sbi.s_group_desc + s->sbi.s_db_per_group);
+		s->sbi.s_debts = (__u8 *) (s->sbi.s_group_desc_units + s->sbi.s_db_per_group);
+		bzero (s->sbi.s_debts, s->sbi.s_groups_count);
+		s->sbi.s_da_reserved = 0;
 		
 		for (i = 0; i < s->sbi.s_db_per_group; i++)
 		{
@@ -566,11 +619,12 @@ read_ext2_sb_info (ushort drv)
 		
 		s->sbi.s_dirty = 0;
 		s->sbi.s_mount_opt = 0;
+		set_opt (s->sbi.s_mount_opt, DELALLOC);
 		
 		if (!(le2cpu16 (sb->s_state) & EXT2_VALID_FS) || (le2cpu16 (sb->s_state) & EXT2_ERROR_FS))
 			s->s_flags |= S_NOT_CLEAN_MOUNTED;
 		
-		if (BIO_WP_CHECK (di))
+		if (BIO_WP_CHECK (di) || readonly)
 			s->s_flags |= MS_RDONLY;
 		
 		DEBUG (("Ext2-FS: s->sbi.s_inodes_count = %ld", s->sbi.s_inodes_count));
@@ -637,6 +691,19 @@ read_ext2_sb_info (ushort drv)
 		}
 		
 		
+		/* replay and start the journal
+		 */
+		if (ext2_journal_load (s))
+		{
+			DEBUG (("Ext2-FS: read_ext2_sb_info: ext2_journal_load fail"));
+			
+			kfree (s->sbi.s_group_desc, s->sbi.s_group_desc_size);
+			kfree (s, sizeof (*s));
+			
+			goto leave;
+		}
+		
+		
 		/* read root cookie
 		 */
 		i = get_cookie (s, EXT2_ROOT_INO, &(s->root));
@@ -644,6 +711,7 @@ read_ext2_sb_info (ushort drv)
 		{
 			DEBUG (("Ext2-FS: read_ext2_sb_info: read root inode fail"));
 			
+			ext2_journal_drop (s);
 			kfree (s->sbi.s_group_desc, s->sbi.s_group_desc_size);
 			kfree (s, sizeof (*s));
 			
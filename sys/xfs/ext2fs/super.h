@@ -53,8 +53,8 @@ ext2_get_group_desc (SI *s, register ulong group, UNIT **u)
 	
 	if (u) *u = s->sbi.s_group_desc_units [group_desc];
 	
-	gd  = s->sbi.s_group_desc [group_desc];
-	gd += group & EXT2_DESC_PER_BLOCK_MASK (s);
+	gd = (ext2_gd *) ((char *) s->sbi.s_group_desc [group_desc]
+		+ (group & EXT2_DESC_PER_BLOCK_MASK (s)) * s->sbi.s_desc_size);
 	
 	return gd;
 }
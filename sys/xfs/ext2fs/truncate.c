@@ -31,6 +31,7 @@
 
 # include "balloc.h"
 # include "inode.h"
+# include "journal.h"
 
 
 INLINE void
@@ -44,7 +45,7 @@ clear_entry (COOKIE *inode, ulong block, ulong offset)
 		if (u)
 		{
 			*((__u32 *) u->data + offset) = 0;
-			bio_MARK_MODIFIED (&bio, u);
+			ext2_mark_modified (inode->s, u);
 		}
 		else
 		{
@@ -240,7 +241,7 @@ trunc_indirect (COOKIE *inode, long offset, ulong parent, ulong parent_offset)
 		tmp = le2cpu32 (*ind);
 		
 		*ind = 0;
-		bio_MARK_MODIFIED (&bio, u);
+		ext2_mark_modified (inode->s, u);
 		
 		inode->in.i_blocks = cpu2le32 (le2cpu32 (inode->in.i_blocks) - blocks);
 		mark_inode_dirty (inode);
@@ -386,9 +387,21 @@ ext2_truncate (COOKIE *inode, unsigned long newsize)
 	if (!(EXT2_ISREG (i_mode) || EXT2_ISDIR (i_mode) || EXT2_ISLNK (i_mode)))
 		return;
 	
+	/* delayed blocks behind the new end are simply forgotten */
+	if (inode->i_da_count)
+	{
+		if (newsize <= (inode->i_da_lblk << EXT2_BLOCK_SIZE_BITS (inode->s)))
+			ext2_da_drop (inode);
+		else
+			ext2_da_flush (inode);
+	}
+	
 	inode->in.i_size = cpu2le32 (newsize);
 	mark_inode_dirty (inode);
 	
+	pc_inval (inode->s, inode->inode, newsize, -1);
+	ext2_bmap_inval (inode);
+	
 	ext2_discard_prealloc (inode);
 	
 	/* do truncation
@@ -413,7 +426,7 @@ ext2_truncate (COOKIE *inode, unsigned long newsize)
 		if (u)
 		{
 			bzero (u->data + offset, EXT2_BLOCK_SIZE (inode->s) - offset);
-			bio_MARK_MODIFIED (&bio, u);
+			ext2_mark_data (inode->s, u);
 		}
 	}
 	
@@ -36,6 +36,7 @@
 #include "mint/stat.h"
 
 #include "isofs.h"
+#include "isofs_dir.h"
 #include "isofs_rrip.h"
 #include "metados.h"
 
@@ -168,7 +169,6 @@ static FILESYS ftab =
 	 */
 	FS_CASESENSITIVE	|
 	FS_LONGPATH		|
-	FS_NO_C_CACHE		|
 	FS_OWN_MEDIACHANGE	|
 //	FS_REENTRANT_L1		|
 //	FS_REENTRANT_L2		|
@@ -226,6 +226,12 @@ static DEVDRV devtab =
 /****************************************************************************/
 /* BEGIN global data definition & access implementation */
 
+/* the mounted medium and the index of its directories; the cookies
+ * point to DNODEs, which stay valid as long as the mount
+ */
+static struct iso_super *isosuper = NULL;
+static DNODE *isoroot = NULL;
+
 /* END global data & access implementation */
 /****************************************************************************/
 
@@ -558,7 +564,13 @@ iso_mountfs(void)
 	}
 
 	super = kmalloc(sizeof(*super));
+	if (!super)
+	{
+		r = ENOMEM;
+		goto out;
+	}
 	bzero(super, sizeof(*super));
+	super->di = di;
 
 	r = iso_makemp(super, u_pri, &ext_attr_length);
 	if (r)
@@ -593,8 +605,8 @@ iso_mountfs(void)
 		bio.rel_resident(u);
 	}
 
-	/* Check the Joliet Extension support */
-	if (u_sup)
+	/* Check the Joliet Extension support, Rock Ridge names are better */
+	if (u_sup && super->rr_skip < 0)
 	{
 		sup = (struct iso_supplementary_descriptor *)u_sup->data;
 		joliet_level = 0;
@@ -640,7 +652,15 @@ iso_mountfs(void)
 	DEBUG(("isofs: rr_skip             %li",  super->rr_skip));
 	DEBUG(("isofs: rr_skip0            %li",  super->rr_skip0));
 
-//	return 0;
+	isoroot = iso_dir_root(super);
+	if (!isoroot)
+	{
+		r = ENOMEM;
+		goto out;
+	}
+
+	isosuper = super;
+	return 0;
 
 out:
 	if (u_pri) bio.rel_resident(u_pri);
@@ -659,9 +679,6 @@ out:
 static long _cdecl
 isofs_root(int drv, fcookie *fc)
 {
-//	SI *s = super [drv];
-	long r;
-	
 	DEBUG(("isofs[%c]: isofs_root enter (mem = %li)", drv+'A', memory));
 	
 	if (drv != isofs_dev)
@@ -670,29 +687,22 @@ isofs_root(int drv, fcookie *fc)
 		return ENXIO;
 	}
 	
-	r = iso_mountfs();
-	
-	DEBUG(("iso_mountfs() -> %li", r));
-	return ENXIO;
-	
-//	if (!s)
+	if (!isosuper)
 	{
-		long i = EMEDIUMTYPE;
+		long r;
 		
-//		i = read_sb_info(drv);
-		if (i)
+		r = iso_mountfs();
+		if (r)
 		{
-			DEBUG(("isofs[%c]: e_root leave failure", drv+'A'));
-			return i;
+			DEBUG(("isofs[%c]: e_root leave failure (%li)", drv+'A', r));
+			return r;
 		}
-		
-//		s = super [drv];
 	}
 	
 	fc->fs = &ftab;
 	fc->dev = drv;
 	fc->aux = 0;
-//	fc->index = (long) s->root; s->root->links++;
+	fc->index = (long) isoroot;
 	
 	DEBUG(("isofs[%c]: e_root leave ok (mem = %li)", drv+'A', memory));
 	return E_OK;
@@ -701,8 +711,9 @@ isofs_root(int drv, fcookie *fc)
 static long _cdecl
 isofs_lookup(fcookie *dir, const char *name, fcookie *fc)
 {
-//	COOKIE *c = (COOKIE *) dir->index;
-//	SI *s = super [dir->dev];
+	DNODE *d = (DNODE *) dir->index;
+	DNODE *e;
+	long r;
 	
 	DEBUG(("isofs[%c]: isofs_lookup (%s)", dir->dev+'A', name));
 	
@@ -711,8 +722,6 @@ isofs_lookup(fcookie *dir, const char *name, fcookie *fc)
 	/* 1 - itself */
 	if (!*name || (name [0] == '.' && name [1] == '\0'))
 	{	
-//		c->links++;
-	
 		DEBUG(("isofs[%c]: isofs_lookup: leave ok, (name = \".\")", dir->dev+'A'));
 		return E_OK;
 	}
@@ -720,19 +729,26 @@ isofs_lookup(fcookie *dir, const char *name, fcookie *fc)
 	/* 2 - parent dir */
 	if (name [0] == '.' && name [1] == '.' && name [2] == '\0')
 	{
-//		if (dir == rootcookie)
-//		{
-//			DEBUG(("isofs[%c]: isofs_lookup: leave ok, EMOUNT, (name = \"..\")", dir->dev+'A'));
-//			return EMOUNT;
-//		}
+		if (!d->parent)
+		{
+			DEBUG(("isofs[%c]: isofs_lookup: leave ok, EMOUNT, (name = \"..\")", dir->dev+'A'));
+			return EMOUNT;
+		}
+		
+		fc->index = (long) d->parent;
+		return E_OK;
 	}
 	
-	/* 3 - normal entry */
+	/* 3 - normal entry, from the directory index */
+	r = iso_dir_lookup(isosuper, d, name, &e);
+	if (r)
 	{
-//		if (not found)
-			return ENOENT;
+		DEBUG(("isofs[%c]: isofs_lookup: leave failure (%li)", dir->dev+'A', r));
+		return r;
 	}
 	
+	fc->index = (long) e;
+	
 	DEBUG(("isofs[%c]: isofs_lookup: leave ok", dir->dev+'A'));
 	return E_OK;
 }
@@ -750,23 +766,31 @@ isofs_getdev(fcookie *fc, long *devsp)
 static long _cdecl
 isofs_getxattr(fcookie *fc, XATTR *xattr)
 {
-	return ENOSYS;
-	
-# if 0
-	xattr->mode			= 
-	xattr->index			= 
-	xattr->dev			= 
-	xattr->rdev 			= 
-	xattr->nlink			= 
-	xattr->uid			= 
-	xattr->gid			= 
-	xattr->size 			= 
-	xattr->blksize			= 
-	xattr->nblocks			= /* number of blocks of size 'blksize' */
-	*((long *) &(xattr->mtime))	= 
-	*((long *) &(xattr->atime))	= 
-	*((long *) &(xattr->ctime))	= 
-# endif
+	DNODE *d = (DNODE *) fc->index;
+	
+	xattr->mode			= d->mode;
+	xattr->index			= (long) d;
+	xattr->dev			= fc->dev;
+	xattr->rdev 			= fc->dev;
+	xattr->nlink			= d->nlink;
+	xattr->uid			= d->uid;
+	xattr->gid			= d->gid;
+	xattr->size 			= d->size;
+	xattr->blksize			= isosuper->logical_block_size;
+	xattr->nblocks			= (d->size + xattr->blksize - 1) >> isosuper->im_bshift;
+	
+	if (native_utc)
+	{
+		SET_XATTR_TD(xattr,m,d->mtime);
+		SET_XATTR_TD(xattr,a,d->mtime);
+		SET_XATTR_TD(xattr,c,d->mtime);
+	}
+	else
+	{
+		SET_XATTR_TD(xattr,m,dostime(d->mtime));
+		SET_XATTR_TD(xattr,a,dostime(d->mtime));
+		SET_XATTR_TD(xattr,c,dostime(d->mtime));
+	}
 	
 	/* fake attr field a little bit */
 	if (S_ISDIR(xattr->mode))
@@ -782,8 +806,32 @@ isofs_getxattr(fcookie *fc, XATTR *xattr)
 static long _cdecl
 isofs_stat64(fcookie *fc, STAT *stat)
 {
-	/* later */
-	return ENOSYS;
+	DNODE *d = (DNODE *) fc->index;
+	
+	stat->dev		= fc->dev;
+	stat->ino		= (long) d;
+	stat->mode		= d->mode;
+	stat->nlink		= d->nlink;
+	stat->uid		= d->uid;
+	stat->gid		= d->gid;
+	stat->rdev		= fc->dev;
+	
+	stat->atime.high_time	= 0;
+	stat->atime.time	= d->mtime;
+	stat->atime.nanoseconds	= 0;
+	
+	stat->mtime		= stat->atime;
+	stat->ctime		= stat->atime;
+	
+	stat->size		= d->size;
+	stat->blocks		= (d->size + 511) >> 9;
+	stat->blksize		= isosuper->logical_block_size;
+	stat->flags		= 0;
+	stat->gen		= 0;
+	
+	bzero(stat->res, sizeof(stat->res));
+	
+	return E_OK;
 }
 
 static long _cdecl
@@ -838,18 +886,44 @@ isofs_remove(fcookie *dir, const char *name)
 static long _cdecl
 isofs_getname(fcookie *root, fcookie *dir, char *pathname, int size)
 {
+	DNODE *r = (DNODE *) root->index;
+	DNODE *d = (DNODE *) dir->index;
+	long len = 0;
+	DNODE *p;
+	char *s;
+	
 	DEBUG(("isofs_getname enter"));
 	
-	pathname [0] = '\0';
+	/* the length of the path first, then fill it in from the end */
+	for (p = d; p && p != r; p = p->parent)
+		len += p->namelen + 1;
 	
+	if (p != r)
 	{
-		;
+		pathname [0] = '\0';
+		
+		DEBUG(("isofs_getname: path not found?"));
+		return ENOTDIR;
+	}
+	
+	if (len >= size)
+	{
+		DEBUG(("isofs_getname: name too long"));
+		return EBADARG;
 	}
 	
-	pathname [0] = '\0';
+	s = pathname + len;
+	*s = '\0';
 	
-	DEBUG(("isofs_getname: path not found?"));
-	return ENOTDIR;
+	for (p = d; p != r; p = p->parent)
+	{
+		s -= p->namelen;
+		memcpy(s, p->name, p->namelen);
+		*--s = '\\';
+	}
+	
+	DEBUG(("isofs_getname: leave ok (%s)", pathname));
+	return E_OK;
 }
 
 static long _cdecl
@@ -862,12 +936,19 @@ isofs_rename(fcookie *olddir, char *oldname, fcookie *newdir, const char *newnam
 static long _cdecl
 isofs_opendir(DIR *dirh, int flags)
 {
-//	if (!S_ISDIR(...))
+	DNODE *d = (DNODE *) dirh->fc.index;
+	long r;
+	
+	if (!S_ISDIR(d->mode))
 	{
 		DEBUG(("isofs_opendir: dir not a DIR!"));
 		return EACCES;
 	}
 	
+	r = iso_dir_index(isosuper, d);
+	if (r)
+		return r;
+	
 	dirh->index = 0;
 	return E_OK;
 }
@@ -875,22 +956,41 @@ isofs_opendir(DIR *dirh, int flags)
 static long _cdecl
 isofs_readdir(DIR *dirh, char *nm, int nmlen, fcookie *fc)
 {
-	long ret = ENMFILES;
+	DNODE *d = (DNODE *) dirh->fc.index;
+	DNODE *e;
+	
+	if (!d->dir || dirh->index >= d->dir->count)
+		return ENMFILES;
+	
+	e = d->dir->entries[dirh->index++];
 	
+	if ((dirh->flags & TOS_SEARCH) == 0)
 	{
-		;
+		long index = (long) e;
+		
+		if (nmlen < 5)
+			return EBADARG;
+		
+		/* nm may be odd */
+		memcpy(nm, &index, 4);
+		nmlen -= 4;
+		nm += 4;
 	}
 	
-	return ret;
+	if (e->namelen >= nmlen)
+		return EBADARG;
+	
+	strcpy(nm, e->name);
+	
+	*fc = dirh->fc;
+	fc->index = (long) e;
+	
+	return E_OK;
 }
 
 static long _cdecl
 isofs_rewinddir(DIR *dirh)
 {
-	{
-		;
-	}
-	
 	dirh->index = 0;
 	return E_OK;
 }
@@ -898,10 +998,7 @@ isofs_rewinddir(DIR *dirh)
 static long _cdecl
 isofs_closedir(DIR *dirh)
 {
-	{
-		;
-	}
-		
+	/* the index stays for the next one */
 	dirh->index = 0;
 	return E_OK;
 }
@@ -915,7 +1012,7 @@ isofs_pathconf(fcookie *dir, int which)
 		case DP_IOPEN:		return UNLIMITED;
 		case DP_MAXLINKS:	return UNLIMITED;
 		case DP_PATHMAX:	return UNLIMITED;
-		case DP_NAMEMAX:	return 255;		/* correct me */
+		case DP_NAMEMAX:	return ISO_NAMEMAX;
 		case DP_ATOMIC:		return 1024;		/* correct me */
 		case DP_TRUNC:		return DP_NOTRUNC;
 		case DP_CASE:		return DP_CASEINSENS;	/* correct me */
@@ -1096,11 +1193,11 @@ isofs_sync(void)
 static long _cdecl
 isofs_open(FILEPTR *f)
 {
-//	COOKIE *c = (COOKIE *) f->fc.index;
+	DNODE *d = (DNODE *) f->fc.index;
 	
 	DEBUG(("isofs_open: enter"));
 	
-//	if (!S_ISREG(...))
+	if (!S_ISREG(d->mode))
 	{
 		DEBUG(("isofs_open: leave failure, not a valid file"));
 		return EACCES;
@@ -1139,13 +1236,47 @@ isofs_write(FILEPTR *f, const char *buf, long bytes)
 static long _cdecl
 isofs_read(FILEPTR *f, char *buf, long bytes)
 {
-	return 0;
+	DNODE *d = (DNODE *) f->fc.index;
+	long bsize = isosuper->logical_block_size;
+	long todo;
+	
+	if (f->pos >= d->size)
+		return 0;
+	
+	if (bytes > d->size - f->pos)
+		bytes = d->size - f->pos;
+	
+	todo = bytes;
+	while (todo > 0)
+	{
+		long offset = f->pos & isosuper->im_bmask;
+		long n = bsize - offset;
+		UNIT *u;
+		
+		if (n > todo)
+			n = todo;
+		
+		u = bio.read(isosuper->di, d->extent + (f->pos >> isosuper->im_bshift), bsize);
+		if (!u)
+		{
+			DEBUG(("isofs_read: bio.read failed"));
+			break;
+		}
+		
+		memcpy(buf, u->data + offset, n);
+		
+		buf += n;
+		f->pos += n;
+		todo -= n;
+	}
+	
+	return bytes - todo;
 }
 
 static long _cdecl
 isofs_lseek(FILEPTR *f, long where, int whence)
 {
-//	COOKIE *c = (COOKIE *) f->fc.index;
+	DNODE *d = (DNODE *) f->fc.index;
 	
 	DEBUG(("isofs_lseek: enter (where = %li, whence = %i)", where, whence));
 	
@@ -1153,11 +1284,11 @@ isofs_lseek(FILEPTR *f, long where, int whence)
 	{
 		case SEEK_SET:				break;
 		case SEEK_CUR:	where += f->pos;	break;
-//		case SEEK_END:	where += c->stat.size;	break;
+		case SEEK_END:	where += d->size;	break;
 		default:	return EINVAL;
 	}
 	
-//	if (where < 0)
+	if (where < 0)
 	{
 		DEBUG(("isofs_lseek: leave failure EBADARG (where = %li)", where));
 		return EBADARG;
@@ -1172,7 +1303,7 @@ isofs_lseek(FILEPTR *f, long where, int whence)
 static long _cdecl
 isofs_ioctl(FILEPTR *f, int mode, void *buf)
 {
-//	COOKIE *c = (COOKIE *) f->fc.index;
+	DNODE *d = (DNODE *) f->fc.index;
 	
 	DEBUG(("isofs_ioctl: enter (mode = %i)", mode));
 	
@@ -1180,7 +1311,7 @@ isofs_ioctl(FILEPTR *f, int mode, void *buf)
 	{
 		case FIONREAD:
 		{
-			*(long *) buf = 0; //c->stat.size - f->pos;
+			*(long *) buf = d->size - f->pos;
 			return E_OK;
 		}
 		case FIONWRITE:
@@ -1324,12 +1455,15 @@ isofs_ioctl(FILEPTR *f, int mode, void *buf)
 static long _cdecl
 isofs_datime(FILEPTR *f, ushort *time, int flag)
 {
-//	COOKIE *c = (COOKIE *) f->fc.index;
+	DNODE *d = (DNODE *) f->fc.index;
 	
 	switch (flag)
 	{
 		case 0:
-//			*(ulong *) time = c->stat.mtime.time;
+			if (native_utc)
+				*(long *) time = d->mtime;
+			else
+				*(long *) time = dostime(d->mtime);
 			break;
 		
 		case 1:
@@ -0,0 +1,461 @@
+/*
+ * This file belongs to FreeMiNT. It's not in the original MiNT 1.12
+ * distribution. See the file CHANGES for a detailed log of changes.
+ *
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This file is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *
+ * Please send suggestions, patches or bug reports to me or
+ * the MiNT mailing list.
+ *
+ */
+
+/*
+ * File : isofs_dir.c
+ *         per mount index of the directories
+ *
+ * A directory is read once, on the first lookup or readdir in it. All its
+ * entries are kept with their resolved names (Rock Ridge NM, Joliet or
+ * plain ISO 9660), extent, size and attributes, so that later lookups,
+ * readdirs and stats do not touch the medium again. The medium is
+ * read-only; the index lives until the file system is unmounted.
+ */
+
+#include "isofs_dir.h"
+
+#include "mint/stat.h"
+
+#include "isofs_rrip.h"
+#include "isofs_util.h"
+
+
+static ulong
+hash_name(const char *name)
+{
+	ulong h = 0;
+	
+	/* case folded, so that case insensitive lookups hit the same chain */
+	while (*name)
+	{
+		char c = *name++;
+		
+		h = (h << 5) + h + (uchar) TOLOWER(c);
+	}
+	
+	return h ^ (h >> 16);
+}
+
+/* convert a 7 byte directory record time stamp to unix time */
+static long
+iso_time7(const uchar *p)
+{
+	long y = p[0] + 1900L;
+	long m = p[1];
+	long days;
+	
+	if (m < 1 || m > 12)
+		return 0;
+	
+	/* count the years from March on, so that the leap day is last */
+	if (m <= 2)
+	{
+		y--;
+		m += 12;
+	}
+	
+	days = 365 * y + y / 4 - y / 100 + y / 400 + (153 * (m - 3) + 2) / 5 + p[2] - 719469L;
+	
+	/* p[6] is the offset from GMT in 15 minute steps */
+	return ((days * 24 + p[3]) * 60 + p[4]) * 60 + p[5] - (signed char) p[6] * 15L * 60;
+}
+
+/* the POSIX file type bits of a Rock Ridge PX field to MiNT's */
+static ushort
+rr_mode(ulong mode)
+{
+	ushort m = mode & 07777;
+	
+	switch (mode & 0170000)
+	{
+		case 0040000:	return m | S_IFDIR;
+		case 0120000:	return m | S_IFLNK;
+		case 0060000:	return m | S_IFBLK;
+		case 0020000:	return m | S_IFCHR;
+		case 0010000:	return m | S_IFIFO;
+		case 0140000:	return m | S_IFSOCK;
+	}
+	
+	return m | S_IFREG;
+}
+
+static DNODE *
+new_dnode(DNODE *parent, const char *name, long namelen)
+{
+	DNODE *d;
+	
+	d = kmalloc(sizeof(*d) + namelen);
+	if (d)
+	{
+		bzero(d, sizeof(*d));
+		d->parent = parent;
+		d->namelen = namelen;
+		memcpy(d->name, name, namelen);
+		d->name[namelen] = '\0';
+	}
+	
+	return d;
+}
+
+/* take over the attributes of a directory record */
+static void
+set_attr(struct iso_super *super, DNODE *d, struct iso_directory_record *ep)
+{
+	d->extent = isonum_733(ep->extent) + isonum_711((uchar *) ep->ext_attr_length);
+	d->size = isonum_733(ep->size);
+	d->mtime = iso_time7((uchar *) ep->date);
+	d->nlink = 1;
+	
+	if (isonum_711((uchar *) ep->flags) & 2)
+	{
+		d->mode = S_IFDIR | 0555;
+		d->nlink = 2;
+	}
+	else
+		d->mode = S_IFREG | 0444;
+	
+	if (super->rr_skip >= 0)
+	{
+		struct iso_rr_attr rr;
+		
+		if (cd9660_rrip_getattr(ep, &rr, super))
+		{
+			d->mode = rr_mode(rr.mode);
+			d->uid = rr.uid;
+			d->gid = rr.gid;
+			d->nlink = rr.links;
+		}
+	}
+}
+
+DNODE *
+iso_dir_root(struct iso_super *super)
+{
+	DNODE *d;
+	
+	d = new_dnode(NULL, "", 0);
+	if (d)
+	{
+		set_attr(super, d, (struct iso_directory_record *) super->root);
+		d->mode = (d->mode & ~S_IFMT) | S_IFDIR;
+	}
+	
+	return d;
+}
+
+static long
+add_entry(ISO_DIR *dir, DNODE *d)
+{
+	if (dir->count == dir->max)
+	{
+		long max = dir->max ? dir->max * 2 : 32;
+		DNODE **e;
+		
+		e = kmalloc(max * sizeof(*e));
+		if (!e)
+			return ENOMEM;
+		
+		if (dir->entries)
+		{
+			memcpy(e, dir->entries, dir->count * sizeof(*e));
+			kfree(dir->entries, dir->max * sizeof(*e));
+		}
+		
+		dir->entries = e;
+		dir->max = max;
+	}
+	
+	dir->entries[dir->count++] = d;
+	return 0;
+}
+
+/* the hash table is sized once all entries are known */
+static long
+hash_entries(ISO_DIR *dir)
+{
+	ulong n = 8;
+	long i;
+	
+	while (n < dir->count && n < 4096)
+		n <<= 1;
+	
+	dir->hash = kmalloc(n * sizeof(*dir->hash));
+	if (!dir->hash)
+		return ENOMEM;
+	
+	bzero(dir->hash, n * sizeof(*dir->hash));
+	dir->hmask = n - 1;
+	
+	for (i = 0; i < dir->count; i++)
+	{
+		DNODE *d = dir->entries[i];
+		DNODE **chain = &dir->hash[hash_name(d->name) & dir->hmask];
+		
+		d->next = *chain;
+		*chain = d;
+	}
+	
+	return 0;
+}
+
+/* A Rock Ridge child link: the entry stands for a directory that was
+ * moved elsewhere to keep the tree within 8 levels. Its size is in the
+ * '.' record at the start of the real extent.
+ */
+static void
+child_link(struct iso_super *super, DNODE *d, ulong blk)
+{
+	UNIT *u;
+	
+	d->extent = blk;
+	d->mode = (d->mode & ~S_IFMT) | S_IFDIR;
+	
+	u = bio.read(super->di, blk, super->logical_block_size);
+	if (u)
+		d->size = isonum_733(((struct iso_directory_record *) u->data)->size);
+}
+
+/* read a directory record name into `name', returns its length or -1 if
+ * the entry is to be left out
+ */
+static long
+entry_name(struct iso_super *super, struct iso_directory_record *ep, char *name, ulong *clink)
+{
+	long namelen = isonum_711((uchar *) ep->name_len);
+	ushort len = 0;
+	
+	/* '.' and '..' */
+	if (namelen == 1 && (ep->name[0] == 0 || ep->name[0] == 1))
+		return -1;
+	
+	*clink = 0;
+	
+	if (super->rr_skip >= 0)
+	{
+		ino_t ino = 0;
+		long r;
+		
+		r = cd9660_rrip_getname(ep, name, &len, &ino, super);
+		
+		/* relocated directories show up through their child link */
+		if (r & ISO_SUSP_RELDIR)
+			return -1;
+		
+		if (r & ISO_SUSP_CLINK)
+			*clink = ino >> super->im_bshift;
+	}
+	else
+		isofntrans((uchar *) ep->name, namelen, (uchar *) name, &len,
+			   0, super->im_joliet_level == 0,
+			   isonum_711((uchar *) ep->flags) & 4,
+			   super->im_joliet_level);
+	
+	if (len == 0)
+		return -1;
+	
+	name[len] = '\0';
+	return len;
+}
+
+static long
+build_index(struct iso_super *super, DNODE *parent, ISO_DIR *dir)
+{
+	long bsize = super->logical_block_size;
+	ulong blocks = (parent->size + bsize - 1) >> super->im_bshift;
+	char name[ISO_NAMEMAX + 1];
+	DNODE *multi = NULL;
+	char *buf;
+	ulong i;
+	long r = 0;
+	
+	/* the Rock Ridge code may read continuation blocks, so work on a
+	 * copy of the directory block
+	 */
+	buf = kmalloc(bsize);
+	if (!buf)
+		return ENOMEM;
+	
+	for (i = 0; i < blocks && r == 0; i++)
+	{
+		long off = 0;
+		UNIT *u;
+		
+		u = bio.read(super->di, parent->extent + i, bsize);
+		if (!u)
+		{
+			r = EREAD;
+			break;
+		}
+		
+		memcpy(buf, u->data, bsize);
+		
+		while (off + ISO_DIRECTORY_RECORD_SIZE <= bsize)
+		{
+			struct iso_directory_record *ep = (struct iso_directory_record *)(buf + off);
+			long reclen = isonum_711((uchar *) ep->length);
+			long namelen;
+			ulong clink;
+			DNODE *d;
+			
+			/* records do not cross blocks; the rest is padding */
+			if (reclen < ISO_DIRECTORY_RECORD_SIZE || off + reclen > bsize)
+				break;
+			
+			off += reclen;
+			
+			/* a file in several extents has a record for each, only
+			 * the first one is kept and the sizes are added
+			 */
+			if (multi)
+			{
+				multi->size += isonum_733(ep->size);
+				if (!(isonum_711((uchar *) ep->flags) & 0x80))
+					multi = NULL;
+				continue;
+			}
+			
+			namelen = entry_name(super, ep, name, &clink);
+			if (namelen < 0)
+				continue;
+			
+			d = new_dnode(parent, name, namelen);
+			if (!d)
+			{
+				r = ENOMEM;
+				break;
+			}
+			
+			set_attr(super, d, ep);
+			if (clink)
+				child_link(super, d, clink);
+			
+			if (isonum_711((uchar *) ep->flags) & 0x80)
+				multi = d;
+			
+			r = add_entry(dir, d);
+			if (r)
+			{
+				kfree(d, sizeof(*d) + d->namelen);
+				break;
+			}
+		}
+	}
+	
+	kfree(buf, bsize);
+	
+	if (r == 0)
+		r = hash_entries(dir);
+	
+	return r;
+}
+
+static void
+free_index(ISO_DIR *dir)
+{
+	long i;
+	
+	for (i = 0; i < dir->count; i++)
+		iso_dir_free(dir->entries[i]);
+	
+	if (dir->entries)
+		kfree(dir->entries, dir->max * sizeof(*dir->entries));
+	if (dir->hash)
+		kfree(dir->hash, (dir->hmask + 1) * sizeof(*dir->hash));
+	
+	kfree(dir, sizeof(*dir));
+}
+
+/* make sure the index of directory `d' is there */
+long
+iso_dir_index(struct iso_super *super, DNODE *d)
+{
+	ISO_DIR *dir;
+	long r;
+	
+	if (!S_ISDIR(d->mode))
+		return ENOTDIR;
+	
+	if (d->dir)
+		return 0;
+	
+	dir = kmalloc(sizeof(*dir));
+	if (!dir)
+		return ENOMEM;
+	
+	bzero(dir, sizeof(*dir));
+	
+	r = build_index(super, d, dir);
+	if (r)
+	{
+		DEBUG(("iso_dir_index(%s): failed -> %li", d->name, r));
+		
+		free_index(dir);
+		return r;
+	}
+	
+	DEBUG(("iso_dir_index(%s): %li entries", d->name, dir->count));
+	
+	d->dir = dir;
+	return 0;
+}
+
+long
+iso_dir_lookup(struct iso_super *super, DNODE *d, const char *name, DNODE **found)
+{
+	DNODE *e;
+	long r;
+	
+	r = iso_dir_index(super, d);
+	if (r)
+		return r;
+	
+	for (e = d->dir->hash[hash_name(name) & d->dir->hmask]; e; e = e->next)
+	{
+		/* plain ISO 9660 names are upper case on the medium */
+		if (super->rr_skip < 0 && super->im_joliet_level == 0)
+		{
+			if (stricmp(name, e->name) == 0)
+				break;
+		}
+		else if (strcmp(name, e->name) == 0)
+			break;
+	}
+	
+	if (!e)
+		return ENOENT;
+	
+	*found = e;
+	return 0;
+}
+
+/* free `d' with everything below it */
+void
+iso_dir_free(DNODE *d)
+{
+	if (d->dir)
+		free_index(d->dir);
+	
+	kfree(d, sizeof(*d) + d->namelen);
+}
@@ -0,0 +1,77 @@
+/*
+ * This file belongs to FreeMiNT. It's not in the original MiNT 1.12
+ * distribution. See the file CHANGES for a detailed log of changes.
+ *
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This file is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *
+ * Please send suggestions, patches or bug reports to me or
+ * the MiNT mailing list.
+ *
+ */
+
+/*
+ * File : isofs_dir.h
+ *         per mount index of the directories
+ */
+
+#ifndef _isofs_dir_h
+#define _isofs_dir_h
+
+#include "isofs_global.h"
+
+
+typedef struct iso_dnode DNODE;
+typedef struct iso_dir ISO_DIR;
+
+/* One entry of a directory. The medium is read-only, so the entries
+ * stay valid as long as the mount and serve as the file cookies.
+ */
+struct iso_dnode
+{
+	DNODE	*next;		/* hash chain in the parent's index */
+	DNODE	*parent;	/* NULL for the root */
+	ISO_DIR	*dir;		/* index of a directory, built on first use */
+	ulong	extent;		/* first logical block of the data */
+	ulong	size;		/* bytes */
+	long	mtime;		/* unix time */
+	ushort	mode;		/* MiNT mode */
+	ushort	nlink;
+	ushort	uid;
+	ushort	gid;
+	ushort	namelen;
+	char	name[1];	/* the resolved name, '\0' terminated */
+};
+
+/* all entries of a directory, in the order on the medium for readdir and
+ * hashed by name for lookup
+ */
+struct iso_dir
+{
+	long	count;
+	long	max;		/* allocated size of entries */
+	DNODE	**entries;
+	ulong	hmask;		/* number of hash chains - 1 */
+	DNODE	**hash;
+};
+
+
+DNODE *	iso_dir_root	(struct iso_super *super);
+long	iso_dir_index	(struct iso_super *super, DNODE *d);
+long	iso_dir_lookup	(struct iso_super *super, DNODE *d, const char *name, DNODE **found);
+void	iso_dir_free	(DNODE *d);
+
+#endif /* _isofs_dir_h */
@@ -29,6 +29,13 @@
 #ifndef _isofs_global_h
 #define _isofs_global_h
 
+#ifdef ISO_HOST
+
+/* tools/isocheck runs the directory code on the host */
+#include "isohost.h"
+
+#else
+
 #include "mint/mint.h"
 
 #include "libkern/libkern.h"
@@ -36,9 +43,6 @@
 #include "mint/proc.h"
 #include "mint/time.h"
 
-#include "iso.h"
-#include "iso_rrip.h"
-
 
 /* debug section
  */
@@ -165,6 +169,14 @@ update_lastlookup(COOKIE *c, const char *name, long namelen)
 	}
 }
 
+#endif /* ISO_HOST */
+
+#include "iso.h"
+#include "iso_rrip.h"
+
+/* longest file name, Rock Ridge names included */
+#define ISO_NAMEMAX	255
+
 enum ISO_TYPE
 {
 	ISO_TYPE_DEFAULT,
@@ -195,6 +195,8 @@ cd9660_rrip_slink(void *v, ISO_RRIP_ANALYZE *ana)
 	return 0;
 }
 
+#endif
+
 /*
  * Alternate name
  */
@@ -222,9 +224,7 @@ cd9660_rrip_altname(void *v, ISO_RRIP_ANALYZE *ana)
 		break;
 		
 	case ISO_SUSP_CFLAG_HOST:
-		/* Inserting hostname i.e. "kurt.tools.de" */
-		inbuf = hostname;
-		wlen = hostnamelen;
+		/* hostname i.e. "kurt.tools.de", the kernel has none */
 		break;
 		
 	case ISO_SUSP_CFLAG_CONTINUE:
@@ -237,7 +237,7 @@ cd9660_rrip_altname(void *v, ISO_RRIP_ANALYZE *ana)
 		break;
 		
 	default:
-		prlongf("RRIP with incorrect NM flags?\n");
+		DEBUG(("RRIP with incorrect NM flags?"));
 		wlen = ana->maxlen + 1;
 		break;
 	}
@@ -310,6 +310,7 @@ cd9660_rrip_reldir(void *v, ISO_RRIP_ANALYZE *ana)
 	    | ISO_SUSP_CLINK | ISO_SUSP_PLINK;
 }
 
+#if 0
 static long
 cd9660_rrip_tstamp(void *v, ISO_RRIP_ANALYZE *ana)
 {
@@ -394,6 +395,8 @@ cd9660_rrip_device(void *v, ISO_RRIP_ANALYZE *ana)
 	return ISO_SUSP_DEVICE;
 }
 
+#endif
+
 /*
  * Flag indicating
  */
@@ -409,7 +412,6 @@ cd9660_rrip_idflag(void *v, ISO_RRIP_ANALYZE *ana)
 	
 	return ISO_SUSP_IDFLAG;
 }
-#endif
 
 /*
  * Continuation polonger
@@ -572,6 +574,8 @@ cd9660_rrip_analyze(struct iso_directory_record *isodir,
 	return cd9660_rrip_loop(isodir, &analyze, rrip_table_analyze);
 }
 
+#endif
+
 /* 
  * Get Alternate Name.
  */
@@ -589,7 +593,7 @@ static const RRIP_TABLE rrip_table_getname[] =
 
 long
 cd9660_rrip_getname(struct iso_directory_record *isodir,
-		    char *outbuf, ushort outlen, ino_t *inump, struct iso_super *super)
+		    char *outbuf, ushort *outlen, ino_t *inump, struct iso_super *super)
 {
 	ISO_RRIP_ANALYZE analyze;
 	const RRIP_TABLE *tab;
@@ -597,7 +601,7 @@ cd9660_rrip_getname(struct iso_directory_record *isodir,
 	
 	analyze.outbuf = outbuf;
 	analyze.outlen = outlen;
-	analyze.maxlen = NAME_MAX;
+	analyze.maxlen = ISO_NAMEMAX;
 	analyze.inump = inump;
 	analyze.super = super;
 	analyze.fields = ISO_SUSP_ALTNAME | ISO_SUSP_RELDIR | ISO_SUSP_CLINK | ISO_SUSP_PLINK;
@@ -616,6 +620,45 @@ cd9660_rrip_getname(struct iso_directory_record *isodir,
 	return cd9660_rrip_loop(isodir, &analyze, tab);
 }
 
+/*
+ * POSIX file attributes only, for the directory index
+ */
+static long
+cd9660_rrip_pxattr(void *v, ISO_RRIP_ANALYZE *ana)
+{
+	ISO_RRIP_ATTR *p = v;
+
+	ana->attr->mode = isonum_733(p->mode);
+	ana->attr->uid = isonum_733(p->uid);
+	ana->attr->gid = isonum_733(p->gid);
+	ana->attr->links = isonum_733(p->links);
+	ana->fields &= ~ISO_SUSP_ATTR;
+	return ISO_SUSP_ATTR;
+}
+
+static const RRIP_TABLE rrip_table_getattr[] =
+{
+	{ "PX", cd9660_rrip_pxattr,	0,			ISO_SUSP_ATTR },
+	{ "RR", cd9660_rrip_idflag,	0,			ISO_SUSP_IDFLAG },
+	{ "CE", cd9660_rrip_cont,	0,			ISO_SUSP_CONT },
+	{ "ST", cd9660_rrip_stop,	0,			ISO_SUSP_STOP },
+	{ "",	0,			0,			0 }
+};
+
+long
+cd9660_rrip_getattr(struct iso_directory_record *isodir,
+		    struct iso_rr_attr *attr, struct iso_super *super)
+{
+	ISO_RRIP_ANALYZE analyze;
+
+	analyze.attr = attr;
+	analyze.super = super;
+	analyze.fields = ISO_SUSP_ATTR;
+
+	return cd9660_rrip_loop(isodir, &analyze, rrip_table_getattr) & ISO_SUSP_ATTR;
+}
+
+#if 0
 /* 
  * Get Symbolic Link.
  */
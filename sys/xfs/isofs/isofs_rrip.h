@@ -28,8 +28,18 @@ typedef u_int32_t daddr_t;
 typedef u_int32_t off_t;
 typedef u_int32_t ino_t;
 
+/* the PX field of an entry */
+struct iso_rr_attr
+{
+	ulong	mode;		/* POSIX mode */
+	ulong	uid;
+	ulong	gid;
+	ulong	links;
+};
+
 typedef struct {
 	struct iso_node	*inop;
+	struct iso_rr_attr *attr;	/* PX output */
 	long		fields;		/* interesting fields in this analysis */
 	daddr_t		iso_ce_blk;	/* block of continuation area */
 	off_t		iso_ce_off;	/* offset of continuation area */
@@ -49,6 +59,9 @@ long cd9660_rrip_getname(struct iso_directory_record *isodir,
 			 char *outbuf, ushort *outlen,
 			 ino_t *inump, struct iso_super *super);
 
+long cd9660_rrip_getattr(struct iso_directory_record *isodir,
+			 struct iso_rr_attr *attr, struct iso_super *super);
+
 long cd9660_rrip_getsymname(struct iso_directory_record *isodir,
 			    char *outbuf, ushort *outlen,
 			    struct iso_super *super);
@@ -11,6 +11,8 @@
 
 # include "bitmap.h"
 
+# include "zone.h"
+
 
 static long	alloc_bit	(ushort *buf, long num, long last);
 static long	free_bit	(ushort *buf, long bitnum);
@@ -147,6 +149,9 @@ free_zone (ushort drive, long zone)
 	save = zone + 1 - psblk->sblk->s_firstdatazn;
 	ret = free_bit (psblk->zbitmap, save);
 	
+	/* the zone map may hold this zone */
+	psblk->zgen++;
+	
 	/* Mark zone bitmap as dirty */
 	psblk->zdirty = 1;
 	if (save < psblk->zlast)
@@ -192,6 +197,10 @@ free_inode (ushort drive, ushort inum)
 	SI *psblk = super_ptr[drive];
 	long ret;
 	
+	/* the inode number may come back with another file */
+	pc_inval (psblk, inum, 0, -1);
+	zmap_inval (drive, inum);
+	
 	ret = free_bit (psblk->ibitmap, inum);
 	if (inum < psblk->ilast)
 	{
@@ -63,6 +63,14 @@ current_time (void)
 }
 # define CURRENT_TIME	current_time ()
 
+/* the file data page cache of the kernel is optional;
+ * files are keyed by super info and inode number
+ */
+# define PCACHE_OK	(KERNEL->pagecache != NULL)
+
+# define pc_inval(s, ino, pos, len) \
+	do { if (PCACHE_OK) pcache.invalidate (s, ino, pos, len); } while (0)
+
 
 /* error UNIT */
 extern UNIT error;
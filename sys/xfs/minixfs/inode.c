@@ -375,6 +375,8 @@ itruncate (unsigned int inum, ushort drive, long int length)
 	trunc_inode (&rip, drive, count, 1);
 	rip.i_size = length;	
 	
+	pc_inval (super_ptr [drive], inum, length, -1);
+	
 	write_inode (inum, &rip, drive);
 	
 	return 0;
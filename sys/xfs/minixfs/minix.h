@@ -176,6 +176,7 @@ struct super_info
 	
 	long	ilast;	/* search start for free inodes */
 	long	zlast;	/* search start for free zones */
+	long	zgen;	/* bumped whenever zones are freed */
 	
 	UNIT	*sunit;	/* actual super block */
 	
@@ -236,10 +236,15 @@ __next (FILEPTR *f, d_inode *rip, long chunk, short mode)
 	f_cache *fch = (f_cache *) f->devinfo;
 	register long znew = 0;
 	
-	if (mode == READ && ((chunk >= fch->fzone) && (chunk < fch->lzone)))
-		znew = fch->zones[chunk - fch->fzone];
-	
-	if (!znew)
+	if (mode == READ)
+	{
+		if ((chunk >= fch->fzone) && (chunk < fch->lzone))
+			znew = fch->zones[chunk - fch->fzone];
+		
+		if (!znew)
+			znew = map_zone (f->fc.index, rip, chunk, f->fc.dev);
+	}
+	else
 		znew = find_zone (rip, chunk, f->fc.dev, mode);
 	
 	return znew;
@@ -290,6 +295,8 @@ __fio (FILEPTR *f, char *buf, long len, short mode)
 	long chunk;
 	long todo = len;	/* Characters remaining */
 	long done = 0;		/* processed characters */
+	long start = f->pos;	/* first byte not from the page cache */
+	char *startbuf = buf;
 	
 	if (len <= 0)
 	{
@@ -326,6 +333,21 @@ __fio (FILEPTR *f, char *buf, long len, short mode)
 	if (todo <= 0)
 		return 0;
 	
+	/* cached file data doesn't need the zone lookups */
+	if (mode == READ && PCACHE_OK)
+	{
+		done = pcache.read (super_ptr [f->fc.dev], f->fc.index, f->pos, buf, todo);
+		buf += done;
+		todo -= done;
+		f->pos += done;
+		
+		if (todo == 0)
+			goto out;
+	}
+	
+	start = f->pos;
+	startbuf = buf;
+	
 	chunk = f->pos >> L_BS;
 	
 	/* Every PRE_READ blocks, try to read in PRE_READ zones into cache */
@@ -333,7 +355,7 @@ __fio (FILEPTR *f, char *buf, long len, short mode)
 	{
 		long i;
 		for (i = 0; i < PRE_READ; i++)
-			fch->zones[i] = find_zone (&rip, i + chunk, f->fc.dev, 0);
+			fch->zones[i] = map_zone (f->fc.index, &rip, i + chunk, f->fc.dev);
 		
 		bio.pre_read (super_ptr[f->fc.dev]->di, (ulong *)fch->zones, PRE_READ, BLOCK_SIZE);
 		
@@ -472,7 +494,18 @@ cont:
 			}
 	}
 	
+	if (mode == READ && PCACHE_OK)
+		pcache.fill (super_ptr [f->fc.dev], f->fc.index, start, startbuf, f->pos - start, rip.i_size);
+	
 out:
+	/* also after a failure, some blocks may be written */
+	if (mode == WRITE && f->pos > start)
+		pc_inval (super_ptr [f->fc.dev], f->fc.index, start, f->pos - start);
+	
+	/* holes may be filled now */
+	if (mode == WRITE)
+		zmap_inval (f->fc.dev, f->fc.index);
+	
 	if (!(f->flags & O_NOATIME))
 		__update_rip (f->fc.index, &rip, f->fc.dev, f->pos, mode);
 	
@@ -747,7 +780,7 @@ m_ioctl (FILEPTR *f, int mode, void *buf)
 			read_inode (f->fc.index, &rip, f->fc.dev);
 			
 			block = *(long *) buf;
-			*(long *) buf = find_zone (&rip, block, f->fc.dev, 0);
+			*(long *) buf = map_zone (f->fc.index, &rip, block, f->fc.dev);
 			
 			return E_OK;
 		}
@@ -1637,6 +1637,10 @@ m_dskchng (int drv, int mode)
 	s->idirty =	0;
 	s->zdirty = 0;
 	
+	/* clear file data cache */
+	pc_inval (s, PC_ALLFILES, 0, -1);
+	zmap_inval (drv, 0);
+	
 	
 	/* free the DI (invalidate also the cache units) */
 	bio.free_di (s->di);
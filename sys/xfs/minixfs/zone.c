@@ -270,6 +270,160 @@ new_zone:
 	return temp_zone;
 }
 
+/* The zone map
+ * 
+ * find_zone() walks the indirection blocks for every zone it is asked
+ * for, so reading a large file sequentially fetches the same indirection
+ * block again for each of its zones. The zone map keeps copies of the
+ * most recently used indirection blocks per (drive, inode). An entry
+ * becomes stale when zones of the drive are freed (zgen changes) or when
+ * the file is written to (zmap_inval), as that may fill holes.
+ */
+
+typedef struct zmap ZMAP;
+struct zmap
+{
+	ZMAP	*next;			/* LRU chain */
+	ushort	drive;
+	ushort	inum;			/* 0 = unused */
+	long	zgen;			/* super_ptr[drive]->zgen when filled */
+	long	first;			/* chunk number of zones[0] */
+	long	zones[NR_INDIRECTS2];	/* copy of the indirection block */
+};
+
+static ZMAP zmap_tab [ZMAP_ENTRIES];
+static ZMAP *zmap_head = NULL;
+
+/* Find the indirection block that holds the zone number of chunk 'numr'
+ * without allocating anything; returns 0 for a hole and the first chunk
+ * the block maps in 'first'.
+ */
+
+static long
+ind_zone (d_inode *rip, long numr, int drive, long *first)
+{
+	long zone;
+	
+	numr -= NR_DZONE_NUM2;
+	if (numr < NR_INDIRECTS2)
+	{
+		*first = NR_DZONE_NUM2;
+		return rip->i_zone[7];
+	}
+	
+	numr -= NR_INDIRECTS2;
+	if (numr < NR_INDIRECTS2 * NR_INDIRECTS2)
+	{
+		*first = NR_DBL2 + (numr & ~(NR_INDIRECTS2 - 1));
+		
+		zone = rip->i_zone[8];
+		if (zone)
+			zone = ((bufr *) cget_zone (zone, drive)->data)->bind[numr >> LNR_IND2];
+		
+		return zone;
+	}
+	
+	numr -= NR_INDIRECTS2 * NR_INDIRECTS2;
+	*first = NR_DBL2 + NR_INDIRECTS2 * NR_INDIRECTS2 + (numr & ~(NR_INDIRECTS2 - 1));
+	
+	zone = rip->i_zone[9];
+	if (zone)
+		zone = ((bufr *) cget_zone (zone, drive)->data)->bind[numr >> (LNR_IND2 * 2)];
+	if (zone)
+		zone = ((bufr *) cget_zone (zone, drive)->data)->bind[(numr >> LNR_IND2) & (NR_INDIRECTS2 - 1)];
+	
+	return zone;
+}
+
+/* Like find_zone (rip, numr, drive, 0), but through the zone map.
+ */
+
+long
+map_zone (ushort inum, d_inode *rip, long numr, int drive)
+{
+	SI *psblk = super_ptr[drive];
+	ZMAP *z, **prev;
+	long ind, first;
+	
+	/* Past EOF ? */
+	if (numr * BLOCK_SIZE >= rip->i_size)
+		return 0;
+	
+	/* Zone in inode ? */
+	if (numr < NR_DZONE_NUM2)
+		return rip->i_zone[numr];
+	
+	if (!zmap_head)
+	{
+		int i;
+		
+		for (i = 0; i < ZMAP_ENTRIES - 1; i++)
+			zmap_tab[i].next = &zmap_tab[i + 1];
+		
+		zmap_head = zmap_tab;
+	}
+	
+	for (prev = &zmap_head; ; prev = &z->next)
+	{
+		z = *prev;
+		
+		if (z->inum == inum && z->drive == drive && z->zgen == psblk->zgen
+			&& numr >= z->first && numr < z->first + NR_INDIRECTS2)
+		{
+			break;
+		}
+		
+		if (!z->next)
+		{
+			/* not mapped, reuse the least recently used entry */
+			ind = ind_zone (rip, numr, drive, &first);
+			if (ind)
+			{
+				UNIT *u = bio.read (psblk->di, ind, BLOCK_SIZE);
+				if (!u)
+				{
+					z->inum = 0;
+					return 0;
+				}
+				
+				bcopy (u->data, z->zones, BLOCK_SIZE);
+			}
+			else
+				bzero (z->zones, BLOCK_SIZE);
+			
+			z->drive = drive;
+			z->inum = inum;
+			z->zgen = psblk->zgen;
+			z->first = first;
+			break;
+		}
+	}
+	
+	/* move to front */
+	*prev = z->next;
+	z->next = zmap_head;
+	zmap_head = z;
+	
+	return z->zones[numr - z->first];
+}
+
+/* Forget the zone map of an inode, or of the whole drive if inum is 0.
+ */
+
+void
+zmap_inval (ushort drive, ushort inum)
+{
+	int i;
+	
+	for (i = 0; i < ZMAP_ENTRIES; i++)
+	{
+		ZMAP *z = &zmap_tab[i];
+		
+		if (z->drive == drive && (!inum || z->inum == inum))
+			z->inum = 0;
+	}
+}
+
 /* This reads zone number 'numr' of an inode .
  * It returns the actual number of valid characters in 'numr' , this is only
  * used for directories so it is hard-coded for the system cache. 
@@ -317,6 +471,39 @@ l_write (ushort inum, long pos, long len, const void *buf, int drive)
 		zoff = pos & (BLOCK_SIZE - 1);		/* Current zone position */
 		wleft = MIN (BLOCK_SIZE - zoff, left);	/* Left to write in curr blk */	
 		
+		if (!zoff && left >= BLOCK_SIZE)
+		{
+			/* whole zones, write contiguous runs in one go */
+			long zones = 1;
+			long data;
+			
+			zne = find_zone (&rip, chunk++, drive, 1);
+			if (zne == 0) break;				/* Partition full */
+			
+			while ((zones + 1) * BLOCK_SIZE <= left
+				&& zones < MAX_RWS / (BLOCK_SIZE / 512))
+			{
+				long znext = find_zone (&rip, chunk, drive, 1);
+				if (znext != zne + zones)
+					break;
+				
+				zones++;
+				chunk++;
+			}
+			
+			if (zones > 1)
+				write_zones (zne, zones, (void *) p, drive);
+			else
+				write_zone (zne, (void *) p, drive);
+			
+			data = zones * BLOCK_SIZE;
+			pos += data;
+			p += data;
+			if (pos > rip.i_size) rip.i_size = pos;
+			left -= data;
+			continue;
+		}
+		
 		if (zoff || ((left < BLOCK_SIZE) && (pos + left < rip.i_size)))
 		{
 			zne = find_zone (&rip, chunk++, drive, 2);	/* Current zone in file */
@@ -340,5 +527,8 @@ l_write (ushort inum, long pos, long len, const void *buf, int drive)
 	rip.i_mtime = CURRENT_TIME;
 	write_inode (inum, &rip, drive);
 	
+	/* holes may be filled now */
+	zmap_inval (drive, inum);
+	
 	return len - left;
 }
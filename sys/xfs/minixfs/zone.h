@@ -22,6 +22,8 @@ UNIT *	cget_zone	(long num, int drive);
 UNIT *	cput_zone	(long num, int drive);
 
 long	find_zone	(d_inode *rip, long numr, int drive, int flag);
+long	map_zone	(ushort inum, d_inode *rip, long numr, int drive);
+void	zmap_inval	(ushort drive, ushort inum);
 int	next_zone	(d_inode *rip, long numr);
 
 long	l_write		(ushort inum, long pos, long len, const void *buf, int drive);
@@ -16,8 +16,14 @@
 
 /*
  * File:  cache.c
- *        a small cache for lookup operations which occur very frequently
+ *        a small cache for lookup operations which occur very frequently,
+ *        and the lifetime of the cached attributes
  *
+ * The names are kept in hash chains over the directory and the name
+ * folded to lower case, so that lookups from the TOS domain, which
+ * compare without case, find the same entries. All entries live for
+ * NFS_CACHE_EXPIRE ticks and are also kept in a list in the order they
+ * were added, which is the order in which they expire.
  */
 
 # include "cache.h"
@@ -26,25 +32,92 @@
 # include "nfsutil.h"
 
 
-typedef struct
+typedef struct nfs_lookup_cache NFS_LOOKUP_CACHE;
+struct nfs_lookup_cache
 {
+	NFS_LOOKUP_CACHE *hnext;	/* next in the hash chain */
+	NFS_LOOKUP_CACHE *older;	/* neighbours in the age list */
+	NFS_LOOKUP_CACHE *younger;
+	NFS_LOOKUP_CACHE **chain;	/* the hash chain it is in */
 	NFS_INDEX *dir;
 	char *name;
 	NFS_INDEX *index;
 	long expiration;
-} NFS_LOOKUP_CACHE;
+};
 
 
 static NFS_LOOKUP_CACHE nfs_cache[LOOKUP_CACHE_SIZE];
+static NFS_LOOKUP_CACHE *hash_table[LOOKUP_HASH_SIZE];
 
+static NFS_LOOKUP_CACHE *oldest = NULL;
+static NFS_LOOKUP_CACHE *youngest = NULL;
+static NFS_LOOKUP_CACHE *free_list = NULL;
 
+static struct nfs_cachestat counters;
 
-/* Delete the i-th entry in the lookup cache, so that it can be reused.
+
+void
+nfs_cache_init (void)
+{
+	long i;
+	
+	for (i = 0;  i < LOOKUP_CACHE_SIZE;  i++)
+	{
+		nfs_cache[i].hnext = free_list;
+		free_list = &nfs_cache[i];
+	}
+}
+
+static NFS_LOOKUP_CACHE **
+hash_chain (NFS_INDEX *dir, const char *name)
+{
+	ulong h = (ulong) dir;
+	
+	while (*name)
+	{
+		char c = *name++;
+		
+		h = (h << 5) + h + (uchar) TOLOWER (c);
+	}
+	
+	h ^= h >> 16;
+	return &hash_table[h & (LOOKUP_HASH_SIZE - 1)];
+}
+
+
+/* Delete an entry in the lookup cache, so that it can be reused.
  */
 static void
-nfs_cache_del (int i)
+nfs_cache_del (NFS_LOOKUP_CACHE *e)
 {
-	NFS_INDEX *ni = nfs_cache[i].index;
+	NFS_INDEX *ni = e->index;
+	NFS_LOOKUP_CACHE **pp;
+	
+	for (pp = e->chain; *pp; pp = &(*pp)->hnext)
+	{
+		if (*pp == e)
+		{
+			*pp = e->hnext;
+			break;
+		}
+	}
+	
+	if (e->older)
+		e->older->younger = e->younger;
+	else
+		oldest = e->younger;
+	
+	if (e->younger)
+		e->younger->older = e->older;
+	else
+		youngest = e->older;
+	
+	e->dir = NULL;
+	e->name = NULL;
+	e->index = NULL;
+	e->hnext = free_list;
+	free_list = e;
+	counters.lookup_entries--;
 	
 	if (ni != NULL)
 	{
@@ -57,10 +130,6 @@ nfs_cache_del (int i)
 		if (0 == ni->link)
 			free_slot (ni);
 	}
-	
-	nfs_cache[i].dir = NULL;
-	nfs_cache[i].name = NULL;
-	nfs_cache[i].index = NULL;
 }
 
 
@@ -71,11 +140,9 @@ void
 nfs_cache_expire (void)
 {
 	long stamp = get_timestamp ();
-	long i;
 	
-	for (i = 0;  i < LOOKUP_CACHE_SIZE;  i++)
-		if (nfs_cache[i].expiration < stamp)
-			nfs_cache_del(i);
+	while (oldest && oldest->expiration < stamp)
+		nfs_cache_del (oldest);
 }
 
 
@@ -86,79 +153,49 @@ nfs_cache_expire (void)
 NFS_INDEX *
 nfs_cache_lookup (NFS_INDEX *dir, const char *name, int dom)
 {
-	long i, eq;
+	NFS_LOOKUP_CACHE *e;
+	long eq;
 	
-	for (i = 0;  i < LOOKUP_CACHE_SIZE; i++)
+	for (e = *hash_chain (dir, name); e; e = e->hnext)
 	{
-		if (dir == nfs_cache[i].dir)
+		if (dir == e->dir)
 		{
 			if (0 == dom)
-				eq = stricmp (name, nfs_cache[i].name);
+				eq = stricmp (name, e->name);
 			else
-				eq = strcmp (name, nfs_cache[i].name);
+				eq = strcmp (name, e->name);
 			
 			if (!eq)
 			{
 				/* BUG: should we set a new expiration time?? */
-				return nfs_cache[i].index;
+				counters.lookup_hits++;
+				return e->index;
 			}
 		}
 	}
 	
+	counters.lookup_misses++;
 	return NULL;
 }
 
 
 /* Add a given index to the lookup cache. The directory this file is in is
  * given in dir, so that we can search for it later.
- * Look through all the cache entries to find a free one; if there is no,
- * take the least recently used one.
+ * Expired entries are dropped first; if there is still no free entry,
+ * the oldest one is taken.
  */
 int
-nfs_cache_add(NFS_INDEX *dir, NFS_INDEX *index)
+nfs_cache_add (NFS_INDEX *dir, NFS_INDEX *index)
 {
-	long i, least;
-	long least_ac, next_expire, now;
+	NFS_LOOKUP_CACHE *e;
 	
-	least = 0;
-	now = get_timestamp ();
+	nfs_cache_expire ();
 	
-	next_expire = least_ac = now + NFS_CACHE_EXPIRE;
-	for (i = 0;  i < LOOKUP_CACHE_SIZE;  i++)
-	{
-		/* look for an unused entry
-		 */
-		if (NULL == nfs_cache[i].dir)
-		{
-			least = i;
-			break;
-		}
-		
-		/* also look for the least recently added entry
-		 */
-		if (nfs_cache[i].expiration < least_ac)
-		{
-			least = i;
-			least_ac = nfs_cache[i].expiration;
-		}
-		
-		/* if the expiration time is over, free and reuse the entry
-		 */
-		if (nfs_cache[i].expiration < now)
-		{
-			nfs_cache_del (i);
-			least = i;
-		}
-	}
+	if (!free_list)
+		nfs_cache_del (oldest);
 	
-	/* free the entry if necessary
-	 */
-	if (nfs_cache[least].dir)
-		nfs_cache_del (least);
-	
-	/* BUG: if the cache entry was not in use, set a timeout for the expire
-	 *      function
-	 */
+	e = free_list;
+	free_list = e->hnext;
 	
 	/* this index is once more in use
 	 */
@@ -166,64 +203,145 @@ nfs_cache_add(NFS_INDEX *dir, NFS_INDEX *index)
 	
 	/* set up cache entry
 	 */
-	nfs_cache[least].dir = dir;
-	nfs_cache[least].index = index;
-	nfs_cache[least].name = index->name;
-	nfs_cache[least].expiration = next_expire;
+	e->dir = dir;
+	e->index = index;
+	e->name = index->name;
+	e->expiration = get_timestamp () + NFS_CACHE_EXPIRE;
+	
+	e->chain = hash_chain (dir, e->name);
+	e->hnext = *e->chain;
+	*e->chain = e;
+	
+	e->younger = NULL;
+	e->older = youngest;
+	if (youngest)
+		youngest->younger = e;
+	else
+		oldest = e;
+	youngest = e;
 	
+	counters.lookup_entries++;
 	return 0;
 }
 
 int
 nfs_cache_remove (NFS_INDEX *ni)
 {
-	long i, n;
+	NFS_LOOKUP_CACHE *e;
 	
-	n = -1;
-	for (i = 0;  i < LOOKUP_CACHE_SIZE; i++)
+	for (e = oldest; e; e = e->younger)
 	{
-		if (ni == nfs_cache[i].index)
+		if (ni == e->index)
 		{
-			n = i;				
+			nfs_cache_del (e);
 			break;
 		}
 	}
 	
-	if (n != -1)
-	{
-		nfs_cache_del (n);
-# if 0
-		ni->link -= 1;
-		nfs_cache[i].dir = NULL;
-		nfs_cache[i].name = NULL;
-		nfs_cache[i].index = NULL;
-		
-		return 1;
-# endif
-	}
-	
 	return 0;
 }
 
 int
 nfs_cache_removebyname (NFS_INDEX *parent, const char *name)
 {
-	long i, n;
+	NFS_LOOKUP_CACHE *e, *found = NULL;
 	
-	n = -1;
-	for (i = 0;  i < LOOKUP_CACHE_SIZE;  i++)
+	for (e = *hash_chain (parent, name); e; e = e->hnext)
 	{
-		if (nfs_cache[i].dir == parent)
+		if (e->dir == parent)
 		{
-			if (!strcmp (name, nfs_cache[i].name))
-				n = i;
+			if (!strcmp (name, e->name))
+				found = e;
 		}
 	}
 	
-	if (n != -1)
-		nfs_cache_del (n);
+	if (found)
+		nfs_cache_del (found);
 	else
 		return 1;
 	
 	return 0;
 }
+
+
+/* Attributes are trusted for ni->actime ticks after they arrived. The
+ * lifetime starts at acregmin (acdirmin for directories) and is doubled
+ * every time the server sends the same attributes again, up to
+ * acregmax; a change sets it back. Files that are being worked on are
+ * checked often, trees that nobody touches hardly ever.
+ */
+static void
+ac_bounds (NFS_INDEX *ni, long *min, long *max)
+{
+	if ((ni->attr.mode & S_IFMT) == S_IFDIR)
+	{
+		*min = ni->opt->acdirmin;
+		*max = ni->opt->acdirmax;
+	}
+	else
+	{
+		*min = ni->opt->acregmin;
+		*max = ni->opt->acregmax;
+	}
+}
+
+/* are the attributes in `ni' still good? */
+int
+nfs_attr_valid (NFS_INDEX *ni)
+{
+	long min, max, actime;
+	
+	if (!(ni->opt->flags & OPT_NOAC))
+	{
+		ac_bounds (ni, &min, &max);
+		
+		actime = ni->actime ? ni->actime : min;
+		if (after (ni->stamp + actime, get_timestamp ()))
+		{
+			counters.attr_hits++;
+			return 1;
+		}
+	}
+	
+	counters.attr_misses++;
+	return 0;
+}
+
+/* adapt the lifetime after the attributes were fetched again because
+ * the old ones in `old' had expired
+ */
+void
+nfs_attr_refreshed (NFS_INDEX *ni, XATTR *old)
+{
+	long min, max;
+	
+	ac_bounds (ni, &min, &max);
+	
+	if (old->mtime == ni->attr.mtime && old->mdate == ni->attr.mdate
+	    && old->size == ni->attr.size)
+	{
+		ni->actime = ni->actime ? (ni->actime << 1) : (min << 1);
+		if (ni->actime > max)
+			ni->actime = max;
+	}
+	else
+	{
+		counters.attr_changed++;
+		ni->actime = min;
+	}
+}
+
+/* make sure the attributes are fetched on the next access */
+void
+nfs_attr_expire (NFS_INDEX *ni)
+{
+	long max = MAX (ni->opt->acregmax, ni->opt->acdirmax);
+	
+	ni->stamp = get_timestamp () - max - 1;
+}
+
+void
+nfs_cache_stat (struct nfs_cachestat *st)
+{
+	*st = counters;
+}
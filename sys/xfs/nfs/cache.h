@@ -25,6 +25,12 @@ void nfs_cache_expire (void);
 int nfs_cache_add (NFS_INDEX *dir, NFS_INDEX *index);
 int nfs_cache_remove (NFS_INDEX *ni);
 int nfs_cache_removebyname (NFS_INDEX *parent, const char *name);
+void nfs_cache_init (void);
+void nfs_cache_stat (struct nfs_cachestat *st);
+
+int nfs_attr_valid (NFS_INDEX *ni);
+void nfs_attr_refreshed (NFS_INDEX *ni, XATTR *old);
+void nfs_attr_expire (NFS_INDEX *ni);
 
 
 # endif /* _cache_h */
@@ -33,13 +33,47 @@
 #define DEFAULT_PORT   2049
 
 
-/* 200 Hz ticks before invalidating xattr struct in index structure */
-#define DEFAULT_ACTIMEO  6000   /* 30 seconds */
+/* 200 Hz ticks before invalidating xattr struct in index structure;
+ * the lifetime starts at the minimum and doubles each time the server
+ * reports the same attributes again, up to the maximum
+ */
+#define DEFAULT_ACREGMIN   600   /* 3 seconds */
+#define DEFAULT_ACREGMAX 12000   /* 60 seconds */
+#define DEFAULT_ACDIRMIN  6000   /* 30 seconds */
+#define DEFAULT_ACDIRMAX 12000   /* 60 seconds */
 
 
 #define DEFAULT_RSIZE 4096 
 #define DEFAULT_WSIZE 4096 
 
+/* NFS version 3 mounts; at most NFS3_MAXDATA */
+#define DEFAULT_RSIZE3 32768
+#define DEFAULT_WSIZE3 32768
+
+/* socket buffer sizes; big enough for a full size version 3 READ reply,
+ * the network stack clamps this to its maximum
+ */
+#define RPC_SOCKBUF   65535L
+
+/* Transfers are split into several READs or WRITEs that are sent without
+ * waiting for the replies. At most RPC_MAXPIPE of them are in flight,
+ * and for READs only as many as their replies fit into the socket
+ * buffer; RPC_REPLY_SLACK is the room for the headers of a reply.
+ */
+#define RPC_MAXPIPE        4
+#define RPC_REPLY_SLACK  512L
+
+/* upper limit for the read-ahead and the write-behind buffer of an
+ * open file
+ */
+#define NFS_IOBUF_MAX  65536L
+
+/* version 3 writes of an open file are sent unstable and committed on
+ * close or sync; up to NFS_COMMIT_MAX bytes of them are kept to send
+ * them again if the server restarts before the COMMIT
+ */
+#define NFS_COMMIT_MAX 131072L
+
 
 
 /* To speed up buffer allocation, some space on the stack is used. These
@@ -60,12 +94,19 @@
 #define HARDLNBUFSIZE      128
 #define READBUFSIZE        128
 #define READDIRBUFSIZE     128
+#define NFS3BUFSIZE        256   /* version 3 handles are larger */
+#define IOSLOT_BUFSIZE     128   /* per READ in flight */
 
 #define MAX_RPC_HDR_SIZE   4096  /* FIXME: this value is too small */
 
 /* maximum number of bytes in a reply for nfs_readdir */
 #define MAX_READDIR_LEN    4108	/* value has been increased because of Ubuntu NFS server problems */
 
+/* maximum number of bytes in a READDIRPLUS reply, which also carries
+ * the handles and attributes of the entries
+ */
+#define MAX_READDIRPLUS_LEN  32768
+
 
 
 /* configuration values for the resend code */
@@ -75,7 +116,8 @@
 
 /* config values for the lookup cache */
 #define USE_CACHE         /* use the lookup cache */
-#define LOOKUP_CACHE_SIZE  64
+#define LOOKUP_CACHE_SIZE  256
+#define LOOKUP_HASH_SIZE   64     /* a power of 2 */
 #define NFS_CACHE_EXPIRE  1000   /* 5 seconds */
 
 /* when a process is running in TOS-Domain, convert filenames to
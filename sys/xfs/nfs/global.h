@@ -29,6 +29,7 @@
 /* own default header */
 # include "config.h"
 # include "nfs_xdr.h"
+# include "nfs3_xdr.h"
 
 
 /* debug section
@@ -151,7 +152,8 @@ typedef struct
 	struct sockaddr_in addr;    /* the address of the server */
 	int retrans;  /* number of request retries */
 	long timeo;   /* initial timeout in 1/200 sec */
-	long reserved[4];
+	ulong version;  /* NFS protocol version spoken with the server */
+	long reserved[3];
 	char hostname[256];
 } SERVER_OPT;
 
@@ -165,7 +167,11 @@ struct nfs_mount_opt
 	long	rsize;
 	long	wsize;
 	long	actimeo;	/* attr cache timeout */
-	long	res[8];
+	long	acregmin;	/* bounds of the adaptive attribute */
+	long	acregmax;	/* lifetime for files and directories */
+	long	acdirmin;
+	long	acdirmax;
+	long	res[4];
 };
 
 
@@ -185,9 +191,11 @@ struct nfs_index
 	NFS_MOUNT_OPT *opt;	/* options for this mount and subdirs */
 	INDEX_CLUSTER *cluster;	/* cluster this is in */
 	nfs_fh	handle;		/* file handle for this on the server */
+	nfs_fh3	fh3;		/* the same for NFS version 3 mounts */
 	long	link;		/* no of times this cookie is in use */
 	XATTR	attr;
 	long	stamp;		/* time stamp when this xattr struct was filled */
+	long	actime;		/* how long attr is trusted, 0 for the minimum */
 	struct nfs_index *dir;	/* index of directory this one is in */
 	struct nfs_index *aux;	/* this is used for getname() */
 	struct nfs_index *next;	/* only if too much of these are in use */
@@ -206,12 +214,15 @@ extern NFS_INDEX *mounted;
 extern INDEX_CLUSTER *cluster[MAX_CLUSTER];
 extern NFS_MOUNT_OPT *opt_list;
 
+/* does this index belong to a mount that speaks NFS version 3? */
+# define NFS_V3(ni)	((ni)->opt->server.version == NFS3_VERSION)
 
-# define NFS_MOUNT_VERS  1
+
+# define NFS_MOUNT_VERS  3
 
 typedef struct
 {
-	long	version;	/* version of this structure, currently 1 */
+	long	version;	/* version of this structure, 1 to 3 */
 	nfs_fh	handle;		/* initial file handle from the server's mountd */
 	XATTR	mntattr;	/* not used yet */
 	long	flags;		/* same as NFS_MOUNT_OPT.flags */
@@ -225,11 +236,33 @@ typedef struct
 	
 	struct sockaddr_in server;	/* address of the server */
 	char hostname[256];
+	
+	/* since version 2 of this structure */
+	long	nfsvers;	/* NFS protocol version, 2 or 3 */
+	nfs_fh3	fh3;		/* initial file handle for version 3 */
+	
+	/* since version 3 of this structure; in 1/200 sec, 0 for default */
+	long	acregmin;
+	long	acregmax;
+	long	acdirmin;
+	long	acdirmax;
 } NFS_MOUNT_INFO;
 
 
 # define NFS_MOUNT	(('N'<< 8) | 1)
 # define NFS_UNMOUNT	(('N'<< 8) | 2)
+# define NFS_CACHESTAT	(('N'<< 8) | 3)	/* struct nfs_cachestat */
+
+/* counters of the lookup and attribute caches, since boot */
+struct nfs_cachestat
+{
+	ulong	lookup_hits;
+	ulong	lookup_misses;
+	long	lookup_entries;	/* names in the cache right now */
+	ulong	attr_hits;
+	ulong	attr_misses;
+	ulong	attr_changed;	/* misses that found the attributes changed */
+};
 
 # define NFS_MNTDUMP	(('N'<< 8) | 42)
 # define NFS_DUMPALL	(('N'<< 8) | 43)
@@ -124,7 +124,10 @@ get_mount_slot (const char *name, NFS_MOUNT_INFO *info)
 	
 	DEBUG(("get_mount_slot: for %s (server %s)", name, info->hostname));
 	
-	if (info->version != NFS_MOUNT_VERS)
+	/* version 1 structures come from mount programs that only know
+	 * about NFS version 2
+	 */
+	if (info->version < 1 || info->version > NFS_MOUNT_VERS)
 	{
 		DEBUG(("get_mount_slot: wrong version of mount program!"
 		       " Got %ld, expected %ld", info->version, NFS_MOUNT_VERS));
@@ -182,14 +185,26 @@ get_mount_slot (const char *name, NFS_MOUNT_INFO *info)
 	opt->flags = info->flags;
 	opt->server.flags = info->flags & SERVER_OPTS;
 	opt->server.addr = info->server;
+	opt->server.version = NFS_VERSION;
+	if (info->version >= 2 && info->nfsvers == NFS3_VERSION)
+		opt->server.version = NFS3_VERSION;
 
 	/* set default values */
 	opt->server.addr.sin_port = DEFAULT_PORT;
 	opt->server.retrans = DEFAULT_RETRANS;
 	opt->server.timeo = DEFAULT_TIMEO;
-	opt->actimeo = DEFAULT_ACTIMEO;
+	opt->actimeo = 0;
+	opt->acregmin = DEFAULT_ACREGMIN;
+	opt->acregmax = DEFAULT_ACREGMAX;
+	opt->acdirmin = DEFAULT_ACDIRMIN;
+	opt->acdirmax = DEFAULT_ACDIRMAX;
 	opt->rsize = DEFAULT_RSIZE;
 	opt->wsize = DEFAULT_WSIZE;
+	if (opt->server.version == NFS3_VERSION)
+	{
+		opt->rsize = DEFAULT_RSIZE3;
+		opt->wsize = DEFAULT_WSIZE3;
+	}
 
 	/* look for the optional values from the mount command */
 	if (!(info->flags & OPT_USE_DEFAULTS))
@@ -201,13 +216,34 @@ get_mount_slot (const char *name, NFS_MOUNT_INFO *info)
 		if (info->timeo > 0)
 			opt->server.timeo = info->timeo;
 		if (info->actimeo > 0)
+		{
+			/* a fixed lifetime for all attributes */
 			opt->actimeo = info->actimeo;
+			opt->acregmin = opt->acregmax = info->actimeo;
+			opt->acdirmin = opt->acdirmax = info->actimeo;
+		}
+		if (info->version >= 3)
+		{
+			if (info->acregmin > 0)
+				opt->acregmin = info->acregmin;
+			if (info->acregmax > 0)
+				opt->acregmax = info->acregmax;
+			if (info->acdirmin > 0)
+				opt->acdirmin = info->acdirmin;
+			if (info->acdirmax > 0)
+				opt->acdirmax = info->acdirmax;
+		}
 		if (info->rsize > 0)
 			opt->rsize = info->rsize;
 		if (info->wsize > 0)
 			opt->wsize = info->wsize;
 	}
 	
+	if (opt->acregmax < opt->acregmin)
+		opt->acregmax = opt->acregmin;
+	if (opt->acdirmax < opt->acdirmin)
+		opt->acdirmax = opt->acdirmin;
+	
 	ni->name = kmalloc (strlen (name) + 1);
 	if (!ni->name)
 	{
@@ -226,6 +262,7 @@ get_mount_slot (const char *name, NFS_MOUNT_INFO *info)
 	ni->link = 0;
 	ni->search_val = 0;
 	ni->stamp = 0;
+	ni->actime = 0;
 	init_mount_attr(&ni->attr);
 
 	ni->next = mounted;
@@ -498,6 +535,7 @@ init_slot:
 	ni->attr.nblocks = 0;
 	ni->attr.dev = 0;
 	ni->stamp = 0;
+	ni->actime = 0;
 	
 	return ni;
 }
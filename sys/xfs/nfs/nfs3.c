@@ -0,0 +1,1181 @@
+/*
+ * This file belongs to FreeMiNT. It's not in the original MiNT 1.12
+ * distribution. See the file CHANGES for a detailed log of changes.
+ *
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This file is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *
+ * Please send suggestions, patches or bug reports to me or
+ * the MiNT mailing list.
+ *
+ */
+
+/*
+ * File : nfs3.c
+ *         the NFS version 3 side of the file system and device functions
+ *
+ * The functions in nfssys.c and nfsdev.c do the checks that do not depend
+ * on the protocol and then pass on to these for mounts that speak
+ * version 3. The main differences to version 2 are the 64 bit offsets,
+ * transfers of up to NFS3_MAXDATA bytes, READDIRPLUS which brings the
+ * handles and attributes of all directory entries along, and unstable
+ * writes that are made permanent with a single COMMIT.
+ */
+
+# include "nfs3.h"
+
+# include "mint/emu_tos.h"
+
+# include "cache.h"
+# include "index.h"
+# include "nfsio.h"
+# include "nfssys.h"
+# include "nfsutil.h"
+# include "sock_ipc.h"
+
+
+/* Send one request and decode the reply. Returns 0 on success, the
+ * status of the nfs function has to be checked by the caller.
+ */
+static long
+rpc_call3 (NFS_INDEX *ni, ulong proc, xdrproc_t xargs, void *args, long size,
+           xdrproc_t xres, void *res)
+{
+	char req_buf[NFS3BUFSIZE];
+	MESSAGE *mreq, *mrep, m;
+	xdrs x;
+	long r;
+	
+	mreq = alloc_message (&m, req_buf, NFS3BUFSIZE, size);
+	if (!mreq)
+	{
+		DEBUG (("rpc_call3(%ld): failed to alloc request msg", proc));
+		return ENOMEM;
+	}
+	
+	xdr_init (&x, mreq->data, mreq->data_len, XDR_ENCODE, NULL);
+	if (!(*xargs)(&x, args))
+	{
+		DEBUG (("rpc_call3(%ld): failed to encode arguments", proc));
+		free_message (mreq);
+		return EBADARG;
+	}
+	
+	r = rpc_request (&ni->opt->server, mreq, proc, &mrep);
+	if (r != 0)
+	{
+		DEBUG (("rpc_call3(%ld): couldn't contact server -> %ld", proc, r));
+		return r;
+	}
+	
+	xdr_init (&x, mrep->data, mrep->data_len, XDR_DECODE, NULL);
+	r = (*xres)(&x, res) ? 0 : EBADARG;
+	if (r)
+		DEBUG (("rpc_call3(%ld): couldnt decode results", proc));
+	
+	free_message (mrep);
+	return r;
+}
+
+/* take over the attributes that came along with a reply; if the server
+ * did not send any, make sure they are fetched on the next access
+ */
+static void
+set_attr3 (NFS_INDEX *ni, post_op_attr *ap)
+{
+	if (ap->present)
+	{
+		v3fattr2xattr (&ap->attributes, &ni->attr);
+		ni->stamp = get_timestamp ();
+	}
+	else
+		nfs_attr_expire (ni);
+}
+
+static void
+fill_cookie (fcookie *fc, NFS_INDEX *ni)
+{
+	fc->fs = &nfs_filesys;
+	fc->dev = nfs_dev;
+	fc->aux = 0;
+	fc->index = (long) ni;
+}
+
+
+long
+nfs3_lookup (fcookie *dir, const char *name, int dom, fcookie *fc)
+{
+	NFS_INDEX *newi, *ni = (NFS_INDEX *) dir->index;
+	diropargs3 dirargs;
+	diropres3 dirres;
+	long r;
+	
+	dirargs.dir = ni->fh3;
+	dirargs.name = name;
+	
+	r = rpc_call3 (ni, NFSPROC3_LOOKUP,
+	               (xdrproc_t) xdr_diropargs3, &dirargs, xdr_size_diropargs3 (&dirargs),
+	               (xdrproc_t) xdr_lookupres3, &dirres);
+	if (r != 0)
+	{
+		DEBUG (("nfs3_lookup(%s): request failed, -> ENOENT", name));
+		return ENOENT;
+	}
+	
+	if (dirres.status != NFS_OK)
+	{
+		DEBUG (("nfs3_lookup(%s) rpc->%d -> ENOENT", name, dirres.status));
+		return ENOENT;
+	}
+	
+	newi = get_slot (ni, name, dom);
+	if (!newi)
+		return EMFILE;
+	
+	newi->dir = ni;
+	newi->link += 1;
+	newi->fh3 = dirres.file;
+	newi->flags &= ~NO_HANDLE;
+	set_attr3 (newi, &dirres.attributes);
+	fill_cookie (fc, newi);
+	
+# ifdef USE_CACHE
+	nfs_cache_add (ni, newi);
+# endif
+	
+	DEBUG (("nfs3_lookup('%s' in '%s') -> OK", name, ni->name));
+	return 0;
+}
+
+long
+nfs3_create (long nfs_opcode, fcookie *dir, const char *name, unsigned mode, int attrib, fcookie *fc)
+{
+	NFS_INDEX *newi, *ni = (NFS_INDEX *) dir->index;
+	diropres3 dirres;
+	sattr3 attr;
+	long r;
+	
+	attr.set_mode = TRUE;
+	attr.mode = nfs_mode (mode, attrib) & ~N_IFMT;
+	attr.set_uid = attr.set_gid = FALSE;
+	attr.set_size = FALSE;
+	attr.size = 0;
+	attr.set_atime = attr.set_mtime = SET_TO_SERVER_TIME;
+	
+	if (nfs_opcode == NFSPROC_MKDIR)
+	{
+		mkdirargs3 mkdirarg;
+		
+		mkdirarg.where.dir = ni->fh3;
+		mkdirarg.where.name = name;
+		mkdirarg.attributes = attr;
+		
+		r = rpc_call3 (ni, NFSPROC3_MKDIR,
+		               (xdrproc_t) xdr_mkdirargs3, &mkdirarg, xdr_size_mkdirargs3 (&mkdirarg),
+		               (xdrproc_t) xdr_createres3, &dirres);
+	}
+	else
+	{
+		createargs3 createarg;
+		
+		/* like the version 2 CREATE, truncate an existing file */
+		attr.set_size = TRUE;
+		
+		createarg.where.dir = ni->fh3;
+		createarg.where.name = name;
+		createarg.how = UNCHECKED;
+		createarg.attributes = attr;
+		
+		r = rpc_call3 (ni, NFSPROC3_CREATE,
+		               (xdrproc_t) xdr_createargs3, &createarg, xdr_size_createargs3 (&createarg),
+		               (xdrproc_t) xdr_createres3, &dirres);
+	}
+	
+	if (r != 0)
+	{
+		DEBUG (("nfs3_create(%s): request failed, -> EACCES", name));
+		return EACCES;
+	}
+	
+	if (dirres.status != NFS_OK)
+	{
+		DEBUG (("nfs3_create(%s) rpc->%d -> EACCES", name, dirres.status));
+		return EACCES;
+	}
+	
+	newi = get_slot (ni, name, p_domain (-1));
+	if (!newi)
+	{
+		DEBUG (("nfs3_create: no slot found -> EACCES"));
+		return EACCES;
+	}
+	
+	newi->dir = ni;
+	newi->link += 1;
+	
+	/* the handle is optional in the reply; if it is missing,
+	 * get_handle() looks it up when it is needed
+	 */
+	if (dirres.has_file)
+	{
+		newi->fh3 = dirres.file;
+		newi->flags &= ~NO_HANDLE;
+	}
+	else
+		newi->flags |= NO_HANDLE;
+	
+	set_attr3 (newi, &dirres.attributes);
+	
+	if (fc)
+		fill_cookie (fc, newi);
+	
+	TRACE (("nfs3_create(%s) -> OK", name));
+	return 0;
+}
+
+long
+nfs3_getattr (NFS_INDEX *ni)
+{
+	getattrres3 stat_res;
+	long r;
+	
+	r = rpc_call3 (ni, NFSPROC3_GETATTR,
+	               (xdrproc_t) xdr_nfsfh3, &ni->fh3, xdr_size_nfsfh3 (&ni->fh3),
+	               (xdrproc_t) xdr_getattrres3, &stat_res);
+	if (r != 0)
+	{
+		DEBUG (("nfs3_getattr(%s): request failed, -> EACCES", ni->name));
+		return EACCES;
+	}
+	
+	if (stat_res.status != NFS_OK)
+	{
+		DEBUG (("nfs3_getattr(%s) rpc->%d, -> EACCES", ni->name, stat_res.status));
+		return EACCES;
+	}
+	
+	v3fattr2xattr (&stat_res.attributes, &ni->attr);
+	ni->stamp = get_timestamp ();
+	
+	return E_OK;
+}
+
+long
+nfs3_setattr (NFS_INDEX *ni, sattr *ap)
+{
+	setattrargs3 s_arg;
+	wccstat3 stat_res;
+	long r;
+	
+	s_arg.file = ni->fh3;
+	sattr2v3sattr (ap, &s_arg.attributes);
+	
+	r = rpc_call3 (ni, NFSPROC3_SETATTR,
+	               (xdrproc_t) xdr_setattrargs3, &s_arg, xdr_size_setattrargs3 (&s_arg),
+	               (xdrproc_t) xdr_wccstat3, &stat_res);
+	if (r != 0)
+	{
+		DEBUG (("nfs3_setattr(%s): request failed, -> EACCES", ni->name));
+		return EACCES;
+	}
+	
+	if (stat_res.status != NFS_OK)
+	{
+		DEBUG (("nfs3_setattr(%s) rpc->%d -> EACCES", ni->name, stat_res.status));
+		return EACCES;
+	}
+	
+	set_attr3 (ni, &stat_res.wcc.after);
+	
+	TRACE (("nfs3_setattr(%s) -> OK", ni->name));
+	return E_OK;
+}
+
+long
+nfs3_remove (long nfs_opcode, NFS_INDEX *ni, const char *name)
+{
+	diropargs3 dirargs;
+	wccstat3 stat_res;
+	long r;
+	
+	dirargs.dir = ni->fh3;
+	dirargs.name = name;
+	
+	r = rpc_call3 (ni, (nfs_opcode == NFSPROC_RMDIR) ? NFSPROC3_RMDIR : NFSPROC3_REMOVE,
+	               (xdrproc_t) xdr_diropargs3, &dirargs, xdr_size_diropargs3 (&dirargs),
+	               (xdrproc_t) xdr_wccstat3, &stat_res);
+	if (r != 0)
+	{
+		DEBUG (("nfs3_remove(%s): request failed, -> EACCES", name));
+		return EACCES;
+	}
+	
+	if (stat_res.status != NFS_OK)
+	{
+		DEBUG (("nfs3_remove(%s, %ld) rpc->%d -> EACCES", name, nfs_opcode, stat_res.status));
+		return EACCES;
+	}
+	
+	set_attr3 (ni, &stat_res.wcc.after);
+	
+# ifdef USE_CACHE
+	nfs_cache_removebyname (ni, name);
+# endif
+	
+	DEBUG (("nfs3_remove(%s, %ld) -> OK", name, nfs_opcode));
+	return 0;
+}
+
+long
+nfs3_rename (NFS_INDEX *oldi, const char *oldname, NFS_INDEX *newi, const char *newname)
+{
+	renameargs3 renarg;
+	nfsstat stat_res;
+	long r;
+	
+	renarg.from.dir = oldi->fh3;
+	renarg.from.name = oldname;
+	renarg.to.dir = newi->fh3;
+	renarg.to.name = newname;
+	
+	/* only the status is of interest, the wcc_data is ignored */
+	r = rpc_call3 (oldi, NFSPROC3_RENAME,
+	               (xdrproc_t) xdr_renameargs3, &renarg, xdr_size_renameargs3 (&renarg),
+	               (xdrproc_t) xdr_nfsstat, &stat_res);
+	if (r != 0)
+	{
+		DEBUG (("nfs3_rename(%s): request failed, -> EACCES", oldname));
+		return EACCES;
+	}
+	
+	if (stat_res != NFS_OK)
+	{
+		DEBUG (("nfs3_rename(%s) rpc->%d -> EACCES", oldname, stat_res));
+		return EACCES;
+	}
+	
+	nfs_cache_removebyname (oldi, oldname);
+	
+	TRACE (("nfs3_rename('%s' -> '%s') -> OK", oldname, newname));
+	return 0;
+}
+
+long
+nfs3_symlink (NFS_INDEX *ni, const char *name, const char *to)
+{
+	symlinkargs3 symarg;
+	diropres3 dirres;
+	long r;
+	
+	symarg.where.dir = ni->fh3;
+	symarg.where.name = name;
+	symarg.to = to;
+	symarg.attributes.set_mode = TRUE;
+	symarg.attributes.mode = 0777;
+	symarg.attributes.set_uid = symarg.attributes.set_gid = FALSE;
+	symarg.attributes.set_size = FALSE;
+	symarg.attributes.set_atime = symarg.attributes.set_mtime = DONT_CHANGE;
+	
+	r = rpc_call3 (ni, NFSPROC3_SYMLINK,
+	               (xdrproc_t) xdr_symlinkargs3, &symarg, xdr_size_symlinkargs3 (&symarg),
+	               (xdrproc_t) xdr_createres3, &dirres);
+	if (r != 0)
+	{
+		DEBUG (("nfs3_symlink: request failed, -> EACCES"));
+		return EACCES;
+	}
+	
+	if (dirres.status != NFS_OK)
+	{
+		DEBUG (("nfs3_symlink rpc->%d -> EACCES", dirres.status));
+		return EACCES;
+	}
+	
+	TRACE (("nfs3_symlink -> OK"));
+	return 0;
+}
+
+/* buf must have room for MAXPATHLEN+1 bytes */
+long
+nfs3_readlink (NFS_INDEX *ni, char *buf)
+{
+	readlinkres3 link_res;
+	long r;
+	
+	link_res.data = buf;
+	
+	r = rpc_call3 (ni, NFSPROC3_READLINK,
+	               (xdrproc_t) xdr_nfsfh3, &ni->fh3, xdr_size_nfsfh3 (&ni->fh3),
+	               (xdrproc_t) xdr_readlinkres3, &link_res);
+	if (r != 0)
+	{
+		DEBUG (("nfs3_readlink: request failed, -> ENOENT"));
+		return ENOENT;
+	}
+	
+	if (link_res.status != NFS_OK)
+	{
+		DEBUG (("nfs3_readlink rpc->%d -> ENOENT", link_res.status));
+		return ENOENT;
+	}
+	
+	set_attr3 (ni, &link_res.attributes);
+	return 0;
+}
+
+long
+nfs3_hardlink (NFS_INDEX *fromi, NFS_INDEX *toi, const char *toname)
+{
+	linkargs3 linkarg;
+	nfsstat stat_res;
+	long r;
+	
+	linkarg.file = fromi->fh3;
+	linkarg.link.dir = toi->fh3;
+	linkarg.link.name = toname;
+	
+	r = rpc_call3 (fromi, NFSPROC3_LINK,
+	               (xdrproc_t) xdr_linkargs3, &linkarg, xdr_size_linkargs3 (&linkarg),
+	               (xdrproc_t) xdr_nfsstat, &stat_res);
+	if (r != 0)
+	{
+		DEBUG (("nfs3_hardlink: request failed, -> EACCES"));
+		return EACCES;
+	}
+	
+	if (stat_res != NFS_OK)
+	{
+		DEBUG (("nfs3_hardlink rpc->%d -> EACCES", stat_res));
+		return EACCES;
+	}
+	
+	/* the link count has changed */
+	nfs_attr_expire (fromi);
+	
+	TRACE (("nfs3_hardlink -> OK"));
+	return 0;
+}
+
+long
+nfs3_dfree (NFS_INDEX *ni, long *buf)
+{
+	fsstatres3 stat_res;
+	ulong bsize;
+	long r;
+	
+	r = rpc_call3 (ni, NFSPROC3_FSSTAT,
+	               (xdrproc_t) xdr_nfsfh3, &ni->fh3, xdr_size_nfsfh3 (&ni->fh3),
+	               (xdrproc_t) xdr_fsstatres3, &stat_res);
+	if (r != 0)
+	{
+		DEBUG (("nfs3_dfree: request failed, -> ENOTDIR"));
+		return ENOTDIR;
+	}
+	
+	if (stat_res.status != NFS_OK)
+	{
+		DEBUG (("nfs3_dfree rpc->%d -> ENOTDIR", stat_res.status));
+		return ENOTDIR;
+	}
+	
+	/* the server counts bytes; choose a cluster size so that the
+	 * number of clusters fits into a long
+	 */
+	bsize = 512;
+	while ((stat_res.tbytes / bsize) > 0x7fffffffUL)
+		bsize <<= 1;
+	
+	buf[0] = stat_res.abytes / bsize;
+	buf[1] = stat_res.tbytes / bsize;
+	buf[2] = bsize;
+	buf[3] = 1;
+	
+	return E_OK;
+}
+
+
+/* this is placed in the fsstuff field of a dir handle; the entries of
+ * a READDIRPLUS reply are decoded one by one as they are read
+ */
+typedef struct
+{
+	MESSAGE	*reply;		/* current reply, if any */
+	xdrs	x;		/* decode position in it */
+	ullong	cookie;		/* for further requests to the server */
+	opaque	cookieverf[NFS3_COOKIEVERFSIZE];
+	short	more;		/* another entry follows in the reply */
+	short	eof;		/* the reply is the last of the directory */
+} NFS3_STUFF;
+
+static void
+drop_reply (NFS3_STUFF *stuff)
+{
+	if (stuff->reply)
+	{
+		free_message (stuff->reply);
+		stuff->reply = NULL;
+	}
+	
+	stuff->more = 0;
+}
+
+/* finish a reply after its last entry */
+static void
+end_reply (NFS3_STUFF *stuff)
+{
+	bool_t eof;
+	
+	if (!xdr_bool (&stuff->x, &eof))
+		eof = TRUE;
+	
+	stuff->eof = eof;
+	drop_reply (stuff);
+}
+
+static long
+readdir_chunk (NFS_INDEX *ni, NFS3_STUFF *stuff)
+{
+	char req_buf[NFS3BUFSIZE];
+	MESSAGE *mreq, *mrep, m;
+	readdirplusargs3 read_arg;
+	readdirplusres3 read_res;
+	xdrs x;
+	long r;
+	
+	read_arg.dir = ni->fh3;
+	read_arg.cookie = stuff->cookie;
+	memcpy (read_arg.cookieverf, stuff->cookieverf, NFS3_COOKIEVERFSIZE);
+	read_arg.dircount = MAX_READDIR_LEN;
+	read_arg.maxcount = MAX_READDIRPLUS_LEN;
+	
+	mreq = alloc_message (&m, req_buf, NFS3BUFSIZE, xdr_size_readdirplusargs3 (&read_arg));
+	if (!mreq)
+	{
+		DEBUG (("readdir_chunk(%s): failed to alloc msg", ni->name));
+		return ENOMEM;
+	}
+	
+	xdr_init (&x, mreq->data, mreq->data_len, XDR_ENCODE, NULL);
+	xdr_readdirplusargs3 (&x, &read_arg);
+	
+	r = rpc_request (&ni->opt->server, mreq, NFSPROC3_READDIRPLUS, &mrep);
+	if (r != 0)
+	{
+		DEBUG (("readdir_chunk(%s): couldnt contact server", ni->name));
+		return r;
+	}
+	
+	xdr_init (&stuff->x, mrep->data, mrep->data_len, XDR_DECODE, NULL);
+	if (!xdr_readdirplusres3 (&stuff->x, &read_res))
+	{
+		DEBUG (("readdir_chunk(%s): could not decode results", ni->name));
+		free_message (mrep);
+		return EBADARG;
+	}
+	
+	if (read_res.status != NFS_OK)
+	{
+		DEBUG (("readdir_chunk(%s) rpc->%d", ni->name, read_res.status));
+		free_message (mrep);
+		return EACCES;
+	}
+	
+	memcpy (stuff->cookieverf, read_res.cookieverf, NFS3_COOKIEVERFSIZE);
+	stuff->reply = mrep;
+	stuff->more = read_res.more;
+	
+	if (!stuff->more)
+		end_reply (stuff);
+	
+	return 0;
+}
+
+long
+nfs3_opendir (DIR *dirh)
+{
+	NFS3_STUFF *stuff = (NFS3_STUFF *) dirh->fsstuff;
+	
+	stuff->reply = NULL;
+	stuff->cookie = 0;
+	bzero (stuff->cookieverf, NFS3_COOKIEVERFSIZE);
+	stuff->more = 0;
+	stuff->eof = 0;
+	dirh->index = 0;
+	
+	return 0;
+}
+
+void
+nfs3_rewinddir (DIR *dirh)
+{
+	NFS3_STUFF *stuff = (NFS3_STUFF *) dirh->fsstuff;
+	
+	drop_reply (stuff);
+	nfs3_opendir (dirh);
+}
+
+void
+nfs3_closedir (DIR *dirh)
+{
+	drop_reply ((NFS3_STUFF *) dirh->fsstuff);
+}
+
+/* index for the entry just decoded, with one more link; with the
+ * handle and the attributes at hand, neither a LOOKUP nor a GETATTR
+ * is needed for it later
+ */
+static NFS_INDEX *
+entry_index (DIR *dirh, NFS_INDEX *ni, entryplus3 *ent)
+{
+	NFS_INDEX *newi;
+	
+	if (!strcmp (ent->name, "."))
+	{
+		newi = ni;
+	}
+	else if (!strcmp (ent->name, ".."))
+	{
+		newi = ni->dir;
+	}
+	else
+	{
+		newi = get_slot (ni, ent->name, (dirh->flags & TOS_SEARCH) ? 0 : 1);
+		if (!newi)
+			return NULL;
+		
+		if (ent->has_handle)
+		{
+			newi->fh3 = ent->handle;
+			newi->flags &= ~NO_HANDLE;
+		}
+		else
+			newi->flags |= NO_HANDLE;
+		
+		set_attr3 (newi, &ent->attributes);
+		
+# ifdef USE_CACHE
+		if (ent->has_handle)
+			nfs_cache_add (ni, newi);
+# endif
+	}
+	
+	if (newi)
+		newi->link += 1;
+	
+	return newi;
+}
+
+/* get the next entry into ent, with the next reply if needed */
+static long
+next_entry (NFS_INDEX *ni, NFS3_STUFF *stuff, entryplus3 *ent)
+{
+	while (!stuff->more)
+	{
+		if (stuff->eof)
+			return ENMFILES;
+		
+		if (readdir_chunk (ni, stuff) != 0)
+			return ENMFILES;
+	}
+	
+	if (!xdr_entryplus3 (&stuff->x, ent))
+	{
+		DEBUG (("nfs3_readdir(%s): could not decode entry, -> ENMFILES", ni->name));
+		drop_reply (stuff);
+		return ENMFILES;
+	}
+	
+	stuff->cookie = ent->cookie;
+	stuff->more = ent->more;
+	
+	return 0;
+}
+
+long
+nfs3_readdir (DIR *dirh, char *name, int namelen, fcookie *fc)
+{
+	NFS3_STUFF *stuff = (NFS3_STUFF *) dirh->fsstuff;
+	NFS_INDEX *ni = (NFS_INDEX *) dirh->fc.index;
+	NFS_INDEX *newi;
+	char namebuf[MAXNAMLEN+1];
+	entryplus3 ent;
+	int giveindex = dirh->flags == 0;
+	int dom = p_domain (-1);
+	
+	ent.name = namebuf;
+	if (next_entry (ni, stuff, &ent) != 0)
+	{
+		TRACE (("nfs3_readdir(%s): end of dir reached, -> ENMFILES", ni->name));
+		return ENMFILES;
+	}
+	
+	if (!stuff->more)
+		end_reply (stuff);
+	
+	if (giveindex)
+	{
+		namelen -= sizeof (long);
+		if (namelen <= 0)
+			return EBADARG;
+		
+		unaligned_putl (name, (long) ent.fileid);
+		name += sizeof (long);
+	}
+	
+	strncpy (name, namebuf, namelen-1);
+	name[namelen-1] = '\0';
+	if (0 == dom)    /* convert to upper case for TOS domain */
+		strupr (name);
+	
+	if (strlen (namebuf) >= namelen)
+	{
+		DEBUG (("nfs3_readdir(%s): name buffer (%ld) too short", ni->name, (long) namelen));
+		return EBADARG;
+	}
+	
+	newi = entry_index (dirh, ni, &ent);
+	if (!newi && strcmp (namebuf, ".."))
+	{
+		DEBUG (("nfs3_readdir(%s): no index for entry, -> EMFILE", ni->name));
+		return EMFILE;
+	}
+	
+	fill_cookie (fc, newi);
+	
+	DEBUG (("nfs3_readdir(%s) -> %s", ni->name, name));
+	return 0;
+}
+
+/* name starts with prefix, ignoring case */
+static int
+prefix_ok (const char *name, const char *prefix)
+{
+	if (!prefix)
+		return 1;
+	
+	while (*prefix)
+	{
+		if (toupper ((int) *name & 0xff) != ((int) *prefix & 0xff))
+			return 0;
+		
+		name++;
+		prefix++;
+	}
+	
+	return 1;
+}
+
+/* Dgetdents() records straight from the READDIRPLUS replies; the
+ * attributes came along, so no GETATTR is sent for the entries
+ */
+long
+nfs3_readdirs (DIR *dirh, char *buf, long len, int flags, const char *prefix)
+{
+	NFS3_STUFF *stuff = (NFS3_STUFF *) dirh->fsstuff;
+	NFS_INDEX *ni = (NFS_INDEX *) dirh->fc.index;
+	char namebuf[MAXNAMLEN+1];
+	long asize = (flags & DGD_STAT) ? sizeof (STAT) : sizeof (XATTR);
+	long ilen = (dirh->flags & TOS_SEARCH) ? 0 : sizeof (long);
+	int dom = p_domain (-1);
+	long done = 0;
+	long r = 0;
+	
+	for (;;)
+	{
+		struct dgdent *d = (struct dgdent *) (buf + done);
+		xdrs save = stuff->x;
+		short more = stuff->more;
+		ullong cookie = stuff->cookie;
+		entryplus3 ent;
+		NFS_INDEX *newi;
+		fcookie fc;
+		long namlen, reclen;
+		char *nm;
+		
+		ent.name = namebuf;
+		if (next_entry (ni, stuff, &ent) != 0)
+			break;
+		
+		if (!prefix_ok (namebuf, prefix))
+		{
+			if (!stuff->more)
+				end_reply (stuff);
+			
+			continue;
+		}
+		
+		namlen = strlen (namebuf);
+		reclen = (sizeof (*d) + asize + ilen + namlen + 2) & ~1L;
+		if (reclen > len - done)
+		{
+			/* decode it again next time; if it was the
+			 * first of a new reply, ask for that again
+			 */
+			if (more)
+			{
+				stuff->x = save;
+				stuff->more = more;
+				stuff->cookie = cookie;
+			}
+			else
+			{
+				drop_reply (stuff);
+				stuff->cookie = cookie;
+			}
+			
+			r = EBADARG;
+			break;
+		}
+		
+		if (!stuff->more)
+			end_reply (stuff);
+		
+		newi = entry_index (dirh, ni, &ent);
+		if (!newi && strcmp (namebuf, ".."))
+		{
+			DEBUG (("nfs3_readdirs(%s): no index for entry, -> EMFILE", ni->name));
+			r = EMFILE;
+			break;
+		}
+		
+		fill_cookie (&fc, newi);
+		
+		if (flags & DGD_STAT)
+			d->xret = nfs_stat64 (&fc, (STAT *) (d + 1));
+		else
+			d->xret = nfs_getxattr (&fc, (XATTR *) (d + 1));
+		
+		nfs_release (&fc);
+		
+		nm = (char *) (d + 1) + asize;
+		if (ilen)
+		{
+			long index = (long) ent.fileid;
+			
+			memcpy (nm, &index, ilen);
+			nm += ilen;
+		}
+		
+		strcpy (nm, namebuf);
+		if (0 == dom)    /* convert to upper case for TOS domain */
+			strupr (nm);
+		
+		d->reclen = reclen;
+		d->namlen = namlen;
+		
+		done += reclen;
+	}
+	
+	TRACE (("nfs3_readdirs(%s) -> %ld bytes", ni->name, done));
+	return done ? done : r;
+}
+
+
+/* start and finish a READ for nfs_pipeline(); the header and arguments
+ * are encoded into the slot, the data goes straight into the buffer
+ */
+static long
+start_read3 (NFS_INDEX *ni, IO_SLOT *s)
+{
+	readargs3 read_arg;
+	MESSAGE *mreq;
+	xdrs x;
+	
+	read_arg.file = ni->fh3;
+	read_arg.offset = s->pos;
+	read_arg.count = s->count;
+	
+	mreq = alloc_message (&s->m, s->req_buf, IOSLOT_BUFSIZE, xdr_size_readargs3 (&read_arg));
+	if (!mreq)
+	{
+		DEBUG (("nfs3_read: failed to alloc request msg, -> EREAD"));
+		return EREAD;
+	}
+	
+	xdr_init (&x, mreq->data, mreq->data_len, XDR_ENCODE, NULL);
+	if (!xdr_readargs3 (&x, &read_arg))
+	{
+		free_message (mreq);
+		
+		DEBUG (("nfs3_read: failed to encode arguments, -> EREAD"));
+		return EREAD;
+	}
+	
+	if (rpc_send (&ni->opt->server, mreq, NFSPROC3_READ, &s->call) != 0)
+	{
+		DEBUG (("nfs3_read: request failed, -> EREAD"));
+		return EREAD;
+	}
+	
+	return 0;
+}
+
+static long
+end_read3 (NFS_INDEX *ni, IO_SLOT *s)
+{
+	readres3 read_res;
+	MESSAGE *mrep;
+	xdrs x;
+	
+	if (rpc_wait (&s->call, &mrep) != 0)
+	{
+		DEBUG (("nfs3_read: request failed, -> EREAD"));
+		return EREAD;
+	}
+	
+	read_res.data_val = s->buf;
+	read_res.data_len = s->count;
+	
+	xdr_init (&x, mrep->data, mrep->data_len, XDR_DECODE, NULL);
+	if (!xdr_readres3 (&x, &read_res))
+	{
+		free_message (mrep);
+		
+		DEBUG (("nfs3_read: could not decode results, -> EREAD"));
+		return EREAD;
+	}
+	
+	free_message (mrep);
+	
+	if (read_res.status != NFS_OK)
+	{
+		/* TL: Try to reduce the rsize */
+		s->retry = (read_res.status == NFSERR_IO);
+		
+		DEBUG (("nfs3_read: rpc->%d, -> EREAD", read_res.status));
+		return EREAD;
+	}
+	
+	set_attr3 (ni, &read_res.attributes);
+	
+	/* a short read means end of file */
+	return read_res.data_len;
+}
+
+static IO_OPS read_ops3 = { start_read3, end_read3, 0 };
+
+long
+nfs3_read_rpcs (NFS_INDEX *ni, long pos, char *buf, long bytes, long chunk, int depth)
+{
+	long r;
+	
+	r = nfs_pipeline (ni, &read_ops3, pos, buf, bytes, chunk, depth, NULL);
+	
+	TRACE (("nfs3_read(%s, %ld) -> %ld", ni->name, bytes, r));
+	return r;
+}
+
+/* make the unstable writes in [offset, offset+count) permanent; returns
+ * 1 if the server lost them in between, which shows up as a change of
+ * the write verifier
+ */
+long
+nfs3_commit (NFS_INDEX *ni, long offset, long count, NFS_VERF *v)
+{
+	commitargs3 commit_arg;
+	commitres3 commit_res;
+	long r;
+	
+	commit_arg.file = ni->fh3;
+	commit_arg.offset = offset;
+	commit_arg.count = count;
+	
+	r = rpc_call3 (ni, NFSPROC3_COMMIT,
+	               (xdrproc_t) xdr_commitargs3, &commit_arg, xdr_size_commitargs3 (&commit_arg),
+	               (xdrproc_t) xdr_commitres3, &commit_res);
+	if (r != 0)
+		return r;
+	
+	if (commit_res.status != NFS_OK)
+	{
+		DEBUG (("commit3(%s): rpc->%d", ni->name, commit_res.status));
+		return EWRITE;
+	}
+	
+	set_attr3 (ni, &commit_res.wcc.after);
+	
+	if (v->changed || (v->valid && memcmp (v->verf, commit_res.verf, NFS3_WRITEVERFSIZE)))
+		return 1;
+	
+	return 0;
+}
+
+/* what the WRITEs of one transfer have in common */
+struct write3
+{
+	enum_t	stable;
+	NFS_VERF *v;
+};
+
+static long
+start_write3 (NFS_INDEX *ni, IO_SLOT *s)
+{
+	struct write3 *w = s->priv;
+	writeargs3 write_arg;
+	MESSAGE *mreq;
+	xdrs x;
+	
+	write_arg.file = ni->fh3;
+	write_arg.offset = s->pos;
+	write_arg.count = s->count;
+	write_arg.stable = w->stable;
+	write_arg.data_val = s->buf;
+	write_arg.data_len = s->count;
+	
+	mreq = alloc_message (&s->m, NULL, 0, xdr_size_writeargs3 (&write_arg));
+	if (!mreq)
+	{
+		DEBUG (("nfs3_write: failed to alloc request msg -> EWRITE"));
+		return EWRITE;
+	}
+	
+	xdr_init (&x, mreq->data, mreq->data_len, XDR_ENCODE, NULL);
+	if (!xdr_writeargs3 (&x, &write_arg))
+	{
+		free_message (mreq);
+		
+		DEBUG (("nfs3_write: failed to encode arguments -> EWRITE"));
+		return EWRITE;
+	}
+	
+	if (rpc_send (&ni->opt->server, mreq, NFSPROC3_WRITE, &s->call) != 0)
+	{
+		DEBUG (("nfs3_write: request failed -> EWRITE"));
+		return EWRITE;
+	}
+	
+	return 0;
+}
+
+static long
+end_write3 (NFS_INDEX *ni, IO_SLOT *s)
+{
+	struct write3 *w = s->priv;
+	writeres3 write_res;
+	MESSAGE *mrep;
+	xdrs x;
+	
+	if (rpc_wait (&s->call, &mrep) != 0)
+	{
+		DEBUG (("nfs3_write: request failed -> EWRITE"));
+		return EWRITE;
+	}
+	
+	xdr_init (&x, mrep->data, mrep->data_len, XDR_DECODE, NULL);
+	if (!xdr_writeres3 (&x, &write_res))
+	{
+		free_message (mrep);
+		
+		DEBUG (("nfs3_write: could not decode results -> EWRITE"));
+		return EWRITE;
+	}
+	
+	free_message (mrep);
+	
+	if (write_res.status != NFS_OK)
+	{
+		/* TL: Reduce the wsize and try again */
+		s->retry = (write_res.status == NFSERR_IO);
+		
+		DEBUG (("nfs3_write: rpc->%d -> EWRITE", write_res.status));
+		return EWRITE;
+	}
+	
+	if (write_res.count == 0)
+	{
+		DEBUG (("nfs3_write: server wrote nothing -> EWRITE"));
+		return EWRITE;
+	}
+	
+	set_attr3 (ni, &write_res.wcc.after);
+	
+	if (w->stable == UNSTABLE)
+	{
+		NFS_VERF *v = w->v;
+		
+		if (v->valid && memcmp (v->verf, write_res.verf, NFS3_WRITEVERFSIZE))
+			v->changed = 1;
+		
+		memcpy (v->verf, write_res.verf, NFS3_WRITEVERFSIZE);
+		v->valid = 1;
+	}
+	
+	return MIN (write_res.count, s->count);
+}
+
+static IO_OPS write_ops3 = { start_write3, end_write3, 1 };
+
+/* With v the WRITEs are sent unstable and not committed; the caller
+ * keeps the data and its verifier until it calls nfs3_commit, v->changed
+ * tells that data written before has been lost.
+ *
+ * Without v, transfers that fit into a single WRITE are sent stable.
+ * Larger ones go out as pipelined unstable WRITEs, so that the server
+ * needs not to sync after each of them, followed by a single COMMIT. As
+ * the caller keeps the data only until we return, the whole transfer
+ * is sent again stable if the server restarted before the COMMIT.
+ */
+long
+nfs3_write_rpcs (NFS_INDEX *ni, long pos, const char *buf, long bytes, long chunk, int depth, NFS_VERF *v)
+{
+	struct write3 w;
+	NFS_VERF own;
+	long r;
+	
+	if (v)
+	{
+		w.stable = UNSTABLE;
+		w.v = v;
+		
+		r = nfs_pipeline (ni, &write_ops3, pos, (char *) buf, bytes, chunk, depth, &w);
+		
+		TRACE (("nfs3_write(%s) unstable -> %ld", ni->name, r));
+		return r;
+	}
+	
+	w.stable = (bytes > chunk) ? UNSTABLE : FILE_SYNC;
+	w.v = &own;
+	
+again:
+	own.valid = 0;
+	own.changed = 0;
+	
+	r = nfs_pipeline (ni, &write_ops3, pos, (char *) buf, bytes, chunk, depth, &w);
+	if (r < 0)
+		return r;
+	
+	if (w.stable == UNSTABLE)
+	{
+		long c;
+		
+		c = own.changed ? 1 : nfs3_commit (ni, pos, r, &own);
+		if (c < 0)
+		{
+			DEBUG (("nfs3_write: COMMIT failed -> EWRITE"));
+			return EWRITE;
+		}
+		
+		if (c > 0)
+		{
+			DEBUG (("nfs3_write: server restarted, resending stable"));
+			w.stable = FILE_SYNC;
+			goto again;
+		}
+	}
+	
+	TRACE (("nfs3_write(%s) -> %ld", ni->name, r));
+	return r;
+}
@@ -0,0 +1,60 @@
+/*
+ * This file belongs to FreeMiNT. It's not in the original MiNT 1.12
+ * distribution. See the file CHANGES for a detailed log of changes.
+ *
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This file is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *
+ * Please send suggestions, patches or bug reports to me or
+ * the MiNT mailing list.
+ *
+ */
+
+/*
+ * File : nfs3.h
+ *        the NFS version 3 side of the file system and device functions
+ */
+
+# ifndef _nfs3_h
+# define _nfs3_h
+
+# include "global.h"
+# include "nfsio.h"
+
+
+long	nfs3_lookup	(fcookie *dir, const char *name, int dom, fcookie *fc);
+long	nfs3_create	(long nfs_opcode, fcookie *dir, const char *name, unsigned mode, int attrib, fcookie *fc);
+long	nfs3_getattr	(NFS_INDEX *ni);
+long	nfs3_setattr	(NFS_INDEX *ni, sattr *ap);
+long	nfs3_remove	(long nfs_opcode, NFS_INDEX *ni, const char *name);
+long	nfs3_rename	(NFS_INDEX *oldi, const char *oldname, NFS_INDEX *newi, const char *newname);
+long	nfs3_symlink	(NFS_INDEX *ni, const char *name, const char *to);
+long	nfs3_readlink	(NFS_INDEX *ni, char *buf);
+long	nfs3_hardlink	(NFS_INDEX *fromi, NFS_INDEX *toi, const char *toname);
+long	nfs3_dfree	(NFS_INDEX *ni, long *buf);
+
+long	nfs3_opendir	(DIR *dirh);
+long	nfs3_readdir	(DIR *dirh, char *name, int namelen, fcookie *fc);
+long	nfs3_readdirs	(DIR *dirh, char *buf, long len, int flags, const char *prefix);
+void	nfs3_rewinddir	(DIR *dirh);
+void	nfs3_closedir	(DIR *dirh);
+
+long	nfs3_read_rpcs	(NFS_INDEX *ni, long pos, char *buf, long bytes, long chunk, int depth);
+long	nfs3_write_rpcs	(NFS_INDEX *ni, long pos, const char *buf, long bytes, long chunk, int depth, NFS_VERF *v);
+long	nfs3_commit	(NFS_INDEX *ni, long offset, long count, NFS_VERF *v);
+
+
+# endif /* _nfs3_h */
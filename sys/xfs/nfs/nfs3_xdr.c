@@ -0,0 +1,558 @@
+/*
+ * This file belongs to FreeMiNT. It's not in the original MiNT 1.12
+ * distribution. See the file CHANGES for a detailed log of changes.
+ *
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This file is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *
+ * Please send suggestions, patches or bug reports to me or
+ * the MiNT mailing list.
+ *
+ */
+
+/*
+ * File : nfs3_xdr.c
+ *        xdr functions for the version 3 protocol types
+ */
+
+# include "global.h"
+
+
+bool_t
+xdr_uint64 (xdrs *x, ullong *val)
+{
+	ulong hi = 0, lo = 0;
+	
+	if (XDR_FREE == x->op)
+		return TRUE;
+	
+	if (XDR_ENCODE == x->op)
+	{
+		hi = (ulong)(*val >> 32);
+		lo = (ulong) *val;
+	}
+	
+	if (!xdr_ulong (x, &hi))
+		return FALSE;
+	if (!xdr_ulong (x, &lo))
+		return FALSE;
+	
+	if (XDR_DECODE == x->op)
+		*val = ((ullong) hi << 32) | lo;
+	
+	return TRUE;
+}
+
+bool_t
+xdr_nfsfh3 (xdrs *x, nfs_fh3 *fp)
+{
+	const opaque *data = fp->data;
+	
+	return xdr_opaque (x, &data, (long *) &fp->len, NFS3_FHSIZE);
+}
+
+/* attributes are only ever sent by the server, so there is no
+ * encoding here
+ */
+bool_t
+xdr_fattr3 (xdrs *x, fattr3 *fp)
+{
+	long *buf;
+	
+	if (XDR_FREE == x->op)
+		return TRUE;
+	
+	if (XDR_DECODE != x->op)
+		return FALSE;
+	
+	buf = xdr_inline (x, xdr_size_fattr3 (fp));
+	if (!buf)
+		return FALSE;
+	
+	fp->type	= IXDR_GET_ENUM (buf);
+	fp->mode	= IXDR_GET_ULONG (buf);
+	fp->nlink	= IXDR_GET_ULONG (buf);
+	fp->uid		= IXDR_GET_ULONG (buf);
+	fp->gid		= IXDR_GET_ULONG (buf);
+	fp->size	= (ullong) IXDR_GET_ULONG (buf) << 32;
+	fp->size	|= IXDR_GET_ULONG (buf);
+	fp->used	= (ullong) IXDR_GET_ULONG (buf) << 32;
+	fp->used	|= IXDR_GET_ULONG (buf);
+	fp->rdev_major	= IXDR_GET_ULONG (buf);
+	fp->rdev_minor	= IXDR_GET_ULONG (buf);
+	fp->fsid	= (ullong) IXDR_GET_ULONG (buf) << 32;
+	fp->fsid	|= IXDR_GET_ULONG (buf);
+	fp->fileid	= (ullong) IXDR_GET_ULONG (buf) << 32;
+	fp->fileid	|= IXDR_GET_ULONG (buf);
+	fp->atime.seconds	= IXDR_GET_ULONG (buf);
+	fp->atime.useconds	= IXDR_GET_ULONG (buf);
+	fp->mtime.seconds	= IXDR_GET_ULONG (buf);
+	fp->mtime.useconds	= IXDR_GET_ULONG (buf);
+	fp->ctime.seconds	= IXDR_GET_ULONG (buf);
+	fp->ctime.useconds	= IXDR_GET_ULONG (buf);
+	
+	return TRUE;
+}
+
+bool_t
+xdr_post_op_attr (xdrs *x, post_op_attr *ap)
+{
+	if (!xdr_bool (x, &ap->present))
+		return FALSE;
+	
+	if (ap->present)
+		return xdr_fattr3 (x, &ap->attributes);
+	
+	return TRUE;
+}
+
+bool_t
+xdr_wcc_data (xdrs *x, wcc_data *wp)
+{
+	bool_t before;
+	
+	if (!xdr_bool (x, &before))
+		return FALSE;
+	
+	/* size, mtime and ctime before the operation */
+	if (before && !xdr_inline (x, 6 * BYTES_PER_XDR_UNIT))
+		return FALSE;
+	
+	return xdr_post_op_attr (x, &wp->after);
+}
+
+bool_t
+xdr_sattr3 (xdrs *x, sattr3 *sp)
+{
+	if (!xdr_bool (x, &sp->set_mode))
+		return FALSE;
+	if (sp->set_mode && !xdr_ulong (x, &sp->mode))
+		return FALSE;
+	
+	if (!xdr_bool (x, &sp->set_uid))
+		return FALSE;
+	if (sp->set_uid && !xdr_ulong (x, &sp->uid))
+		return FALSE;
+	
+	if (!xdr_bool (x, &sp->set_gid))
+		return FALSE;
+	if (sp->set_gid && !xdr_ulong (x, &sp->gid))
+		return FALSE;
+	
+	if (!xdr_bool (x, &sp->set_size))
+		return FALSE;
+	if (sp->set_size && !xdr_uint64 (x, &sp->size))
+		return FALSE;
+	
+	if (!xdr_enum (x, &sp->set_atime))
+		return FALSE;
+	if (sp->set_atime == SET_TO_CLIENT_TIME && !xdr_nfstime (x, &sp->atime))
+		return FALSE;
+	
+	if (!xdr_enum (x, &sp->set_mtime))
+		return FALSE;
+	if (sp->set_mtime == SET_TO_CLIENT_TIME && !xdr_nfstime (x, &sp->mtime))
+		return FALSE;
+	
+	return TRUE;
+}
+
+long
+xdr_size_sattr3 (sattr3 *sp)
+{
+	long r = 6 * sizeof (ulong);
+	
+	if (sp->set_mode)
+		r += sizeof (ulong);
+	if (sp->set_uid)
+		r += sizeof (ulong);
+	if (sp->set_gid)
+		r += sizeof (ulong);
+	if (sp->set_size)
+		r += 2 * sizeof (ulong);
+	if (sp->set_atime == SET_TO_CLIENT_TIME)
+		r += xdr_size_nfstime (&sp->atime);
+	if (sp->set_mtime == SET_TO_CLIENT_TIME)
+		r += xdr_size_nfstime (&sp->mtime);
+	
+	return r;
+}
+
+bool_t
+xdr_diropargs3 (xdrs *x, diropargs3 *ap)
+{
+	if (!xdr_nfsfh3 (x, &ap->dir))
+		return FALSE;
+	
+	return xdr_string (x, &ap->name, MAXNAMLEN);
+}
+
+long
+xdr_size_diropargs3 (diropargs3 *ap)
+{
+	long r = xdr_size_nfsfh3 (&ap->dir);
+	
+	r += sizeof (ulong);
+	r += (strlen (ap->name) + 3) & (~3L);  /* round up to four bytes */
+	
+	return r;
+}
+
+bool_t
+xdr_getattrres3 (xdrs *x, getattrres3 *rp)
+{
+	if (!xdr_enum (x, &rp->status))
+		return FALSE;
+	
+	if (NFS_OK == rp->status)
+		return xdr_fattr3 (x, &rp->attributes);
+	
+	return TRUE;
+}
+
+bool_t
+xdr_setattrargs3 (xdrs *x, setattrargs3 *ap)
+{
+	bool_t check = FALSE;	/* no ctime guard */
+	
+	if (!xdr_nfsfh3 (x, &ap->file))
+		return FALSE;
+	
+	if (!xdr_sattr3 (x, &ap->attributes))
+		return FALSE;
+	
+	return xdr_bool (x, &check);
+}
+
+bool_t
+xdr_wccstat3 (xdrs *x, wccstat3 *rp)
+{
+	if (!xdr_enum (x, &rp->status))
+		return FALSE;
+	
+	return xdr_wcc_data (x, &rp->wcc);
+}
+
+bool_t
+xdr_lookupres3 (xdrs *x, diropres3 *rp)
+{
+	if (!xdr_enum (x, &rp->status))
+		return FALSE;
+	
+	if (NFS_OK == rp->status)
+	{
+		rp->has_file = TRUE;
+		if (!xdr_nfsfh3 (x, &rp->file))
+			return FALSE;
+		
+		return xdr_post_op_attr (x, &rp->attributes);
+	}
+	
+	return TRUE;
+}
+
+bool_t
+xdr_createres3 (xdrs *x, diropres3 *rp)
+{
+	if (!xdr_enum (x, &rp->status))
+		return FALSE;
+	
+	if (NFS_OK == rp->status)
+	{
+		if (!xdr_bool (x, &rp->has_file))
+			return FALSE;
+		
+		if (rp->has_file && !xdr_nfsfh3 (x, &rp->file))
+			return FALSE;
+		
+		return xdr_post_op_attr (x, &rp->attributes);
+	}
+	
+	return TRUE;
+}
+
+bool_t
+xdr_readlinkres3 (xdrs *x, readlinkres3 *rp)
+{
+	if (!xdr_enum (x, &rp->status))
+		return FALSE;
+	
+	if (!xdr_post_op_attr (x, &rp->attributes))
+		return FALSE;
+	
+	if (NFS_OK == rp->status)
+	{
+		const char *name = rp->data;
+		
+		return xdr_string (x, &name, MAXPATHLEN);
+	}
+	
+	return TRUE;
+}
+
+bool_t
+xdr_readargs3 (xdrs *x, readargs3 *ap)
+{
+	if (!xdr_nfsfh3 (x, &ap->file))
+		return FALSE;
+	
+	if (!xdr_uint64 (x, &ap->offset))
+		return FALSE;
+	
+	return xdr_ulong (x, &ap->count);
+}
+
+bool_t
+xdr_readres3 (xdrs *x, readres3 *rp)
+{
+	if (!xdr_enum (x, &rp->status))
+		return FALSE;
+	
+	if (!xdr_post_op_attr (x, &rp->attributes))
+		return FALSE;
+	
+	if (NFS_OK == rp->status)
+	{
+		const char *data = rp->data_val;
+		long max = rp->data_len;
+		
+		if (!xdr_ulong (x, &rp->count))
+			return FALSE;
+		
+		if (!xdr_bool (x, &rp->eof))
+			return FALSE;
+		
+		/* the caller sets data_len to the size of data_val */
+		return xdr_opaque (x, &data, (long *) &rp->data_len, max);
+	}
+	
+	return TRUE;
+}
+
+bool_t
+xdr_writeargs3 (xdrs *x, writeargs3 *ap)
+{
+	if (!xdr_nfsfh3 (x, &ap->file))
+		return FALSE;
+	
+	if (!xdr_uint64 (x, &ap->offset))
+		return FALSE;
+	
+	if (!xdr_ulong (x, &ap->count))
+		return FALSE;
+	
+	if (!xdr_enum (x, &ap->stable))
+		return FALSE;
+	
+	return xdr_opaque (x, &ap->data_val, (long *) &ap->data_len, NFS3_MAXDATA);
+}
+
+bool_t
+xdr_writeres3 (xdrs *x, writeres3 *rp)
+{
+	if (!xdr_enum (x, &rp->status))
+		return FALSE;
+	
+	if (!xdr_wcc_data (x, &rp->wcc))
+		return FALSE;
+	
+	if (NFS_OK == rp->status)
+	{
+		if (!xdr_ulong (x, &rp->count))
+			return FALSE;
+		
+		if (!xdr_enum (x, &rp->committed))
+			return FALSE;
+		
+		return xdr_fixedopaq (x, rp->verf, NFS3_WRITEVERFSIZE);
+	}
+	
+	return TRUE;
+}
+
+bool_t
+xdr_commitres3 (xdrs *x, commitres3 *rp)
+{
+	if (!xdr_enum (x, &rp->status))
+		return FALSE;
+	
+	if (!xdr_wcc_data (x, &rp->wcc))
+		return FALSE;
+	
+	if (NFS_OK == rp->status)
+		return xdr_fixedopaq (x, rp->verf, NFS3_WRITEVERFSIZE);
+	
+	return TRUE;
+}
+
+bool_t
+xdr_createargs3 (xdrs *x, createargs3 *ap)
+{
+	if (!xdr_diropargs3 (x, &ap->where))
+		return FALSE;
+	
+	if (!xdr_enum (x, &ap->how))
+		return FALSE;
+	
+	return xdr_sattr3 (x, &ap->attributes);
+}
+
+bool_t
+xdr_mkdirargs3 (xdrs *x, mkdirargs3 *ap)
+{
+	if (!xdr_diropargs3 (x, &ap->where))
+		return FALSE;
+	
+	return xdr_sattr3 (x, &ap->attributes);
+}
+
+bool_t
+xdr_symlinkargs3 (xdrs *x, symlinkargs3 *ap)
+{
+	if (!xdr_diropargs3 (x, &ap->where))
+		return FALSE;
+	
+	if (!xdr_sattr3 (x, &ap->attributes))
+		return FALSE;
+	
+	return xdr_string (x, &ap->to, MAXPATHLEN);
+}
+
+long
+xdr_size_symlinkargs3 (symlinkargs3 *ap)
+{
+	long r = xdr_size_diropargs3 (&ap->where);
+	
+	r += xdr_size_sattr3 (&ap->attributes);
+	r += sizeof (ulong);
+	r += (strlen (ap->to) + 3) & (~3L);
+	
+	return r;
+}
+
+bool_t
+xdr_renameargs3 (xdrs *x, renameargs3 *ap)
+{
+	if (!xdr_diropargs3 (x, &ap->from))
+		return FALSE;
+	
+	return xdr_diropargs3 (x, &ap->to);
+}
+
+bool_t
+xdr_linkargs3 (xdrs *x, linkargs3 *ap)
+{
+	if (!xdr_nfsfh3 (x, &ap->file))
+		return FALSE;
+	
+	return xdr_diropargs3 (x, &ap->link);
+}
+
+bool_t
+xdr_readdirplusargs3 (xdrs *x, readdirplusargs3 *ap)
+{
+	if (!xdr_nfsfh3 (x, &ap->dir))
+		return FALSE;
+	
+	if (!xdr_uint64 (x, &ap->cookie))
+		return FALSE;
+	
+	if (!xdr_fixedopaq (x, ap->cookieverf, NFS3_COOKIEVERFSIZE))
+		return FALSE;
+	
+	if (!xdr_ulong (x, &ap->dircount))
+		return FALSE;
+	
+	return xdr_ulong (x, &ap->maxcount);
+}
+
+bool_t
+xdr_readdirplusres3 (xdrs *x, readdirplusres3 *rp)
+{
+	post_op_attr dir_attr;
+	
+	if (!xdr_enum (x, &rp->status))
+		return FALSE;
+	
+	if (!xdr_post_op_attr (x, &dir_attr))
+		return FALSE;
+	
+	if (NFS_OK == rp->status)
+	{
+		if (!xdr_fixedopaq (x, rp->cookieverf, NFS3_COOKIEVERFSIZE))
+			return FALSE;
+		
+		return xdr_bool (x, &rp->more);
+	}
+	
+	return TRUE;
+}
+
+bool_t
+xdr_entryplus3 (xdrs *x, entryplus3 *ep)
+{
+	const char *name = ep->name;
+	
+	if (!xdr_uint64 (x, &ep->fileid))
+		return FALSE;
+	
+	if (!xdr_string (x, &name, MAXNAMLEN))
+		return FALSE;
+	
+	if (!xdr_uint64 (x, &ep->cookie))
+		return FALSE;
+	
+	if (!xdr_post_op_attr (x, &ep->attributes))
+		return FALSE;
+	
+	if (!xdr_bool (x, &ep->has_handle))
+		return FALSE;
+	
+	if (ep->has_handle && !xdr_nfsfh3 (x, &ep->handle))
+		return FALSE;
+	
+	return xdr_bool (x, &ep->more);
+}
+
+bool_t
+xdr_fsstatres3 (xdrs *x, fsstatres3 *rp)
+{
+	if (!xdr_enum (x, &rp->status))
+		return FALSE;
+	
+	if (!xdr_post_op_attr (x, &rp->attributes))
+		return FALSE;
+	
+	if (NFS_OK == rp->status)
+	{
+		if (!xdr_uint64 (x, &rp->tbytes))
+			return FALSE;
+		if (!xdr_uint64 (x, &rp->fbytes))
+			return FALSE;
+		if (!xdr_uint64 (x, &rp->abytes))
+			return FALSE;
+		if (!xdr_uint64 (x, &rp->tfiles))
+			return FALSE;
+		if (!xdr_uint64 (x, &rp->ffiles))
+			return FALSE;
+		if (!xdr_uint64 (x, &rp->afiles))
+			return FALSE;
+		
+		return xdr_ulong (x, &rp->invarsec);
+	}
+	
+	return TRUE;
+}
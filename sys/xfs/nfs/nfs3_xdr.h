@@ -0,0 +1,467 @@
+/*
+ * This file belongs to FreeMiNT. It's not in the original MiNT 1.12
+ * distribution. See the file CHANGES for a detailed log of changes.
+ *
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This file is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *
+ * Please send suggestions, patches or bug reports to me or
+ * the MiNT mailing list.
+ *
+ */
+
+/*
+ *  File : nfs3_xdr.h
+ *         definitions for the version 3 protocol, see rfc 1813
+ */
+
+
+# ifndef _nfs3_xdr_h
+# define _nfs3_xdr_h
+
+
+# include "global.h"
+# include "xdr.h"
+
+
+/* request numbers
+ */
+
+# define NFSPROC3_NULL		0
+# define NFSPROC3_GETATTR	1
+# define NFSPROC3_SETATTR	2
+# define NFSPROC3_LOOKUP	3
+# define NFSPROC3_ACCESS	4
+# define NFSPROC3_READLINK	5
+# define NFSPROC3_READ		6
+# define NFSPROC3_WRITE		7
+# define NFSPROC3_CREATE	8
+# define NFSPROC3_MKDIR		9
+# define NFSPROC3_SYMLINK	10
+# define NFSPROC3_MKNOD		11
+# define NFSPROC3_REMOVE	12
+# define NFSPROC3_RMDIR		13
+# define NFSPROC3_RENAME	14
+# define NFSPROC3_LINK		15
+# define NFSPROC3_READDIR	16
+# define NFSPROC3_READDIRPLUS	17
+# define NFSPROC3_FSSTAT	18
+# define NFSPROC3_FSINFO	19
+# define NFSPROC3_PATHCONF	20
+# define NFSPROC3_COMMIT	21
+
+# define NFS3_VERSION		3
+
+
+# define NFS3_FHSIZE		64	/* max size in bytes of a file handle */
+# define NFS3_COOKIEVERFSIZE	8
+# define NFS3_WRITEVERFSIZE	8
+
+/* The protocol itself has no limit, but a READ reply or WRITE call has
+ * to fit into a single UDP datagram together with its rpc header.
+ */
+# define NFS3_MAXDATA		32768
+
+
+/* the error codes that are new in version 3; the others are the same as
+ * in enum nfsstat
+ */
+# define NFS3ERR_XDEV		18
+# define NFS3ERR_INVAL		22
+# define NFS3ERR_MLINK		31
+# define NFS3ERR_BADHANDLE	10001
+# define NFS3ERR_NOT_SYNC	10002
+# define NFS3ERR_BAD_COOKIE	10003
+# define NFS3ERR_NOTSUPP	10004
+# define NFS3ERR_TOOSMALL	10005
+# define NFS3ERR_SERVERFAULT	10006
+# define NFS3ERR_BADTYPE	10007
+# define NFS3ERR_JUKEBOX	10008
+
+
+/* ftype3 uses the same numbers as ftype, plus these */
+# define NF3SOCK		6
+# define NF3FIFO		7
+
+
+/* stable_how */
+# define UNSTABLE		0
+# define DATA_SYNC		1
+# define FILE_SYNC		2
+
+/* createmode3 */
+# define UNCHECKED		0
+# define GUARDED		1
+# define EXCLUSIVE		2
+
+/* time_how */
+# define DONT_CHANGE		0
+# define SET_TO_SERVER_TIME	1
+# define SET_TO_CLIENT_TIME	2
+
+
+bool_t xdr_uint64 (xdrs *x, ullong *val);
+
+
+typedef struct nfs_fh3
+{
+	ulong	len;
+	opaque	data[NFS3_FHSIZE];
+} nfs_fh3;
+
+bool_t xdr_nfsfh3 (xdrs *x, nfs_fh3 *fhp);
+# define xdr_size_nfsfh3(fhp)	(sizeof (ulong) + (((fhp)->len + 3) & ~3L))
+
+
+/* nfstime3 has the same layout as nfstime, but counts nanoseconds
+ * in the second field
+ */
+typedef struct fattr3 fattr3;
+struct fattr3
+{
+	ftype	type;
+	ulong	mode;
+	ulong	nlink;
+	ulong	uid;
+	ulong	gid;
+	ullong	size;
+	ullong	used;
+	ulong	rdev_major;
+	ulong	rdev_minor;
+	ullong	fsid;
+	ullong	fileid;
+	nfstime	atime;
+	nfstime	mtime;
+	nfstime	ctime;
+};
+
+bool_t xdr_fattr3 (xdrs *x, fattr3 *fp);
+# define xdr_size_fattr3(fp)	(21 * sizeof (ulong))
+
+
+typedef struct post_op_attr post_op_attr;
+struct post_op_attr
+{
+	bool_t	present;
+	fattr3	attributes;
+};
+
+bool_t xdr_post_op_attr (xdrs *x, post_op_attr *ap);
+
+
+/* the pre_op_attr half is skipped while decoding */
+typedef struct wcc_data wcc_data;
+struct wcc_data
+{
+	post_op_attr after;
+};
+
+bool_t xdr_wcc_data (xdrs *x, wcc_data *wp);
+
+
+typedef struct sattr3 sattr3;
+struct sattr3
+{
+	bool_t	set_mode;
+	ulong	mode;
+	bool_t	set_uid;
+	ulong	uid;
+	bool_t	set_gid;
+	ulong	gid;
+	bool_t	set_size;
+	ullong	size;
+	enum_t	set_atime;
+	nfstime	atime;
+	enum_t	set_mtime;
+	nfstime	mtime;
+};
+
+bool_t xdr_sattr3 (xdrs *x, sattr3 *sp);
+long xdr_size_sattr3 (sattr3 *sp);
+
+
+
+/* arguments for and results of nfs functions
+ */
+
+typedef struct diropargs3 diropargs3;
+struct diropargs3
+{
+	nfs_fh3	dir;
+	const char	*name;
+};
+
+bool_t xdr_diropargs3 (xdrs *x, diropargs3 *ap);
+long xdr_size_diropargs3 (diropargs3 *ap);
+
+
+typedef struct getattrres3 getattrres3;
+struct getattrres3
+{
+	enum_t	status;
+	fattr3	attributes;
+};
+
+bool_t xdr_getattrres3 (xdrs *x, getattrres3 *rp);
+
+
+typedef struct setattrargs3 setattrargs3;
+struct setattrargs3
+{
+	nfs_fh3	file;
+	sattr3	attributes;
+};
+
+bool_t xdr_setattrargs3 (xdrs *x, setattrargs3 *ap);
+# define xdr_size_setattrargs3(ap) \
+	(xdr_size_nfsfh3 (&(ap)->file) + xdr_size_sattr3 (&(ap)->attributes) + sizeof (ulong))
+
+
+/* status and the wcc_data of the changed object, used for the results
+ * of SETATTR, REMOVE and RMDIR
+ */
+typedef struct wccstat3 wccstat3;
+struct wccstat3
+{
+	enum_t	status;
+	wcc_data wcc;
+};
+
+bool_t xdr_wccstat3 (xdrs *x, wccstat3 *rp);
+
+
+/* results of LOOKUP, CREATE, MKDIR and SYMLINK; the attributes of the
+ * directory are skipped
+ */
+typedef struct diropres3 diropres3;
+struct diropres3
+{
+	enum_t	status;
+	bool_t	has_file;
+	nfs_fh3	file;
+	post_op_attr attributes;
+};
+
+bool_t xdr_lookupres3 (xdrs *x, diropres3 *rp);
+bool_t xdr_createres3 (xdrs *x, diropres3 *rp);
+
+
+typedef struct readlinkres3 readlinkres3;
+struct readlinkres3
+{
+	enum_t	status;
+	post_op_attr attributes;
+	char *	data;
+};
+
+bool_t xdr_readlinkres3 (xdrs *x, readlinkres3 *rp);
+
+
+typedef struct readargs3 readargs3;
+struct readargs3
+{
+	nfs_fh3	file;
+	ullong	offset;
+	ulong	count;
+};
+
+bool_t xdr_readargs3 (xdrs *x, readargs3 *ap);
+# define xdr_size_readargs3(ap)	(xdr_size_nfsfh3 (&(ap)->file) + 3 * sizeof (ulong))
+
+
+typedef struct readres3 readres3;
+struct readres3
+{
+	enum_t	status;
+	post_op_attr attributes;
+	ulong	count;
+	bool_t	eof;
+	char *	data_val;
+	ulong	data_len;	/* size of data_val on entry */
+};
+
+bool_t xdr_readres3 (xdrs *x, readres3 *rp);
+
+
+typedef struct writeargs3 writeargs3;
+struct writeargs3
+{
+	nfs_fh3	file;
+	ullong	offset;
+	ulong	count;
+	enum_t	stable;
+	const char *	data_val;
+	ulong	data_len;
+};
+
+bool_t xdr_writeargs3 (xdrs *x, writeargs3 *ap);
+# define xdr_size_writeargs3(ap) \
+	(xdr_size_nfsfh3 (&(ap)->file) + 5 * sizeof (ulong) + (((ap)->data_len + 3) & ~3L))
+
+
+typedef struct writeres3 writeres3;
+struct writeres3
+{
+	enum_t	status;
+	wcc_data wcc;
+	ulong	count;
+	enum_t	committed;
+	opaque	verf[NFS3_WRITEVERFSIZE];
+};
+
+bool_t xdr_writeres3 (xdrs *x, writeres3 *rp);
+
+
+/* COMMIT takes the same arguments as READ */
+typedef readargs3 commitargs3;
+
+# define xdr_commitargs3	xdr_readargs3
+# define xdr_size_commitargs3	xdr_size_readargs3
+
+
+typedef struct commitres3 commitres3;
+struct commitres3
+{
+	enum_t	status;
+	wcc_data wcc;
+	opaque	verf[NFS3_WRITEVERFSIZE];
+};
+
+bool_t xdr_commitres3 (xdrs *x, commitres3 *rp);
+
+
+typedef struct createargs3 createargs3;
+struct createargs3
+{
+	diropargs3	where;
+	enum_t		how;		/* only UNCHECKED and GUARDED */
+	sattr3		attributes;
+};
+
+bool_t xdr_createargs3 (xdrs *x, createargs3 *ap);
+# define xdr_size_createargs3(ap) \
+	(xdr_size_diropargs3 (&(ap)->where) + sizeof (ulong) + xdr_size_sattr3 (&(ap)->attributes))
+
+
+typedef struct mkdirargs3 mkdirargs3;
+struct mkdirargs3
+{
+	diropargs3	where;
+	sattr3		attributes;
+};
+
+bool_t xdr_mkdirargs3 (xdrs *x, mkdirargs3 *ap);
+# define xdr_size_mkdirargs3(ap) \
+	(xdr_size_diropargs3 (&(ap)->where) + xdr_size_sattr3 (&(ap)->attributes))
+
+
+typedef struct symlinkargs3 symlinkargs3;
+struct symlinkargs3
+{
+	diropargs3	where;
+	sattr3		attributes;
+	const char *	to;
+};
+
+bool_t xdr_symlinkargs3 (xdrs *x, symlinkargs3 *ap);
+long xdr_size_symlinkargs3 (symlinkargs3 *ap);
+
+
+typedef struct renameargs3 renameargs3;
+struct renameargs3
+{
+	diropargs3	from;
+	diropargs3	to;
+};
+
+bool_t xdr_renameargs3 (xdrs *x, renameargs3 *ap);
+# define xdr_size_renameargs3(ap) \
+	(xdr_size_diropargs3 (&(ap)->from) + xdr_size_diropargs3 (&(ap)->to))
+
+
+typedef struct linkargs3 linkargs3;
+struct linkargs3
+{
+	nfs_fh3		file;
+	diropargs3	link;
+};
+
+bool_t xdr_linkargs3 (xdrs *x, linkargs3 *ap);
+# define xdr_size_linkargs3(ap) \
+	(xdr_size_nfsfh3 (&(ap)->file) + xdr_size_diropargs3 (&(ap)->link))
+
+
+typedef struct readdirplusargs3 readdirplusargs3;
+struct readdirplusargs3
+{
+	nfs_fh3	dir;
+	ullong	cookie;
+	opaque	cookieverf[NFS3_COOKIEVERFSIZE];
+	ulong	dircount;
+	ulong	maxcount;
+};
+
+bool_t xdr_readdirplusargs3 (xdrs *x, readdirplusargs3 *ap);
+# define xdr_size_readdirplusargs3(ap)	(xdr_size_nfsfh3 (&(ap)->dir) + 6 * sizeof (ulong))
+
+
+/* READDIRPLUS replies are decoded one entry at a time: first the
+ * head of the reply, then each entry, then the eof flag
+ */
+typedef struct readdirplusres3 readdirplusres3;
+struct readdirplusres3
+{
+	enum_t	status;
+	opaque	cookieverf[NFS3_COOKIEVERFSIZE];
+	bool_t	more;		/* an entry follows */
+};
+
+bool_t xdr_readdirplusres3 (xdrs *x, readdirplusres3 *rp);
+
+
+typedef struct entryplus3 entryplus3;
+struct entryplus3
+{
+	ullong	fileid;
+	char *	name;
+	ullong	cookie;
+	post_op_attr attributes;
+	bool_t	has_handle;
+	nfs_fh3	handle;
+	bool_t	more;		/* another entry follows */
+};
+
+bool_t xdr_entryplus3 (xdrs *x, entryplus3 *ep);
+
+
+typedef struct fsstatres3 fsstatres3;
+struct fsstatres3
+{
+	enum_t	status;
+	post_op_attr attributes;
+	ullong	tbytes;		/* total size of the file system */
+	ullong	fbytes;		/* free bytes */
+	ullong	abytes;		/* free bytes available to the user */
+	ullong	tfiles;
+	ullong	ffiles;
+	ullong	afiles;
+	ulong	invarsec;
+};
+
+bool_t xdr_fsstatres3 (xdrs *x, fsstatres3 *rp);
+
+
+# endif /* _nfs3_xdr_h */
@@ -23,6 +23,7 @@
 
 # include "mint/ioctl.h"
 
+# include "nfsio.h"
 # include "nfssys.h"
 # include "nfsutil.h"
 # include "sock_ipc.h"
@@ -94,255 +95,236 @@ nfs_open (FILEPTR *f)
 		}
 	}
 	
+	/* without it the file is read and written unbuffered */
+	f->devinfo = (long) nfs_file_open (ni);
+	
 	DEBUG (("nfs_open(%s) -> ok", ni->name));
 	return 0;
 }
 
-/* BUG: should we really allways return EWRITE? Better might be the number of
- *      already written bytes.
- */
-static long _cdecl
-nfs_write (FILEPTR *f, const char *buf, long bytes)
+/* the version 2 READ and WRITE requests for nfs_pipeline() */
+
+static long
+start_write (NFS_INDEX *ni, IO_SLOT *s)
 {
-	NFS_INDEX *ni = (NFS_INDEX *) f->fc.index;
+	writeargs write_arg;
+	MESSAGE *mreq;
+	xdrs x;
 	
-	long pos;
-	long written;
+	write_arg.file = ni->handle;
+	write_arg.beginoffset = 0;
+	write_arg.offset = s->pos;
+	write_arg.totalcount = s->count;
+	write_arg.data_val = s->buf;
+	write_arg.data_len = s->count;
 	
-	/* TL: If we get an NFSERR_IO we'll reduce the wsize for this request
-	 * and retry.
-	 * It would be better to adjust wsize dynamically but this is better
-	 * than nothing.
-	 */
-	long wsize = ni->opt->wsize;
-	
-	/* TL: If somehow mounted with too big wsize reduce it here. */
-	if (wsize > MAXDATA)
-		wsize = ni->opt->wsize = MAXDATA;
+	mreq = alloc_message (&s->m, NULL, 0, xdr_size_writeargs (&write_arg));
+	if (!mreq)
+	{
+		DEBUG (("nfs_write: could not allocate message buffer -> EWRITE"));
+		return EWRITE;
+	}
 	
-	if (ROOT_INDEX == ni)
+	xdr_init (&x, mreq->data, mreq->data_len, XDR_ENCODE, NULL);
+	if (!xdr_writeargs (&x, &write_arg))
 	{
-		DEBUG (("nfs_write: attempt to write root dir! -> 0"));
-		return 0;
+		free_message (mreq);
+		
+		DEBUG (("nfs_write: failed to encode arguments -> EWRITE"));
+		return EWRITE;
 	}
 	
-	if (ni->opt->flags & OPT_RO)
+	if (rpc_send (&ni->opt->server, mreq, NFSPROC_WRITE, &s->call) != 0)
 	{
-		DEBUG (("nfs_write: mount is read-only -> EACCES"));
-		return EACCES;
+		DEBUG (("nfs_write: could not contact server -> EWRITE"));
+		return EWRITE;
 	}
 	
-	TRACE(("nfs_write: writing %ld bytes to file '%s'", bytes, ni->name));
+	return 0;
+}
+
+static long
+end_write (NFS_INDEX *ni, IO_SLOT *s)
+{
+	attrstat write_res;
+	MESSAGE *mrep;
+	xdrs x;
+	
+	if (rpc_wait (&s->call, &mrep) != 0)
+	{
+		DEBUG (("nfs_write: could not contact server -> EWRITE"));
+		return EWRITE;
+	}
 	
-	written = 0;
-	pos = f->pos;
-	while (bytes > 0)
+	xdr_init (&x, mrep->data, mrep->data_len, XDR_DECODE, NULL);
+	if (!xdr_attrstat (&x, &write_res))
 	{
-		writeargs write_arg;
-		attrstat write_res;
-		xdrs x;
-		
-		MESSAGE *mreq;
-		MESSAGE *mrep;
-		MESSAGE m;
-		
-		long count = (bytes > wsize) ? wsize : bytes;
-		long r;
-		
-		write_arg.file = ni->handle;
-		write_arg.beginoffset = 0;
-		write_arg.offset = pos;
-		write_arg.totalcount = count;
-		write_arg.data_val = buf + written;
-		write_arg.data_len = count;
-		
-		mreq = alloc_message (&m, NULL, 0, xdr_size_writeargs (&write_arg));
-		if (!mreq)
-		{
-			DEBUG(("nfs_write: could not allocate message buffer -> EWRITE"));
-			return EWRITE;
-		}
-		
-		xdr_init (&x, mreq->data, mreq->data_len, XDR_ENCODE, NULL);
-		if (!xdr_writeargs (&x, &write_arg))
-		{
-			DEBUG (("nfs_write: failed to encode arguments -> EWRITE"));
-			return EWRITE;
-		}
+		free_message (mrep);
 		
-		r = rpc_request (&ni->opt->server, mreq, NFSPROC_WRITE, &mrep);
-		if (r != 0)
-		{
-			DEBUG (("nfs_write: could not contact server -> EWRITE"));
-			return EWRITE;
-		}
+		DEBUG (("nfs_write: failed to decode results -> EWRITE"));
+		return EWRITE;
+	}
+	
+	free_message (mrep);
+	
+	if (write_res.status != NFS_OK)
+	{
+		/* TL: Reduce the wsize and try again */
+		s->retry = (write_res.status == NFSERR_IO);
 		
-		xdr_init (&x, mrep->data, mrep->data_len, XDR_DECODE, NULL);
-		if (!xdr_attrstat (&x, &write_res))
-		{
-			free_message (mrep);
-			
-			DEBUG (("nfs_write: failed to decode results -> EWRITE"));
-			return EWRITE;
-		}
+		DEBUG (("nfs_write: rpc->%d -> EWRITE", write_res.status));
+		return EWRITE;
+	}
+	
+	fattr2xattr (&write_res.attrstat_u.attributes, &ni->attr);
+	ni->stamp = get_timestamp ();
+	
+	/* version 2 writes are always complete */
+	return s->count;
+}
+
+static IO_OPS write_ops = { start_write, end_write, 1 };
+
+long
+nfs2_write_rpcs (NFS_INDEX *ni, long pos, const char *buf, long bytes, long chunk, int depth)
+{
+	long r;
+	
+	TRACE (("nfs_write: writing %ld bytes to file '%s'", bytes, ni->name));
+	
+	r = nfs_pipeline (ni, &write_ops, pos, (char *) buf, bytes, chunk, depth, NULL);
+	
+	TRACE (("nfs_write(%s) -> %ld", ni->name, r));
+	return r;
+}
+
+static long
+start_read (NFS_INDEX *ni, IO_SLOT *s)
+{
+	readargs read_arg;
+	MESSAGE *mreq;
+	xdrs x;
+	
+	read_arg.file = ni->handle;
+	read_arg.offset = s->pos;
+	read_arg.count = s->count;
+	read_arg.totalcount = s->count;
+	
+	mreq = alloc_message (&s->m, s->req_buf, IOSLOT_BUFSIZE, xdr_size_readargs (&read_arg));
+	if (!mreq)
+	{
+		DEBUG (("nfs_read: failed to allocate message buffer, -> EREAD"));
+		return EREAD;
+	}
+	
+	xdr_init (&x, mreq->data, mreq->data_len, XDR_ENCODE, NULL);
+	if (!xdr_readargs (&x, &read_arg))
+	{
+		free_message (mreq);
 		
+		DEBUG (("nfs_read: failed to encode arguments, -> EREAD"));
+		return EREAD;
+	}
+	
+	if (rpc_send (&ni->opt->server, mreq, NFSPROC_READ, &s->call) != 0)
+	{
+		DEBUG (("nfs_read: failed to contact server, -> EREAD"));
+		return EREAD;
+	}
+	
+	return 0;
+}
+
+static long
+end_read (NFS_INDEX *ni, IO_SLOT *s)
+{
+	readres read_res;
+	MESSAGE *mrep;
+	xdrs x;
+	
+	if (rpc_wait (&s->call, &mrep) != 0)
+	{
+		DEBUG (("nfs_read: failed to contact server, -> EREAD"));
+		return EREAD;
+	}
+	
+	read_res.readres_u.read_ok.data_val = s->buf;
+	
+	xdr_init (&x, mrep->data, mrep->data_len, XDR_DECODE, NULL);
+	if (!xdr_readres (&x, &read_res))
+	{
 		free_message (mrep);
 		
-		if (write_res.status != NFS_OK)
-		{
-			/* TL: Reduce the wsize and try again */
-			if (write_res.status == NFSERR_IO)
-			{
-				if (wsize > 1023)
-				{
-					wsize >>= 1;
-					continue;
-				}
-				else
-				{
-					DEBUG(("nfs_write: write failed -> EWRITE"));
-					return EWRITE;
-				}
-			}
-		}
-		
-		fattr2xattr (&write_res.attrstat_u.attributes, &ni->attr);
-		ni->stamp = get_timestamp ();
+		DEBUG (("nfs_read: could not decode results, -> EREAD"));
+		return EREAD;
+	}
+	
+	free_message (mrep);
+	
+	if (read_res.status != NFS_OK)
+	{
+		/* TL: Try to reduce the rsize */
+		s->retry = (read_res.status == NFSERR_IO);
 		
-		written += count;
-		pos += count;
-		bytes -= count;
+		DEBUG (("nfs_read: request failed, -> EREAD"));
+		return EREAD;
 	}
 	
-	f->pos = pos;
+	fattr2xattr (&read_res.readres_u.read_ok.attributes, &ni->attr);
+	ni->stamp = get_timestamp ();
 	
-	TRACE (("nfs_write(%s) -> %ld", ni->name, written));
-	return written;
+	/* a short read means end of file */
+	return MIN (read_res.readres_u.read_ok.data_len, s->count);
 }
 
-/* BUG: should we really allways return EREAD? Better might be the number of
- *      already read bytes.
+static IO_OPS read_ops = { start_read, end_read, 0 };
+
+long
+nfs2_read_rpcs (NFS_INDEX *ni, long pos, char *buf, long bytes, long chunk, int depth)
+{
+	TRACE (("nfs_read: reading %ld bytes for file '%s'", bytes, ni->name));
+	
+	return nfs_pipeline (ni, &read_ops, pos, buf, bytes, chunk, depth, NULL);
+}
+
+/* BUG: should we really allways return EWRITE? Better might be the number of
+ *      already written bytes.
  */
 static long _cdecl
-nfs_read (FILEPTR *f, char *buf, long bytes)
+nfs_write (FILEPTR *f, const char *buf, long bytes)
 {
 	NFS_INDEX *ni = (NFS_INDEX *) f->fc.index;
-	long pos;
-	long read;
-	
-	/* TL: If we get an NFSERR_IO try to reduce the rsize for this request
-	 * and retry.
-	 * It would be better to adjust rsize dynamically but this is better
-	 * than nothing.
-	 */
-	long rsize = ni->opt->rsize;
-	
-	/* TL: If somehow mounted with too big rsize reduce it here */
-	if (rsize > MAXDATA)
-		rsize = ni->opt->rsize = MAXDATA;
 	
 	if (ROOT_INDEX == ni)
 	{
-		DEBUG (("nfs_read: attempt to read root dir! -> 0"));
+		DEBUG (("nfs_write: attempt to write root dir! -> 0"));
 		return 0;
 	}
 	
-	TRACE (("nfs_read: reading %ld bytes for file '%s'", bytes, ni->name));
-	
-	read = 0;
-	pos = f->pos;
-	while (bytes > 0)
+	if (ni->opt->flags & OPT_RO)
 	{
-		char req_buf[READBUFSIZE];
-		
-		readargs read_arg;
-		readres read_res;
-		xdrs x;
-		
-		MESSAGE *mreq;
-		MESSAGE *mrep;
-		MESSAGE m;
-		
-		long count = (bytes > ni->opt->rsize) ? ni->opt->rsize : bytes;
-		long r;
-		
-		read_arg.file = ni->handle;
-		read_arg.offset = pos;
-		read_arg.count = count;
-		read_arg.totalcount = count;
-		
-		mreq = alloc_message (&m, req_buf, READBUFSIZE, xdr_size_readargs(&read_arg));
-		if (!mreq)
-		{
-			DEBUG (("nfs_read: failed to allocate message buffer, -> EREAD"));
-			return EREAD;
-		}
-		
-		xdr_init (&x, mreq->data, mreq->data_len, XDR_ENCODE, NULL);
-		if (!xdr_readargs (&x, &read_arg))
-		{
-			DEBUG (("nfs_read: failed to encode arguments, -> EREAD"));
-			return EREAD;
-		}
-		
-		r = rpc_request (&ni->opt->server, mreq, NFSPROC_READ, &mrep);
-		if (r != 0)
-		{
-			DEBUG (("nfs_read: failed to contact server, -> EREAD"));
-			return EREAD;
-		}
+		DEBUG (("nfs_write: mount is read-only -> EACCES"));
+		return EACCES;
+	}
+	
+	return nfs_file_write (f, buf, bytes);
+}
 
-		read_res.readres_u.read_ok.data_val = buf + read;
-		
-		xdr_init (&x, mrep->data, mrep->data_len, XDR_DECODE, NULL);
-		if (!xdr_readres (&x, &read_res))
-		{
-			free_message (mrep);
-			
-			DEBUG (("nfs_read: could not decode results, -> EREAD"));
-			return EREAD;
-		}
-		
-		free_message (mrep);
-		
-		if (read_res.status != NFS_OK)
-		{
-			/* TL: Try to reduce the rsize */
-			if (read_res.status == NFSERR_IO)
-			{
-				if (rsize > 1023)
-				{
-					rsize >>= 1;
-					continue;
-				}
-				else
-				{
-					/* read failed for some reason */
-					DEBUG (("nfs_read: request failed, -> EREAD"));
-					return EREAD;
-				}
-			}
-		}
-		
-		r = read_res.readres_u.read_ok.data_len;
-		read += r;
-		pos += r;
-		bytes -= r;
-		
-		fattr2xattr (&read_res.readres_u.read_ok.attributes, &ni->attr);
-		ni->stamp = get_timestamp ();
-		
-		if (r < count)
-		{
-			/* no more data */
-			
-			DEBUG (("nfs_read: read only %ld bytes, -> ok", r));
-			break;
-		}
+/* BUG: should we really allways return EREAD? Better might be the number of
+ *      already read bytes.
+ */
+static long _cdecl
+nfs_read (FILEPTR *f, char *buf, long bytes)
+{
+	NFS_INDEX *ni = (NFS_INDEX *) f->fc.index;
+	
+	if (ROOT_INDEX == ni)
+	{
+		DEBUG (("nfs_read: attempt to read root dir! -> 0"));
+		return 0;
 	}
 	
-	f->pos = pos;
-	return read;
+	return nfs_file_read (f, buf, bytes);
 }
 
 static long _cdecl
@@ -549,9 +531,23 @@ nfs_datime (FILEPTR *f, ushort *timeptr, int flag)
 static long _cdecl
 nfs_close (FILEPTR *f, int pid)
 {
-	TRACE (("nfs_close -> ok"));
+	NFS_FILE *nf = (NFS_FILE *) f->devinfo;
+	
+	TRACE (("nfs_close"));
+	
+	/* the writes behind are sent on every close, so that errors are
+	 * reported, but the buffers go with the last reference
+	 */
+	if (nf)
+	{
+		long r = nfs_file_close (nf, f->links <= 0);
+		
+		if (f->links <= 0)
+			f->devinfo = 0;
+		
+		return r;
+	}
 	
-	/* nothing to do */
 	return 0;
 }
 
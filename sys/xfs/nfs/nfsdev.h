@@ -22,5 +22,8 @@
 
 extern DEVDRV nfs_device;
 
+long	nfs2_read_rpcs	(NFS_INDEX *ni, long pos, char *buf, long bytes, long chunk, int depth);
+long	nfs2_write_rpcs	(NFS_INDEX *ni, long pos, const char *buf, long bytes, long chunk, int depth);
+
 
 # endif /* _nfsdev_h */
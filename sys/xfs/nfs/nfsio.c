@@ -0,0 +1,657 @@
+/*
+ * This file belongs to FreeMiNT. It's not in the original MiNT 1.12
+ * distribution. See the file CHANGES for a detailed log of changes.
+ *
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This file is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *
+ * Please send suggestions, patches or bug reports to me or
+ * the MiNT mailing list.
+ *
+ */
+
+/*
+ * File : nfsio.c
+ *         pipelined READ/WRITE requests, read-ahead and write-behind
+ *
+ * With one request at a time, a transfer can not go faster than rsize
+ * bytes per round trip to the server. nfs_pipeline() splits a transfer
+ * into chunks and keeps several requests for them in flight.
+ *
+ * On top of that, every open file gets a read-ahead buffer that is filled
+ * with one pipelined transfer when the file is read sequentially, and a
+ * write-behind buffer that collects small contiguous writes until it is
+ * full, the file is closed or the file system is synced. Before anything
+ * is read from the server or its attributes are fetched, all pending
+ * writes to that file are flushed, so that the client sees its own
+ * writes.
+ *
+ * On version 3 mounts the flushed data goes out as unstable WRITEs and
+ * is kept in the commit buffer of the file. A single COMMIT makes it
+ * permanent when the file is closed, on sync (which is also what Fsync
+ * does) or when the buffer has to be reused for data that is not
+ * contiguous or doesn't fit. If the write verifier changes in between,
+ * the server has restarted and lost the data, so it is sent again.
+ */
+
+# include "nfsio.h"
+
+# include "nfs3.h"
+# include "nfsdev.h"
+
+
+/*============================================================*/
+
+static void
+cancel_slots (IO_SLOT *slot, int first, int n, int depth)
+{
+	while (n--)
+	{
+		rpc_cancel (&slot[first].call);
+		first = (first + 1) % depth;
+	}
+}
+
+/* Transfer `bytes' bytes at file offset `pos' in chunks of `chunk'
+ * bytes with at most `depth' requests in flight. Returns the number of
+ * bytes transferred, which is less than requested only at the end of a
+ * file, or an error.
+ */
+long
+nfs_pipeline (NFS_INDEX *ni, IO_OPS *ops, long pos, char *buf, long bytes, long chunk, int depth, void *priv)
+{
+	IO_SLOT slot[RPC_MAXPIPE];
+	long issued = 0;	/* bytes covered by requests sent so far */
+	long done = 0;		/* bytes of finished requests */
+	int first = 0;		/* the oldest request in flight */
+	int n = 0;		/* number of requests in flight */
+	long r;
+	
+	if (depth > RPC_MAXPIPE)
+		depth = RPC_MAXPIPE;
+	else if (depth < 1)
+		depth = 1;
+	
+	for (;;)
+	{
+		IO_SLOT *s;
+		
+		/* keep the pipe filled */
+		while (n < depth && issued < bytes)
+		{
+			s = &slot[(first + n) % depth];
+			s->pos = pos + issued;
+			s->buf = buf + issued;
+			s->count = MIN (chunk, bytes - issued);
+			s->retry = 0;
+			s->priv = priv;
+			
+			r = (*ops->start)(ni, s);
+			if (r != 0)
+				goto error;
+			
+			issued += s->count;
+			n++;
+		}
+		
+		if (n == 0)
+			break;
+		
+		/* the replies are taken in the order of the requests */
+		s = &slot[first];
+		first = (first + 1) % depth;
+		n--;
+		
+		r = (*ops->end)(ni, s);
+		if (r < 0)
+		{
+			/* TL: If we get an NFSERR_IO reduce the size of
+			 * the requests and retry.
+			 */
+			if (s->retry && chunk > 1023)
+			{
+				DEBUG (("nfs_pipeline: reducing chunk size to %ld", chunk >> 1));
+				
+				cancel_slots (slot, first, n, depth);
+				first = n = 0;
+				issued = done;
+				chunk >>= 1;
+				continue;
+			}
+			
+			goto error;
+		}
+		
+		done += r;
+		
+		if (r < s->count)
+		{
+			cancel_slots (slot, first, n, depth);
+			first = n = 0;
+			
+			/* no more data */
+			if (!ops->write)
+				break;
+			
+			/* the server took only part of it, send the rest again */
+			issued = done;
+		}
+	}
+	
+	return done;
+	
+error:
+	cancel_slots (slot, first, n, depth);
+	return r;
+}
+
+
+/* The replies of the READs in flight have to fit into the receive
+ * buffer of the socket, otherwise they are dropped and have to be
+ * requested again. Take smaller chunks if not even two fit.
+ */
+static long
+read_chunk (NFS_INDEX *ni, int *depth)
+{
+	long chunk = NFS_V3 (ni) ? NFS3_MAXDATA : MAXDATA;
+	long n;
+	
+	if (ni->opt->rsize < chunk)
+		chunk = ni->opt->rsize;
+	
+	while (chunk > 1024 && 2 * (chunk + RPC_REPLY_SLACK) > RPC_SOCKBUF)
+		chunk >>= 1;
+	
+	n = RPC_SOCKBUF / (chunk + RPC_REPLY_SLACK);
+	*depth = (n > RPC_MAXPIPE) ? RPC_MAXPIPE : ((n < 1) ? 1 : n);
+	
+	return chunk;
+}
+
+/* WRITE replies are small, but the requests are kept below the buffer
+ * limit so that the write-behind buffer holds a full pipe
+ */
+static long
+write_chunk (NFS_INDEX *ni, int *depth)
+{
+	long chunk = NFS_V3 (ni) ? NFS3_MAXDATA : MAXDATA;
+	
+	if (ni->opt->wsize < chunk)
+		chunk = ni->opt->wsize;
+	
+	if (chunk > NFS_IOBUF_MAX / RPC_MAXPIPE)
+		chunk = NFS_IOBUF_MAX / RPC_MAXPIPE;
+	
+	*depth = RPC_MAXPIPE;
+	return chunk;
+}
+
+static long
+read_rpcs (NFS_INDEX *ni, long pos, char *buf, long bytes)
+{
+	long chunk;
+	int depth;
+	
+	chunk = read_chunk (ni, &depth);
+	
+	if (NFS_V3 (ni))
+		return nfs3_read_rpcs (ni, pos, buf, bytes, chunk, depth);
+	
+	return nfs2_read_rpcs (ni, pos, buf, bytes, chunk, depth);
+}
+
+/* v as for nfs3_write_rpcs, NULL for writes that are permanent on return */
+static long
+write_rpcs (NFS_INDEX *ni, long pos, const char *buf, long bytes, NFS_VERF *v)
+{
+	long chunk;
+	int depth;
+	
+	chunk = write_chunk (ni, &depth);
+	
+	if (NFS_V3 (ni))
+		return nfs3_write_rpcs (ni, pos, buf, bytes, chunk, depth, v);
+	
+	return nfs2_write_rpcs (ni, pos, buf, bytes, chunk, depth);
+}
+
+/*============================================================*/
+
+/* all open files, for flushing the writes to a file before it is read
+ * through another file pointer and for sync
+ */
+static NFS_FILE *open_files = NULL;
+
+/* the kernel may switch to another process while we wait for a reply */
+static void
+lock_file (NFS_FILE *nf)
+{
+	while (nf->busy)
+	{
+		nf->wanted = 1;
+		sleep (IO_Q, (long) nf);
+	}
+	
+	nf->busy = 1;
+}
+
+static void
+unlock_file (NFS_FILE *nf)
+{
+	nf->busy = 0;
+	
+	if (nf->wanted)
+	{
+		nf->wanted = 0;
+		wake (IO_Q, (long) nf);
+	}
+}
+
+/* make the data in the commit buffer permanent */
+static long
+commit_file (NFS_FILE *nf)
+{
+	long r;
+	
+	if (nf->clen == 0)
+		return 0;
+	
+	r = nfs3_commit (nf->ni, nf->cpos, nf->clen, &nf->verf);
+	if (r > 0)
+	{
+		DEBUG (("commit_file(%s): server restarted, resending", nf->ni->name));
+		r = write_rpcs (nf->ni, nf->cpos, nf->cbuf, nf->clen, NULL);
+		if (r > 0)
+			r = 0;
+	}
+	
+	nf->clen = 0;
+	nf->verf.valid = 0;
+	nf->verf.changed = 0;
+	
+	if (r < 0)
+		DEBUG (("commit_file(%s): failed -> %ld", nf->ni->name, r));
+	
+	return r;
+}
+
+static long
+flush_file (NFS_FILE *nf)
+{
+	long r;
+	
+	if (nf->wlen == 0)
+		return 0;
+	
+	if (NFS_V3 (nf->ni) && !nf->cbuf)
+		nf->cbuf = kmalloc (NFS_COMMIT_MAX);
+	
+	/* without a commit buffer the writes are permanent at once */
+	if (!nf->cbuf)
+	{
+		r = write_rpcs (nf->ni, nf->wpos, nf->wbuf, nf->wlen, NULL);
+		nf->wlen = 0;
+		
+		if (r < 0)
+		{
+			DEBUG (("flush_file(%s): write-behind failed -> %ld", nf->ni->name, r));
+			return r;
+		}
+		
+		return 0;
+	}
+	
+	/* only contiguous data is committed at once */
+	if (nf->clen && (nf->wpos != nf->cpos + nf->clen || nf->clen + nf->wlen > NFS_COMMIT_MAX))
+	{
+		r = commit_file (nf);
+		if (r)
+		{
+			nf->wlen = 0;
+			return r;
+		}
+	}
+	
+	r = write_rpcs (nf->ni, nf->wpos, nf->wbuf, nf->wlen, &nf->verf);
+	if (r < 0)
+	{
+		DEBUG (("flush_file(%s): write-behind failed -> %ld", nf->ni->name, r));
+		nf->wlen = 0;
+		return r;
+	}
+	
+	/* what was written before is lost, the server restarted */
+	if (nf->verf.changed)
+	{
+		DEBUG (("flush_file(%s): server restarted, resending", nf->ni->name));
+		
+		nf->verf.changed = 0;
+		if (nf->clen)
+		{
+			r = write_rpcs (nf->ni, nf->cpos, nf->cbuf, nf->clen, NULL);
+			nf->clen = 0;
+			if (r < 0)
+			{
+				nf->wlen = 0;
+				return r;
+			}
+		}
+	}
+	
+	if (nf->clen == 0)
+		nf->cpos = nf->wpos;
+	
+	memcpy (nf->cbuf + nf->clen, nf->wbuf, nf->wlen);
+	nf->clen += nf->wlen;
+	nf->wlen = 0;
+	
+	return 0;
+}
+
+/* Flush the write-behind buffers of all files that are open on `ni', or
+ * of all open files if it is NULL, and with `commit' set make the data
+ * permanent. A failure is also remembered in the file, so that its
+ * owner learns about it on the next write or close.
+ */
+static long
+flush_files (NFS_INDEX *ni, int commit)
+{
+	NFS_FILE *nf;
+	long ret = 0;
+	
+restart:
+	for (nf = open_files; nf; nf = nf->next)
+	{
+		long r;
+		
+		if ((nf->wlen == 0 && (!commit || nf->clen == 0)) || (ni && nf->ni != ni))
+			continue;
+		
+		/* the list may change while we wait, so start over */
+		if (nf->busy)
+		{
+			nf->wanted = 1;
+			sleep (IO_Q, (long) nf);
+			goto restart;
+		}
+		
+		lock_file (nf);
+		r = flush_file (nf);
+		if (r == 0 && commit)
+			r = commit_file (nf);
+		if (r)
+			ret = nf->error = r;
+		unlock_file (nf);
+		
+		goto restart;
+	}
+	
+	return ret;
+}
+
+long
+nfs_flush_index (NFS_INDEX *ni)
+{
+	return flush_files (ni, 0);
+}
+
+long _cdecl
+nfs_sync (void)
+{
+	TRACE (("nfs_sync"));
+	
+	flush_files (NULL, 1);
+	return E_OK;
+}
+
+/* forget what has been read ahead of a file that is written to */
+void
+nfs_drop_readahead (NFS_INDEX *ni)
+{
+	NFS_FILE *nf;
+	
+	for (nf = open_files; nf; nf = nf->next)
+	{
+		if (nf->ni == ni)
+			nf->rlen = 0;
+	}
+}
+
+NFS_FILE *
+nfs_file_open (NFS_INDEX *ni)
+{
+	NFS_FILE *nf;
+	long chunk;
+	int depth;
+	
+	nf = kmalloc (sizeof (*nf));
+	if (!nf)
+		return NULL;
+	
+	bzero (nf, sizeof (*nf));
+	nf->ni = ni;
+	
+	/* the buffers hold one full pipe and are allocated when needed */
+	chunk = read_chunk (ni, &depth);
+	nf->rsize = MIN (chunk * depth, NFS_IOBUF_MAX);
+	
+	chunk = write_chunk (ni, &depth);
+	nf->wsize = MIN (chunk * depth, NFS_IOBUF_MAX);
+	
+	nf->next = open_files;
+	open_files = nf;
+	
+	return nf;
+}
+
+/* Called on every close of the file pointer; `last' is set when the
+ * last reference goes away.
+ */
+long
+nfs_file_close (NFS_FILE *nf, int last)
+{
+	long r;
+	
+	lock_file (nf);
+	
+	r = flush_file (nf);
+	if (r == 0)
+		r = commit_file (nf);
+	if (r == 0)
+		r = nf->error;
+	nf->error = 0;
+	
+	unlock_file (nf);
+	
+	if (last)
+	{
+		NFS_FILE **pp;
+		
+		for (pp = &open_files; *pp; pp = &(*pp)->next)
+		{
+			if (*pp == nf)
+			{
+				*pp = nf->next;
+				break;
+			}
+		}
+		
+		if (nf->rbuf)
+			kfree (nf->rbuf);
+		if (nf->wbuf)
+			kfree (nf->wbuf);
+		if (nf->cbuf)
+			kfree (nf->cbuf);
+		kfree (nf);
+	}
+	
+	return r;
+}
+
+long
+nfs_file_read (FILEPTR *f, char *buf, long bytes)
+{
+	NFS_FILE *nf = (NFS_FILE *) f->devinfo;
+	NFS_INDEX *ni = (NFS_INDEX *) f->fc.index;
+	long pos = f->pos;
+	long done = 0;
+	long r = 0;
+	
+	/* let the server see all writes to this file first */
+	nfs_flush_index (ni);
+	
+	if (!nf)
+	{
+		r = read_rpcs (ni, pos, buf, bytes);
+		if (r > 0)
+			f->pos += r;
+		
+		return r;
+	}
+	
+	lock_file (nf);
+	
+	/* the file has been changed since it was read */
+	if (nf->rlen && (nf->rtime != ni->attr.mtime || nf->rdate != ni->attr.mdate))
+		nf->rlen = 0;
+	
+	while (bytes > 0)
+	{
+		long n;
+		
+		if (pos >= nf->rpos && pos < nf->rpos + nf->rlen)
+		{
+			n = MIN (bytes, nf->rpos + nf->rlen - pos);
+			memcpy (buf + done, nf->rbuf + (pos - nf->rpos), n);
+			
+			pos += n;
+			done += n;
+			bytes -= n;
+			continue;
+		}
+		
+		/* read ahead only when the file is read sequentially in
+		 * pieces smaller than the buffer
+		 */
+		if (pos == nf->seqpos && bytes < nf->rsize)
+		{
+			if (!nf->rbuf)
+				nf->rbuf = kmalloc (nf->rsize);
+			
+			if (nf->rbuf)
+			{
+				nf->rlen = 0;
+				
+				r = read_rpcs (ni, pos, nf->rbuf, nf->rsize);
+				if (r <= 0)
+					break;
+				
+				nf->rpos = pos;
+				nf->rlen = r;
+				nf->rtime = ni->attr.mtime;
+				nf->rdate = ni->attr.mdate;
+				continue;
+			}
+		}
+		
+		r = read_rpcs (ni, pos, buf + done, bytes);
+		if (r > 0)
+		{
+			pos += r;
+			done += r;
+		}
+		
+		break;
+	}
+	
+	nf->seqpos = pos;
+	f->pos = pos;
+	
+	unlock_file (nf);
+	
+	if (r < 0 && done == 0)
+		return r;
+	
+	return done;
+}
+
+long
+nfs_file_write (FILEPTR *f, const char *buf, long bytes)
+{
+	NFS_FILE *nf = (NFS_FILE *) f->devinfo;
+	NFS_INDEX *ni = (NFS_INDEX *) f->fc.index;
+	long r;
+	
+	nfs_drop_readahead (ni);
+	
+	if (!nf)
+	{
+		r = write_rpcs (ni, f->pos, buf, bytes, NULL);
+		if (r > 0)
+		{
+			f->pos += r;
+			if (f->pos > ni->attr.size)
+				ni->attr.size = f->pos;
+		}
+		
+		return r;
+	}
+	
+	lock_file (nf);
+	
+	if (nf->error)
+	{
+		r = nf->error;
+		nf->error = 0;
+		goto out;
+	}
+	
+	/* only contiguous writes are collected */
+	if (nf->wlen && (f->pos != nf->wpos + nf->wlen || nf->wlen + bytes > nf->wsize))
+	{
+		r = flush_file (nf);
+		if (r)
+			goto out;
+	}
+	
+	if (bytes < nf->wsize && !nf->wbuf)
+		nf->wbuf = kmalloc (nf->wsize);
+	
+	if (bytes < nf->wsize && nf->wbuf)
+	{
+		if (nf->wlen == 0)
+			nf->wpos = f->pos;
+		
+		memcpy (nf->wbuf + nf->wlen, buf, bytes);
+		nf->wlen += bytes;
+		r = bytes;
+	}
+	else
+	{
+		r = write_rpcs (ni, f->pos, buf, bytes, NULL);
+		if (r < 0)
+			goto out;
+	}
+	
+	/* until the data is on the server, the size is known only here */
+	f->pos += r;
+	if (f->pos > ni->attr.size)
+		ni->attr.size = f->pos;
+	
+out:
+	unlock_file (nf);
+	return r;
+}
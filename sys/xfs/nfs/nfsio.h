@@ -0,0 +1,115 @@
+/*
+ * This file belongs to FreeMiNT. It's not in the original MiNT 1.12
+ * distribution. See the file CHANGES for a detailed log of changes.
+ *
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This file is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *
+ * Please send suggestions, patches or bug reports to me or
+ * the MiNT mailing list.
+ *
+ */
+
+/*
+ * File : nfsio.h
+ *         pipelined READ/WRITE requests, read-ahead and write-behind
+ */
+
+# ifndef _nfsio_h
+# define _nfsio_h
+
+# include "global.h"
+# include "sock_ipc.h"
+
+
+/* one READ or WRITE request that is on its way to the server */
+typedef struct io_slot IO_SLOT;
+struct io_slot
+{
+	RPC_CALL call;
+	MESSAGE	m;
+	char	req_buf[IOSLOT_BUFSIZE];	/* arguments of small requests */
+	long	pos;		/* file offset of this chunk */
+	long	count;		/* bytes requested */
+	char	*buf;		/* data of this chunk */
+	short	retry;		/* set by end() on NFSERR_IO */
+	void	*priv;		/* for the protocol functions */
+};
+
+/* write verifier of the unstable WRITEs since the last COMMIT */
+typedef struct nfs_verf NFS_VERF;
+struct nfs_verf
+{
+	short	valid;
+	short	changed;	/* the server restarted, writes are lost */
+	opaque	verf[NFS3_WRITEVERFSIZE];
+};
+
+/* the protocol specific part of a transfer: start() encodes and sends
+ * a request, end() waits for its reply and returns the number of bytes
+ * transferred or an error
+ */
+typedef struct io_ops IO_OPS;
+struct io_ops
+{
+	long	(*start)(NFS_INDEX *ni, IO_SLOT *s);
+	long	(*end)(NFS_INDEX *ni, IO_SLOT *s);
+	short	write;		/* short counts do not mean end of file */
+};
+
+long	nfs_pipeline	(NFS_INDEX *ni, IO_OPS *ops, long pos, char *buf, long bytes, long chunk, int depth, void *priv);
+
+
+/* the state of an open file, kept in FILEPTR.devinfo */
+typedef struct nfs_file NFS_FILE;
+struct nfs_file
+{
+	NFS_FILE	*next;		/* list of all open files */
+	NFS_INDEX	*ni;
+	
+	char	*rbuf;		/* read-ahead buffer */
+	long	rpos;		/* file offset of rbuf[0] */
+	long	rlen;		/* number of valid bytes in rbuf */
+	long	rsize;		/* size of rbuf */
+	ushort	rtime, rdate;	/* modification time of the data in rbuf */
+	long	seqpos;		/* where the last read ended */
+	
+	char	*wbuf;		/* write-behind buffer */
+	long	wpos;		/* file offset of wbuf[0] */
+	long	wlen;		/* number of bytes in wbuf */
+	long	wsize;		/* size of wbuf */
+	
+	char	*cbuf;		/* version 3: written, but not committed */
+	long	cpos;		/* file offset of cbuf[0] */
+	long	clen;		/* number of bytes in cbuf */
+	NFS_VERF verf;		/* verifier of the data in cbuf */
+	
+	long	error;		/* a write-behind that failed, for the next call */
+	short	busy;		/* in use by a process */
+	short	wanted;		/* someone sleeps until it is not busy */
+};
+
+NFS_FILE *	nfs_file_open	(NFS_INDEX *ni);
+long		nfs_file_close	(NFS_FILE *nf, int last);
+long		nfs_file_read	(FILEPTR *f, char *buf, long bytes);
+long		nfs_file_write	(FILEPTR *f, const char *buf, long bytes);
+
+long		nfs_flush_index	(NFS_INDEX *ni);
+void		nfs_drop_readahead (NFS_INDEX *ni);
+long _cdecl	nfs_sync	(void);
+
+
+# endif /* _nfsio_h */
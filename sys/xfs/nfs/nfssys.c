@@ -28,6 +28,8 @@
 
 # include "cache.h"
 # include "index.h"
+# include "nfs3.h"
+# include "nfsio.h"
 # include "nfsutil.h"
 # include "sock_ipc.h"
 # include "version.h"
@@ -43,7 +45,7 @@ static long	_cdecl nfs_lookup	(fcookie *dir, const char *name, fcookie *fc);
 static long	_cdecl nfs_creat	(fcookie *dir, const char *name, unsigned int mode, int attrib, fcookie *fc);
 static DEVDRV *	_cdecl nfs_getdev	(fcookie *fc, long *devsp);
        long	_cdecl nfs_getxattr	(fcookie *fc, XATTR *xattr);
-static long	_cdecl nfs_stat64	(fcookie *fc, STAT *ptr);
+       long	_cdecl nfs_stat64	(fcookie *fc, STAT *ptr);
 static long	_cdecl nfs_chattr	(fcookie *fc, int attrib);
 static long	_cdecl nfs_chown	(fcookie *fc, int uid, int gid);
 static long	_cdecl nfs_chmode	(fcookie *fc, unsigned int mode);
@@ -54,6 +56,7 @@ static long	_cdecl nfs_getname	(fcookie *root, fcookie *dir, char *pathname, int
 static long	_cdecl nfs_rename	(fcookie *olddir, char *oldname, fcookie *newdir, const char *newname);
 static long	_cdecl nfs_opendir	(DIR *dirh, int flags);
 static long	_cdecl nfs_readdir	(DIR *dirh, char *nm, int nmlen, fcookie *);
+static long	_cdecl nfs_readdirs	(DIR *dirh, char *buf, long len, int flags, const char *prefix);
 static long	_cdecl nfs_rewinddir	(DIR *dirh);
 static long	_cdecl nfs_closedir	(DIR *dirh);
 static long	_cdecl nfs_pathconf	(fcookie *dir, int which);
@@ -65,7 +68,7 @@ static long	_cdecl nfs_readlink	(fcookie *dir, char *buf, int len);
 static long	_cdecl nfs_hardlink	(fcookie *fromdir, const char *fromname, fcookie *todir, const char *toname);
 static long	_cdecl nfs_fscntl	(fcookie *dir, const char *name, int cmd, long arg);
 static long	_cdecl nfs_dskchng	(int drv, int mode);
-static long	_cdecl nfs_release	(fcookie *fc);
+       long	_cdecl nfs_release	(fcookie *fc);
 static long	_cdecl nfs_dupcookie	(fcookie *dst, fcookie *src);
 
 
@@ -86,15 +89,18 @@ FILESYS nfs_filesys =
 	 * FS_EXT_1		extensions level 1 - mknod & unmount
 	 * FS_EXT_2		extensions level 2 - additional place at the end
 	 * FS_EXT_3		extensions level 3 - stat & native UTC timestamps
+	 * FS_EXT_4		extensions level 4 - readdirs
 	 */
 	FS_CASESENSITIVE	|
 	FS_LONGPATH		|
 	FS_NO_C_CACHE		|
 	FS_OWN_MEDIACHANGE	|
+	FS_DO_SYNC		|
 /*	FS_REENTRANT_L1		| */
 /*	FS_REENTRANT_L2		| */
 	FS_EXT_2		|
-	FS_EXT_3		,
+	FS_EXT_3		|
+	FS_EXT_4		,
 	
 	nfs_root,
 	nfs_lookup, nfs_creat, nfs_getdev, nfs_getxattr,
@@ -104,7 +110,7 @@ FILESYS nfs_filesys =
 	nfs_pathconf, nfs_dfree, nfs_writelabel, nfs_readlabel,
 	nfs_symlink, nfs_readlink, nfs_hardlink, nfs_fscntl, nfs_dskchng,
 	nfs_release, nfs_dupcookie,
-	NULL, /* sync */
+	nfs_sync,
 	
 	/* FS_EXT_1 */
 	NULL, NULL,
@@ -116,7 +122,10 @@ FILESYS nfs_filesys =
 	nfs_stat64,
 	
 	0, 0, 0, 0, 0,
-	NULL, NULL
+	NULL, NULL,
+	
+	/* FS_EXT_4 */
+	nfs_readdirs
 };
 
 
@@ -148,6 +157,7 @@ get_handle (NFS_INDEX *ni)
 		if (newi != ni)
 		{
 			ni->handle = newi->handle;
+			ni->fh3 = newi->fh3;
 			ni->attr = newi->attr;
 			ni->stamp = newi->stamp;
 		}
@@ -168,6 +178,7 @@ init_fs (void)
 {
 	init_mount_attr (&root_attr);
 	init_index ();
+	nfs_cache_init ();
 	init_ipc (NFS_PROGRAM, NFS_VERSION);
 	root_attr.blksize = sizeof (NFS_INDEX);
 }
@@ -335,6 +346,9 @@ nfs_lookup (fcookie *dir, const char *name, fcookie *fc)
 		return ENOTDIR;
 	}
 	
+	if (NFS_V3 (ni))
+		return nfs3_lookup (dir, name, dom, fc);
+	
 	dirargs.dir = ni->handle;
 	dirargs.name = name;
 	
@@ -420,6 +434,9 @@ do_create (long nfs_opcode, fcookie *dir, const char *name, unsigned mode, int a
 		return ENOTDIR;
 	}
 	
+	if (NFS_V3 (ni))
+		return nfs3_create (nfs_opcode, dir, name, mode, attrib, fc);
+	
 	createarg.where.dir = ni->handle;
 	createarg.where.name = name;
 	createarg.attributes.mode = nfs_mode (mode, attrib);
@@ -546,7 +563,8 @@ nfs_getxattr (fcookie *fc, XATTR *xattr)
 {
 	NFS_INDEX *ni = (NFS_INDEX *) fc->index;
 	char req_buf[XATTRBUFSIZE];
-	long stamp, r;
+	XATTR old;
+	long r;
 	MESSAGE *mreq, *mrep, m;
 	attrstat stat_res;
 	xdrs x;
@@ -578,65 +596,77 @@ nfs_getxattr (fcookie *fc, XATTR *xattr)
 	 * exceeded. If so, return the cached values, but only if the mount
 	 * has not specified not to use the attribute cache.
 	 */
-	if (!(ni->opt->flags & OPT_NOAC))
+	if (nfs_attr_valid (ni))
 	{
-		stamp = get_timestamp ();
-		if (after (ni->stamp + ni->opt->actimeo, stamp))
+		if (xattr)
 		{
-			if (xattr)
-			{
-				*xattr = ni->attr;
-				xattr->dev = fc->dev;
+			*xattr = ni->attr;
+			xattr->dev = fc->dev;
 # if 0   /* BUG: which device is this file on???? */
-				xattr->index = (long) ni;
+			xattr->index = (long) ni;
 # endif
-				
-				if (ni->opt->flags & OPT_RO)
-				{
-					xattr->mode &= ~(S_IWOTH|S_IWGRP|S_IWUSR);
-					xattr->attr |= FA_RDONLY;
-				}
-				
-				if ((xattr->mode & S_IFMT) == S_IFLNK)
-					/* fix for buffer size when reading symlinks */
-					++xattr->size;
+			
+			if (ni->opt->flags & OPT_RO)
+			{
+				xattr->mode &= ~(S_IWOTH|S_IWGRP|S_IWUSR);
+				xattr->attr |= FA_RDONLY;
 			}
 			
-			DEBUG (("nfs_getxattr(%s): from cache -> mode 0%o, ok", ni->name, ni->attr.mode));
-			return E_OK;
+			if ((xattr->mode & S_IFMT) == S_IFLNK)
+				/* fix for buffer size when reading symlinks */
+				++xattr->size;
 		}
+		
+		DEBUG (("nfs_getxattr(%s): from cache -> mode 0%o, ok", ni->name, ni->attr.mode));
+		return E_OK;
 	}
 	
-	mreq = alloc_message (&m, req_buf, XATTRBUFSIZE, xdr_size_nfsfh (&ni->handle));
-	if (!mreq)
-	{
-		DEBUG (("nfs_getxattr(%s): failed to alloc msg, -> ENOENT", ni->name));
-		return ENOENT;
-	}
-	xdr_init (&x, mreq->data, mreq->data_len, XDR_ENCODE, NULL);
-	xdr_nfsfh (&x, &ni->handle);
+	/* the server knows the size and times only after the writes */
+	nfs_flush_index (ni);
 	
-	r = rpc_request (&ni->opt->server, mreq, NFSPROC_GETATTR, &mrep);
-	if (r != 0)
+	old = ni->attr;
+	
+	if (NFS_V3 (ni))
 	{
-		DEBUG (("nfs_getxattr(%s): couldn't contact server, -> EACCES",ni->name));
-		return EACCES;
+		r = nfs3_getattr (ni);
+		if (r != E_OK)
+			return r;
 	}
-	xdr_init (&x, mrep->data, mrep->data_len, XDR_DECODE, NULL);
-	if (!xdr_attrstat (&x, &stat_res))
+	else
 	{
-		DEBUG (("nfs_getxattr(%s): couldnt decode results, -> EACCES", ni->name));
+		mreq = alloc_message (&m, req_buf, XATTRBUFSIZE, xdr_size_nfsfh (&ni->handle));
+		if (!mreq)
+		{
+			DEBUG (("nfs_getxattr(%s): failed to alloc msg, -> ENOENT", ni->name));
+			return ENOENT;
+		}
+		xdr_init (&x, mreq->data, mreq->data_len, XDR_ENCODE, NULL);
+		xdr_nfsfh (&x, &ni->handle);
+		
+		r = rpc_request (&ni->opt->server, mreq, NFSPROC_GETATTR, &mrep);
+		if (r != 0)
+		{
+			DEBUG (("nfs_getxattr(%s): couldn't contact server, -> EACCES",ni->name));
+			return EACCES;
+		}
+		xdr_init (&x, mrep->data, mrep->data_len, XDR_DECODE, NULL);
+		if (!xdr_attrstat (&x, &stat_res))
+		{
+			DEBUG (("nfs_getxattr(%s): couldnt decode results, -> EACCES", ni->name));
+			free_message (mrep);
+			return EACCES;
+		}
 		free_message (mrep);
-		return EACCES;
-	}
-	free_message (mrep);
-	if (stat_res.status != NFS_OK)
-	{
-		DEBUG (("nfs_getxattr(%s) rpc->%d, -> EACCES", ni->name, stat_res.status));
-		return EACCES;
+		if (stat_res.status != NFS_OK)
+		{
+			DEBUG (("nfs_getxattr(%s) rpc->%d, -> EACCES", ni->name, stat_res.status));
+			return EACCES;
+		}
+		fattr2xattr (&stat_res.attrstat_u.attributes, &ni->attr);
+		ni->stamp = get_timestamp ();
 	}
-	fattr2xattr (&stat_res.attrstat_u.attributes, &ni->attr);
-	ni->stamp = get_timestamp ();
+	
+	nfs_attr_refreshed (ni, &old);
 	
 	if (xattr)
 	{
@@ -669,7 +699,7 @@ nfs_getxattr (fcookie *fc, XATTR *xattr)
 	return E_OK;
 }
 
-static long _cdecl
+long _cdecl
 nfs_stat64 (fcookie *fc, STAT *stat)
 {
 	NFS_INDEX *ni = (NFS_INDEX *) fc->index;
@@ -740,6 +770,18 @@ do_sattr (fcookie *fc, sattr *ap)
 		return ENOENT;
 	}
 	
+	/* a pending write would undo a truncation */
+	nfs_flush_index (ni);
+	
+	if (NFS_V3 (ni))
+	{
+		r = nfs3_setattr (ni, ap);
+		if (r == E_OK)
+			nfs_drop_readahead (ni);
+		
+		return r;
+	}
+	
 	s_arg.file = ni->handle;
 	s_arg.attributes = *ap;
 	
@@ -779,6 +821,8 @@ do_sattr (fcookie *fc, sattr *ap)
 	fattr2xattr (&stat_res.attrstat_u.attributes, &ni->attr);
 	ni->stamp = get_timestamp ();
 	
+	nfs_drop_readahead (ni);
+	
 	TRACE (("do_sattr(%s) -> OK", ni->name));
 	return E_OK;
 }
@@ -925,6 +969,10 @@ do_remove (long nfs_opcode, fcookie *dir, const char *name)
 		DEBUG (("do_remove(%s): failed to get handle, -> ENOTDIR", name));
 		return ENOTDIR;
 	}
+	
+	if (NFS_V3 (ni))
+		return nfs3_remove (nfs_opcode, ni, name);
+	
 	dirargs.dir = ni->handle;
 	dirargs.name = name;
 	mreq = alloc_message (&m, req_buf, REMBUFSIZE, xdr_size_diropargs(&dirargs));
@@ -1114,6 +1162,9 @@ nfs_rename (fcookie *olddir, char *oldname, fcookie *newdir, const char *newname
 		DEBUG (("nfs_rename(%s): no handle for old dir, -> ENOTDIR", oldname));
 		return ENOTDIR;
 	}
+	
+	if (NFS_V3 (oldi))
+		return nfs3_rename (oldi, oldname, newi, newname);
 
 	renarg.from.dir = oldi->handle;
 	renarg.from.name = oldname;
@@ -1196,6 +1247,9 @@ nfs_opendir (DIR *dirh, int flags)
 			return ENOTDIR;
 		}
 		
+		if (NFS_V3 (ni))
+			return nfs3_opendir (dirh);
+		
 		stuff.nf->buffer = kmalloc (MAX_READDIR_LEN + ADD_BUF_LEN);
 		if (!stuff.nf->buffer)
 		{
@@ -1222,7 +1276,9 @@ nfs_rewinddir (DIR *dirh)
 	union { char *c; NETFS_STUFF *nf; long *l; } stuff; stuff.c = dirh->fsstuff;
 	union { long *l; void *v; } ptr;
 	
-	if (ROOT_INDEX != (NFS_INDEX *) dirh->fc.index)
+	if (ROOT_INDEX != (NFS_INDEX *) dirh->fc.index && NFS_V3 ((NFS_INDEX *) dirh->fc.index))
+		nfs3_rewinddir (dirh);
+	else if (ROOT_INDEX != (NFS_INDEX *) dirh->fc.index)
 	{
 		stuff.nf->curr_entry = NULL;
 		ptr.v = &stuff.nf->lastcookie[0];
@@ -1241,7 +1297,9 @@ nfs_closedir (DIR *dirh)
 {
 	NETFS_STUFF *stuff = (NETFS_STUFF *) &dirh->fsstuff;
 	
-	if (ROOT_INDEX != (NFS_INDEX *) dirh->fc.index)
+	if (ROOT_INDEX != (NFS_INDEX *) dirh->fc.index && NFS_V3 ((NFS_INDEX *) dirh->fc.index))
+		nfs3_closedir (dirh);
+	else if (ROOT_INDEX != (NFS_INDEX *) dirh->fc.index)
 	{
 		if (stuff->buffer)
 			kfree (stuff->buffer);
@@ -1331,6 +1389,9 @@ nfs_readdir (DIR *dirh, char *name, int namelen, fcookie *fc)
 		return 0;
 	}
 
+	if (NFS_V3(ni))
+		return nfs3_readdir(dirh, name, namelen, fc);
+
 restart:
 	TRACE (("trying to get entry from buffer"));
 	if (stuff->curr_entry)
@@ -1378,7 +1439,7 @@ restart:
 				goto prep_next_entry;
 			}
 			newi->flags |= NO_HANDLE;
-			newi->stamp = get_timestamp()-ni->opt->actimeo-1;  /* no attr yet */
+			nfs_attr_expire(newi);  /* no attr yet */
 		}
 		if (newi)
 		{
@@ -1459,6 +1520,20 @@ prep_next_entry:
 	return ENMFILES;
 }
 
+/* only the version 3 replies carry the attributes; the others are
+ * left to readdir
+ */
+static long _cdecl
+nfs_readdirs (DIR *dirh, char *buf, long len, int flags, const char *prefix)
+{
+	NFS_INDEX *ni = (NFS_INDEX *) dirh->fc.index;
+	
+	if (ROOT_INDEX == ni || !NFS_V3 (ni))
+		return ENOSYS;
+	
+	return nfs3_readdirs (dirh, buf, len, flags, prefix);
+}
+
 
 
 
@@ -1537,6 +1612,9 @@ nfs_dfree (fcookie *dir, long *buf)
 		return ENOTDIR;
 	}
 	
+	if (NFS_V3 (ni))
+		return nfs3_dfree (ni, buf);
+	
 	mreq = alloc_message(&m, req_buf, DFREEBUFSIZE, xdr_size_nfsfh(&ni->handle));
 	if (!mreq)
 	{
@@ -1649,6 +1727,9 @@ nfs_symlink (fcookie *dir, const char *name, const char *to)
 		return ENOTDIR;
 	}
 	
+	if (NFS_V3 (ni))
+		return nfs3_symlink (ni, name, to);
+	
 	symarg.from.dir = ni->handle;
 	symarg.from.name = name;
 	symarg.to = to;
@@ -1721,34 +1802,43 @@ nfs_readlink (fcookie *dir, char *buf, int len)
 		DEBUG(("nfs_readlink: failed to get handle, -> ENOTDIR"));
 		return ENOTDIR;
 	}
-	mreq = alloc_message(&m, req_buf, READLNBUFSIZE,
-	                               xdr_size_nfsfh(&ni->handle));
-	if (!mreq)
-	{
-		DEBUG(("nfs_readlink: failed to allocate buffer, -> ENOENT"));
-		return ENOENT;
-	}
-	xdr_init(&x, mreq->data, mreq->data_len, XDR_ENCODE, NULL);
-	xdr_nfsfh(&x, &ni->handle);
-	r = rpc_request(&ni->opt->server, mreq, NFSPROC_READLINK, &mrep);
-	if (r != 0)
+	if (NFS_V3(ni))
 	{
-		DEBUG(("nfs_readlink: couldn't contact server, -> ENOENT"));
-		return ENOENT;
+		r = nfs3_readlink(ni, databuf);
+		if (r != 0)
+			return r;
 	}
-	xdr_init(&x, mrep->data, mrep->data_len, XDR_DECODE, NULL);
-	link_res.readlinkres_u.data = &databuf[0];
-	if (!xdr_readlinkres(&x, &link_res))
+	else
 	{
-		DEBUG(("nfs_readlink: couldnt decode results, -> ENOENT"));
+		mreq = alloc_message(&m, req_buf, READLNBUFSIZE,
+		                               xdr_size_nfsfh(&ni->handle));
+		if (!mreq)
+		{
+			DEBUG(("nfs_readlink: failed to allocate buffer, -> ENOENT"));
+			return ENOENT;
+		}
+		xdr_init(&x, mreq->data, mreq->data_len, XDR_ENCODE, NULL);
+		xdr_nfsfh(&x, &ni->handle);
+		r = rpc_request(&ni->opt->server, mreq, NFSPROC_READLINK, &mrep);
+		if (r != 0)
+		{
+			DEBUG(("nfs_readlink: couldn't contact server, -> ENOENT"));
+			return ENOENT;
+		}
+		xdr_init(&x, mrep->data, mrep->data_len, XDR_DECODE, NULL);
+		link_res.readlinkres_u.data = &databuf[0];
+		if (!xdr_readlinkres(&x, &link_res))
+		{
+			DEBUG(("nfs_readlink: couldnt decode results, -> ENOENT"));
+			free_message(mrep);
+			return ENOENT;
+		}
 		free_message(mrep);
-		return ENOENT;
-	}
-	free_message(mrep);
-	if (link_res.status != NFS_OK)
-	{
-		DEBUG(("nfs_readlink -> ENOENT"));
-		return ENOENT;
+		if (link_res.status != NFS_OK)
+		{
+			DEBUG(("nfs_readlink -> ENOENT"));
+			return ENOENT;
+		}
 	}
 	{
 		short i = len;
@@ -1806,6 +1896,10 @@ nfs_hardlink (fcookie *fromdir, const char *fromname, fcookie *todir, const char
 
 	fromi = (NFS_INDEX*)fc.index;
 	nfs_release(&fc);
+
+	if (NFS_V3(fromi))
+		return nfs3_hardlink(fromi, toi, toname);
+
 	linkarg.to.dir = toi->handle;
 	linkarg.to.name = toname;
 	linkarg.from = fromi->handle;
@@ -1925,7 +2019,10 @@ nfs_fscntl (fcookie *dir, const char *name, int cmd, long arg)
 			}
 			
 			ni->link = 1;
-			ni->handle = info->handle;
+			if (NFS_V3 (ni))
+				ni->fh3 = info->fh3;
+			else
+				ni->handle = info->handle;
 			
 			DEBUG (("nfs_fscntl: mounting dir '%s'", ni->name));
 			return 0;
@@ -1964,6 +2061,14 @@ nfs_fscntl (fcookie *dir, const char *name, int cmd, long arg)
 			
 			return r;
 		}
+		case NFS_CACHESTAT:
+		{
+			if (!arg)
+				return EBADARG;
+			
+			nfs_cache_stat ((struct nfs_cachestat *) arg);
+			return E_OK;
+		}
 		case NFS_MNTDUMP:
 		{
 			/* for debugging only */
@@ -1987,7 +2092,7 @@ nfs_dskchng (int drv, int mode)
 	return 0;
 }
 
-static long _cdecl
+long _cdecl
 nfs_release (fcookie *fc)
 {
 	NFS_INDEX *ni = (NFS_INDEX*)fc->index;
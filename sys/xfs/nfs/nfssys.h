@@ -27,6 +27,8 @@ void	init_fs	(void);
 long	do_sattr (fcookie *fc, sattr *attr);
 
 long	_cdecl nfs_getxattr	(fcookie *fc, XATTR *xattr);
+long	_cdecl nfs_stat64	(fcookie *fc, STAT *stat);
+long	_cdecl nfs_release	(fcookie *fc);
 
 
 # endif /* _nfssys_h */
@@ -170,6 +170,115 @@ fattr2xattr (fattr *fa, XATTR *xa)
 	xa->reserved3 [1] = 0;
 }
 
+/* version 3 attributes carry the file type only in the type field
+ */
+INLINE int
+mint_type3 (int type)
+{
+	switch (type)
+	{
+		case NFREG:
+			return S_IFREG;
+		case NFDIR:
+			return S_IFDIR;
+		case NFBLK:
+			return S_IFBLK;
+		case NFCHR:
+			return S_IFCHR;
+		case NFLNK:
+			return S_IFLNK;
+		case NF3SOCK:
+			return S_IFSOCK;
+		case NF3FIFO:
+			return S_IFIFO;
+	}
+	
+	return S_IFREG;
+}
+
+/* clamp a 64 bit quantity to what fits into the XATTR structure */
+INLINE long
+clamp64 (ullong v)
+{
+	if (v > 0x7fffffffUL)
+		return 0x7fffffffL;
+	
+	return (long) v;
+}
+
+/* convert an nfs version 3 fattr3 structure into an MiNT xattr structure
+ */
+void
+v3fattr2xattr (fattr3 *fa, XATTR *xa)
+{
+	xa->mode = mint_type3 (fa->type) | (fa->mode & ~S_IFMT);
+	xa->attr = 0;
+	
+	if ((xa->mode & S_IFMT) == S_IFDIR)
+		xa->attr |= FA_DIR;
+	if ((xa->mode & (S_IWUSR | S_IWGRP | S_IWOTH)) == 0)
+		xa->attr |= FA_RDONLY;
+	
+	xa->index	= (long) fa->fileid;
+	xa->dev		= (long) fa->fsid;
+	xa->rdev	= (long) fa->fsid;
+	xa->nlink	= fa->nlink;
+	xa->uid		= fa->uid;
+	xa->gid		= fa->gid;
+	xa->size	= clamp64 (fa->size);
+	xa->blksize	= 512;
+	xa->nblocks	= clamp64 (fa->used >> 9);
+	
+	if (native_utc)
+	{
+		SET_XATTR_TD(xa,m,fa->mtime.seconds);
+		SET_XATTR_TD(xa,a,fa->atime.seconds);
+		SET_XATTR_TD(xa,c,fa->ctime.seconds);
+	}
+	else
+	{
+		SET_XATTR_TD(xa,m,dostime(fa->mtime.seconds));
+		SET_XATTR_TD(xa,a,dostime(fa->atime.seconds));
+		SET_XATTR_TD(xa,c,dostime(fa->ctime.seconds));
+	}
+	
+	xa->reserved2 = 0;
+	xa->reserved3 [0] = 0;
+	xa->reserved3 [1] = 0;
+}
+
+/* convert a version 2 sattr, where (ulong) -1 means "leave alone",
+ * into the version 3 representation
+ */
+void
+sattr2v3sattr (sattr *sa, sattr3 *s3)
+{
+	s3->set_mode = (sa->mode != (ulong) -1L);
+	s3->mode = sa->mode & ~N_IFMT;
+	s3->set_uid = (sa->uid != (ulong) -1L);
+	s3->uid = sa->uid;
+	s3->set_gid = (sa->gid != (ulong) -1L);
+	s3->gid = sa->gid;
+	s3->set_size = (sa->size != (ulong) -1L);
+	s3->size = sa->size;
+	
+	s3->set_atime = DONT_CHANGE;
+	if (sa->atime.seconds != (ulong) -1L)
+	{
+		s3->set_atime = SET_TO_CLIENT_TIME;
+		s3->atime.seconds = sa->atime.seconds;
+		s3->atime.useconds = sa->atime.useconds * 1000;
+	}
+	
+	s3->set_mtime = DONT_CHANGE;
+	if (sa->mtime.seconds != (ulong) -1L)
+	{
+		s3->set_mtime = SET_TO_CLIENT_TIME;
+		s3->mtime.seconds = sa->mtime.seconds;
+		s3->mtime.useconds = sa->mtime.useconds * 1000;
+	}
+}
+
 # if 0
 void
 xattr2fattr (XATTR *xa, fattr *fa)
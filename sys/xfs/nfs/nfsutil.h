@@ -26,6 +26,8 @@ INLINE long	get_timestamp (void);
 int 		nfs_mode (int mode, int attrib);
 
 void fattr2xattr (fattr *fa, XATTR *xa);
+void v3fattr2xattr (fattr3 *fa, XATTR *xa);
+void sattr2v3sattr (sattr *sa, sattr3 *s3);
 # if 0
 void xattr2fattr (XATTR *xa, fattr *fa);
 # endif
@@ -91,7 +91,7 @@ recvmsg (struct socket *so, struct msghdr *msg, short flags)
 /* In order to make this module more usable we provide the possibility
  * to select the number of the remote program and its version at
  * initialization time. These numbers is stored in this variable for
- * later use.
+ * later use. A mount can override the version in its SERVER_OPT.
  */
 ulong rpc_program;
 ulong rpc_progversion;
@@ -542,7 +542,7 @@ open_connection (struct socket **resultso)
 	/* Do some settings on the socket so that it becomes usable
 	 */
 	
-	arg = 10240;
+	arg = RPC_SOCKBUF;
 	ret = setsockopt (so, SOL_SOCKET, SO_RCVBUF, &arg, sizeof (arg));
 	if (ret < 0)
 	{
@@ -550,7 +550,7 @@ open_connection (struct socket **resultso)
 		goto error;
 	}
 	
-	arg = 10240;
+	arg = RPC_SOCKBUF;
 	ret = setsockopt (so, SOL_SOCKET, SO_SNDBUF, &arg, sizeof (arg));
 	if (ret < 0)
 	{
@@ -697,33 +697,30 @@ rpc_receivemessage (struct socket *so, MESSAGE *mrep, long toread)
 }
 
 
-/* this function does all the dirty work:
- *  - set up rpc header
- *  - link request into linked list, send it and go to sleep
- *  - receive reply
- *  - break down reply rpc header
- *  - return results of remote function or error message
- * the results (if valid) have to be freed after use
+static volatile ulong next_xid = 0;
+
+/* Set up the rpc header of a request, link the request into the list of
+ * pending requests and send it for the first time. The header goes into
+ * hdr_buf if it fits, otherwise it is allocated and freed together with
+ * the message.
  */
-long
-rpc_request (SERVER_OPT *opt, MESSAGE *mreq, ulong proc, MESSAGE **mrep)
+static long
+rpc_start (SERVER_OPT *opt, MESSAGE *mreq, ulong proc, char *hdr_buf, long hdr_buflen, RPC_CALL *call)
 {
-	char req_buf[MAX_RPC_HDR_SIZE];
 	rpc_msg hdr;
 	xdrs xhdr;
-	MESSAGE *reply, mbuf;
-	static volatile ulong xid = 0;
-	ulong our_xid;
 	long r;
 	
 	
 	/* make a header */
-	our_xid = xid++;
-	hdr.xid = our_xid;
+	call->opt = opt;
+	call->mreq = mreq;
+	call->xid = next_xid++;
+	hdr.xid = call->xid;
 	hdr.mtype = CALL;
 	hdr.cbody.rpcvers = RPC_VERSION;
 	hdr.cbody.prog = rpc_program;
-	hdr.cbody.vers = rpc_progversion;
+	hdr.cbody.vers = opt->version ? opt->version : rpc_progversion;
 	hdr.cbody.proc = proc;
 	
 	if (do_auth_init)
@@ -733,7 +730,7 @@ rpc_request (SERVER_OPT *opt, MESSAGE *mreq, ulong proc, MESSAGE **mrep)
 		else
 			do_auth_init -= 1;
 	}
-	setup_auth (our_xid);
+	setup_auth (call->xid);
 	hdr.cbody.cred = unix_auth;
 	hdr.cbody.verf = null_auth;
 	
@@ -741,7 +738,7 @@ rpc_request (SERVER_OPT *opt, MESSAGE *mreq, ulong proc, MESSAGE **mrep)
 	hdr.cbody.xproc = NULL;
 	
 	mreq->hdr_len = xdr_size_rpc_msg (&hdr);
-	if (mreq->hdr_len > MAX_RPC_HDR_SIZE)
+	if (mreq->hdr_len > hdr_buflen)
 	{
 		mreq->header = kmalloc (mreq->hdr_len);
 		if (!mreq->header)
@@ -754,7 +751,7 @@ rpc_request (SERVER_OPT *opt, MESSAGE *mreq, ulong proc, MESSAGE **mrep)
 		mreq->flags |= FREE_HEADER;
 	}
 	else
-		mreq->header = req_buf;
+		mreq->header = hdr_buf;
 	
 	xdr_init (&xhdr, mreq->header, mreq->hdr_len, XDR_ENCODE, NULL);
 	if (!xdr_rpc_msg (&xhdr, &hdr))
@@ -764,6 +761,84 @@ rpc_request (SERVER_OPT *opt, MESSAGE *mreq, ulong proc, MESSAGE **mrep)
 		return EBADARG;
 	}
 	
+	if (!nfs_so)
+	{
+		DEBUG (("rpc_req: no open connection"));
+		free_message (mreq);
+		return EACCES;
+	}
+	
+	call->stamp = *_hz_200;
+	insert_request (call->xid);
+	
+	r = rpc_sendmessage (nfs_so, opt, mreq);
+	if (r < 0)
+	{
+		DEBUG (("rpc_request: could not write message -> %ld", (long)r));
+		
+		free_message (mreq);
+		delete_request (call->xid);
+		return r;
+	}
+	
+	return 0;
+}
+
+/* this function does all the dirty work:
+ *  - set up rpc header
+ *  - link request into linked list, send it and go to sleep
+ *  - receive reply
+ *  - break down reply rpc header
+ *  - return results of remote function or error message
+ * the results (if valid) have to be freed after use
+ */
+long
+rpc_request (SERVER_OPT *opt, MESSAGE *mreq, ulong proc, MESSAGE **mrep)
+{
+	char req_buf[MAX_RPC_HDR_SIZE];
+	RPC_CALL call;
+	long r;
+	
+	r = rpc_start (opt, mreq, proc, req_buf, MAX_RPC_HDR_SIZE, &call);
+	if (r != 0)
+		return r;
+	
+	return rpc_wait (&call, mrep);
+}
+
+/* Send a request without waiting for the reply, so that several requests
+ * can be on their way to the server at the same time. Every call that
+ * returns 0 has to be finished with rpc_wait() or rpc_cancel(); the
+ * message must stay valid until then.
+ */
+long
+rpc_send (SERVER_OPT *opt, MESSAGE *mreq, ulong proc, RPC_CALL *call)
+{
+	/* the header has to live as long as the request */
+	return rpc_start (opt, mreq, proc, NULL, 0, call);
+}
+
+/* drop a request that was sent with rpc_send() */
+void
+rpc_cancel (RPC_CALL *call)
+{
+	delete_request (call->xid);
+	free_message (call->mreq);
+}
+
+/* Wait for the reply to a request, resending it when it times out. On
+ * success *mrep is the request message which now holds the results.
+ */
+long
+rpc_wait (RPC_CALL *call, MESSAGE **mrep)
+{
+	SERVER_OPT *opt = call->opt;
+	MESSAGE *mreq = call->mreq;
+	rpc_msg hdr;
+	xdrs xhdr;
+	MESSAGE *reply, mbuf;
+	long r;
+	
 	
 	/* This is the main send/resend code. We have to send the message, wait
 	 * for reply, and if it times out, resend the message. But make sure
@@ -771,37 +846,33 @@ rpc_request (SERVER_OPT *opt, MESSAGE *mreq, ulong proc, MESSAGE **mrep)
 	 * use the nfs at the same time. It is also possible, that a process
 	 * receives a message that belongs to someone else. In that case, we
 	 * check against the list of outstanding requests and store it in a
-	 * list if it was waited for. Otherwise silently discard it.
+	 * list if it was waited for. Otherwise silently discard it. The same
+	 * happens to the replies of our own requests that are still in flight.
 	 */
 	{
 		struct socket *so = nfs_so;
 		long timeout, stamp, toread;
 		int retry;
 		
-		if (!so)
-		{
-			DEBUG (("rpc_req: no open connection"));
-			free_message (mreq);
-			return EACCES;
-		}
-		
-		/* Now send the message and wait for answer */
+		/* the message has already been sent once by rpc_start() */
 		timeout = opt->timeo;
-		stamp = *_hz_200;
-		insert_request (our_xid);
+		stamp = call->stamp;
 		/* TL: we have to increase the timeout by opt->timeo instead of just 
                  *     multiplying it by 2
 		 */
 		for (retry = 0; retry < opt->retrans; retry++, timeout += opt->timeo)
 		{
-		    r = rpc_sendmessage (so, opt, mreq);
-		    if (r < 0)
+		    if (retry > 0)
 		    {
-			DEBUG (("rpc_request: could not write message -> %ld", (long)r));
-			
-			free_message (mreq);
-			delete_request (our_xid);
-			return r;
+			r = rpc_sendmessage (so, opt, mreq);
+			if (r < 0)
+			{
+			    DEBUG (("rpc_request: could not write message -> %ld", (long)r));
+			    
+			    free_message (mreq);
+			    delete_request (call->xid);
+			    return r;
+			}
 		    }
 		
 		    /* Wait for reply. Any reply for anybody! So we have
@@ -822,7 +893,7 @@ rpc_request (SERVER_OPT *opt, MESSAGE *mreq, ulong proc, MESSAGE **mrep)
 			/* give up CPU */
 			s_yield ();
 			
-			rq = search_request (our_xid);
+			rq = search_request (call->xid);
 			if (rq && rq->have_answer)
 			{
 			    TRACE (("rpc_req: got reply from list"));
@@ -835,7 +906,7 @@ rpc_request (SERVER_OPT *opt, MESSAGE *mreq, ulong proc, MESSAGE **mrep)
 			     * NOTE that this works because the `msg' is the
 			     * first member of the REQUEST structure.
 			     */
-			    remove_request (our_xid);
+			    remove_request (call->xid);
 			    goto have_reply;
 			}
 			/* Now try to drain the socket: read messages from
@@ -852,7 +923,7 @@ rpc_request (SERVER_OPT *opt, MESSAGE *mreq, ulong proc, MESSAGE **mrep)
 				DEBUG(("rpc_req: so_ioctl(FIONREAD) failed -> %ld", r));
 
 				free_message(mreq);
-				delete_request(our_xid);
+				delete_request(call->xid);
 				return r;
 			    }
 			    if (toread == 0) break;
@@ -866,7 +937,7 @@ rpc_request (SERVER_OPT *opt, MESSAGE *mreq, ulong proc, MESSAGE **mrep)
 				 * the error condition. */
 				
 				free_message (mreq);
-				delete_request (our_xid);
+				delete_request (call->xid);
 				return so_read (so, &c, sizeof(c));
 			    }
 
@@ -882,7 +953,7 @@ rpc_request (SERVER_OPT *opt, MESSAGE *mreq, ulong proc, MESSAGE **mrep)
 			     * the request. Otherwise we have to store the
 			     * reply in the list and wait again.
 			     */
-			    if (get_xid(reply) == our_xid)
+			    if (get_xid(reply) == call->xid)
 			    {
 				TRACE(("rpc_req: got a matching reply"));
 				goto have_reply;
@@ -918,14 +989,14 @@ rpc_request (SERVER_OPT *opt, MESSAGE *mreq, ulong proc, MESSAGE **mrep)
 		}  /* for retry < max_retry */
 
 		DEBUG (("rpc: RPC timed out, no reply"));
-		delete_request (our_xid);
+		delete_request (call->xid);
 		free_message (mreq);
 		return EACCES;
 	}
 	
 have_reply:
 	
-	delete_request (our_xid);
+	delete_request (call->xid);
 	free_message_body (mreq);    /* for reusing the message header */
 	
 	/* SECURITY: here we might want to check for the correct sender address
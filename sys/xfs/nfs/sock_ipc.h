@@ -47,7 +47,21 @@ struct message
 void		free_message (MESSAGE *m);
 MESSAGE *	alloc_message (MESSAGE *m, char *buf, long buf_len, long data_size);
 
+
+/* a request that has been sent but not yet answered */
+typedef struct rpc_call RPC_CALL;
+struct rpc_call
+{
+	SERVER_OPT *opt;
+	MESSAGE	*mreq;		/* the request, later the reply */
+	ulong	xid;		/* transaction id */
+	long	stamp;		/* when the request was sent first */
+};
+
 long	rpc_request (SERVER_OPT *opt, MESSAGE *mreq, ulong proc, MESSAGE **mrep);
+long	rpc_send (SERVER_OPT *opt, MESSAGE *mreq, ulong proc, RPC_CALL *call);
+long	rpc_wait (RPC_CALL *call, MESSAGE **mrep);
+void	rpc_cancel (RPC_CALL *call);
 int	init_ipc (ulong prog, ulong version);
 
 
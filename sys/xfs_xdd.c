@@ -33,6 +33,7 @@
 # include "mint/file.h"
 # include "mint/stat.h"
 
+# include "k_semaphore.h"
 # include "proc.h"
 # include "time.h"
 
@@ -163,10 +164,13 @@ xfs_deblock_level_0(FILESYS *fs, ushort dev, const char *func)
 	if (fs->sleepers)
 	{
 		DMA_DEBUG(("level 0: wake on %lx, %c (%s, %i)", fs, 'A'+dev, func, fs->sleepers));
-		wake(IO_Q, (long) fs);
+		wake_one(IO_Q, (long) fs);
 	}
 }
 
+/* level 1 locks are per device, so waiters sleep on fs + dev and only
+ * somebody waiting for the released device is woken
+ */
 static void
 xfs_block_level_1(FILESYS *fs, ushort dev, const char *func)
 {
@@ -176,7 +180,7 @@ xfs_block_level_1(FILESYS *fs, ushort dev, const char *func)
 	{
 		fs->sleepers++;
 		DMA_DEBUG(("level 1: sleep on %lx, %c (%s, %i)", fs, 'A'+dev, func, fs->sleepers));
-		sleep(IO_Q, (long) fs);
+		sleep(IO_Q, (long) fs + dev);
 		fs->sleepers--;
 	}
 
@@ -191,12 +195,22 @@ xfs_deblock_level_1(FILESYS *fs, ushort dev, const char *func)
 	if (fs->sleepers)
 	{
 		DMA_DEBUG(("level 1: wake on %lx, %c (%s, %i)", fs, 'A'+dev, func, fs->sleepers));
-		wake(IO_Q, (long) fs);
+		wake_one(IO_Q, (long) fs + dev);
 	}
 }
 
-static volatile ushort xfs_sema_lock = 0;
-static volatile ushort xfs_sleepers = 0;
+/* all filesystems without own locking share this one; it is exclusive
+ * unless the filesystem declares FS_SHARED_READ, then the read-only
+ * operations below take it shared
+ */
+static struct rwlock xfs_glock;
+static struct lockstat xfs_glock_stat;
+
+void
+xfs_lock_init(void)
+{
+	rw_init(&xfs_glock, &xfs_glock_stat, "xfs");
+}
 
 void _cdecl
 xfs_block(FILESYS *fs, ushort dev, const char *func)
@@ -207,15 +221,8 @@ xfs_block(FILESYS *fs, ushort dev, const char *func)
 	}
 	else
 	{
-		while (xfs_sema_lock)
-		{
-			xfs_sleepers++;
-			DMA_DEBUG(("[%c: -> %lx] sleep on xfs_sema_lock (%s, %i)", 'A'+dev, fs, func, xfs_sleepers));
-			sleep(IO_Q, (long) &xfs_sema_lock);
-			xfs_sleepers--;
-		}
-
-		xfs_sema_lock = 1;
+		DMA_DEBUG(("[%c: -> %lx] xfs_glock (%s, %i)", 'A'+dev, fs, func, xfs_glock.wsleepers));
+		rw_wlock(&xfs_glock);
 	}
 }
 
@@ -228,14 +235,33 @@ xfs_deblock(FILESYS *fs, ushort dev, const char *func)
 	}
 	else
 	{
-		xfs_sema_lock = 0;
+		DMA_DEBUG(("[%c: -> %lx] xfs_glock released (%s)", 'A'+dev, fs, func));
+		rw_wunlock(&xfs_glock);
+	}
+}
 
-		if (xfs_sleepers)
-		{
-			DMA_DEBUG(("[%c: -> %lx] wake on xfs_sema_lock (%s, %i)", 'A'+dev, fs, func, xfs_sleepers));
-			wake(IO_Q, (long) &xfs_sema_lock);
-		}
+/* the FS_EXT_2 block/deblock callbacks know no shared mode, so those
+ * filesystems are always locked exclusively
+ */
+static void
+xfs_rblock(FILESYS *fs, ushort dev, const char *func)
+{
+	if ((fs->fsflags & (FS_EXT_2|FS_SHARED_READ)) == FS_SHARED_READ)
+	{
+		DMA_DEBUG(("[%c: -> %lx] xfs_glock shared (%s, %i)", 'A'+dev, fs, func, xfs_glock.rsleepers));
+		rw_rlock(&xfs_glock);
 	}
+	else
+		xfs_block(fs, dev, func);
+}
+
+static void
+xfs_rdeblock(FILESYS *fs, ushort dev, const char *func)
+{
+	if ((fs->fsflags & (FS_EXT_2|FS_SHARED_READ)) == FS_SHARED_READ)
+		rw_runlock(&xfs_glock);
+	else
+		xfs_deblock(fs, dev, func);
 }
 
 # ifdef DEBUG_INFO
@@ -249,6 +275,16 @@ xfs_deblock(FILESYS *fs, ushort dev, const char *func)
 	if (!(fs->fsflags & FS_REENTRANT_L2))	\
 		xfs_deblock(fs, dev, func);	\
 })
+# define xfs_rlock(fs, dev, func)		\
+({						\
+	if (!(fs->fsflags & FS_REENTRANT_L2))	\
+		xfs_rblock(fs, dev, func);	\
+})
+# define xfs_runlock(fs, dev, func)		\
+({						\
+	if (!(fs->fsflags & FS_REENTRANT_L2))	\
+		xfs_rdeblock(fs, dev, func);	\
+})
 # else
 # define xfs_lock(fs, dev, func)		\
 ({						\
@@ -260,14 +296,27 @@ xfs_deblock(FILESYS *fs, ushort dev, const char *func)
 	if (!(fs->fsflags & FS_REENTRANT_L2))	\
 		xfs_deblock(fs, dev, NULL);	\
 })
+# define xfs_rlock(fs, dev, func)		\
+({						\
+	if (!(fs->fsflags & FS_REENTRANT_L2))	\
+		xfs_rblock(fs, dev, NULL);	\
+})
+# define xfs_runlock(fs, dev, func)		\
+({						\
+	if (!(fs->fsflags & FS_REENTRANT_L2))	\
+		xfs_rdeblock(fs, dev, NULL);	\
+})
 # endif /* DEBUG_INFO */
 
 # else /* NONBLOCKING_DMA */
 
 void _cdecl xfs_block(FILESYS *fs, ushort dev, const char *func){ return; }
 void _cdecl xfs_deblock(FILESYS *fs, ushort dev, const char *func){ return; }
+void xfs_lock_init(void){ return; }
 #define xfs_lock(fs, dev, func)
 #define xfs_unlock(fs, dev, func)
+#define xfs_rlock(fs, dev, func)
+#define xfs_runlock(fs, dev, func)
 
 # endif /* NONBLOCKING_DMA */
 
@@ -289,9 +338,9 @@ xfs_lookup(FILESYS *fs, fcookie *dir, const char *name, fcookie *fc)
 {
 	long r;
 	
-	xfs_lock(fs, dir->dev, "xfs_lookup");
+	xfs_rlock(fs, dir->dev, "xfs_lookup");
 	r = (*fs->lookup)(dir, name, fc);
-	xfs_unlock(fs, dir->dev, "xfs_lokup");
+	xfs_runlock(fs, dir->dev, "xfs_lokup");
 	
 	return r;
 }
@@ -309,9 +358,9 @@ xfs_getxattr(FILESYS *fs, fcookie *fc, XATTR *xattr)
 	{
 		long r;
 		
-		xfs_lock(fs, fc->dev, "xfs_getxattr");
+		xfs_rlock(fs, fc->dev, "xfs_getxattr");
 		r = (*fs->getxattr)(fc, xattr);
-		xfs_unlock(fs, fc->dev, "xfs_getxattr");
+		xfs_runlock(fs, fc->dev, "xfs_getxattr");
 		
 		return r;
 	}
@@ -403,9 +452,9 @@ xfs_getname(FILESYS *fs, fcookie *root, fcookie *dir, char *buf, int len)
 {
 	long r;
 	
-	xfs_lock(fs, root->dev, "xfs_getname");
+	xfs_rlock(fs, root->dev, "xfs_getname");
 	r = (*fs->getname)(root, dir, buf, len);
-	xfs_unlock(fs, root->dev, "xfs_getname");
+	xfs_runlock(fs, root->dev, "xfs_getname");
 	
 	return r;
 }
@@ -437,9 +486,42 @@ xfs_readdir(FILESYS *fs, DIR *dirh, char *nm, int nmlen, fcookie *fc)
 {
 	long r;
 	
-	xfs_lock(fs, dirh->fc.dev, "xfs_readdir");
+	xfs_rlock(fs, dirh->fc.dev, "xfs_readdir");
 	r = (*fs->readdir)(dirh, nm, nmlen, fc);
-	xfs_unlock(fs, dirh->fc.dev, "xfs_readdir");
+	xfs_runlock(fs, dirh->fc.dev, "xfs_readdir");
+	
+	return r;
+}
+long _cdecl
+xfs_readdirs(FILESYS *fs, DIR *dirh, char *buf, long len, int flags, const char *prefix)
+{
+	long r;
+	
+	if (!(fs->fsflags & FS_EXT_4) || !fs->readdirs)
+		return ENOSYS;
+	
+	xfs_rlock(fs, dirh->fc.dev, "xfs_readdirs");
+	r = (*fs->readdirs)(dirh, buf, len, flags, prefix);
+	xfs_runlock(fs, dirh->fc.dev, "xfs_readdirs");
+	
+	/* the XATTRs are as getxattr left them, UTC on FS_EXT_3 */
+	if (r > 0 && !(flags & DGD_STAT) && (fs->fsflags & FS_EXT_3))
+	{
+		long done;
+		
+		for (done = 0; done < r; done += ((struct dgdent *)(buf + done))->reclen)
+		{
+			struct dgdent *d = (struct dgdent *)(buf + done);
+			XATTR *xattr = (XATTR *)(d + 1);
+			
+			if (d->xret == E_OK)
+			{
+				xtime_to_local_dos(xattr, m);
+				xtime_to_local_dos(xattr, a);
+				xtime_to_local_dos(xattr, c);
+			}
+		}
+	}
 	
 	return r;
 }
@@ -476,9 +558,9 @@ xfs_dfree(FILESYS *fs, fcookie *dir, long *buf)
 {
 	long r;
 	
-	xfs_lock(fs, dir->dev, "xfs_dfree");
+	xfs_rlock(fs, dir->dev, "xfs_dfree");
 	r = (*fs->dfree)(dir, buf);
-	xfs_unlock(fs, dir->dev, "xfs_dfree");
+	xfs_runlock(fs, dir->dev, "xfs_dfree");
 	
 	return r;
 }
@@ -498,9 +580,9 @@ xfs_readlabel(FILESYS *fs, fcookie *dir, char *name, int namelen)
 {
 	long r;
 	
-	xfs_lock(fs, dir->dev, "xfs_readlabel");
+	xfs_rlock(fs, dir->dev, "xfs_readlabel");
 	r = (*fs->readlabel)(dir, name, namelen);
-	xfs_unlock(fs, dir->dev, "xfs_readlabel");
+	xfs_runlock(fs, dir->dev, "xfs_readlabel");
 	
 	return r;
 }
@@ -521,9 +603,9 @@ xfs_readlink(FILESYS *fs, fcookie *fc, char *buf, int len)
 {
 	long r;
 	
-	xfs_lock(fs, fc->dev, "xfs_readlink");
+	xfs_rlock(fs, fc->dev, "xfs_readlink");
 	r = (*fs->readlink)(fc, buf, len);
-	xfs_unlock(fs, fc->dev, "xfs_readlink");
+	xfs_runlock(fs, fc->dev, "xfs_readlink");
 	
 	return r;
 }
@@ -601,9 +683,9 @@ xfs_stat64(FILESYS *fs, fcookie *fc, STAT *stat)
 	{
 		long r;
 		
-		xfs_lock(fs, fc->dev, "xfs_stat64");
+		xfs_rlock(fs, fc->dev, "xfs_stat64");
 		r = (*fs->stat64)(fc, stat);
-		xfs_unlock(fs, fc->dev, "xfs_stat64");
+		xfs_runlock(fs, fc->dev, "xfs_stat64");
 		
 		return r;
 	}
@@ -38,6 +38,7 @@ long getstat64 (FILESYS *fs, fcookie *fc, STAT *ptr);
 
 void _cdecl xfs_block (FILESYS *fs, ushort dev, const char *func);
 void _cdecl xfs_deblock (FILESYS *fs, ushort dev, const char *func);
+void xfs_lock_init (void);
 
 
 long _cdecl xfs_root(FILESYS *fs, int drv, fcookie *fc);
@@ -60,6 +61,7 @@ long _cdecl xfs_rename(FILESYS *fs, fcookie *olddir, char *oldname, fcookie *new
 
 long _cdecl xfs_opendir(FILESYS *fs, DIR *dirh, int flags);
 long _cdecl xfs_readdir(FILESYS *fs, DIR *dirh, char *nm, int nmlen, fcookie *fc);
+long _cdecl xfs_readdirs(FILESYS *fs, DIR *dirh, char *buf, long len, int flags, const char *prefix);
 long _cdecl xfs_rewinddir(FILESYS *fs, DIR *dirh);
 long _cdecl xfs_closedir(FILESYS *fs, DIR *dirh);
 
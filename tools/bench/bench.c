@@ -0,0 +1,37 @@
+/*
+ * bench.c: timing and output shared by the benchmark programs
+ *
+ * All lines look alike: what was measured, how much of it, the time
+ * and the rate, so that the output of several runs can be compared
+ * with diff or sorted by column.
+ */
+
+#include <stdio.h>
+#include <sys/time.h>
+
+#include "bench.h"
+
+long
+now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000L + tv.tv_usec / 1000;
+}
+
+void
+report_rate(const char *what, long n, const char *unit, long ms)
+{
+	printf("%-22s %7ld %-6s %7ld ms %7ld us/%s\n", what, n, unit, ms,
+	       n > 0 ? ms * 1000L / n : 0L, unit);
+}
+
+void
+report_kbytes(const char *what, long kbytes, long ms)
+{
+	if (ms <= 0)
+		ms = 1;
+
+	printf("%-22s %7ld KB     %7ld ms %7ld KB/s\n", what, kbytes, ms, kbytes * 1000L / ms);
+}
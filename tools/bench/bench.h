@@ -0,0 +1,17 @@
+/*
+ * bench.h: timing and output shared by the benchmark programs
+ */
+
+#ifndef _bench_h
+#define _bench_h
+
+/* milliseconds since some fixed point in time */
+long now(void);
+
+/* n operations of one unit ("loop", "pair", ...) took ms milliseconds */
+void report_rate(const char *what, long n, const char *unit, long ms);
+
+/* kbytes took ms milliseconds */
+void report_kbytes(const char *what, long kbytes, long ms);
+
+#endif /* _bench_h */
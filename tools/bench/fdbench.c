@@ -0,0 +1,127 @@
+/*
+ * fdbench.c: cost of file handle allocation
+ *
+ * Times dup() until the given number of handles is open followed by
+ * closing them again, which makes the table grow and exercises the
+ * search for a free handle, and a fork loop with that many handles open
+ * against one with only the standard handles, which shows what copying
+ * the table costs.
+ *
+ * usage: fdbench [-n loops] [-h handles]
+ *
+ *	-n	iterations per test (default 100)
+ *	-h	number of handles to open (default 500)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "bench.h"
+
+/* open handles until there are n of them; returns the number opened */
+static long
+fill(int *fds, long n)
+{
+	long i;
+
+	for (i = 0; i < n; i++)
+	{
+		fds[i] = dup(0);
+		if (fds[i] < 0)
+			break;
+	}
+
+	return i;
+}
+
+static void
+drain(int *fds, long n)
+{
+	while (n--)
+		close(fds[n]);
+}
+
+static int
+fork_loop(const char *what, long loops)
+{
+	long i, t0;
+
+	t0 = now();
+	for (i = 0; i < loops; i++)
+	{
+		long pid = fork();
+		int status;
+
+		if (pid == 0)
+			_exit(0);
+		if (pid < 0 || waitpid(pid, &status, 0) != pid)
+		{
+			perror("fork");
+			return 1;
+		}
+	}
+	report_rate(what, loops, "loop", now() - t0);
+
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	long loops = 100, handles = 500, got, i, t0;
+	int *fds;
+	int j;
+
+	for (j = 1; j < argc; j++)
+	{
+		if (!strcmp(argv[j], "-n") && j + 1 < argc)
+			loops = atol(argv[++j]);
+		else if (!strcmp(argv[j], "-h") && j + 1 < argc)
+			handles = atol(argv[++j]);
+		else
+			break;
+	}
+
+	if (j != argc || loops <= 0 || handles <= 0)
+	{
+		fprintf(stderr, "usage: fdbench [-n loops] [-h handles]\n");
+		return 2;
+	}
+
+	fds = malloc(handles * sizeof(*fds));
+	if (!fds)
+	{
+		fprintf(stderr, "fdbench: out of memory\n");
+		return 2;
+	}
+
+	got = fill(fds, handles);
+	drain(fds, got);
+	if (got < handles)
+		printf("only %ld handles could be opened\n", got);
+
+	t0 = now();
+	for (i = 0; i < loops; i++)
+	{
+		if (fill(fds, got) != got)
+		{
+			perror("dup");
+			return 1;
+		}
+		drain(fds, got);
+	}
+	report_rate("dup+close", loops, "loop", now() - t0);
+
+	if (fork_loop("fork", loops))
+		return 1;
+
+	fill(fds, got);
+	if (fork_loop("fork, handles", loops))
+		return 1;
+
+	drain(fds, got);
+	return 0;
+}
@@ -0,0 +1,122 @@
+/*
+ * forkbench.c: cost of process creation
+ *
+ * Times loops of fork (child exits at once), vfork, and fork followed by
+ * exec of this program, which then exits at once.  With a large parent
+ * (-m) the difference between copying the memory on fork and sharing
+ * it copy-on-write shows.
+ *
+ * usage: forkbench [-n loops] [-m kbytes]
+ *
+ *	-n	iterations per test (default 200)
+ *	-m	touch this much memory in the parent first (default 0)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "bench.h"
+
+static int
+reap(long pid)
+{
+	int status;
+
+	if (pid < 0)
+	{
+		perror("fork");
+		return 1;
+	}
+
+	if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status))
+	{
+		fprintf(stderr, "forkbench: child failed\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	long loops = 200, kbytes = 0, i, t0;
+	char *mem;
+	int j;
+
+	/* the child of the exec test */
+	if (argc == 2 && !strcmp(argv[1], "-x"))
+		return 0;
+
+	for (j = 1; j < argc; j++)
+	{
+		if (!strcmp(argv[j], "-n") && j + 1 < argc)
+			loops = atol(argv[++j]);
+		else if (!strcmp(argv[j], "-m") && j + 1 < argc)
+			kbytes = atol(argv[++j]);
+		else
+			break;
+	}
+
+	if (j != argc || loops <= 0 || kbytes < 0)
+	{
+		fprintf(stderr, "usage: forkbench [-n loops] [-m kbytes]\n");
+		return 2;
+	}
+
+	if (kbytes)
+	{
+		mem = malloc(kbytes * 1024L);
+		if (!mem)
+		{
+			fprintf(stderr, "forkbench: out of memory\n");
+			return 2;
+		}
+
+		memset(mem, 1, kbytes * 1024L);
+	}
+
+	t0 = now();
+	for (i = 0; i < loops; i++)
+	{
+		long pid = fork();
+
+		if (pid == 0)
+			_exit(0);
+		if (reap(pid))
+			return 1;
+	}
+	report_rate("fork", loops, "loop", now() - t0);
+
+	t0 = now();
+	for (i = 0; i < loops; i++)
+	{
+		long pid = vfork();
+
+		if (pid == 0)
+			_exit(0);
+		if (reap(pid))
+			return 1;
+	}
+	report_rate("vfork", loops, "loop", now() - t0);
+
+	t0 = now();
+	for (i = 0; i < loops; i++)
+	{
+		long pid = fork();
+
+		if (pid == 0)
+		{
+			execl(argv[0], argv[0], "-x", NULL);
+			_exit(1);
+		}
+		if (reap(pid))
+			return 1;
+	}
+	report_rate("fork+exec", loops, "loop", now() - t0);
+
+	return 0;
+}
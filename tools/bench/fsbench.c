@@ -0,0 +1,120 @@
+/*
+ * fsbench.c: file throughput on a local file system
+ *
+ * Writes a file in large chunks, reads it back sequentially, then reads
+ * small blocks at random offsets.  Large transfers go through the
+ * multi-zone paths of the file system, the random reads through the
+ * block map lookup of zones behind the indirect blocks.
+ *
+ * usage: fsbench [-s kbytes] [-b bufsize] [-r reads] [-k] file
+ *
+ *	-s	size of the file in KB (default 4096)
+ *	-b	size of a sequential write or read (default 32768)
+ *	-r	number of 1 KB random reads (default 2000)
+ *	-k	keep the file
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+int
+main(int argc, char **argv)
+{
+	long kbytes = 4096, bufsize = 32768, reads = 2000, total, done, n, i, t0;
+	int keep = 0, fd, j;
+	char *buf;
+
+	for (j = 1; j < argc && argv[j][0] == '-'; j++)
+	{
+		if (!strcmp(argv[j], "-s") && j + 1 < argc)
+			kbytes = atol(argv[++j]);
+		else if (!strcmp(argv[j], "-b") && j + 1 < argc)
+			bufsize = atol(argv[++j]);
+		else if (!strcmp(argv[j], "-r") && j + 1 < argc)
+			reads = atol(argv[++j]);
+		else if (!strcmp(argv[j], "-k"))
+			keep = 1;
+		else
+			break;
+	}
+
+	if (j != argc - 1 || kbytes <= 0 || kbytes > 32767L || bufsize < 1024 || reads < 0)
+	{
+		fprintf(stderr, "usage: fsbench [-s kbytes] [-b bufsize] [-r reads] [-k] file\n");
+		return 2;
+	}
+
+	buf = malloc(bufsize);
+	if (!buf)
+	{
+		fprintf(stderr, "fsbench: out of memory\n");
+		return 2;
+	}
+
+	memset(buf, 'x', bufsize);
+	total = kbytes * 1024L;
+
+	fd = open(argv[j], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+	{
+		perror(argv[j]);
+		return 1;
+	}
+
+	t0 = now();
+	for (done = 0; done < total; done += n)
+	{
+		n = total - done < bufsize ? total - done : bufsize;
+
+		if (write(fd, buf, n) != n)
+		{
+			perror("write");
+			return 1;
+		}
+	}
+
+	if (fsync(fd) || close(fd))
+	{
+		perror("close");
+		return 1;
+	}
+	report_kbytes("write", kbytes, now() - t0);
+
+	fd = open(argv[j], O_RDONLY);
+	if (fd < 0)
+	{
+		perror(argv[j]);
+		return 1;
+	}
+
+	t0 = now();
+	for (done = 0; (n = read(fd, buf, bufsize)) > 0; done += n)
+		;
+	report_kbytes("read", done / 1024, now() - t0);
+
+	srand(1);
+	t0 = now();
+	for (i = 0; i < reads; i++)
+	{
+		long pos = (rand() % (total / 1024)) * 1024L;
+
+		if (lseek(fd, pos, SEEK_SET) != pos || read(fd, buf, 1024) != 1024)
+		{
+			perror("random read");
+			return 1;
+		}
+	}
+	report_kbytes("random", reads, now() - t0);
+
+	close(fd);
+
+	if (!keep)
+		unlink(argv[j]);
+
+	return 0;
+}
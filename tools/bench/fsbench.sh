@@ -0,0 +1,41 @@
+#!/bin/sh
+#
+# Run fsbench on a minixfs made with the tools of tools/minix: minit
+# makes a new file system on the drive, then fsbench runs with small
+# and large buffers on a file that needs only the direct zones and on
+# one that goes through the double indirect zones.  At the end
+# fsck.minix checks (without repairing) what the writes left behind.
+#
+# usage: fsbench.sh drive
+#
+# The partition must have the ID MIX or RAW (see tools/minix/docs/
+# minit.doc); EVERYTHING ON IT IS LOST.  minit, fsck.minix and fsbench
+# are taken from $PATH unless MINIT, FSCK and FSBENCH say otherwise.
+#
+
+MINIT=${MINIT:-minit}
+FSCK=${FSCK:-fsck.minix}
+FSBENCH=${FSBENCH:-fsbench}
+
+if [ $# -ne 1 ]; then
+	echo "usage: fsbench.sh drive"
+	exit 2
+fi
+
+drv=`echo $1 | cut -c1 | tr A-Z a-z`
+dir=/$drv
+
+# minit asks before it overwrites the drive
+echo y | $MINIT $drv: || { echo "minit failed"; exit 1; }
+
+# minit unlocks the drive, which makes the kernel mount it again
+ls $dir > /dev/null || { echo "$dir is not accessible"; exit 1; }
+
+for size in 6 8192; do
+	for buf in 1024 32768; do
+		echo "== $size KB file, $buf byte buffer"
+		$FSBENCH -s $size -b $buf -k $dir/bench$size-$buf || exit 1
+	done
+done
+
+$FSCK -f -n $drv:
@@ -0,0 +1,237 @@
+/*
+ * futexbench.c: user space lock with Pfutex against Psemaphore
+ *
+ * Times lock/unlock pairs of a mutex built on Pfutex, where the kernel
+ * is entered only when the lock is contended, and of a Psemaphore,
+ * which is a system call for every lock and unlock.  The uncontended
+ * test runs in one process; in the contended one several processes
+ * share the lock through a shared memory file and yield while holding
+ * it, so that the others have to wait.
+ *
+ * usage: futexbench [-n loops] [-p processes]
+ *
+ *	-n	lock/unlock pairs per test (default 20000)
+ *	-p	processes of the contended test (default 4)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <mintbind.h>
+
+#include "bench.h"
+
+/* see sys/mint/futex.h */
+#define FUTEX_WAIT	0
+#define FUTEX_WAKE	1
+
+#ifndef SHMSETBLK
+#define SHMSETBLK	(('M' << 8) | 1)
+#endif
+
+#define SEM_ID		0x46424e43L	/* "FBNC" */
+#define SHM_FILE	"u:\\shm\\futexbench"
+
+#define LOCKED		0x80000000L
+
+struct shared
+{
+	volatile long lock;	/* LOCKED or 0 */
+	volatile long waiters;
+	volatile long counter;
+};
+
+/* the C library has no binding for it yet */
+static long
+Pfutex(short op, volatile long *addr, long val, long arg)
+{
+	register long ret __asm__("d0");
+
+	__asm__ volatile
+	(
+		"move.l	%4,-(%%sp)\n\t"
+		"move.l	%3,-(%%sp)\n\t"
+		"move.l	%2,-(%%sp)\n\t"
+		"move.w	%1,-(%%sp)\n\t"
+		"move.w	#0x185,-(%%sp)\n\t"
+		"trap	#1\n\t"
+		"lea	16(%%sp),%%sp"
+		: "=r" (ret)
+		: "r" (op), "r" (addr), "r" (val), "r" (arg)
+		: "d1", "d2", "a0", "a1", "a2", "cc", "memory"
+	);
+
+	return ret;
+}
+
+/* set bit 31 of *p, return its old value; a single instruction, so
+ * this is atomic against the scheduler on a single CPU
+ */
+static int
+test_and_set(volatile long *p)
+{
+	char old;
+
+	__asm__ volatile
+	(
+		"bset	#7,%1\n\t"
+		"sne	%0"
+		: "=d" (old), "+m" (*(volatile char *) p)
+		:
+		: "cc"
+	);
+
+	return old;
+}
+
+/* the waiters count must not lose updates either */
+static void
+waiter_inc(volatile long *p)
+{
+	__asm__ volatile ("addq.l	#1,%0" : "+m" (*p) : : "cc");
+}
+
+static void
+waiter_dec(volatile long *p)
+{
+	__asm__ volatile ("subq.l	#1,%0" : "+m" (*p) : : "cc");
+}
+
+static void
+futex_lock(struct shared *s)
+{
+	while (test_and_set(&s->lock))
+	{
+		waiter_inc(&s->waiters);
+		Pfutex(FUTEX_WAIT, &s->lock, LOCKED, 0);
+		waiter_dec(&s->waiters);
+	}
+}
+
+static void
+futex_unlock(struct shared *s)
+{
+	s->lock = 0;
+	if (s->waiters)
+		Pfutex(FUTEX_WAKE, &s->lock, 1, 0);
+}
+
+static void
+sema_lock(void)
+{
+	Psemaphore(2, SEM_ID, -1L);
+}
+
+static void
+sema_unlock(void)
+{
+	Psemaphore(3, SEM_ID, 0);
+}
+
+/* loops lock/unlock pairs in each of procs processes */
+static long
+run(struct shared *s, int futex, long procs, long loops)
+{
+	long i, k, t0;
+
+	s->counter = 0;
+	t0 = now();
+
+	for (k = 0; k < procs; k++)
+	{
+		long pid = procs > 1 ? fork() : 0;
+
+		if (pid < 0)
+		{
+			perror("fork");
+			exit(1);
+		}
+
+		if (pid)
+			continue;
+
+		for (i = 0; i < loops; i++)
+		{
+			if (futex)
+				futex_lock(s);
+			else
+				sema_lock();
+
+			s->counter++;
+			if (procs > 1)
+				Syield();
+
+			if (futex)
+				futex_unlock(s);
+			else
+				sema_unlock();
+		}
+
+		if (procs > 1)
+			_exit(0);
+	}
+
+	while (procs > 1 && wait(NULL) > 0)
+		;
+
+	if (s->counter != procs * loops)
+		fprintf(stderr, "futexbench: counter %ld, expected %ld\n", s->counter, procs * loops);
+
+	return now() - t0;
+}
+
+int
+main(int argc, char **argv)
+{
+	long loops = 20000, procs = 4;
+	struct shared *s;
+	int fd, j;
+
+	for (j = 1; j < argc; j++)
+	{
+		if (!strcmp(argv[j], "-n") && j + 1 < argc)
+			loops = atol(argv[++j]);
+		else if (!strcmp(argv[j], "-p") && j + 1 < argc)
+			procs = atol(argv[++j]);
+		else
+			break;
+	}
+
+	if (j != argc || loops < 10 || procs < 2)
+	{
+		fprintf(stderr, "usage: futexbench [-n loops] [-p processes]\n");
+		return 2;
+	}
+
+	/* global memory, shared with the children through the shm file */
+	s = (struct shared *) Mxalloc(sizeof(*s), 0x23);
+	fd = Fcreate(SHM_FILE, 0);
+	if (!s || (long) s < 0 || fd < 0 || Fcntl(fd, (long) s, SHMSETBLK) < 0)
+	{
+		fprintf(stderr, "futexbench: no shared memory\n");
+		return 1;
+	}
+	memset(s, 0, sizeof(*s));
+
+	if (Psemaphore(0, SEM_ID, 0) < 0)
+	{
+		fprintf(stderr, "futexbench: can't create the semaphore\n");
+		return 1;
+	}
+	sema_unlock();
+
+	report_rate("Pfutex", loops, "pair", run(s, 1, 1, loops));
+	report_rate("Psemaphore", loops, "pair", run(s, 0, 1, loops));
+	report_rate("Pfutex, contended", procs * loops / 10, "pair", run(s, 1, procs, loops / 10));
+	report_rate("Psemaphore, contended", procs * loops / 10, "pair", run(s, 0, procs, loops / 10));
+
+	Psemaphore(2, SEM_ID, -1L);
+	Psemaphore(1, SEM_ID, 0);
+	Fclose(fd);
+	Fdelete(SHM_FILE);
+
+	return 0;
+}
@@ -0,0 +1,130 @@
+/*
+ * msgbench.c: Pmsg round trip time
+ *
+ * A parent and a child pass a message back and forth, the parent with
+ * a write/read (mode 2), the child reading the request and writing the
+ * reply.  Idle processes that wait on mailboxes of their own (-p) show
+ * whether finding the partner of a rendezvous depends on the number of
+ * waiting processes.
+ *
+ * usage: msgbench [-n loops] [-p idle]
+ *
+ *	-n	round trips (default 2000)
+ *	-p	number of idle processes waiting in Pmsg (default 0)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <mintbind.h>
+
+#include "bench.h"
+
+#define MBOX		0x4d424e43L	/* "MBNC" */
+#define REPLY(pid)	(0xffff0000L | (pid))
+
+struct msg
+{
+	long msg1;
+	long msg2;
+	short pid;
+};
+
+int
+main(int argc, char **argv)
+{
+	long loops = 2000, idle = 0, i, t0, ms, server;
+	long *pids;
+	struct msg m;
+	char what[32];
+	int j;
+
+	for (j = 1; j < argc; j++)
+	{
+		if (!strcmp(argv[j], "-n") && j + 1 < argc)
+			loops = atol(argv[++j]);
+		else if (!strcmp(argv[j], "-p") && j + 1 < argc)
+			idle = atol(argv[++j]);
+		else
+			break;
+	}
+
+	if (j != argc || loops <= 0 || idle < 0)
+	{
+		fprintf(stderr, "usage: msgbench [-n loops] [-p idle]\n");
+		return 2;
+	}
+
+	pids = malloc((idle + 1) * sizeof(*pids));
+	if (!pids)
+	{
+		fprintf(stderr, "msgbench: out of memory\n");
+		return 2;
+	}
+
+	/* nobody ever writes to these */
+	for (i = 0; i < idle; i++)
+	{
+		pids[i] = fork();
+		if (pids[i] == 0)
+		{
+			Pmsg(0, MBOX + 1 + i, &m);
+			_exit(0);
+		}
+		if (pids[i] < 0)
+		{
+			perror("fork");
+			idle = i;
+			break;
+		}
+	}
+
+	server = fork();
+	if (server == 0)
+	{
+		for (;;)
+		{
+			if (Pmsg(0, MBOX, &m))
+				_exit(1);
+
+			m.msg1++;
+			if (Pmsg(1, REPLY(m.pid), &m))
+				_exit(1);
+		}
+	}
+	if (server < 0)
+	{
+		perror("fork");
+		return 1;
+	}
+
+	m.msg1 = 0;
+	t0 = now();
+	for (i = 0; i < loops; i++)
+	{
+		if (Pmsg(2, MBOX, &m))
+		{
+			fprintf(stderr, "msgbench: Pmsg failed\n");
+			break;
+		}
+	}
+	ms = now() - t0;
+
+	if (i == loops && m.msg1 != loops)
+		fprintf(stderr, "msgbench: lost %ld replies\n", loops - m.msg1);
+
+	sprintf(what, "%ld idle", idle);
+	report_rate(what, i, "trip", ms);
+
+	pids[idle] = server;
+	for (i = 0; i <= idle; i++)
+	{
+		kill(pids[i], SIGKILL);
+		waitpid(pids[i], NULL, 0);
+	}
+
+	return 0;
+}
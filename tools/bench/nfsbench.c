@@ -0,0 +1,118 @@
+/*
+ * nfsbench.c: sequential NFS throughput
+ *
+ * Writes a file of the given size on an NFS mount, then reads it back,
+ * and prints the rate of both.  The time of the close after writing is
+ * printed separately: on a version 3 mount that is where the client
+ * sends the COMMIT for the unstable writes.  See README for how to run
+ * it at different network latencies.
+ *
+ * usage: nfsbench [-s kbytes] [-b bufsize] [-k] file
+ *
+ *	-s	size of the file in KB (default 1024)
+ *	-b	size of a single write or read (default 8192)
+ *	-k	keep the file
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+int
+main(int argc, char **argv)
+{
+	long kbytes = 1024, bufsize = 8192, total, done, n, t0, t1, t2;
+	int keep = 0, fd, i;
+	char *buf;
+
+	for (i = 1; i < argc && argv[i][0] == '-'; i++)
+	{
+		if (!strcmp(argv[i], "-s") && i + 1 < argc)
+			kbytes = atol(argv[++i]);
+		else if (!strcmp(argv[i], "-b") && i + 1 < argc)
+			bufsize = atol(argv[++i]);
+		else if (!strcmp(argv[i], "-k"))
+			keep = 1;
+		else
+			break;
+	}
+
+	if (i != argc - 1 || kbytes <= 0 || bufsize <= 0)
+	{
+		fprintf(stderr, "usage: nfsbench [-s kbytes] [-b bufsize] [-k] file\n");
+		return 2;
+	}
+
+	buf = malloc(bufsize);
+	if (!buf)
+	{
+		fprintf(stderr, "nfsbench: out of memory\n");
+		return 2;
+	}
+
+	memset(buf, 'x', bufsize);
+	total = kbytes * 1024L;
+
+	fd = open(argv[i], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+	{
+		perror(argv[i]);
+		return 1;
+	}
+
+	t0 = now();
+	for (done = 0; done < total; )
+	{
+		n = total - done < bufsize ? total - done : bufsize;
+
+		if (write(fd, buf, n) != n)
+		{
+			perror("write");
+			return 1;
+		}
+
+		done += n;
+	}
+
+	t1 = now();
+	if (close(fd))
+	{
+		perror("close");
+		return 1;
+	}
+
+	t2 = now();
+	report_kbytes("write", kbytes, t2 - t0);
+	report_rate("close", 1, "close", t2 - t1);
+
+	fd = open(argv[i], O_RDONLY);
+	if (fd < 0)
+	{
+		perror(argv[i]);
+		return 1;
+	}
+
+	t0 = now();
+	for (done = 0; (n = read(fd, buf, bufsize)) > 0; done += n)
+		;
+
+	t2 = now();
+	close(fd);
+
+	if (n < 0)
+	{
+		perror("read");
+		return 1;
+	}
+
+	report_kbytes("read", done / 1024, t2 - t0);
+
+	if (!keep)
+		unlink(argv[i]);
+
+	return 0;
+}
@@ -0,0 +1,102 @@
+#!/bin/sh
+#
+# Check the isofs directory code (isocheck, i.e. sys/xfs/isofs/isofs_dir.c
+# and isofs_rrip.c) against images made by mkisofs: the listing of a
+# Rock Ridge image must match the tree it was made from, names, types,
+# permissions and file sizes; a Joliet image the names and types; and a
+# plain ISO 9660 image must have all the files.  The tree has a directory
+# of several blocks, directories deeper than 8 levels (relocated with
+# Rock Ridge), long and mixed case names, a symlink and an empty file.
+#
+# Needs mkisofs (or genisoimage, or xorriso -as mkisofs).
+#
+
+ISOCHECK=${ISOCHECK:-./isocheck}
+MKISOFS=${MKISOFS:-`which mkisofs || which genisoimage`}
+fail=0
+
+tree=isotree
+
+mktree()
+{
+	rm -rf $tree
+	mkdir -p $tree/big $tree/sub/d1/d2/d3/d4/d5/d6/d7/d8/d9
+	echo hello > "$tree/Mixed Case Name.txt"
+	dd if=/dev/zero bs=1024 count=100 2>/dev/null | tr '\0' x > $tree/sub/data.bin
+	chmod 600 $tree/sub/data.bin
+	: > $tree/sub/empty
+	ln -s ../sub/data.bin $tree/sub/link
+	echo deep > $tree/sub/d1/d2/d3/d4/d5/d6/d7/d8/d9/deep_file
+	i=0
+	while [ $i -lt 300 ]; do
+		echo $i > $tree/big/a_rather_long_file_name_$i
+		i=`expr $i + 1`
+	done
+}
+
+# type, permissions, size of regular files and path of everything in the tree
+expected()
+{
+	(cd $tree && find . -mindepth 1 | sed 's|^\./||' | while read p; do
+		if [ -h "$p" ]; then
+			echo "l 0`stat -c %a "$p"` 0 $p"
+		elif [ -d "$p" ]; then
+			echo "d 0`stat -c %a "$p"` 0 $p"
+		else
+			echo "- 0`stat -c %a "$p"` `stat -c %s "$p"` $p"
+		fi
+	done) | sort
+}
+
+# name, mkisofs options
+run()
+{
+	rm -f $1.iso $1.out
+	$MKISOFS -quiet $2 -o $1.iso $tree >/dev/null 2>&1 || { echo "$1: mkisofs failed"; fail=1; return 1; }
+	$ISOCHECK $1.iso > $1.raw || { echo "$1: isocheck failed"; fail=1; return 1; }
+	grep -v ' \.\{0,1\}rr_moved$' $1.raw | sort > $1.out
+}
+
+if [ -z "$MKISOFS" ]; then
+	echo "mkisofs not found"
+	exit 1
+fi
+
+mktree
+expected > expected.out
+
+if run rr "-R"; then
+	if cmp -s rr.out expected.out; then
+		echo "rr: ok"
+	else
+		echo "rr: FAIL, listing differs:"
+		diff rr.out expected.out
+		fail=1
+	fi
+fi
+
+if run joliet "-J"; then
+	awk '$1 != "l" { print $1, $4 }' expected.out | sort > expected-j.out
+	awk '{ print $1, $4 }' joliet.out | sort > joliet-j.out
+	if cmp -s joliet-j.out expected-j.out; then
+		echo "joliet: ok"
+	else
+		echo "joliet: FAIL, listing differs:"
+		diff joliet-j.out expected-j.out
+		fail=1
+	fi
+fi
+
+if run plain ""; then
+	want=`grep -c '^-' expected.out`
+	got=`grep -c '^-' plain.out`
+	if [ "$want" = "$got" ]; then
+		echo "plain: ok ($got files)"
+	else
+		echo "plain: FAIL, $got files instead of $want"
+		fail=1
+	fi
+fi
+
+rm -rf $tree *.iso *.raw *.out
+exit $fail
@@ -0,0 +1,236 @@
+/*
+ * isocheck.c: list an ISO 9660 image through the isofs directory code
+ *
+ * Runs the directory index and the Rock Ridge and Joliet name handling
+ * of the isofs driver (sys/xfs/isofs) on the host against an image
+ * file, e.g. one made by mkisofs, and prints every entry the way the
+ * driver sees it.  Each entry is also looked up by its name, which has
+ * to find the same entry again.  check.sh compares the listing with the
+ * tree the image was made from.
+ *
+ * usage: isocheck image
+ *
+ * One line per entry: type (d, l or -), the permission bits, the size
+ * of a regular file (0 for the others) and the path.
+ */
+
+#include "isofs_dir.h"
+#include "isofs_rrip.h"
+
+#define NBUF	4
+
+static int fd;
+static long errors;
+
+/* the directory code holds at most one block while it reads another */
+static UNIT *
+host_read(DI *di, ulong block, long size)
+{
+	static char *bufs[NBUF];
+	static UNIT units[NBUF];
+	static int next;
+	UNIT *u;
+
+	u = &units[next];
+	if (!bufs[next])
+	{
+		bufs[next] = malloc(size);
+		if (!bufs[next])
+			return NULL;
+	}
+
+	u->data = bufs[next];
+	next = (next + 1) % NBUF;
+
+	if (pread(fd, u->data, size, (off_t) block * size) != size)
+		return NULL;
+
+	return u;
+}
+
+struct bio bio = { host_read };
+
+static void
+die(const char *msg)
+{
+	fprintf(stderr, "isocheck: %s\n", msg);
+	exit(2);
+}
+
+/* see iso_makemp() in isofs.c */
+static void
+makemp(struct iso_super *super, const char *data)
+{
+	const struct iso_primary_descriptor *pri = (const void *) data;
+	const struct iso_directory_record *rootp = (const void *) pri->root_directory_record;
+
+	super->logical_block_size = isonum_723((uchar *) pri->logical_block_size);
+	if (super->logical_block_size < ISO_DEFAULT_BLOCK_SIZE)
+		die("unsupported logical block size");
+
+	super->volume_space_size = isonum_733((uchar *) pri->volume_space_size);
+	memcpy(super->root, rootp, sizeof(super->root));
+	super->root_extent = isonum_733((uchar *) rootp->extent);
+	super->root_size = isonum_733((uchar *) rootp->size);
+	super->im_joliet_level = 0;
+
+	super->im_bmask = super->logical_block_size - 1;
+	super->im_bshift = 0;
+	while ((1 << super->im_bshift) < super->logical_block_size)
+		super->im_bshift++;
+}
+
+/* see iso_mountfs() in isofs.c */
+static void
+mount(struct iso_super *super)
+{
+	char pri[ISO_DEFAULT_BLOCK_SIZE], sup[ISO_DEFAULT_BLOCK_SIZE];
+	char buf[ISO_DEFAULT_BLOCK_SIZE];
+	int have_pri = 0, have_sup = 0;
+	long blk;
+	UNIT *u;
+
+	for (blk = 16; blk < 100; blk++)
+	{
+		struct iso_volume_descriptor *vdp = (void *) buf;
+
+		if (pread(fd, buf, sizeof(buf), blk * sizeof(buf)) != sizeof(buf))
+			die("read error");
+
+		if (memcmp(vdp->id, ISO_STANDARD_ID, sizeof(vdp->id)) != 0)
+			die("not an ISO 9660 image");
+
+		if (isonum_711((uchar *) vdp->type) == ISO_VD_PRIMARY && !have_pri)
+		{
+			memcpy(pri, buf, sizeof(buf));
+			have_pri = 1;
+		}
+		else if (isonum_711((uchar *) vdp->type) == ISO_VD_SUPPLEMENTARY && !have_sup)
+		{
+			memcpy(sup, buf, sizeof(buf));
+			have_sup = 1;
+		}
+		else if (isonum_711((uchar *) vdp->type) == ISO_VD_END)
+			break;
+	}
+
+	if (!have_pri)
+		die("no primary volume descriptor");
+
+	bzero(super, sizeof(*super));
+	makemp(super, pri);
+
+	u = bio.read(NULL, super->root_extent
+		     + isonum_711((uchar *) ((struct iso_directory_record *) super->root)->ext_attr_length),
+		     super->logical_block_size);
+	if (!u)
+		die("can't read the root directory");
+
+	super->rr_skip = cd9660_rrip_offset((struct iso_directory_record *) u->data, super);
+
+	if (have_sup && super->rr_skip < 0)
+	{
+		struct iso_supplementary_descriptor *s = (void *) sup;
+		int level = 0;
+
+		if ((isonum_711((uchar *) s->flags) & 1) == 0)
+		{
+			if (memcmp(s->escape, "%/@", 3) == 0)
+				level = 1;
+			if (memcmp(s->escape, "%/C", 3) == 0)
+				level = 2;
+			if (memcmp(s->escape, "%/E", 3) == 0)
+				level = 3;
+		}
+
+		if (level)
+		{
+			makemp(super, sup);
+			super->im_joliet_level = level;
+		}
+	}
+
+	fprintf(stderr, "isocheck: %s, block size %ld\n",
+		super->rr_skip >= 0 ? "Rock Ridge"
+		: super->im_joliet_level ? "Joliet" : "ISO 9660",
+		super->logical_block_size);
+}
+
+static void
+list(struct iso_super *super, DNODE *dir, const char *path)
+{
+	long i, r;
+
+	r = iso_dir_index(super, dir);
+	if (r)
+	{
+		fprintf(stderr, "isocheck: %s: index failed (%ld)\n", *path ? path : "/", r);
+		errors++;
+		return;
+	}
+
+	for (i = 0; i < dir->dir->count; i++)
+	{
+		DNODE *d = dir->dir->entries[i];
+		DNODE *found = NULL;
+		char *sub;
+		char type = '-';
+
+		sub = malloc(strlen(path) + d->namelen + 2);
+		if (!sub)
+			die("out of memory");
+		sprintf(sub, "%s%s%s", path, *path ? "/" : "", d->name);
+
+		if (iso_dir_lookup(super, dir, d->name, &found) || found != d)
+		{
+			fprintf(stderr, "isocheck: %s: lookup finds %s\n", sub,
+				found ? found->name : "nothing");
+			errors++;
+		}
+
+		if (S_ISDIR(d->mode))
+			type = 'd';
+		else if (S_ISLNK(d->mode))
+			type = 'l';
+
+		printf("%c %04o %lu %s\n", type, d->mode & 07777,
+		       type == '-' ? (unsigned long) d->size : 0UL, sub);
+
+		if (type == 'd')
+			list(super, d, sub);
+
+		free(sub);
+	}
+}
+
+int
+main(int argc, char **argv)
+{
+	struct iso_super super;
+	DNODE *root;
+
+	if (argc != 2)
+	{
+		fprintf(stderr, "usage: isocheck image\n");
+		return 2;
+	}
+
+	fd = open(argv[1], O_RDONLY);
+	if (fd < 0)
+	{
+		perror(argv[1]);
+		return 2;
+	}
+
+	mount(&super);
+
+	root = iso_dir_root(&super);
+	if (!root)
+		die("out of memory");
+
+	list(&super, root, "");
+	iso_dir_free(root);
+
+	close(fd);
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,84 @@
+/*
+ * isohost.h: what the isofs directory code needs from the kernel, for
+ * building it on the host (see isofs_global.h, ISO_HOST)
+ */
+
+#ifndef _isohost_h
+#define _isohost_h
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* isofs_rrip.h has its own */
+#define ino_t		iso_ino_t
+#define off_t		iso_off_t
+#define daddr_t		iso_daddr_t
+
+typedef unsigned char	uchar;
+
+#define INLINE		static inline
+
+/* MiNT's values, see sys/mint/errno.h */
+#define E_OK		0
+#define EREAD		-11
+#define ENOENT		-33
+#define ENOTDIR		-34
+#define ENOMEM		-39
+
+#define FORCE(x)
+#define ALERT(x)
+#define DEBUG(x)
+#define TRACE(x)
+#define ASSERT(x)
+
+/* MiNT's file types, instead of sys/mint/stat.h */
+#define _mint_stat_h
+#undef S_IFMT
+#undef S_IFLNK
+#undef S_IFIFO
+#undef S_IFREG
+#undef S_IFBLK
+#undef S_IFDIR
+#undef S_IFCHR
+#undef S_IFSOCK
+#undef S_ISDIR
+#undef S_ISLNK
+#define S_IFMT		0170000
+#define S_IFLNK		0160000
+#define S_IFMEM		0140000
+#define S_IFIFO		0120000
+#define S_IFREG		0100000
+#define S_IFBLK		0060000
+#define S_IFDIR		0040000
+#define S_IFCHR		0020000
+#define S_IFSOCK	0010000
+#define S_ISDIR(m)	(((m) & S_IFMT) == S_IFDIR)
+#define S_ISLNK(m)	(((m) & S_IFMT) == S_IFLNK)
+
+#define kmalloc(n)	malloc(n)
+#define kfree(p, n)	free(p)
+#define TOLOWER(c)	tolower((uchar) (c))
+#define stricmp		strcasecmp
+
+/* a block cache of one block */
+typedef struct di DI;
+
+typedef struct
+{
+	char	*data;
+} UNIT;
+
+struct bio
+{
+	UNIT *	(*read)(DI *di, ulong block, long size);
+};
+
+extern struct bio bio;
+
+#endif /* _isohost_h */
@@ -0,0 +1,83 @@
+#!/bin/sh
+#
+# Check the ext2fs journal replay (jbdcheck, i.e. sys/xfs/ext2fs/jbd.c)
+# against e2fsprogs: mke2fs makes an image, debugfs logs transactions
+# into its journal the way Linux does, then one copy is replayed by
+# jbdcheck and one by debugfs, and both copies must be identical
+# (except some statistics and the checksum of the superblock).
+#
+# Needs mke2fs, debugfs and e2fsck from e2fsprogs 1.43 or later.
+#
+
+JBDCHECK=${JBDCHECK:-./jbdcheck}
+fail=0
+
+# write a file of n blocks of size bs, filled with the given character
+blocks()
+{
+	dd if=/dev/zero bs=$2 count=$3 2>/dev/null | tr '\0' "$4" > $1
+}
+
+# name, mke2fs options, journal_open options
+check()
+{
+	name=$1
+	bs=$2
+	mkopts=$3
+	joopts=$4
+
+	rm -f $name.img $name-ref.img
+	mke2fs -q -F -b $bs $mkopts $name.img 16M >/dev/null 2>&1 || { echo "$name: mke2fs failed"; fail=1; return; }
+
+	# free blocks at the end of the file system
+	b=`expr 16777216 / $bs - 100`
+
+	blocks f1 $bs 3 A
+	blocks f2 $bs 1 B
+	blocks f3 $bs 1 C
+	# a block that looks like a journal block, it's escaped in the log
+	{ printf '\300\073\071\230'; dd if=/dev/zero bs=1 count=`expr $bs - 4` 2>/dev/null | tr '\0' D; } > fm
+
+	# 1: three blocks; 2: revokes one of them; 3: relogs another;
+	# 4: escaped block; 5: never committed
+	debugfs -w $name.img >/dev/null 2>&1 <<EOF
+jo $joopts
+jw -b $b,`expr $b + 1`,`expr $b + 2` f1
+jw -r `expr $b + 1`
+jw -b `expr $b + 2` f2
+jw -b `expr $b + 4` fm
+jw -b `expr $b + 5` -c f3
+jc
+EOF
+
+	cp $name.img $name-ref.img
+
+	$JBDCHECK $name.img > $name.out || { echo "$name: jbdcheck failed"; fail=1; return; }
+	debugfs -w -R jr $name-ref.img >/dev/null 2>&1
+
+	# offsets in cmp -l are 1 based
+	diffs=`cmp -l $name.img $name-ref.img | awk '
+		$1 >= 1089 && $1 <= 1092 { next }	# s_lastcheck
+		$1 >= 1401 && $1 <= 1408 { next }	# s_kbytes_written
+		$1 >= 2045 && $1 <= 2048 { next }	# s_checksum
+		{ n++ }
+		END { print n + 0 }'`
+
+	if [ "$diffs" != 0 ]; then
+		echo "$name: FAIL, $diffs bytes differ from the e2fsprogs replay"
+		fail=1
+	elif ! e2fsck -fn $name.img >/dev/null 2>&1; then
+		echo "$name: FAIL, e2fsck finds errors after the replay"
+		fail=1
+	else
+		echo "$name: ok (`cat $name.out`)"
+	fi
+
+	rm -f f1 f2 f3 fm $name.out $name.img $name-ref.img
+}
+
+check ext3-1k 1024 "-t ext3" ""
+check ext3-4k 4096 "-t ext3" ""
+check ext4-csum 4096 "-t ext4 -O 64bit,metadata_csum" "-c"
+
+exit $fail
@@ -0,0 +1,340 @@
+/*
+ * jbdcheck.c: replay the ext3 journal of a file system image
+ *
+ * Runs the journal replay of the ext2 driver (sys/xfs/ext2fs/jbd.c) on
+ * the host against an image file, e.g. one made by Linux or e2fsprogs.
+ * Afterwards the log is marked empty and the needs_recovery flag is
+ * cleared, as the driver does on mount.  check.sh compares the result
+ * with the replay of e2fsprogs.
+ *
+ * usage: jbdcheck [-n] [-v] image
+ *
+ *	-n	don't write anything, only report
+ *	-v	list the replayed blocks
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "jbd.h"
+
+#define EXT3_FEATURE_COMPAT_HAS_JOURNAL	0x0004
+#define EXT3_FEATURE_INCOMPAT_RECOVER	0x0004
+#define EXT4_FEATURE_INCOMPAT_64BIT	0x0080
+#define EXT4_FEATURE_RO_COMPAT_METADATA_CSUM	0x0400
+#define EXT4_EXTENTS_FL			0x00080000UL
+#define EXT4_EXT_MAGIC			0xf30a
+
+static int fd;
+static int dry_run;
+static int verbose;
+static unsigned long bsize;
+static unsigned long *map;		/* log block -> device block */
+static unsigned long maplen;
+
+static unsigned long
+le32(const unsigned char *p)
+{
+	return p[0] | (p[1] << 8) | ((unsigned long) p[2] << 16) | ((unsigned long) p[3] << 24);
+}
+
+static unsigned int
+le16(const unsigned char *p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+static void
+put_le32(unsigned char *p, unsigned long v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+	p[2] = v >> 16;
+	p[3] = v >> 24;
+}
+
+static void
+die(const char *msg)
+{
+	fprintf(stderr, "jbdcheck: %s\n", msg);
+	exit(2);
+}
+
+static void
+rd(unsigned long long off, void *buf, unsigned long len)
+{
+	if (pread(fd, buf, len, off) != (ssize_t) len)
+		die("read error");
+}
+
+static void
+wr(unsigned long long off, const void *buf, unsigned long len)
+{
+	if (pwrite(fd, buf, len, off) != (ssize_t) len)
+		die("write error");
+}
+
+static void
+map_add(unsigned long lblk, unsigned long pblk)
+{
+	if (lblk < maplen)
+		map[lblk] = pblk;
+}
+
+/* indirect block tree of the given depth */
+static void
+map_ind(unsigned long pblk, int depth, unsigned long *lblk)
+{
+	unsigned long n = bsize / 4;
+	unsigned char *buf;
+	unsigned long i;
+
+	if (!pblk)
+	{
+		unsigned long span = 1;
+
+		while (depth--)
+			span *= n;
+
+		*lblk += span;
+		return;
+	}
+
+	buf = malloc(bsize);
+	if (!buf)
+		die("out of memory");
+
+	rd((unsigned long long) pblk * bsize, buf, bsize);
+
+	for (i = 0; i < n; i++)
+	{
+		unsigned long b = le32(buf + 4 * i);
+
+		if (depth == 1)
+			map_add((*lblk)++, b);
+		else
+			map_ind(b, depth - 1, lblk);
+	}
+
+	free(buf);
+}
+
+static void
+map_extents(const unsigned char *node)
+{
+	unsigned int entries = le16(node + 2);
+	unsigned int depth = le16(node + 6);
+	unsigned int i;
+
+	if (le16(node) != EXT4_EXT_MAGIC)
+		die("bad extent header");
+
+	for (i = 0; i < entries; i++)
+	{
+		const unsigned char *e = node + 12 + 12 * i;
+
+		if (depth)
+		{
+			unsigned char *buf = malloc(bsize);
+			unsigned long long leaf;
+
+			if (!buf)
+				die("out of memory");
+
+			leaf = le32(e + 4) | ((unsigned long long) le16(e + 8) << 32);
+			rd(leaf * bsize, buf, bsize);
+			map_extents(buf);
+			free(buf);
+		}
+		else
+		{
+			unsigned long lblk = le32(e);
+			unsigned int len = le16(e + 4);
+			unsigned long long start = le32(e + 8) | ((unsigned long long) le16(e + 6) << 32);
+			unsigned int k;
+
+			/* uninitialized extent */
+			if (len > 32768)
+				len -= 32768;
+
+			for (k = 0; k < len; k++)
+				map_add(lblk + k, start + k);
+		}
+	}
+}
+
+static long
+replay_read(struct jbd_replay *r, __u32 log, char *buf)
+{
+	if (log >= maplen || !map[log])
+		return EBADARG;
+
+	rd((unsigned long long) map[log] * bsize, buf, bsize);
+	return E_OK;
+}
+
+static long
+replay_write(struct jbd_replay *r, __u32 block, char *data)
+{
+	if (verbose)
+		printf("block %lu\n", (unsigned long) block);
+
+	if (!dry_run)
+		wr((unsigned long long) block * bsize, data, bsize);
+
+	return E_OK;
+}
+
+int
+main(int argc, char **argv)
+{
+	unsigned char sb[1024];
+	unsigned char *gd, *ino;
+	unsigned long inum, ipg, isize, group, index, desc_size, first_data;
+	unsigned long long itable;
+	struct jbd_replay r;
+	struct jbd_sb *jsb;
+	char *jbuf;
+	long err;
+	int i;
+
+	for (i = 1; i < argc && argv[i][0] == '-'; i++)
+	{
+		if (!strcmp(argv[i], "-n"))
+			dry_run = 1;
+		else if (!strcmp(argv[i], "-v"))
+			verbose = 1;
+		else
+			break;
+	}
+
+	if (i != argc - 1)
+	{
+		fprintf(stderr, "usage: jbdcheck [-n] [-v] image\n");
+		return 2;
+	}
+
+	fd = open(argv[i], dry_run ? O_RDONLY : O_RDWR);
+	if (fd < 0)
+	{
+		perror(argv[i]);
+		return 2;
+	}
+
+	/* file system superblock */
+	rd(1024, sb, sizeof(sb));
+	if (le16(sb + 56) != 0xef53)
+		die("not an ext2 file system");
+
+	if (!(le32(sb + 92) & EXT3_FEATURE_COMPAT_HAS_JOURNAL))
+		die("no journal");
+
+	inum = le32(sb + 224);
+	if (!inum || le32(sb + 228))
+		die("external journals are not supported");
+
+	bsize = 1024UL << le32(sb + 24);
+	first_data = le32(sb + 20);
+	ipg = le32(sb + 40);
+	isize = le32(sb + 76) ? le16(sb + 88) : 128;
+	desc_size = (le32(sb + 96) & EXT4_FEATURE_INCOMPAT_64BIT) ? le16(sb + 254) : 32;
+	if (desc_size < 32)
+		desc_size = 32;
+
+	/* journal inode */
+	group = (inum - 1) / ipg;
+	index = (inum - 1) % ipg;
+
+	gd = malloc(desc_size);
+	ino = malloc(isize);
+	jbuf = malloc(3 * bsize);
+	if (!gd || !ino || !jbuf)
+		die("out of memory");
+
+	rd((unsigned long long) (first_data + 1) * bsize + group * desc_size, gd, desc_size);
+	itable = le32(gd + 8);
+	if (desc_size >= 64)
+		itable |= (unsigned long long) le32(gd + 0x28) << 32;
+
+	rd(itable * bsize + index * isize, ino, isize);
+
+	maplen = le32(ino + 4) / bsize;
+	map = calloc(maplen ? maplen : 1, sizeof(*map));
+	if (!map)
+		die("out of memory");
+
+	if (le32(ino + 32) & EXT4_EXTENTS_FL)
+	{
+		map_extents(ino + 40);
+	}
+	else
+	{
+		unsigned long lblk = 12;
+
+		for (index = 0; index < 12; index++)
+			map_add(index, le32(ino + 40 + 4 * index));
+
+		map_ind(le32(ino + 40 + 48), 1, &lblk);
+		map_ind(le32(ino + 40 + 52), 2, &lblk);
+		map_ind(le32(ino + 40 + 56), 3, &lblk);
+	}
+
+	/* journal superblock */
+	r.sb = jbuf;
+	r.buf = jbuf + bsize;
+	r.data = jbuf + 2 * bsize;
+	r.bsize = bsize;
+	r.read = replay_read;
+	r.write = replay_write;
+	r.arg = NULL;
+
+	if (replay_read(&r, 0, r.sb))
+		die("journal inode has no superblock");
+
+	jsb = (struct jbd_sb *) r.sb;
+	if (be2cpu32(jsb->s_header.h_magic) != JBD_MAGIC
+		|| be2cpu32(jsb->s_blocksize) != bsize
+		|| be2cpu32(jsb->s_maxlen) > maplen)
+	{
+		die("invalid journal superblock");
+	}
+
+	r.first = be2cpu32(jsb->s_first);
+	r.maxlen = be2cpu32(jsb->s_maxlen);
+
+	if (!jsb->s_start)
+	{
+		printf("journal is empty, sequence %lu\n", (unsigned long) be2cpu32(jsb->s_sequence));
+		return 0;
+	}
+
+	err = jbd_recover(&r);
+	if (err)
+	{
+		fprintf(stderr, "jbdcheck: replay failed (%ld)\n", err);
+		return 1;
+	}
+
+	printf("transactions %lu-%lu, %ld blocks replayed\n",
+		(unsigned long) be2cpu32(jsb->s_sequence), (unsigned long) r.end_tid - 1, r.replayed);
+
+	if (!dry_run)
+	{
+		/* the log is empty now, see journal_recover() */
+		jsb->s_start = 0;
+		jsb->s_sequence = cpu2be32(r.end_tid + 1);
+		jbd_sb_csum(r.sb);
+		wr((unsigned long long) map[0] * bsize, r.sb, bsize);
+
+		put_le32(sb + 96, le32(sb + 96) & ~EXT3_FEATURE_INCOMPAT_RECOVER);
+		if (le32(sb + 100) & EXT4_FEATURE_RO_COMPAT_METADATA_CSUM)
+			put_le32(sb + 1020, jbd_crc32c(0xffffffffUL, sb, 1020));
+		wr(1024, sb, sizeof(sb));
+	}
+
+	close(fd);
+	return 0;
+}
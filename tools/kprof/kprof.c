@@ -0,0 +1,288 @@
+/*
+ * kprof.c: flat profile from the kernel profiler output
+ *
+ * Resolves the "pc" lines of /kern/kprof (or a copy of it) against the
+ * symbols of the kernel and prints the functions sorted by the number
+ * of samples, followed by the system calls.  The symbols are read from
+ * the linker map the kernel build writes (map.txt) or from the output
+ * of nm; in the latter case the addresses are taken as offsets from
+ * the start of the text segment, as they are for a TOS executable.
+ *
+ * usage: kprof [-n lines] map|nm-output [profile]
+ *
+ *	-n	print only the first lines functions
+ *
+ * The profile is read from stdin if not given.  Sampling is switched
+ * on with "sysctl -w kern.profile=1"; see sys/kprof.c for the format.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+struct sym
+{
+	unsigned long addr;
+	char *name;
+	unsigned long count;
+};
+
+struct call
+{
+	char trap[8];
+	unsigned long nr;
+	unsigned long count;
+};
+
+static struct sym *syms;
+static long nsyms, maxsyms;
+
+static void
+die(const char *msg)
+{
+	fprintf(stderr, "kprof: %s\n", msg);
+	exit(2);
+}
+
+static void
+add_sym(unsigned long addr, const char *name)
+{
+	if (nsyms == maxsyms)
+	{
+		maxsyms = maxsyms ? 2 * maxsyms : 1024;
+		syms = realloc(syms, maxsyms * sizeof(*syms));
+		if (!syms)
+			die("out of memory");
+	}
+
+	syms[nsyms].addr = addr;
+	syms[nsyms].name = strdup(name);
+	syms[nsyms].count = 0;
+	if (!syms[nsyms].name)
+		die("out of memory");
+
+	nsyms++;
+}
+
+/*
+ * Symbols of the .text output section of a GNU ld map, e.g.
+ *
+ *	.text           0x00000000    0x5a3c4
+ *	 .text          0x00000000     0x1f0 main.o
+ *	                0x00000000                _main
+ *
+ * or lines "00000000 T _main" from nm; returns the text start.
+ */
+static unsigned long
+read_syms(FILE *f)
+{
+	char line[1024], name[512], type;
+	unsigned long addr, text = 0;
+	int in_text = 0;
+
+	while (fgets(line, sizeof(line), f))
+	{
+		size_t n = strspn(line, "0123456789abcdefABCDEF");
+
+		if (line[0] == '.')
+		{
+			in_text = (sscanf(line, ".text %lx", &addr) == 1);
+			if (in_text)
+				text = addr;
+
+			continue;
+		}
+
+		if (n >= 8 && line[n] == ' ')
+		{
+			/* nm */
+			if (sscanf(line, "%lx %c %511s", &addr, &type, name) == 3
+			    && (type == 't' || type == 'T'))
+				add_sym(addr, name);
+
+			continue;
+		}
+
+		if (in_text && isspace((unsigned char) line[0])
+		    && sscanf(line, " 0x%lx %511s", &addr, name) == 2
+		    && !strchr(line, '=') && !strstr(line, "PROVIDE")
+		    && sscanf(line, " 0x%*x %*s %c", &type) != 1)
+			add_sym(addr, name);
+	}
+
+	return text;
+}
+
+static int
+by_addr(const void *a, const void *b)
+{
+	const struct sym *x = a, *y = b;
+
+	return (x->addr > y->addr) - (x->addr < y->addr);
+}
+
+static int
+by_count(const void *a, const void *b)
+{
+	const struct sym *x = a, *y = b;
+
+	return (x->count < y->count) - (x->count > y->count);
+}
+
+static int
+call_by_count(const void *a, const void *b)
+{
+	const struct call *x = a, *y = b;
+
+	return (x->count < y->count) - (x->count > y->count);
+}
+
+/* last symbol at or below addr */
+static struct sym *
+lookup(unsigned long addr)
+{
+	long lo = 0, hi = nsyms - 1;
+
+	if (!nsyms || addr < syms[0].addr)
+		return NULL;
+
+	while (lo < hi)
+	{
+		long mid = (lo + hi + 1) / 2;
+
+		if (syms[mid].addr <= addr)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+
+	return &syms[lo];
+}
+
+int
+main(int argc, char **argv)
+{
+	unsigned long text, base = 0, len = 0, off, count;
+	unsigned long samples = 0, kernel = 0, user = 0, other = 0, unknown = 0;
+	struct call *calls = NULL;
+	long ncalls = 0, maxcalls = 0, lines = -1, i;
+	char line[256], trap[8];
+	FILE *f, *p;
+	int shift = 0;
+
+	for (i = 1; i < argc && argv[i][0] == '-' && argv[i][1]; i++)
+	{
+		if (!strcmp(argv[i], "-n") && i + 1 < argc)
+			lines = atol(argv[++i]);
+		else
+			break;
+	}
+
+	if (i >= argc || argc - i > 2)
+	{
+		fprintf(stderr, "usage: kprof [-n lines] map|nm-output [profile]\n");
+		return 2;
+	}
+
+	f = fopen(argv[i], "r");
+	if (!f)
+	{
+		perror(argv[i]);
+		return 2;
+	}
+
+	p = stdin;
+	if (i + 1 < argc)
+	{
+		p = fopen(argv[i + 1], "r");
+		if (!p)
+		{
+			perror(argv[i + 1]);
+			return 2;
+		}
+	}
+
+	text = read_syms(f);
+	fclose(f);
+
+	if (!nsyms)
+		die("no text symbols found");
+
+	/* offsets from the text start, like the pc lines */
+	for (i = 0; i < nsyms; i++)
+		syms[i].addr -= text;
+
+	qsort(syms, nsyms, sizeof(*syms), by_addr);
+
+	while (fgets(line, sizeof(line), p))
+	{
+		if (sscanf(line, "# kprof hz %*d text %lx %lx shift %d", &base, &len, &shift) == 3)
+			continue;
+
+		if (sscanf(line, "# samples %lu kernel %lu user %lu other %lu",
+			   &samples, &kernel, &user, &other) == 4)
+			continue;
+
+		if (sscanf(line, "pc %lx %lu", &off, &count) == 2)
+		{
+			struct sym *s = lookup(off);
+
+			if (s)
+				s->count += count;
+			else
+				unknown += count;
+
+			continue;
+		}
+
+		if (sscanf(line, "sys %7s %lx %lu", trap, &off, &count) == 3)
+		{
+			if (ncalls == maxcalls)
+			{
+				maxcalls = maxcalls ? 2 * maxcalls : 64;
+				calls = realloc(calls, maxcalls * sizeof(*calls));
+				if (!calls)
+					die("out of memory");
+			}
+
+			strcpy(calls[ncalls].trap, trap);
+			calls[ncalls].nr = off;
+			calls[ncalls].count = count;
+			ncalls++;
+		}
+	}
+
+	if (p != stdin)
+		fclose(p);
+
+	if (!shift)
+		die("not a kprof profile");
+
+	printf("# %lu samples: kernel %lu, user %lu, other %lu\n", samples, kernel, user, other);
+	printf("# text 0x%08lx, 0x%lx bytes, resolution %d bytes\n", base, len, 1 << shift);
+
+	qsort(syms, nsyms, sizeof(*syms), by_count);
+
+	printf("\n%8s %6s  %s\n", "samples", "%", "function");
+	for (i = 0; i < nsyms && syms[i].count && i != lines; i++)
+		printf("%8lu %6.2f  %s\n", syms[i].count,
+		       kernel ? 100.0 * syms[i].count / kernel : 0.0, syms[i].name);
+
+	if (unknown)
+		printf("%8lu %6.2f  (before the first symbol)\n", unknown,
+		       kernel ? 100.0 * unknown / kernel : 0.0);
+
+	if (ncalls)
+	{
+		qsort(calls, ncalls, sizeof(*calls), call_by_count);
+
+		printf("\n%8s %6s  %s\n", "samples", "%", "system call");
+		for (i = 0; i < ncalls; i++)
+			printf("%8lu %6.2f  %s 0x%03lx\n", calls[i].count,
+			       samples ? 100.0 * calls[i].count / samples : 0.0,
+			       calls[i].trap, calls[i].nr);
+	}
+
+	return 0;
+}
@@ -0,0 +1,127 @@
+/*
+ * ktrace.c: print the kernel event trace buffer
+ *
+ * Reads /kern/ktrace (or a copy of it given as argument) and prints one
+ * line per event.  The data is decoded byte by byte, so this also works
+ * on a host with a different byte order; see sys/mint/ktrace.h for the
+ * format.
+ *
+ * Tracing is switched on with e.g. "sysctl -w kern.trace=7".
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KTRACE_MAGIC	0x4b545243L
+#define KTRACE_VERSION	1
+
+#define HEADER_SIZE	16
+#define EVENT_SIZE	20
+
+static const char *traps[] = { "gemdos", "bios", "xbios" };
+static const char *queues[] = { "run", "ready", "wait", "iowait", "zombie", "tsr", "stop", "select" };
+
+static unsigned long
+get32(const unsigned char *p)
+{
+	return ((unsigned long) p[0] << 24) | ((unsigned long) p[1] << 16)
+		| ((unsigned long) p[2] << 8) | p[3];
+}
+
+static long
+get32s(const unsigned char *p)
+{
+	unsigned long v = get32(p);
+
+	return (v & 0x80000000UL) ? -(long) (~v + 1) : (long) v;
+}
+
+static int
+get16s(const unsigned char *p)
+{
+	unsigned int v = (p[0] << 8) | p[1];
+
+	return (v & 0x8000) ? (int) v - 0x10000 : (int) v;
+}
+
+static const char *
+trap(int i)
+{
+	return (i >= 0 && i < 3) ? traps[i] : "?";
+}
+
+static const char *
+queue(long q)
+{
+	return (q >= 0 && q < 8) ? queues[q] : "?";
+}
+
+int
+main(int argc, char **argv)
+{
+	const char *name = argc > 1 ? argv[1] : "/kern/ktrace";
+	unsigned char h[HEADER_SIZE], e[EVENT_SIZE];
+	unsigned long nevents, i;
+	int hz;
+	FILE *f;
+
+	f = fopen(name, "rb");
+	if (!f)
+	{
+		perror(name);
+		return 1;
+	}
+
+	if (fread(h, HEADER_SIZE, 1, f) != 1
+	    || get32(h) != KTRACE_MAGIC || get16s(h + 4) != KTRACE_VERSION)
+	{
+		fprintf(stderr, "ktrace: %s: not a version %d trace\n", name, KTRACE_VERSION);
+		return 1;
+	}
+
+	hz = get16s(h + 6);
+	nevents = get32(h + 8);
+
+	printf("# %lu events, %lu lost\n", nevents, get32(h + 12));
+
+	for (i = 0; i < nevents && fread(e, EVENT_SIZE, 1, f) == 1; i++)
+	{
+		unsigned long t = get32(e);
+		int pid = get16s(e + 4);
+		int type = e[6], arg = e[7];
+		long a = get32s(e + 8), b = get32s(e + 12), c = get32s(e + 16);
+
+		printf("%7lu.%03lu %5d ", t / hz, (t % hz) * 1000 / hz, pid);
+
+		switch (type)
+		{
+			case 1:
+				printf("enter  %s 0x%03lx\n", trap(arg), a);
+				break;
+			case 2:
+				printf("exit   %s 0x%03lx = %ld (%ld ms)\n", trap(arg), a, b, c * 1000 / hz);
+				break;
+			case 3:
+				printf("switch -> %ld (%s)\n", a, queue(arg));
+				break;
+			case 4:
+				printf("sleep  %s 0x%08lx\n", queue(a), b);
+				break;
+			case 5:
+				printf("wake   %ld %s 0x%08lx\n", c, queue(a), b);
+				break;
+			case 6:
+				printf("%s  %c: sector %lu, %ld bytes (%ld ms)\n",
+				       (arg & 1) ? "write" : "read ", 'A' + (arg >> 1),
+				       (unsigned long) a, b, c * 1000 / hz);
+				break;
+			default:
+				printf("type %d arg %d %ld %ld %ld\n", type, arg, a, b, c);
+				break;
+		}
+	}
+
+	fclose(f);
+	return 0;
+}
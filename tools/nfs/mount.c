@@ -124,6 +124,18 @@ parse_option (char *s)
 			strcat (optionstr, "retrans=");
 			_ltoa (retrans, &optionstr[strlen (optionstr)], 10);
 		}
+		else if (!strncmp (s, "nfsvers=", 8))
+		{
+			nfsvers = strtol (&s[8], &p, 10);
+			strcat (optionstr, "vers=");
+			_ltoa (nfsvers, &optionstr[strlen (optionstr)], 10);
+		}
+		else if (!strncmp (s, "vers=", 5))
+		{
+			nfsvers = strtol (&s[5], &p, 10);
+			strcat (optionstr, "vers=");
+			_ltoa (nfsvers, &optionstr[strlen (optionstr)], 10);
+		}
 		else if (!strncmp (s, "port=", 5))
 		{
 			port = strtol (&s[5], &p, 10);
@@ -132,18 +144,27 @@ parse_option (char *s)
 		}
 		else if (!strncmp (s, "acregmin=", 9))
 		{
-			/* not supported yet */
-			strtol (&s[9], &p, 10);
+			acregmin = strtol (&s[9], &p, 10);
+			strcat (optionstr, "acregmin=");
+			_ltoa (acregmin, &optionstr[strlen (optionstr)], 10);
 		}
 		else if (!strncmp (s, "acregmax=", 9))
 		{
-			/* not supported yet */
-			strtol (&s[9], &p, 10);
+			acregmax = strtol (&s[9], &p, 10);
+			strcat (optionstr, "acregmax=");
+			_ltoa (acregmax, &optionstr[strlen (optionstr)], 10);
 		}
 		else if (!strncmp (s, "acdirmin=", 9))
 		{
-			/* not supported yet */
-			strtol (&s[9], &p, 10);
+			acdirmin = strtol (&s[9], &p, 10);
+			strcat (optionstr, "acdirmin=");
+			_ltoa (acdirmin, &optionstr[strlen (optionstr)], 10);
+		}
+		else if (!strncmp (s, "acdirmax=", 9))
+		{
+			acdirmax = strtol (&s[9], &p, 10);
+			strcat (optionstr, "acdirmax=");
+			_ltoa (acdirmax, &optionstr[strlen (optionstr)], 10);
 		}
 		else if (!strncmp (s, "actimeo=", 8))
 		{
@@ -64,6 +64,40 @@ xdr_size_fhstatus (fhstatus *fhsp)
 }
 
 
+bool_t
+xdr_mountres3 (XDR *x, mountres3 *mrp)
+{
+	char *data = mrp->fhandle.data;
+	u_int len;
+	u_long n, flavor;
+	
+	if (!xdr_u_long (x, &mrp->status))
+		return FALSE;
+	
+	if (0 != mrp->status)
+		return TRUE;
+	
+	if (!xdr_bytes (x, &data, &len, FHSIZE3))
+		return FALSE;
+	
+	mrp->fhandle.len = len;
+	
+	/* the list of auth flavors the server accepts; we only
+	 * speak AUTH_UNIX anyway
+	 */
+	if (!xdr_u_long (x, &n))
+		return FALSE;
+	
+	while (n--)
+	{
+		if (!xdr_u_long (x, &flavor))
+			return FALSE;
+	}
+	
+	return TRUE;
+}
+
+
 bool_t
 xdr_mountlist (XDR *x, mountlist *mlp)
 {
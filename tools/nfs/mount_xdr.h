@@ -29,12 +29,14 @@
 
 #define MOUNT_PROGRAM   100005
 #define MOUNT_VERSION   1
+#define MOUNT_V3        3	/* hands out NFS version 3 handles */
 #define MOUNT_MAXPROC   5
 
 
 #define MNTPATHLEN   1024
 #define MNTNAMLEN     255
 #define MNTFHSIZE      32
+#define FHSIZE3        64
 
 
 bool_t xdr_dirpath (XDR *x, char *s);
@@ -63,6 +65,22 @@ bool_t xdr_fhstatus (XDR *x, fhstatus *fhsp);
 long xdr_size_fhstatus (fhstatus *fhsp);
 
 
+/* same layout as nfs_fh3 in the kernel */
+typedef struct fhandle3
+{
+	u_long len;
+	char data[FHSIZE3];
+} fhandle3;
+
+typedef struct mountres3
+{
+	u_long status;
+	fhandle3 fhandle;   /* if status == 0; the auth flavors are skipped */
+} mountres3;
+
+bool_t xdr_mountres3 (XDR *x, mountres3 *mrp);
+
+
 typedef struct mountlist
 {
 	char *ml_hostname;
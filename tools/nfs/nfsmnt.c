@@ -38,8 +38,13 @@ long wsize = 0;
 long timeo = 0;
 long retrans = 0;
 long actimeo = 0;
+long acregmin = 0;
+long acregmax = 0;
+long acdirmin = 0;
+long acdirmax = 0;
 
 int port = 0; /* use the default port as default */
+long nfsvers = 0; /* try version 3 first, then version 2 */
 
 int soft = 0;
 int intr = 0;
@@ -63,7 +68,7 @@ int nosuid = 0;
 
 
 #define MOUNT_PORT  2050
-#define NFS_MOUNT_VERS 1
+#define NFS_MOUNT_VERS 3
 
 
 typedef struct myxattr MYXATTR;
@@ -105,6 +110,16 @@ typedef struct
 
 	struct sockaddr_in server;
 	char hostname[256];
+
+	/* since version 2 of this structure */
+	long	nfsvers;	/* NFS protocol version, 2 or 3 */
+	fhandle3 fh3;		/* initial file handle for version 3 */
+
+	/* since version 3 of this structure */
+	long	acregmin;
+	long	acregmax;
+	long	acdirmin;
+	long	acdirmax;
 } NFS_MOUNT_INFO;
 
 
@@ -151,6 +166,41 @@ make_socket (long maxmsgsize)
 
 #pragma GCC diagnostic ignored "-Wcast-qual"
 
+/* ask the version 3 mount daemon for a handle */
+static long
+mount_v3 (struct sockaddr_in *server, const char *remote, fhandle3 *fh, int *s)
+{
+	struct timeval retry_time = { 1, 0 };  /* every second */
+	struct timeval total_time = { 5, 0 };  /* total timeout */
+	enum clnt_stat res;
+	mountres3 mr;
+	CLIENT *cl;
+	
+	server->sin_port = htons (0);  /* ask the port mapper for that port */
+	
+	cl = clntudp_create (server, MOUNT_PROGRAM, MOUNT_V3, retry_time, s);
+	if (!cl)
+		return 1;
+	
+	res = clnt_call (cl, MOUNTPROC_MNT,
+	                (xdrproc_t) xdr_dirpath, (void *)remote,
+	                (xdrproc_t) xdr_mountres3, (void *)&mr, total_time);
+	
+	clnt_destroy (cl);
+	
+	if (res != RPC_SUCCESS)
+		return res;
+	
+	if (mr.status != 0)
+	{
+		fprintf (stderr, "do_nfs_mount: version 3 mount request failed with %ld\n", mr.status);
+		return -1;
+	}
+	
+	*fh = mr.fhandle;
+	return 0;
+}
+
 long
 do_nfs_mount (const char *remote, const char *localdir)
 {
@@ -204,6 +254,10 @@ do_nfs_mount (const char *remote, const char *localdir)
 	info.rsize = rsize;
 	info.wsize = wsize;
 	info.actimeo = actimeo * CLOCKS_PER_SEC/10;
+	info.acregmin = acregmin * CLOCKS_PER_SEC;
+	info.acregmax = acregmax * CLOCKS_PER_SEC;
+	info.acdirmin = acdirmin * CLOCKS_PER_SEC;
+	info.acdirmax = acdirmax * CLOCKS_PER_SEC;
 	strncpy (info.hostname, hostname, sizeof (info.hostname) - 1);
 	info.hostname[sizeof(info.hostname)-1] = '\0';
 	
@@ -227,45 +281,62 @@ do_nfs_mount (const char *remote, const char *localdir)
 	
 	server.sin_family = AF_INET;
 	memcpy ((char*) &server.sin_addr, hp->h_addr, hp->h_length);
-	server.sin_port = htons (0);  /* ask the port mapper for that port */
 	
-	cl = clntudp_create (&server, MOUNT_PROGRAM, MOUNT_VERSION, retry_time, &s);
-	if (!cl)
+	info.nfsvers = 2;
+	if (nfsvers != 2)
 	{
-		/* also try a fallback method with a fixed port number */
-		server.sin_port = htons(MOUNT_PORT);
-		cl = clntudp_create (&server, MOUNT_PROGRAM, MOUNT_VERSION, retry_time, &s);
-		if (!cl)
+		if (mount_v3 (&server, remote, &info.fh3, &s) == 0)
+			info.nfsvers = 3;
+		else if (nfsvers == 3)
 		{
-			fprintf (stderr, "do_nfs_mount: failed to create RPC client\n");
+			fprintf (stderr, "do_nfs_mount: server does not offer NFS version 3\n");
 			return 1;
 		}
 	}
 	
-	res = clnt_call (cl, MOUNTPROC_MNT,
-	                (xdrproc_t) xdr_dirpath, (void *)remote,
-	                (xdrproc_t) xdr_fhstatus, (void *)&fh, total_time);
-	
-	if (res != RPC_SUCCESS)
+	if (info.nfsvers == 2)
 	{
-		clnt_perror (cl, "do_nfs_mount");
+		server.sin_port = htons (0);  /* ask the port mapper for that port */
+		
+		cl = clntudp_create (&server, MOUNT_PROGRAM, MOUNT_VERSION, retry_time, &s);
+		if (!cl)
+		{
+			/* also try a fallback method with a fixed port number */
+			server.sin_port = htons(MOUNT_PORT);
+			cl = clntudp_create (&server, MOUNT_PROGRAM, MOUNT_VERSION, retry_time, &s);
+			if (!cl)
+			{
+				fprintf (stderr, "do_nfs_mount: failed to create RPC client\n");
+				return 1;
+			}
+		}
+		
+		res = clnt_call (cl, MOUNTPROC_MNT,
+		                (xdrproc_t) xdr_dirpath, (void *)remote,
+		                (xdrproc_t) xdr_fhstatus, (void *)&fh, total_time);
+		
+		if (res != RPC_SUCCESS)
+		{
+			clnt_perror (cl, "do_nfs_mount");
+			clnt_destroy (cl);
+			
+			return res;
+		}
+		
 		clnt_destroy (cl);
 		
-		return res;
-	}
-	
-	clnt_destroy (cl);
-	
-	if (fh.status != 0)
-	{
-		fprintf (stderr, "do_nfs_mount: mount request failed with %ld\n", fh.status);
-		return -1;
+		if (fh.status != 0)
+		{
+			fprintf (stderr, "do_nfs_mount: mount request failed with %ld\n", fh.status);
+			return -1;
+		}
+		
+		info.handle = fh.fhstatus_u.directory;
 	}
 	
 	info.server.sin_family = AF_INET;
 	memcpy ((char*) &info.server.sin_addr, hp->h_addr, hp->h_length);
 	info.server.sin_port = htons (port);
-	info.handle = fh.fhstatus_u.directory;
 	
 	r = Dcntl (NFS_MOUNT, mountname, &info);
 	if (r != 0)
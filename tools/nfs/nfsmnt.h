@@ -23,10 +23,15 @@ extern long wsize;
 extern long timeo;
 extern long retrans;
 extern int port;
+extern long nfsvers;
 extern int soft;
 extern int intr;
 extern int secure;
 extern long actimeo;
+extern long acregmin;
+extern long acregmax;
+extern long acdirmin;
+extern long acdirmax;
 extern int noac;
 
 